@@ -223,7 +223,7 @@ int MAIN (int argc, char *argv[])
         if(verbosity>=1)
             std::cout<<"# Argument\n"<<argument->stream().format(outmode);
 
-        pvac::ClientProvider prov(defaultProvider);
+        pvac::ClientProvider prov(defaultProvider, shortLivedConfig());
 
         pvac::ClientChannel chan(prov.connect(pv));
 
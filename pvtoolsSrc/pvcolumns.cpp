@@ -0,0 +1,252 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+#include <string.h>
+
+#include <epicsEndian.h>
+#include <epicsGuard.h>
+
+#include "pvcolumns.h"
+
+typedef epicsGuard<epicsMutex> Guard;
+
+namespace {
+
+const char magic[8] = {'P', 'V', 'A', 'C', 'O', 'L', 0, 1};
+
+void putBytes(std::vector<char>& out, const void *data, size_t len)
+{
+    const char *bytes = static_cast<const char*>(data);
+    out.insert(out.end(), bytes, bytes+len);
+}
+
+void pad8(std::vector<char>& out)
+{
+    out.resize((out.size()+7u)&~size_t(7u), '\0');
+}
+
+template<typename T>
+void put(std::vector<char>& out, T val)
+{
+    putBytes(out, &val, sizeof(val));
+}
+
+size_t elementSize(pvd::ScalarType type)
+{
+    switch(type) {
+    case pvd::pvBoolean:
+    case pvd::pvByte:
+    case pvd::pvUByte:  return 1u;
+    case pvd::pvShort:
+    case pvd::pvUShort: return 2u;
+    case pvd::pvInt:
+    case pvd::pvUInt:
+    case pvd::pvFloat:  return 4u;
+    case pvd::pvLong:
+    case pvd::pvULong:
+    case pvd::pvDouble: return 8u;
+    case pvd::pvString: break;
+    }
+    return 0u;
+}
+
+} // namespace
+
+void ColumnWriter::Column::reset()
+{
+    data.clear();
+    offsets.clear();
+    stroffsets.clear();
+    offsets.push_back(0u);
+    stroffsets.push_back(0u);
+}
+
+ColumnWriter::ColumnWriter(std::ostream& strm, size_t maxrows)
+    :strm(strm)
+    ,maxrows(maxrows ? maxrows : 1u)
+{
+    std::vector<char> header;
+    putBytes(header, magic, sizeof(magic));
+    header.push_back(EPICS_BYTE_ORDER==EPICS_ENDIAN_BIG ? 1 : 0);
+    pad8(header);
+    strm.write(&header[0], header.size());
+}
+
+ColumnWriter::~ColumnWriter()
+{
+    flush();
+}
+
+void ColumnWriter::columns(Channel& chan, const pvd::PVStructure& fld, const std::string& prefix)
+{
+    const pvd::PVFieldPtrArray& children = fld.getPVFields();
+    const pvd::StringArray& names = fld.getStructure()->getFieldNames();
+
+    for(size_t i=0, N=children.size(); i<N; i++) {
+        const pvd::PVField& child = *children[i];
+        std::string name(prefix.empty() ? names[i] : prefix+"."+names[i]);
+
+        switch(child.getField()->getType()) {
+        case pvd::structure:
+            columns(chan, static_cast<const pvd::PVStructure&>(child), name);
+            break;
+        case pvd::scalar:
+        case pvd::scalarArray: {
+            chan.columns.push_back(Column());
+            Column& col = chan.columns.back();
+            col.name = name;
+            col.offset = child.getFieldOffset();
+            col.array = child.getField()->getType()==pvd::scalarArray;
+            col.type = col.array
+                    ? static_cast<const pvd::ScalarArray*>(child.getField().get())->getElementType()
+                    : static_cast<const pvd::Scalar*>(child.getField().get())->getScalarType();
+            col.reset();
+        }
+            break;
+        default:
+            break; // not representable as a column
+        }
+    }
+}
+
+void ColumnWriter::append(const std::string& name, const pvd::PVStructure& root)
+{
+    Guard G(mutex);
+
+    std::pair<channels_t::iterator, bool> ins(channels.insert(std::make_pair(name, Channel())));
+    Channel& chan = ins.first->second;
+
+    if(ins.second) {
+        chan.index = pvd::uint32(channels.size()-1u);
+        chan.rows = 0u;
+    }
+
+    if(chan.type!=root.getStructure()) {
+        // new PV, or type changed on reconnect
+        if(chan.rows)
+            writeBatch(chan);
+        chan.type = root.getStructure();
+        chan.columns.clear();
+        columns(chan, root, std::string());
+        writeSchema(name, chan);
+    }
+
+    for(size_t c=0, C=chan.columns.size(); c<C; c++) {
+        Column& col = chan.columns[c];
+        pvd::PVFieldPtr fld(root.getSubField(col.offset));
+
+        if(!col.array) {
+            const pvd::PVScalar& sfld = static_cast<const pvd::PVScalar&>(*fld);
+            if(col.type==pvd::pvString) {
+                std::string val(sfld.getAs<std::string>());
+                putBytes(col.data, val.c_str(), val.size());
+                col.offsets.push_back(col.data.size());
+            } else {
+                switch(col.type) {
+#define CASE(TYPE, PVT) case pvd::PVT: put<pvd::TYPE>(col.data, sfld.getAs<pvd::TYPE>()); break
+                CASE(boolean, pvBoolean);
+                CASE(int8, pvByte);
+                CASE(int16, pvShort);
+                CASE(int32, pvInt);
+                CASE(int64, pvLong);
+                CASE(uint8, pvUByte);
+                CASE(uint16, pvUShort);
+                CASE(uint32, pvUInt);
+                CASE(uint64, pvULong);
+                CASE(float, pvFloat);
+                CASE(double, pvDouble);
+#undef CASE
+                case pvd::pvString:
+                    break;
+                }
+            }
+
+        } else if(col.type==pvd::pvString) {
+            pvd::PVStringArray::const_svector arr(static_cast<const pvd::PVStringArray&>(*fld).view());
+            for(size_t i=0; i<arr.size(); i++) {
+                putBytes(col.data, arr[i].c_str(), arr[i].size());
+                col.stroffsets.push_back(col.data.size());
+            }
+            col.offsets.push_back(col.stroffsets.size()-1u);
+
+        } else {
+            pvd::shared_vector<const void> arr;
+            static_cast<const pvd::PVScalarArray&>(*fld).getAs(arr);
+            // void vector size is in bytes
+            putBytes(col.data, arr.data(), arr.size());
+            col.offsets.push_back(col.offsets.back() + arr.size()/elementSize(col.type));
+        }
+    }
+
+    if(++chan.rows>=maxrows)
+        writeBatch(chan);
+}
+
+void ColumnWriter::flush()
+{
+    Guard G(mutex);
+    // in order of first append(), not by name
+    std::vector<Channel*> byindex(channels.size());
+    for(channels_t::iterator it(channels.begin()), end(channels.end()); it!=end; ++it)
+        byindex[it->second.index] = &it->second;
+
+    for(size_t i=0; i<byindex.size(); i++) {
+        if(byindex[i]->rows)
+            writeBatch(*byindex[i]);
+    }
+    strm.flush();
+}
+
+void ColumnWriter::writeSchema(const std::string& name, const Channel& chan)
+{
+    std::vector<char> body;
+    put<pvd::uint32>(body, pvd::uint32(name.size()));
+    put<pvd::uint32>(body, pvd::uint32(chan.columns.size()));
+    putBytes(body, name.c_str(), name.size());
+    pad8(body);
+
+    for(size_t c=0; c<chan.columns.size(); c++) {
+        const Column& col = chan.columns[c];
+        put<pvd::uint32>(body, pvd::uint32(col.name.size()));
+        put<pvd::uint8>(body, pvd::uint8(col.type));
+        put<pvd::uint8>(body, col.array ? 1u : 0u);
+        put<pvd::uint16>(body, 0u);
+        putBytes(body, col.name.c_str(), col.name.size());
+        pad8(body);
+    }
+
+    write('S', chan.index, body);
+}
+
+void ColumnWriter::writeBatch(Channel& chan)
+{
+    std::vector<char> body;
+    put<pvd::uint64>(body, chan.rows);
+
+    for(size_t c=0; c<chan.columns.size(); c++) {
+        Column& col = chan.columns[c];
+        if(col.array || col.type==pvd::pvString) {
+            putBytes(body, &col.offsets[0], col.offsets.size()*sizeof(pvd::uint64));
+            if(col.array && col.type==pvd::pvString)
+                putBytes(body, &col.stroffsets[0], col.stroffsets.size()*sizeof(pvd::uint64));
+        }
+        if(!col.data.empty())
+            putBytes(body, &col.data[0], col.data.size());
+        pad8(body);
+        col.reset();
+    }
+    chan.rows = 0u;
+
+    write('B', chan.index, body);
+}
+
+void ColumnWriter::write(pvd::uint32 kind, pvd::uint32 index, std::vector<char>& body)
+{
+    std::vector<char> header;
+    put<pvd::uint32>(header, kind);
+    put<pvd::uint32>(header, index);
+    put<pvd::uint64>(header, body.size());
+    strm.write(&header[0], header.size());
+    strm.write(&body[0], body.size());
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+#ifndef PVCOLUMNS_H
+#define PVCOLUMNS_H
+
+#include <ostream>
+#include <vector>
+#include <map>
+#include <string>
+
+#include <epicsMutex.h>
+
+#include <pv/pvData.h>
+
+/* Binary columnar output of pvget/pvmonitor ('-M binary')
+ *
+ * A self-describing stream in host byte order, which may be mmap()'d or bulk loaded.
+ * Each record begins at, and each column is padded to, a multiple of 8 bytes.
+ *
+ *   header:  magic "PVACOL\0" followed by version byte 1,
+ *            u8 byte order (0 little, 1 big), 7 zero bytes
+ *   record:  u32 kind ('S' schema or 'B' batch), u32 channel index, u64 length of body, body
+ *
+ *   'S' body: u32 PV name length, u32 column count, PV name padded to 8,
+ *             then for each column: u32 name length, u8 pvd::ScalarType, u8 1 if array, u16 0,
+ *             column name padded to 8
+ *   'B' body: u64 row count, then each column of the latest 'S' with this channel index
+ *             scalar:       values[rows]
+ *             string:       u64 offsets[rows+1] into chars, chars
+ *             array:        u64 offsets[rows+1] into elements, elements
+ *             string array: u64 offsets[rows+1] into strings, u64 offsets[strings+1] into chars, chars
+ *             with each part padded to 8
+ *
+ * Columns are the scalar and scalar array fields of a structure,
+ * including those of sub-structures with names like "alarm.severity".
+ * Unions and structure arrays are omitted.
+ * A 'S' record for an index already seen replaces the schema (the PV type changed).
+ */
+class ColumnWriter {
+public:
+    explicit ColumnWriter(std::ostream& strm, size_t maxrows=1024u);
+    ~ColumnWriter();
+
+    // Add one row with the current values of all columns.
+    // Rows are written in batches of up to maxrows
+    void append(const std::string& name, const pvd::PVStructure& root);
+    // Write all pending rows
+    void flush();
+
+private:
+    struct Column {
+        std::string name;
+        size_t offset; // in PVStructure
+        pvd::ScalarType type;
+        bool array;
+        std::vector<char> data;
+        std::vector<pvd::uint64> offsets, stroffsets;
+        void reset();
+    };
+    struct Channel {
+        pvd::uint32 index;
+        pvd::StructureConstPtr type;
+        std::vector<Column> columns;
+        size_t rows;
+    };
+
+    void columns(Channel& chan, const pvd::PVStructure& fld, const std::string& prefix);
+    void writeSchema(const std::string& name, const Channel& chan);
+    void writeBatch(Channel& chan);
+    void write(pvd::uint32 kind, pvd::uint32 index, std::vector<char>& body);
+
+    std::ostream& strm;
+    const size_t maxrows;
+
+    epicsMutex mutex;
+    typedef std::map<std::string, Channel> channels_t;
+    channels_t channels;
+
+    EPICS_NOT_COPYABLE(ColumnWriter)
+};
+
+#endif /* PVCOLUMNS_H */
@@ -30,6 +30,7 @@
 #include <pva/client.h>
 
 #include "pvutils.h"
+#include "pvcolumns.h"
 
 #ifndef EXECNAME
 #  define EXECNAME "pvget"
@@ -41,6 +42,44 @@ size_t pvnamewidth;
 
 int haderror;
 
+// machine oriented output formats replace the text of outmode
+enum outformat_t {
+    Text,
+    NDJSON,
+    Binary
+} outformat = Text;
+bool flatten;
+ColumnWriter *colout;
+
+// '-M binary' get results, appended to colout in input order
+struct ColumnSink : public OrderedOutput::Sink
+{
+    std::vector<std::string> names;
+    std::vector<pvd::PVStructure::const_shared_pointer> values;
+
+    explicit ColumnSink(const std::vector<std::string>& names)
+        :names(names)
+        ,values(names.size())
+    {}
+    virtual ~ColumnSink() {}
+
+    virtual void emit(size_t index) OVERRIDE FINAL
+    {
+        if(values[index])
+            colout->append(names[index], *values[index]);
+        values[index].reset();
+    }
+};
+ColumnSink *colsink;
+
+void flushOutput()
+{
+    if(colout)
+        colout->flush();
+    else
+        std::cout.flush();
+}
+
 void usage (void)
 {
     fprintf (stderr, "\nUsage: " EXECNAME " [options] <PV name>...\n"
@@ -48,7 +87,14 @@ void usage (void)
              COMMON_OPTIONS
              " deprecated options:\n"
              "  -q, -t, -i, -n, -F: ignored\n"
-             "  -f <input file>:   errors\n"
+             " Many PVs:\n"
+             "  -f <input file>:   Read PV names from a file, one per line.  '-' reads stdin.\n"
+             "  -W <count>:        Get at most this many PVs concurrently.  default is no limit\n"
+             "  -S:                Print a summary of connect and get (or first update) times\n"
+             " Machine oriented output:\n"
+             "  -M ndjson:         One JSON object per line.  {\"name\":\"pv\",\"data\":{...}} or {\"name\":\"pv\",\"event\":\"...\"}\n"
+             "  -M binary:         Binary columnar stream.  Batches of rows with a schema per PV.  See pvcolumns.h\n"
+             "  -l:                With '-M ndjson', flatten sub-structures.  eg. {\"alarm.severity\":0}\n"
              " Output details:\n"
              "  -m -v:             Monitor in Raw mode.  Print only fields marked as changed.\n"
              "  -m -vv:            Monitor in Raw mode.  Highlight fields marked as changed, show all valid fields.\n"
@@ -63,9 +109,19 @@ struct Getter : public pvac::ClientChannel::GetCallback, public Tracker
 {
     POINTER_DEFINITIONS(Getter);
 
+    const size_t index; // in input order
+    OrderedOutput& output;
+    PhaseTimes& times;
+    const epicsTime started;
+
     pvac::Operation op;
 
-    Getter(pvac::ClientChannel& channel, const pvd::PVStructurePtr& pvRequest)
+    Getter(pvac::ClientChannel& channel, const pvd::PVStructurePtr& pvRequest,
+           size_t index, OrderedOutput& output, PhaseTimes& times)
+        :index(index)
+        ,output(output)
+        ,times(times)
+        ,started(epicsTime::getCurrent())
     {
         op = channel.get(this, pvRequest);
     }
@@ -73,28 +129,59 @@ struct Getter : public pvac::ClientChannel::GetCallback, public Tracker
 
     virtual void getDone(const pvac::GetEvent& event) OVERRIDE FINAL
     {
-        std::cout<<std::setw(pvnamewidth)<<std::left<<op.name()<<' ';
+        times.add(epicsTime::getCurrent() - started);
+
+        // printed in input order
+        std::ostringstream strm;
+
+        if(outformat!=Text) {
+            pvd::BitSet all;
+            all.set(0);
+            if(event.event==pvac::GetEvent::Fail) {
+                if(outformat==NDJSON)
+                    jevent(strm, op.name(), "error", event.message);
+                else
+                    std::cerr<<op.name()<<" Error "<<event.message<<"\n";
+                haderror = 1;
+            } else if(event.event==pvac::GetEvent::Success) {
+                if(outformat==NDJSON)
+                    jdata(strm, op.name(), *event.value, verbosity>=2 ? all : *event.valid, flatten);
+                else
+                    colsink->values[index] = event.value; // appended in input order
+            }
+            output.complete(index, strm.str());
+            done();
+            return;
+        }
+
         switch(event.event) {
         case pvac::GetEvent::Fail:
-            std::cerr<<"Error "<<event.message<<"\n";
+            std::cerr<<std::setw(pvnamewidth)<<std::left<<op.name()<<" Error "<<event.message<<"\n";
             haderror = 1;
             break;
         case pvac::GetEvent::Cancel:
             break;
-        case pvac::GetEvent::Success: {
-            pvd::PVStructure::Formatter fmt(event.value->stream()
-                                            .format(outmode));
+        case pvac::GetEvent::Success:
+            strm<<std::setw(pvnamewidth)<<std::left<<op.name()<<' ';
+            if(outmode==pvd::PVStructure::Formatter::JSON) {
+                pvd::BitSet all;
+                all.set(0);
+                jprint(strm, *event.value, verbosity>=2 ? all : *event.valid);
 
-            if(verbosity>=2)
-                fmt.highlight(*event.valid); // show all, highlight valid
-            else
-                fmt.show(*event.valid); // only show valid, highlight none
+            } else {
+                pvd::PVStructure::Formatter fmt(event.value->stream()
+                                                .format(outmode));
 
-            std::cout<<fmt;
-        }
+                if(verbosity>=2)
+                    fmt.highlight(*event.valid); // show all, highlight valid
+                else
+                    fmt.show(*event.valid); // only show valid, highlight none
+
+                strm<<fmt;
+            }
             break;
         }
-        std::cout.flush();
+        output.complete(index, strm.str());
         done();
     }
 };
@@ -159,6 +246,8 @@ struct WorkQueue : public epicsThreadRunable {
         while(running) {
             if(queue.empty()) {
                 UnGuard U(G);
+                // write out while idle, rather than after each update
+                flushOutput();
                 event.wait();
             } else {
                 queue_t::value_type ent(queue.front());
@@ -185,14 +274,23 @@ struct MonTracker : public pvac::ClientChannel::MonitorCallback,
 {
     POINTER_DEFINITIONS(MonTracker);
 
-    MonTracker(WorkQueue& monwork, pvac::ClientChannel& channel, const pvd::PVStructurePtr& pvRequest)
+    MonTracker(WorkQueue& monwork, pvac::ClientChannel& channel, const pvd::PVStructurePtr& pvRequest,
+               PhaseTimes& times)
         :monwork(monwork)
+        ,times(times)
+        ,started(epicsTime::getCurrent())
+        ,first(true)
         ,mon(channel.monitor(this, pvRequest))
     {}
     virtual ~MonTracker() {mon.cancel();}
 
     WorkQueue& monwork;
 
+    // time to first update.  only access for process()
+    PhaseTimes& times;
+    const epicsTime started;
+    bool first;
+
     pvd::BitSet valid; // only access for process()
 
     pvac::Monitor mon; // must be last data member
@@ -212,33 +310,64 @@ struct MonTracker : public pvac::ClientChannel::MonitorCallback,
         // running on our worker thread
         switch(evt.event) {
         case pvac::MonitorEvent::Fail:
-            std::cerr<<std::setw(pvnamewidth)<<std::left<<mon.name()<<" Error "<<evt.message<<"\n";
+            if(outformat==NDJSON)
+                jevent(std::cout, mon.name(), "error", evt.message);
+            else
+                std::cerr<<std::setw(pvnamewidth)<<std::left<<mon.name()<<" Error "<<evt.message<<"\n";
             haderror = 1;
             done();
             break;
         case pvac::MonitorEvent::Cancel:
             break;
         case pvac::MonitorEvent::Disconnect:
-            std::cout<<std::setw(pvnamewidth)<<std::left<<mon.name()<<" <Disconnect>\n";
+            if(outformat==NDJSON)
+                jevent(std::cout, mon.name(), "disconnect", std::string());
+            else if(outformat==Binary)
+                std::cerr<<mon.name()<<" <Disconnect>\n";
+            else
+                std::cout<<std::setw(pvnamewidth)<<std::left<<mon.name()<<" <Disconnect>\n";
             valid.clear();
             break;
         case pvac::MonitorEvent::Data:
         {
             unsigned n;
             for(n=0; n<2 && mon.poll(); n++) {
+                if(first) {
+                    times.add(epicsTime::getCurrent() - started);
+                    first = false;
+                }
                 valid |= mon.changed;
 
-                pvd::PVStructure::Formatter fmt(mon.root->stream()
-                                                .format(outmode));
+                pvd::BitSet all;
+                all.set(0);
+                const pvd::BitSet& mask = verbosity>=3 ? all : verbosity>=2 ? valid : mon.changed;
 
-                if(verbosity>=3)
-                    fmt.highlight(mon.changed); // show all
-                else if(verbosity>=2)
-                    fmt.highlight(mon.changed).show(valid);
-                else
-                    fmt.show(mon.changed); // highlight none
+                if(outformat==NDJSON) {
+                    jdata(std::cout, mon.name(), *mon.root, mask, flatten);
+                    continue;
+                } else if(outformat==Binary) {
+                    colout->append(mon.name(), *mon.root);
+                    continue;
+                }
+
+                std::cout<<std::setw(pvnamewidth)<<std::left<<mon.name()<<' ';
 
-                std::cout<<std::setw(pvnamewidth)<<std::left<<mon.name()<<' '<<fmt;
+                if(outmode==pvd::PVStructure::Formatter::JSON) {
+                    jprint(std::cout, *mon.root, mask);
+
+                } else {
+                    pvd::PVStructure::Formatter fmt(mon.root->stream()
+                                                    .format(outmode));
+
+                    if(verbosity>=3)
+                        fmt.highlight(mon.changed); // show all
+                    else if(verbosity>=2)
+                        fmt.highlight(mon.changed).show(valid);
+                    else
+                        fmt.show(mon.changed); // highlight none
+
+                    std::cout<<fmt;
+                }
             }
             if(n==2) {
                 // too many updates, re-queue to balance with others
@@ -252,7 +381,6 @@ struct MonTracker : public pvac::ClientChannel::MonitorCallback,
         }
             break;
         }
-        std::cout.flush();
     }
 };
 
@@ -273,10 +401,13 @@ int MAIN (int argc, char *argv[])
 #endif
 
         epics::RefMonitor refmon;
+        std::string namefile;
+        epicsUInt32 window = 0u;
+        bool summary = false;
 
         // ================ Parse Arguments
 
-        while ((opt = getopt(argc, argv, ":hvVRM:r:w:tmp:qdcF:f:ni")) != -1) {
+        while ((opt = getopt(argc, argv, ":hvVRM:r:w:tmp:qdcF:f:nilW:S")) != -1) {
             switch (opt) {
             case 'h':               /* Print usage */
                 usage();
@@ -309,6 +440,10 @@ int MAIN (int argc, char *argv[])
                     outmode = pvd::PVStructure::Formatter::NT;
                 } else if(strcmp(optarg, "json")==0) {
                     outmode = pvd::PVStructure::Formatter::JSON;
+                } else if(strcmp(optarg, "ndjson")==0) {
+                    outformat = NDJSON;
+                } else if(strcmp(optarg, "binary")==0) {
+                    outformat = Binary;
                 } else {
                     fprintf(stderr, "Unknown output mode '%s'\n", optarg);
                     outmode = pvd::PVStructure::Formatter::Raw;
@@ -337,8 +472,21 @@ int MAIN (int argc, char *argv[])
                 // deprecate
                 break;
             case 'f':               /* Use input stream as input */
-                fprintf(stderr, "Unsupported option -f\n");
-                return 1;
+                namefile = optarg;
+                break;
+            case 'W':               /* Concurrency window */
+                if(epicsParseUInt32(optarg, &window, 0, 0)) {
+                    fprintf(stderr, "'%s' is not a valid count "
+                                    "- ignored. ('" EXECNAME " -h' for help.)\n", optarg);
+                    window = 0u;
+                }
+                break;
+            case 'S':               /* Timing summary */
+                summary = true;
+                break;
+            case 'l':               /* Flatten sub-structures */
+                flatten = true;
+                break;
             case 'm':               /* Monitor mode */
                 monitor = true;
                 break;
@@ -380,33 +528,70 @@ int MAIN (int argc, char *argv[])
             return 1;
         }
 
-        for(int i = optind; i < argc; i++) {
-            pvnamewidth = std::max(pvnamewidth, strlen(argv[i]));
+        std::vector<std::string> names(argv+optind, argv+argc);
+        if(!namefile.empty())
+            readLines(names, namefile);
+
+        for(size_t i = 0; i < names.size(); i++) {
+            pvnamewidth = std::max(pvnamewidth, names[i].size());
         }
 
         SET_LOG_LEVEL(debugFlag ? pva::logLevelDebug : pva::logLevelError);
 
         epics::pvAccess::ca::CAClientFactory::start();
 
+        // flush()'d on destruction, after all operations have completed
+        epics::auto_ptr<ColumnWriter> columnWriter;
+        if(outformat==Binary) {
+            columnWriter.reset(new ColumnWriter(std::cout));
+            colout = columnWriter.get();
+        }
+
         {
-            pvac::ClientProvider provider(defaultProvider);
+            // a monitor may run for a long time, so keep watching beacons
+            pvac::ClientProvider provider(defaultProvider,
+                                          monitor ? std::tr1::shared_ptr<pva::Configuration>() : shortLivedConfig());
+
+            // must outlive operations
+            const epicsTime start(epicsTime::getCurrent());
+            PhaseTimes connectTimes, opTimes;
+            ColumnSink columnSink(names);
+            colsink = &columnSink;
+            OrderedOutput output(std::cout, names.size(), outformat==Binary ? &columnSink : 0);
 
             std::vector<std::tr1::shared_ptr<Tracker> > tracked;
+            tracked.reserve(names.size());
 
             epics::auto_ptr<WorkQueue> Q;
             if(monitor)
                 Q.reset(new WorkQueue);
 
-            for(int i = optind; i < argc; i++) {
-                pvac::ClientChannel chan(provider.connect(argv[i]));
+            // Create all channels before any operation, so that searches are sent together
+            std::vector<pvac::ClientChannel> chans;
+            std::vector<std::tr1::shared_ptr<ConnectTimer> > connecting;
+            chans.reserve(names.size());
+            for(size_t i = 0; i < names.size(); i++) {
+                chans.push_back(provider.connect(names[i]));
+                if(summary)
+                    connecting.push_back(std::tr1::shared_ptr<ConnectTimer>(new ConnectTimer(chans.back(), connectTimes)));
+            }
 
+            Tracker::prepare(); // install signal handler
+
+            bool ok = true;
+            for(size_t i = 0; ok && i < names.size(); i++) {
                 if(monitor) {
-                    std::tr1::shared_ptr<MonTracker> mon(new MonTracker(*Q, chan, pvRequest));
+                    std::tr1::shared_ptr<MonTracker> mon(new MonTracker(*Q, chans[i], pvRequest, opTimes));
 
                     tracked.push_back(mon);
 
                 } else { // Get
-                    std::tr1::shared_ptr<Getter> get(new Getter(chan, pvRequest));
+                    if(window)
+                        ok = Tracker::waitFor(window-1u);
+                    if(!ok || Tracker::abort)
+                        break;
+
+                    std::tr1::shared_ptr<Getter> get(new Getter(chans[i], pvRequest, i, output, opTimes));
 
                     tracked.push_back(get);
                 }
@@ -414,23 +599,32 @@ int MAIN (int argc, char *argv[])
 
             // ========================== Wait for operations to complete, or timeout
 
-            Tracker::prepare(); // install signal handler
-
             if(debugFlag)
                 std::cerr<<"Waiting...\n";
 
-            {
-                Guard G(Tracker::doneLock);
-                while(Tracker::inprog.size() && !Tracker::abort) {
-                    UnGuard U(G);
-                    if(timeout<=0)
-                        Tracker::doneEvt.wait();
-                    else if(!Tracker::doneEvt.wait(timeout)) {
-                        haderror = 1;
-                        std::cerr<<"Timeout\n";
-                        break;
-                    }
+            if(!ok || !Tracker::waitFor(0u)) {
+                haderror = 1;
+                std::cerr<<"Timeout\n";
+            }
+
+            if(!monitor) {
+                // print results which completed after one which did not
+                std::vector<std::string> missing(names.size());
+                for(size_t i=0; i<names.size(); i++) {
+                    std::ostringstream strm;
+                    if(outformat==NDJSON)
+                        jevent(strm, names[i], "error", "No response");
+                    else if(outformat==Text)
+                        strm<<std::setw(pvnamewidth)<<std::left<<names[i]<<" <no response>\n";
+                    missing[i] = strm.str();
                 }
+                output.drain(missing);
+            }
+
+            if(summary) {
+                std::cerr<<"Timing of "<<names.size()<<" PVs in "<<(epicsTime::getCurrent() - start)<<" seconds\n";
+                connectTimes.show(std::cerr, "connect");
+                opTimes.show(std::cerr, monitor ? "update" : "get");
             }
         }
 
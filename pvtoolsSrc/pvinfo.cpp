@@ -176,7 +176,7 @@ int main (int argc, char *argv[])
     pva::ca::CAClientFactory::start();
 
         {
-        pvac::ClientProvider prov(defaultProvider);
+        pvac::ClientProvider prov(defaultProvider, shortLivedConfig());
 
         for(int i = optind; i<argc; i++) {
             pvac::ClientChannel chan(prov.connect(argv[i]));
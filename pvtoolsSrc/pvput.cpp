@@ -3,8 +3,10 @@
  * found in the file LICENSE that is included with the distribution
  */
 #include <iostream>
+#include <iomanip>
 #include <vector>
 #include <string>
+#include <algorithm>
 #include <istream>
 #include <fstream>
 #include <sstream>
@@ -33,6 +35,10 @@
 
 namespace {
 
+size_t pvnamewidth;
+
+int haderror;
+
 void usage (bool details=false)
 {
     fprintf (stderr,
@@ -46,7 +52,11 @@ void usage (bool details=false)
              " Deprecated options:\n"
              "  default: Auto - try value as enum string, then as index number\n"
              "  -n, -s, -F, -t: ignored\n"
-             "  -f <input file>: error"
+             " Many PVs:\n"
+             "  -f <input file>: Read lines of '<PV name> <value> ...' from a file.  '-' reads stdin.\n"
+             "                   A value beginning with '[' or '{' is the remainder of the line.\n"
+             "  -W <count>:      Put at most this many PVs concurrently.  default is no limit\n"
+             "  -S:              Print a summary of connect and put times\n"
              , request.c_str(), timeout, defaultProvider.c_str());
     if(details) {
         fprintf (stderr,
@@ -70,6 +80,15 @@ void usage (bool details=false)
                  "\n"
                  "  pvput group:pv some='{\"value\":1.234}' other='{\"value\":\"a string\"}'\n"
                  "\n"
+                 "Many PVs\n"
+                 "\n"
+                 "  pvput -W 100 -f restore.txt\n"
+                 "\n"
+                 "with restore.txt containing lines like\n"
+                 "\n"
+                 "  double01 1.234\n"
+                 "  arr:pv [1.0, 2.0]\n"
+                 "\n"
                  );
     }
 }
@@ -217,15 +236,18 @@ struct Putter : public pvac::ClientChannel::PutCallback
                     // ignore
 
                 } else if(it->second[0]=='[') {
-                    pvd::shared_vector<std::string> arr;
-                    jarray(arr, it->second.c_str());
-
                     pvd::PVScalarArray* afld(dynamic_cast<pvd::PVScalarArray*>(fld.get()));
                     if(!afld) {
                         fprintf(stderr, "%s : Error not a scalar array field\n", it->first.c_str());
                         throw std::runtime_error("Not a scalar array field");
                     }
-                    afld->putFrom(freeze(arr));
+
+                    // numbers parse directly into the array, others as strings then converted
+                    if(!jarrayNumeric(*afld, it->second.c_str())) {
+                        pvd::shared_vector<std::string> arr;
+                        jarray(arr, it->second.c_str());
+                        afld->putFrom(freeze(arr));
+                    }
                     args.tosend.set(afld->getFieldOffset());
 
                 } else if(it->second[0]=='{' || it->second[0]=='[') {
@@ -262,6 +284,196 @@ struct Putter : public pvac::ClientChannel::PutCallback
     }
 };
 
+// One line of a '-f' batch.  Fetch the old value, put, then fetch the new value.
+// Each operation is started from the completion of the previous, so callbacks are serialized.
+struct BatchPutter : public Putter, public pvac::ClientChannel::GetCallback, public Tracker
+{
+    pvac::ClientChannel chan;
+    const pvd::PVStructurePtr pvRequest;
+    const size_t index; // in input order
+    OrderedOutput& output;
+    PhaseTimes& times;
+    const bool quiet;
+    bool fetchedOld;
+    epicsTime started;
+    std::ostringstream strm;
+
+    pvac::Operation oldop, putop, newop;
+
+    BatchPutter(const pvac::ClientChannel& chan, const pvd::PVStructurePtr& pvRequest,
+                const std::vector<std::string>& vals, bool quiet,
+                size_t index, OrderedOutput& output, PhaseTimes& times)
+        :chan(chan)
+        ,pvRequest(pvRequest)
+        ,index(index)
+        ,output(output)
+        ,times(times)
+        ,quiet(quiet)
+        ,fetchedOld(quiet)
+    {
+        values = vals;
+        strm << std::boolalpha;
+        if(quiet)
+            startPut();
+        else
+            oldop = this->chan.get(this, pvRequest);
+    }
+    virtual ~BatchPutter() {}
+
+    void startPut()
+    {
+        started = epicsTime::getCurrent();
+        putop = chan.put(this, pvRequest, true);
+    }
+
+    void complete()
+    {
+        output.complete(index, strm.str());
+        Tracker::done();
+    }
+
+    void fail(const std::string& msg)
+    {
+        std::cerr<<std::setw(pvnamewidth)<<std::left<<chan.name()<<" Error: "<<msg<<"\n";
+        haderror = 1;
+        complete();
+    }
+
+    virtual void getDone(const pvac::GetEvent& evt) OVERRIDE FINAL
+    {
+        switch(evt.event) {
+        case pvac::GetEvent::Cancel:
+            return;
+        case pvac::GetEvent::Fail:
+            fail(evt.message);
+            return;
+        case pvac::GetEvent::Success:
+            break;
+        }
+
+        // as with a single PV, -q prints only the new value.  Prefixed by the name to tell lines apart.
+        strm<<std::setw(pvnamewidth)<<std::left<<chan.name()<<(quiet ? " " : fetchedOld ? " New : " : " Old : ")
+            <<evt.value->stream().format(outmode);
+
+        if(fetchedOld) {
+            complete();
+        } else {
+            fetchedOld = true;
+            startPut();
+        }
+    }
+
+    virtual void putDone(const pvac::PutEvent& evt) OVERRIDE FINAL
+    {
+        Putter::putDone(evt);
+        times.add(epicsTime::getCurrent() - started);
+
+        switch(evt.event) {
+        case pvac::PutEvent::Cancel:
+            return;
+        case pvac::PutEvent::Fail:
+            fail(evt.message);
+            return;
+        case pvac::PutEvent::Success:
+            break;
+        }
+
+        newop = chan.get(this, pvRequest);
+    }
+};
+
+// split '<PV name> <value> ...'
+void splitLine(const std::string& line, std::string& name, std::vector<std::string>& vals)
+{
+    size_t sep = line.find_first_of(" \t");
+    name = line.substr(0, sep);
+    vals.clear();
+
+    while(sep!=std::string::npos) {
+        size_t start = line.find_first_not_of(" \t", sep);
+        if(start==std::string::npos)
+            break;
+        if(line[start]=='[' || line[start]=='{') {
+            vals.push_back(line.substr(start));
+            break;
+        }
+        sep = line.find_first_of(" \t", start);
+        vals.push_back(line.substr(start, sep==std::string::npos ? sep : sep-start));
+    }
+}
+
+int putBatch(const std::vector<std::string>& lines, const pvd::PVStructurePtr& pvRequest,
+             bool quiet, epicsUInt32 window, bool summary)
+{
+    std::vector<std::string> names(lines.size());
+    std::vector<std::vector<std::string> > vals(lines.size());
+    for(size_t i=0; i<lines.size(); i++) {
+        splitLine(lines[i], names[i], vals[i]);
+        if(vals[i].empty()) {
+            fprintf(stderr, "No value(s) specified for %s\n", names[i].c_str());
+            return 1;
+        }
+        pvnamewidth = std::max(pvnamewidth, names[i].size());
+    }
+
+    pvac::ClientProvider ctxt(defaultProvider, shortLivedConfig());
+
+    // must outlive operations
+    const epicsTime start(epicsTime::getCurrent());
+    PhaseTimes connectTimes, putTimes;
+    OrderedOutput output(std::cout, names.size());
+
+    std::vector<std::tr1::shared_ptr<BatchPutter> > tracked;
+    tracked.reserve(names.size());
+
+    // Create all channels before any operation, so that searches are sent together
+    std::vector<pvac::ClientChannel> chans;
+    std::vector<std::tr1::shared_ptr<ConnectTimer> > connecting;
+    chans.reserve(names.size());
+    for(size_t i=0; i<names.size(); i++) {
+        chans.push_back(ctxt.connect(names[i]));
+        if(summary)
+            connecting.push_back(std::tr1::shared_ptr<ConnectTimer>(new ConnectTimer(chans.back(), connectTimes)));
+    }
+
+    Tracker::prepare(); // install signal handler
+
+    bool ok = true;
+    for(size_t i=0; ok && i<names.size(); i++) {
+        if(window)
+            ok = Tracker::waitFor(window-1u);
+        if(!ok || Tracker::abort)
+            break;
+
+        tracked.push_back(std::tr1::shared_ptr<BatchPutter>(new BatchPutter(chans[i], pvRequest, vals[i], quiet,
+                                                                            i, output, putTimes)));
+    }
+
+    if(!ok || !Tracker::waitFor(0u)) {
+        haderror = 1;
+        std::cerr<<"Timeout\n";
+    }
+
+    {
+        // print results which completed after one which did not
+        std::vector<std::string> missing(names.size());
+        for(size_t i=0; i<names.size(); i++) {
+            std::ostringstream strm;
+            strm<<std::setw(pvnamewidth)<<std::left<<names[i]<<" <no response>\n";
+            missing[i] = strm.str();
+        }
+        output.drain(missing);
+    }
+
+    if(summary) {
+        std::cerr<<"Timing of "<<names.size()<<" PVs in "<<(epicsTime::getCurrent() - start)<<" seconds\n";
+        connectTimes.show(std::cerr, "connect");
+        putTimes.show(std::cerr, "put");
+    }
+
+    return haderror;
+}
+
 } // namespace
 
 int main (int argc, char *argv[])
@@ -269,11 +481,14 @@ int main (int argc, char *argv[])
     try {
         int opt;                    /* getopt() current option */
         bool quiet = false;
+        std::string namefile;
+        epicsUInt32 window = 0u;
+        bool summary = false;
 
         setvbuf(stdout,NULL,_IOLBF,BUFSIZ);    /* Set stdout to line buffering */
         putenv(const_cast<char*>("POSIXLY_CORRECT="));            /* Behave correct on GNU getopt systems; e.g. handle negative numbers */
 
-        while ((opt = getopt(argc, argv, ":hvVM:r:w:tp:qdF:f:ns")) != -1) {
+        while ((opt = getopt(argc, argv, ":hvVM:r:w:tp:qdF:f:nsW:S")) != -1) {
             switch (opt) {
             case 'h':               /* Print usage */
                 usage(true);
@@ -338,8 +553,18 @@ int main (int argc, char *argv[])
             case 'F':               /* Store this for output formatting */
                 break;
             case 'f':               /* Use input stream as input */
-                fprintf(stderr, "Unsupported option -f\n");
-                return 1;
+                namefile = optarg;
+                break;
+            case 'W':               /* Concurrency window */
+                if(epicsParseUInt32(optarg, &window, 0, 0)) {
+                    fprintf(stderr, "'%s' is not a valid count "
+                                    "- ignored. ('pvput -h' for help.)\n", optarg);
+                    window = 0u;
+                }
+                break;
+            case 'S':               /* Timing summary */
+                summary = true;
+                break;
             case 'n':
                 break;
             case 's':
@@ -360,6 +585,35 @@ int main (int argc, char *argv[])
             }
         }
 
+        pvd::PVStructure::shared_pointer pvRequest;
+        try {
+            pvRequest = pvd::createRequest(request);
+        } catch(std::exception& e){
+            fprintf(stderr, "failed to parse request string: %s\n", e.what());
+            return 1;
+        }
+
+        if(!namefile.empty()) {
+            if(argc > optind) {
+                fprintf(stderr, "PV names and values must all be in '%s'. ('pvput -h' for help.)\n", namefile.c_str());
+                return 1;
+            }
+            std::vector<std::string> lines;
+            readLines(lines, namefile);
+            if(lines.empty()) {
+                fprintf(stderr, "No pv name specified. ('pvput -h' for help.)\n");
+                return 1;
+            }
+
+            SET_LOG_LEVEL(debugFlag ? pva::logLevelDebug : pva::logLevelError);
+
+            std::cout << std::boolalpha;
+
+            epics::pvAccess::ca::CAClientFactory::start();
+
+            return putBatch(lines, pvRequest, quiet, window, summary);
+        }
+
         if (argc <= optind)
         {
             fprintf(stderr, "No pv name specified. ('pvput -h' for help.)\n");
@@ -382,21 +636,13 @@ int main (int argc, char *argv[])
         for (int n = 0; optind < argc; n++, optind++)
             thework.values.push_back(argv[optind]);
 
-        pvd::PVStructure::shared_pointer pvRequest;
-        try {
-            pvRequest = pvd::createRequest(request);
-        } catch(std::exception& e){
-            fprintf(stderr, "failed to parse request string: %s\n", e.what());
-            return 1;
-        }
-
         SET_LOG_LEVEL(debugFlag ? pva::logLevelDebug : pva::logLevelError);
 
         std::cout << std::boolalpha;
 
         epics::pvAccess::ca::CAClientFactory::start();
 
-        pvac::ClientProvider ctxt(providerName);
+        pvac::ClientProvider ctxt(providerName, shortLivedConfig());
 
         pvac::ClientChannel chan(ctxt.connect(pvName));
 
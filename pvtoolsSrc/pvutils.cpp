@@ -9,6 +9,7 @@
 #endif
 
 #include <iostream>
+#include <fstream>
 
 #include <string>
 #include <ostream>
@@ -16,9 +17,16 @@
 #include <iomanip>
 #include <stdexcept>
 #include <algorithm>
+#include <limits>
+
+#include <string.h>
+
+#include <epicsStdlib.h>
+#include <epicsStdio.h>
 
 #include <pv/logger.h>
 #include <pv/pvTimeStamp.h>
+#include <pv/configuration.h>
 
 #include "pvutils.h"
 
@@ -55,6 +63,142 @@ void Tracker::prepare()
 #endif
 }
 
+void readLines(std::vector<std::string>& out, const std::string& fname)
+{
+    std::ifstream file;
+    std::istream *strm = &std::cin;
+    if(fname!="-") {
+        file.open(fname.c_str());
+        if(!file.is_open())
+            throw std::runtime_error("Unable to open "+fname);
+        strm = &file;
+    }
+
+    std::string line;
+    while(std::getline(*strm, line)) {
+        size_t start = line.find_first_not_of(" \t\r"),
+               end = line.find_last_not_of(" \t\r");
+        if(start==std::string::npos || line[start]=='#')
+            continue;
+        out.push_back(line.substr(start, end-start+1u));
+    }
+}
+
+void PhaseTimes::add(double seconds)
+{
+    Guard G(lock);
+    if(count==0u || min>seconds)
+        min = seconds;
+    if(count==0u || max<seconds)
+        max = seconds;
+    total += seconds;
+    count++;
+}
+
+void PhaseTimes::show(std::ostream& strm, const char *name)
+{
+    Guard G(lock);
+    strm<<"  "<<std::setw(10)<<std::left<<name<<std::right<<std::setw(7)<<count;
+    if(count)
+        strm<<std::fixed<<std::setprecision(3)
+            <<"  min "<<std::setw(9)<<min*1e3
+            <<"  mean "<<std::setw(9)<<total/count*1e3
+            <<"  max "<<std::setw(9)<<max*1e3<<" ms";
+    strm<<"\n";
+}
+
+ConnectTimer::ConnectTimer(const pvac::ClientChannel& chan, PhaseTimes& times)
+    :chan(chan)
+    ,times(times)
+    ,created(epicsTime::getCurrent())
+    ,connected(false)
+{
+    this->chan.addConnectListener(this);
+}
+
+ConnectTimer::~ConnectTimer()
+{
+    chan.removeConnectListener(this);
+}
+
+void ConnectTimer::connectEvent(const pvac::ConnectEvent& evt)
+{
+    if(!evt.connected || connected)
+        return;
+    connected = true;
+    times.add(epicsTime::getCurrent() - created);
+}
+
+OrderedOutput::OrderedOutput(std::ostream& strm, size_t count, Sink *sink)
+    :strm(strm)
+    ,sink(sink)
+    ,results(count)
+    ,ready(count, false)
+    ,next(0u)
+    ,drained(false)
+{}
+
+void OrderedOutput::complete(size_t index, const std::string& result)
+{
+    Guard G(lock);
+    if(drained)
+        return;
+    results[index] = result;
+    ready[index] = true;
+
+    bool wrote = false;
+    for(; next<ready.size() && ready[next]; next++) {
+        strm<<results[next];
+        std::string().swap(results[next]);
+        if(sink)
+            sink->emit(next);
+        wrote = true;
+    }
+    if(wrote)
+        strm.flush();
+}
+
+void OrderedOutput::drain(const std::vector<std::string>& missing)
+{
+    Guard G(lock);
+    if(drained)
+        return;
+    drained = true;
+
+    for(; next<ready.size(); next++) {
+        if(ready[next]) {
+            strm<<results[next];
+            if(sink)
+                sink->emit(next);
+        } else if(next<missing.size())
+            strm<<missing[next];
+        std::string().swap(results[next]);
+    }
+    strm.flush();
+}
+
+bool Tracker::waitFor(size_t limit)
+{
+    Guard G(doneLock);
+    while(inprog.size()>limit && !abort) {
+        UnGuard U(G);
+        if(timeout<=0)
+            doneEvt.wait();
+        else if(!doneEvt.wait(timeout))
+            return false;
+    }
+    return true;
+}
+
+std::tr1::shared_ptr<pva::Configuration> shortLivedConfig()
+{
+    return pva::ConfigurationBuilder()
+            .add("EPICS_PVA_CLIENT_LAZY", "YES")
+            .push_map()
+            .push_env()
+            .build();
+}
+
 static
 void early(const char *inp, unsigned pos)
 {
@@ -126,3 +270,567 @@ void jarray(pvd::shared_vector<std::string>& out, const char *inp)
     }
 
 }
+
+namespace {
+
+inline bool jspace(char c)
+{
+    return c==' ' || c=='\t' || c=='\n' || c=='\r';
+}
+
+// powers of ten which are exactly representable as double
+const double exact10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+    1e21, 1e22
+};
+
+// One JSON number, scanned without conversion
+struct JNumber {
+    const char *end; // first char after number
+    bool negative;
+    bool integer;    // no fraction or exponent
+    bool overflow;   // more significant digits than mantissa can hold
+    pvd::uint64 mantissa;
+    int exponent;    // base 10
+};
+
+bool jnumber(const char *inp, JNumber& num)
+{
+    const pvd::uint64 maxm = std::numeric_limits<pvd::uint64>::max();
+    num.negative = *inp=='-';
+    num.integer = true;
+    num.overflow = false;
+    num.mantissa = 0u;
+    num.exponent = 0;
+
+    if(num.negative)
+        inp++;
+    if(*inp<'0' || *inp>'9')
+        return false;
+
+    for(; *inp>='0' && *inp<='9'; inp++) {
+        unsigned d = *inp-'0';
+        if(num.mantissa > (maxm-d)/10u)
+            num.overflow = true;
+        else
+            num.mantissa = num.mantissa*10u + d;
+    }
+
+    if(*inp=='.') {
+        num.integer = false;
+        inp++;
+        if(*inp<'0' || *inp>'9')
+            return false;
+        for(; *inp>='0' && *inp<='9'; inp++) {
+            unsigned d = *inp-'0';
+            if(num.overflow || num.mantissa > (maxm-d)/10u) {
+                num.overflow = true;
+            } else {
+                num.mantissa = num.mantissa*10u + d;
+                num.exponent--;
+            }
+        }
+    }
+
+    if(*inp=='e' || *inp=='E') {
+        num.integer = false;
+        inp++;
+        bool eneg = false;
+        if(*inp=='+' || *inp=='-')
+            eneg = *inp++=='-';
+        if(*inp<'0' || *inp>'9')
+            return false;
+        int e = 0;
+        for(; *inp>='0' && *inp<='9'; inp++) {
+            if(e<10000)
+                e = e*10 + (*inp-'0');
+        }
+        num.exponent += eneg ? -e : e;
+    }
+
+    num.end = inp;
+    return true;
+}
+
+// integer types.  Fractions, and out of range values, are left to the slow path
+template<typename T>
+bool jconvert(const char *, const JNumber& num, T& out)
+{
+    if(!num.integer || num.overflow)
+        return false;
+
+    pvd::uint64 limit = pvd::uint64(std::numeric_limits<T>::max());
+    if(num.negative)
+        limit = std::numeric_limits<T>::is_signed ? limit+1u : 0u;
+    if(num.mantissa>limit)
+        return false;
+
+    out = num.negative ? T(pvd::int64(0u-num.mantissa)) : T(num.mantissa);
+    return true;
+}
+
+bool jconvert(const char *start, const JNumber& num, double& out)
+{
+    if(!num.overflow && num.mantissa<=(pvd::uint64(1u)<<53) && num.exponent>=-22 && num.exponent<=22) {
+        // both mantissa and power of ten are exact, so the result is correctly rounded
+        double val = double(num.mantissa);
+        if(num.exponent<0)
+            val /= exact10[-num.exponent];
+        else
+            val *= exact10[num.exponent];
+        out = num.negative ? -val : val;
+    } else {
+        out = epicsStrtod(start, 0);
+    }
+    return true;
+}
+
+bool jconvert(const char *start, const JNumber& num, float& out)
+{
+    double val;
+    jconvert(start, num, val);
+    out = float(val);
+    return true;
+}
+
+template<typename T>
+bool jarrayT(pvd::PVScalarArray& out, const char *inp)
+{
+    const char *end = inp + strlen(inp);
+
+    // Size storage up front.  Every element but the last is followed by a ','
+    pvd::shared_vector<T> arr(std::count(inp, end, ',')+1u);
+    size_t n = 0u;
+
+    inp++; // skip '['
+    for(; jspace(*inp); inp++) {}
+
+    if(*inp!=']') {
+        while(true) {
+            JNumber num;
+            if(!jnumber(inp, num) || !jconvert(inp, num, arr[n]))
+                return false;
+            n++;
+
+            for(inp = num.end; jspace(*inp); inp++) {}
+
+            if(*inp==']')
+                break;
+            else if(*inp!=',')
+                return false;
+
+            for(inp++; jspace(*inp); inp++) {}
+        }
+    }
+
+    for(inp++; jspace(*inp); inp++) {}
+    if(*inp!='\0')
+        return false;
+
+    arr.resize(n);
+    out.putFrom(pvd::freeze(arr));
+    return true;
+}
+
+} // namespace
+
+bool jarrayNumeric(pvd::PVScalarArray& out, const char *inp)
+{
+    if(inp[0]!='[')
+        return false;
+
+    switch(out.getScalarArray()->getElementType()) {
+#define CASE(TYPE, PVT) case pvd::PVT: return jarrayT<pvd::TYPE>(out, inp)
+    CASE(int8, pvByte);
+    CASE(int16, pvShort);
+    CASE(int32, pvInt);
+    CASE(int64, pvLong);
+    CASE(uint8, pvUByte);
+    CASE(uint16, pvUShort);
+    CASE(uint32, pvUInt);
+    CASE(uint64, pvULong);
+    CASE(float, pvFloat);
+    CASE(double, pvDouble);
+#undef CASE
+    default:
+        return false; // boolean and string
+    }
+}
+
+namespace {
+
+// Formats into a fixed buffer which is written out as it fills.
+// Avoids the per-value overhead of std::ostream and of the generic JSON printer.
+struct JWriter {
+    std::ostream& strm;
+    size_t pos;
+    char buf[16u*1024u];
+
+    explicit JWriter(std::ostream& strm) :strm(strm), pos(0u) {}
+    ~JWriter() { flush(); }
+
+    void flush()
+    {
+        strm.write(buf, pos);
+        pos = 0u;
+    }
+
+    // ensure space for n chars
+    char* reserve(size_t n)
+    {
+        if(pos+n > sizeof(buf))
+            flush();
+        return buf+pos;
+    }
+
+    void put(char c)
+    {
+        reserve(1u);
+        buf[pos++] = c;
+    }
+
+    void put(const char *s, size_t n)
+    {
+        while(n) {
+            size_t cnt = std::min(n, sizeof(buf)-pos);
+            if(!cnt) {
+                flush();
+                continue;
+            }
+            memcpy(buf+pos, s, cnt);
+            pos += cnt;
+            s += cnt;
+            n -= cnt;
+        }
+    }
+
+    void put(const char *s) { put(s, strlen(s)); }
+
+    void num(pvd::uint64 val, bool negative=false)
+    {
+        char tmp[24];
+        char *end = tmp+sizeof(tmp), *p = end;
+        do {
+            *--p = char('0' + val%10u);
+            val /= 10u;
+        } while(val);
+        if(negative)
+            *--p = '-';
+        put(p, end-p);
+    }
+
+    void num(pvd::int64 val)
+    {
+        if(val<0)
+            num(0u-pvd::uint64(val), true);
+        else
+            num(pvd::uint64(val));
+    }
+
+    void num(pvd::int8 val)   { num(pvd::int64(val)); }
+    void num(pvd::int16 val)  { num(pvd::int64(val)); }
+    void num(pvd::int32 val)  { num(pvd::int64(val)); }
+    void num(pvd::uint8 val)  { num(pvd::uint64(val)); }
+    void num(pvd::uint16 val) { num(pvd::uint64(val)); }
+    void num(pvd::uint32 val) { num(pvd::uint64(val)); }
+
+    // Shortest of %.15g, %.16g, or %.17g which reads back as the same value.
+    // %g drops trailing zeros, so %.15g is already the shortest representation
+    // of any value which has one with 15 or fewer digits.
+    void num(double val)
+    {
+        if(val-val!=0.0) {
+            // NaN or Inf have no JSON representation
+            put("null", 4u);
+            return;
+        }
+        if(val>-1e15 && val<1e15 && val==double(pvd::int64(val)) && (val!=0.0 || 1.0/val>0.0)) {
+            // integral, excluding -0.0
+            num(pvd::int64(val));
+            return;
+        }
+        char *out = reserve(32u);
+        int n = 0;
+        for(int prec=15; prec<=17; prec++) {
+            n = epicsSnprintf(out, 32u, "%.*g", prec, val);
+            if(epicsStrtod(out, 0)==val)
+                break;
+        }
+        pos += n;
+    }
+
+    void num(float val)
+    {
+        if(val-val!=0.0f) {
+            put("null", 4u);
+            return;
+        }
+        char *out = reserve(32u);
+        int n = 0;
+        for(int prec=6; prec<=9; prec++) {
+            n = epicsSnprintf(out, 32u, "%.*g", prec, double(val));
+            if(float(epicsStrtod(out, 0))==val)
+                break;
+        }
+        pos += n;
+    }
+
+    void str(const std::string& s)
+    {
+        static const char hex[] = "0123456789abcdef";
+        put('"');
+        for(size_t i=0, N=s.size(); i<N; i++) {
+            char c = s[i];
+            switch(c) {
+            case '"':  put("\\\"", 2u); break;
+            case '\\': put("\\\\", 2u); break;
+            case '\n': put("\\n", 2u); break;
+            case '\r': put("\\r", 2u); break;
+            case '\t': put("\\t", 2u); break;
+            default:
+                if((unsigned char)c < 0x20u) {
+                    char esc[6] = {'\\', 'u', '0', '0', hex[(c>>4)&0xf], hex[c&0xf]};
+                    put(esc, 6u);
+                } else {
+                    put(c);
+                }
+            }
+        }
+        put('"');
+    }
+
+    template<typename T>
+    void array(const pvd::PVScalarArray& fld)
+    {
+        typename pvd::PVValueArray<T>::const_svector arr(static_cast<const pvd::PVValueArray<T>&>(fld).view());
+        put('[');
+        for(size_t i=0, N=arr.size(); i<N; i++) {
+            if(i)
+                put(',');
+            num(arr[i]);
+        }
+        put(']');
+    }
+
+    void field(const pvd::PVField& fld, const pvd::BitSet& mask, bool all);
+    void flat(const pvd::PVStructure& fld, const pvd::BitSet& mask, bool all, std::string& prefix, bool& first);
+};
+
+void JWriter::field(const pvd::PVField& fld, const pvd::BitSet& mask, bool all)
+{
+    switch(fld.getField()->getType()) {
+    case pvd::scalar: {
+        const pvd::PVScalar& sfld = static_cast<const pvd::PVScalar&>(fld);
+        switch(sfld.getScalar()->getScalarType()) {
+        case pvd::pvBoolean:
+            if(sfld.getAs<pvd::boolean>())
+                put("true", 4u);
+            else
+                put("false", 5u);
+            break;
+#define CASE(TYPE, PVT) case pvd::PVT: num(sfld.getAs<pvd::TYPE>()); break
+        CASE(int8, pvByte);
+        CASE(int16, pvShort);
+        CASE(int32, pvInt);
+        CASE(int64, pvLong);
+        CASE(uint8, pvUByte);
+        CASE(uint16, pvUShort);
+        CASE(uint32, pvUInt);
+        CASE(uint64, pvULong);
+        CASE(float, pvFloat);
+        CASE(double, pvDouble);
+#undef CASE
+        case pvd::pvString:
+            str(sfld.getAs<std::string>());
+            break;
+        }
+    }
+        break;
+    case pvd::scalarArray: {
+        const pvd::PVScalarArray& afld = static_cast<const pvd::PVScalarArray&>(fld);
+        switch(afld.getScalarArray()->getElementType()) {
+        case pvd::pvBoolean: {
+            pvd::PVBooleanArray::const_svector arr(static_cast<const pvd::PVBooleanArray&>(afld).view());
+            put('[');
+            for(size_t i=0, N=arr.size(); i<N; i++) {
+                if(i)
+                    put(',');
+                if(arr[i])
+                    put("true", 4u);
+                else
+                    put("false", 5u);
+            }
+            put(']');
+        }
+            break;
+#define CASE(TYPE, PVT) case pvd::PVT: array<pvd::TYPE>(afld); break
+        CASE(int8, pvByte);
+        CASE(int16, pvShort);
+        CASE(int32, pvInt);
+        CASE(int64, pvLong);
+        CASE(uint8, pvUByte);
+        CASE(uint16, pvUShort);
+        CASE(uint32, pvUInt);
+        CASE(uint64, pvULong);
+        CASE(float, pvFloat);
+        CASE(double, pvDouble);
+#undef CASE
+        case pvd::pvString: {
+            pvd::PVStringArray::const_svector arr(static_cast<const pvd::PVStringArray&>(afld).view());
+            put('[');
+            for(size_t i=0, N=arr.size(); i<N; i++) {
+                if(i)
+                    put(',');
+                str(arr[i]);
+            }
+            put(']');
+        }
+            break;
+        }
+    }
+        break;
+    case pvd::structure: {
+        const pvd::PVStructure& sfld = static_cast<const pvd::PVStructure&>(fld);
+        const pvd::PVFieldPtrArray& children = sfld.getPVFields();
+        const pvd::StringArray& names = sfld.getStructure()->getFieldNames();
+        all |= mask.get(sfld.getFieldOffset());
+
+        bool first = true;
+        put('{');
+        for(size_t i=0, N=children.size(); i<N; i++) {
+            const pvd::PVField& child = *children[i];
+            if(!all) {
+                // skip unless this child, or one of its sub-fields, is selected
+                pvd::int32 next = mask.nextSetBit(child.getFieldOffset());
+                if(next<0 || size_t(next)>=child.getNextFieldOffset())
+                    continue;
+            }
+            if(!first)
+                put(',');
+            first = false;
+            str(names[i]);
+            put(':');
+            field(child, mask, all);
+        }
+        put('}');
+    }
+        break;
+    case pvd::structureArray: {
+        pvd::PVStructureArray::const_svector arr(static_cast<const pvd::PVStructureArray&>(fld).view());
+        pvd::BitSet everything;
+        everything.set(0);
+        put('[');
+        for(size_t i=0, N=arr.size(); i<N; i++) {
+            if(i)
+                put(',');
+            if(arr[i])
+                field(*arr[i], everything, true);
+            else
+                put("null", 4u);
+        }
+        put(']');
+    }
+        break;
+    case pvd::union_: {
+        pvd::PVFieldPtr val(static_cast<const pvd::PVUnion&>(fld).get());
+        if(val)
+            field(*val, mask, true);
+        else
+            put("null", 4u);
+    }
+        break;
+    case pvd::unionArray: {
+        pvd::PVUnionArray::const_svector arr(static_cast<const pvd::PVUnionArray&>(fld).view());
+        put('[');
+        for(size_t i=0, N=arr.size(); i<N; i++) {
+            if(i)
+                put(',');
+            pvd::PVFieldPtr val(arr[i] ? arr[i]->get() : pvd::PVFieldPtr());
+            if(val)
+                field(*val, mask, true);
+            else
+                put("null", 4u);
+        }
+        put(']');
+    }
+        break;
+    }
+}
+
+// members of sub-structures become "prefix.name":value members of the current object
+void JWriter::flat(const pvd::PVStructure& fld, const pvd::BitSet& mask, bool all, std::string& prefix, bool& first)
+{
+    const pvd::PVFieldPtrArray& children = fld.getPVFields();
+    const pvd::StringArray& names = fld.getStructure()->getFieldNames();
+    all |= mask.get(fld.getFieldOffset());
+
+    for(size_t i=0, N=children.size(); i<N; i++) {
+        const pvd::PVField& child = *children[i];
+        if(!all) {
+            pvd::int32 next = mask.nextSetBit(child.getFieldOffset());
+            if(next<0 || size_t(next)>=child.getNextFieldOffset())
+                continue;
+        }
+
+        size_t plen = prefix.size();
+        if(plen)
+            prefix += '.';
+        prefix += names[i];
+
+        if(child.getField()->getType()==pvd::structure) {
+            flat(static_cast<const pvd::PVStructure&>(child), mask, all, prefix, first);
+        } else {
+            if(!first)
+                put(',');
+            first = false;
+            str(prefix);
+            put(':');
+            field(child, mask, all);
+        }
+
+        prefix.resize(plen);
+    }
+}
+
+} // namespace
+
+void jprint(std::ostream& strm, const pvd::PVStructure& root, const pvd::BitSet& mask)
+{
+    JWriter out(strm);
+    out.field(root, mask, false);
+    out.put('\n');
+}
+
+void jdata(std::ostream& strm, const std::string& name, const pvd::PVStructure& root, const pvd::BitSet& mask, bool flatten)
+{
+    JWriter out(strm);
+    out.put("{\"name\":");
+    out.str(name);
+    out.put(",\"data\":");
+    if(flatten) {
+        std::string prefix;
+        bool first = true;
+        out.put('{');
+        out.flat(root, mask, false, prefix, first);
+        out.put('}');
+    } else {
+        out.field(root, mask, false);
+    }
+    out.put("}\n", 2u);
+}
+
+void jevent(std::ostream& strm, const std::string& name, const char *event, const std::string& message)
+{
+    JWriter out(strm);
+    out.put("{\"name\":");
+    out.str(name);
+    out.put(",\"event\":\"");
+    out.put(event);
+    out.put('"');
+    if(!message.empty()) {
+        out.put(",\"message\":");
+        out.str(message);
+    }
+    out.put("}\n", 2u);
+}
@@ -8,14 +8,17 @@
 #include <ostream>
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include <epicsEvent.h>
 #include <epicsMutex.h>
 #include <epicsGuard.h>
+#include <epicsTime.h>
 
 #include <pv/event.h>
 #include <pv/pvData.h>
 #include <pv/pvAccess.h>
+#include <pva/client.h>
 
 typedef epicsGuard<epicsMutex> Guard;
 typedef epicsGuardRelease<epicsMutex> UnGuard;
@@ -69,10 +72,84 @@ struct Tracker {
     }
 
     static void prepare();
+    // Wait until no more than 'limit' are in progress.  Returns false on timeout.
+    static bool waitFor(size_t limit);
     EPICS_NOT_COPYABLE(Tracker)
 };
 
 void jarray(pvd::shared_vector<std::string>& out, const char *inp);
 
+// Fast path for a JSON array of numbers.  Parses directly into the storage of a numeric array field.
+// Returns false, leaving the field unchanged, if the field is not numeric,
+// or inp is not a plain array of numbers in range, which the slow path may still handle.
+bool jarrayNumeric(pvd::PVScalarArray& out, const char *inp);
+
+// Print the fields selected by mask on a single line as JSON.
+// Numbers are printed with the fewest digits which read back as the same value.
+void jprint(std::ostream& strm, const pvd::PVStructure& root, const pvd::BitSet& mask);
+
+// One line of newline delimited JSON: {"name":"...","data":{...}}
+// With flatten=true, leaf fields of sub-structures become members named eg. "alarm.severity".
+void jdata(std::ostream& strm, const std::string& name, const pvd::PVStructure& root, const pvd::BitSet& mask, bool flatten);
+// One line of newline delimited JSON: {"name":"...","event":"...","message":"..."}
+void jevent(std::ostream& strm, const std::string& name, const char *event, const std::string& message);
+
+// Read PV names, or other lines, from a file.  "-" reads stdin.
+// Leading and trailing whitespace is removed.  Blank lines, and lines beginning with '#', are skipped.
+void readLines(std::vector<std::string>& out, const std::string& fname);
+
+// Min/mean/max of the durations of one phase (eg. connect) of a batch of operations
+struct PhaseTimes {
+    epicsMutex lock;
+    size_t count;
+    double total, min, max;
+
+    PhaseTimes() :count(0u), total(0.0), min(0.0), max(0.0) {}
+    void add(double seconds);
+    void show(std::ostream& strm, const char *name);
+};
+
+// Records the time from creation until a channel first connects, which includes search
+struct ConnectTimer : public pvac::ClientChannel::ConnectCallback
+{
+    pvac::ClientChannel chan;
+    PhaseTimes& times;
+    const epicsTime created;
+    bool connected;
+
+    ConnectTimer(const pvac::ClientChannel& chan, PhaseTimes& times);
+    virtual ~ConnectTimer();
+    virtual void connectEvent(const pvac::ConnectEvent& evt) OVERRIDE FINAL;
+    EPICS_NOT_COPYABLE(ConnectTimer)
+};
+
+// Results of a batch of operations, printed in input order as soon as all earlier results are available.
+struct OrderedOutput {
+    // For output which isn't text.  Called with each completed result, in input order, after its text.
+    struct Sink {
+        virtual ~Sink() {}
+        virtual void emit(size_t index) =0;
+    };
+
+    epicsMutex lock;
+    std::ostream& strm;
+    Sink * const sink;
+    std::vector<std::string> results;
+    std::vector<bool> ready;
+    size_t next;
+    bool drained;
+
+    OrderedOutput(std::ostream& strm, size_t count, Sink *sink=0);
+    void complete(size_t index, const std::string& result);
+    // Print all remaining results in order, with missing[i] in place of any which never completed.
+    // eg. after timeout or SIGINT.  Later results are discarded.
+    void drain(const std::vector<std::string>& missing);
+    EPICS_NOT_COPYABLE(OrderedOutput)
+};
+
+// Client configuration for single shot operations.
+// Defaults to $EPICS_PVA_CLIENT_LAZY=YES, which may be overridden from the environment.
+std::tr1::shared_ptr<pva::Configuration> shortLivedConfig();
+
 
 #endif /* PVUTILS_H */
@@ -226,6 +226,7 @@ void register_reftrack()
     pvac::detail::registerRefTrackMonitor();
     pvac::detail::registerRefTrackRPC();
     pvac::detail::registerRefTrackInfo();
+    pvac::detail::registerRefTrackArray();
 }
 
 std::tr1::shared_ptr<epics::pvAccess::Channel>
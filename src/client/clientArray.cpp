@@ -0,0 +1,537 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <algorithm>
+
+#include <epicsMutex.h>
+#include <epicsGuard.h>
+#include <epicsEvent.h>
+#include <epicsThread.h>
+#include <epicsTime.h>
+
+#include <pv/current_function.h>
+#include <pv/pvData.h>
+#include <pv/bitSet.h>
+#include <pv/createRequest.h>
+#include <pv/reftrack.h>
+
+#define epicsExportSharedSymbols
+#include "pv/logger.h"
+#include "clientpvt.h"
+#include "pv/pvAccess.h"
+
+namespace {
+using pvac::detail::CallbackGuard;
+using pvac::detail::CallbackUse;
+
+// Element type specific handling of the reassembled array
+typedef pvd::shared_vector<void> (*alloc_fn)(size_t count);
+typedef void (*copy_fn)(void *dest, const pvd::PVScalarArray& src, size_t count);
+
+template<typename T>
+pvd::shared_vector<void> allocElements(size_t count)
+{
+    pvd::shared_vector<T> ret(count);
+    return pvd::static_shared_vector_cast<void>(ret);
+}
+
+template<typename T>
+void copyElements(void *dest, const pvd::PVScalarArray& src, size_t count)
+{
+    pvd::shared_vector<const T> in(static_cast<const pvd::PVValueArray<T>&>(src).view());
+    std::copy(in.begin(), in.begin()+count, static_cast<T*>(dest));
+}
+
+bool elementOps(pvd::ScalarType type, alloc_fn& alloc, copy_fn& copy)
+{
+    switch(type) {
+#define CASE(TYPE, PVT) case pvd::PVT: alloc = &allocElements<TYPE>; copy = &copyElements<TYPE>; return true
+    CASE(pvd::boolean, pvBoolean);
+    CASE(pvd::int8, pvByte);
+    CASE(pvd::int16, pvShort);
+    CASE(pvd::int32, pvInt);
+    CASE(pvd::int64, pvLong);
+    CASE(pvd::uint8, pvUByte);
+    CASE(pvd::uint16, pvUShort);
+    CASE(pvd::uint32, pvUInt);
+    CASE(pvd::uint64, pvULong);
+    CASE(float, pvFloat);
+    CASE(double, pvDouble);
+    CASE(std::string, pvString);
+#undef CASE
+    }
+    return false;
+}
+
+struct ArrayGetter;
+
+// One ChannelArray, with at most one request outstanding.
+// Guarded by ArrayGetter::mutex
+struct ArrayLane : public pva::ChannelArrayRequester
+{
+    const std::tr1::weak_ptr<ArrayGetter> owner;
+    pva::ChannelArray::shared_pointer op;
+    // chunk in flight, relative to ArrayOptions::offset
+    size_t offset, count;
+    bool connected, busy;
+
+    static size_t num_instances;
+
+    explicit ArrayLane(const std::tr1::shared_ptr<ArrayGetter>& owner)
+        :owner(owner), offset(0u), count(0u), connected(false), busy(false)
+    {REFTRACE_INCREMENT(num_instances);}
+    virtual ~ArrayLane() {REFTRACE_DECREMENT(num_instances);}
+
+    virtual std::string getRequesterName() OVERRIDE FINAL;
+
+    virtual void channelArrayConnect(const pvd::Status& status,
+                                     pva::ChannelArray::shared_pointer const & channelArray,
+                                     pvd::Array::const_shared_pointer const & array) OVERRIDE FINAL;
+
+    virtual void putArrayDone(const pvd::Status& status,
+                              pva::ChannelArray::shared_pointer const & channelArray) OVERRIDE FINAL {}
+
+    virtual void getArrayDone(const pvd::Status& status,
+                              pva::ChannelArray::shared_pointer const & channelArray,
+                              pvd::PVArray::shared_pointer const & pvArray) OVERRIDE FINAL;
+
+    virtual void getLengthDone(const pvd::Status& status,
+                               pva::ChannelArray::shared_pointer const & channelArray,
+                               size_t length) OVERRIDE FINAL;
+
+    virtual void setLengthDone(const pvd::Status& status,
+                               pva::ChannelArray::shared_pointer const & channelArray) OVERRIDE FINAL {}
+
+    virtual void channelDisconnect(bool destroy) OVERRIDE FINAL;
+};
+
+size_t ArrayLane::num_instances;
+
+struct ArrayGetter : public pvac::detail::CallbackStorage,
+                     public pvac::Operation::Impl,
+                     public pvac::detail::wrapped_shared_from_this<ArrayGetter>
+{
+    pvac::ClientChannel::ArrayCallback *cb;
+    pvac::ArrayEvent event;
+
+    pvac::ClientChannel::ArrayOptions opts;
+    std::string channelName;
+    epicsTime start;
+
+    // channels connected for ArrayOptions::stripes
+    std::vector<pva::Channel::shared_pointer> stripes;
+    std::vector<std::tr1::shared_ptr<ArrayLane> > lanes;
+
+    // known after the first channelArrayConnect()
+    bool typed;
+    pvd::ScalarType type;
+    alloc_fn alloc;
+    copy_fn copy;
+    size_t elementSize;
+
+    bool lengthRequested, sized;
+    pvd::shared_vector<void> buffer;
+    // next element to request, relative to ArrayOptions::offset
+    size_t next;
+    // some thread is in dispatch()
+    bool dispatching;
+
+    static size_t num_instances;
+
+    explicit ArrayGetter(pvac::ClientChannel::ArrayCallback* cb)
+        :cb(cb)
+        ,start(epicsTime::getCurrent())
+        ,typed(false)
+        ,type(pvd::pvDouble)
+        ,alloc(0)
+        ,copy(0)
+        ,elementSize(0u)
+        ,lengthRequested(false)
+        ,sized(false)
+        ,next(0u)
+        ,dispatching(false)
+    {REFTRACE_INCREMENT(num_instances);}
+    virtual ~ArrayGetter() {
+        CallbackGuard G(*this);
+        cb = 0;
+        G.wait(); // paranoia
+        REFTRACE_DECREMENT(num_instances);
+    }
+
+    // release ChannelArrays, and any channels of our own
+    void close()
+    {
+        for(size_t i=0; i<lanes.size(); i++) {
+            if(lanes[i]->op)
+                lanes[i]->op->destroy();
+            lanes[i]->op.reset();
+            lanes[i]->connected = lanes[i]->busy = false;
+        }
+        for(size_t i=0; i<stripes.size(); i++)
+            stripes[i]->destroy();
+        stripes.clear();
+    }
+
+    void callEvent(CallbackGuard& G, pvac::ArrayEvent::event_t evt = pvac::ArrayEvent::Fail)
+    {
+        if(!cb) return;
+
+        close();
+
+        event.event = evt;
+        event.elapsed = epicsTime::getCurrent() - start;
+        pvac::ClientChannel::ArrayCallback *C=cb;
+        cb = 0;
+        {
+            CallbackUse U(G);
+            try {
+                C->arrayDone(event);
+            } catch(std::exception& e) {
+                LOG(pva::logLevelInfo, "Lost exception during arrayDone(): %s", e.what());
+            }
+        }
+        // don't hold a (large) result while the Operation lives on
+        event.value.clear();
+    }
+
+    void fail(CallbackGuard& G, const std::string& msg)
+    {
+        event.message = msg;
+        callEvent(G);
+    }
+
+    virtual std::string name() const OVERRIDE FINAL
+    {
+        return channelName;
+    }
+
+    // called automatically via wrapped_shared_from_this
+    virtual void cancel() OVERRIDE FINAL
+    {
+        // keepalive for safety in case callback wants to destroy us
+        std::tr1::shared_ptr<ArrayGetter> keepalive(internal_shared_from_this());
+        CallbackGuard G(*this);
+        callEvent(G, pvac::ArrayEvent::Cancel);
+        G.wait();
+    }
+
+    virtual void show(std::ostream &strm) const OVERRIDE FINAL
+    {
+        strm << "Operation(GetArray"
+                "\"" << name() <<"\""
+             ")";
+    }
+
+    void resize(CallbackGuard& G, size_t total)
+    {
+        sized = true;
+        event.total = total;
+        buffer = (*alloc)(total);
+        if(total==0u) {
+            event.value = pvd::freeze(buffer);
+            callEvent(G, pvac::ArrayEvent::Success);
+        }
+    }
+
+    // Issue the next chunk on each idle lane.
+    void dispatch()
+    {
+        // a ChannelArray may complete synchronously, and re-enter through laneDone().
+        // the outer call issues all chunks, so recursion is no deeper than one.
+        if(dispatching)
+            return;
+        dispatching = true;
+
+        bool issued = true;
+        while(issued && cb && sized) {
+            issued = false;
+            for(size_t i=0; i<lanes.size() && cb && next<event.total; i++) {
+                ArrayLane& lane = *lanes[i];
+                if(!lane.connected || lane.busy)
+                    continue;
+
+                lane.offset = next;
+                lane.count = std::min(opts.chunk, event.total - next);
+                lane.busy = true;
+                next += lane.count;
+                issued = true;
+
+                pva::ChannelArray::shared_pointer op(lane.op);
+                op->getArray(opts.offset + lane.offset, lane.count, 1u);
+            }
+        }
+
+        dispatching = false;
+    }
+
+    void laneConnect(ArrayLane& lane, const pvd::Status& status,
+                     const pva::ChannelArray::shared_pointer& channelArray,
+                     const pvd::Array::const_shared_pointer& array)
+    {
+        std::tr1::shared_ptr<ArrayGetter> keepalive(internal_shared_from_this());
+        CallbackGuard G(*this);
+        if(!cb) return;
+
+        if(!status.isSuccess()) {
+            fail(G, status.getMessage());
+            return;
+        }
+        if(!array || array->getType()!=pvd::scalarArray) {
+            fail(G, "Not a scalar array");
+            return;
+        }
+
+        const pvd::ScalarType atype = static_cast<const pvd::ScalarArray&>(*array).getElementType();
+        if(!typed) {
+            if(!elementOps(atype, alloc, copy)) {
+                fail(G, "Unsupported element type");
+                return;
+            }
+            type = atype;
+            elementSize = pvd::ScalarTypeFunc::elementSize(type);
+            typed = true;
+
+        } else if(atype!=type) {
+            fail(G, "Element type differs between channels");
+            return;
+        }
+
+        lane.op = channelArray;
+        lane.connected = true;
+
+        if(!sized && opts.count) {
+            resize(G, opts.count);
+
+        } else if(!sized && !lengthRequested) {
+            lengthRequested = true;
+            lane.busy = true;
+            channelArray->getLength();
+            return;
+        }
+
+        dispatch();
+    }
+
+    void laneLength(ArrayLane& lane, const pvd::Status& status, size_t length)
+    {
+        std::tr1::shared_ptr<ArrayGetter> keepalive(internal_shared_from_this());
+        CallbackGuard G(*this);
+        if(!cb) return;
+        lane.busy = false;
+
+        if(!status.isSuccess()) {
+            fail(G, status.getMessage());
+            return;
+        } else if(length<opts.offset) {
+            fail(G, "Offset beyond end of array");
+            return;
+        }
+
+        resize(G, length - opts.offset);
+        dispatch();
+    }
+
+    void laneDone(ArrayLane& lane, const pvd::Status& status,
+                  const pvd::PVArray::shared_pointer& pvArray)
+    {
+        std::tr1::shared_ptr<ArrayGetter> keepalive(internal_shared_from_this());
+        CallbackGuard G(*this);
+        if(!cb || !lane.busy) return;
+
+        if(!status.isSuccess()) {
+            fail(G, status.getMessage());
+            return;
+        }
+
+        pvd::PVScalarArray::shared_pointer arr(std::tr1::dynamic_pointer_cast<pvd::PVScalarArray>(pvArray));
+        if(!arr || arr->getScalarArray()->getElementType()!=type) {
+            fail(G, "Element type changed");
+            return;
+        } else if(arr->getLength()<lane.count) {
+            fail(G, "Array shorter than expected");
+            return;
+        }
+
+        const size_t count = lane.count;
+        void *dest = static_cast<char*>(buffer.data()) + lane.offset*elementSize;
+        std::string error;
+        {
+            // Copy w/o lock, so that lanes on different connections copy in parallel.
+            // 'buffer' is only allocated by resize(), once.
+            G.store.mutex.unlock();
+            try {
+                (*copy)(dest, *arr, count);
+            }catch(std::exception& e){
+                error = e.what();
+            }
+            G.store.mutex.lock();
+        }
+        if(!cb) {
+            return; // cancelled while copying
+        } else if(!error.empty()) {
+            fail(G, error);
+            return;
+        }
+
+        lane.busy = false;
+        event.received += count;
+        event.bytes += count*elementSize;
+
+        if(event.received==event.total) {
+            event.message.clear();
+            event.value = pvd::freeze(buffer);
+            callEvent(G, pvac::ArrayEvent::Success);
+            return;
+        }
+
+        {
+            pvac::ArrayEvent progress(event);
+            progress.event = pvac::ArrayEvent::Success;
+            progress.elapsed = epicsTime::getCurrent() - start;
+            pvac::ClientChannel::ArrayCallback *C=cb;
+            CallbackUse U(G);
+            try {
+                C->arrayProgress(progress);
+            } catch(std::exception& e) {
+                LOG(pva::logLevelInfo, "Lost exception during arrayProgress(): %s", e.what());
+            }
+        }
+
+        dispatch();
+    }
+
+    void laneDisconnect()
+    {
+        std::tr1::shared_ptr<ArrayGetter> keepalive(internal_shared_from_this());
+        CallbackGuard G(*this);
+        fail(G, "Disconnect");
+    }
+};
+
+size_t ArrayGetter::num_instances;
+
+std::string ArrayLane::getRequesterName()
+{
+    std::tr1::shared_ptr<ArrayGetter> O(owner.lock());
+    return O ? O->channelName : "<dead>";
+}
+
+void ArrayLane::channelArrayConnect(const pvd::Status& status,
+                                    pva::ChannelArray::shared_pointer const & channelArray,
+                                    pvd::Array::const_shared_pointer const & array)
+{
+    std::tr1::shared_ptr<ArrayGetter> O(owner.lock());
+    if(O)
+        O->laneConnect(*this, status, channelArray, array);
+}
+
+void ArrayLane::getArrayDone(const pvd::Status& status,
+                             pva::ChannelArray::shared_pointer const & channelArray,
+                             pvd::PVArray::shared_pointer const & pvArray)
+{
+    std::tr1::shared_ptr<ArrayGetter> O(owner.lock());
+    if(O)
+        O->laneDone(*this, status, pvArray);
+}
+
+void ArrayLane::getLengthDone(const pvd::Status& status,
+                              pva::ChannelArray::shared_pointer const & channelArray,
+                              size_t length)
+{
+    std::tr1::shared_ptr<ArrayGetter> O(owner.lock());
+    if(O)
+        O->laneLength(*this, status, length);
+}
+
+void ArrayLane::channelDisconnect(bool destroy)
+{
+    std::tr1::shared_ptr<ArrayGetter> O(owner.lock());
+    if(O)
+        O->laneDisconnect();
+}
+
+} //namespace
+
+namespace pvac {
+
+ClientChannel::ArrayOptions::ArrayOptions()
+    :offset(0u)
+    ,count(0u)
+    ,chunk(1024u*1024u)
+    ,inflight(4u)
+{}
+
+Operation
+ClientChannel::getArray(ClientChannel::ArrayCallback* cb,
+                        const ArrayOptions& opts,
+                        epics::pvData::PVStructure::const_shared_pointer pvRequest)
+{
+    if(!impl) throw std::logic_error("Dead Channel");
+    if(opts.chunk==0u || opts.inflight==0u)
+        throw std::logic_error("getArray() chunk and inflight must be non-zero");
+    if(!pvRequest)
+        pvRequest = pvd::createRequest("field(value)");
+
+    pva::Channel::shared_pointer chan(getChannel());
+    const pvd::PVStructure::shared_pointer request(std::tr1::const_pointer_cast<pvd::PVStructure>(pvRequest));
+
+    std::tr1::shared_ptr<ArrayGetter> ret(ArrayGetter::build(cb));
+    std::tr1::shared_ptr<ArrayGetter> inner(ret->internal_shared_from_this());
+
+    std::vector<pva::Channel::shared_pointer> channels;
+    {
+        Guard G(ret->mutex);
+        ret->opts = opts;
+        ret->channelName = chan->getChannelName();
+
+        channels.push_back(chan);
+        if(!opts.stripes.empty()) {
+            pva::ChannelProvider::shared_pointer provider(chan->getProvider());
+            if(!provider)
+                throw std::runtime_error("Dead provider");
+            for(size_t i=0; i<opts.stripes.size(); i++) {
+                ret->stripes.push_back(provider->createChannel(ret->channelName,
+                                                               pva::DefaultChannelRequester::build(),
+                                                               opts.stripes[i].priority,
+                                                               opts.stripes[i].address));
+                channels.push_back(ret->stripes.back());
+            }
+        }
+
+        for(size_t c=0; c<channels.size(); c++)
+            for(size_t i=0; i<opts.inflight; i++)
+                ret->lanes.push_back(std::tr1::shared_ptr<ArrayLane>(new ArrayLane(inner)));
+    }
+
+    // channelArrayConnect() may be called before createChannelArray() returns
+    for(size_t c=0, l=0; c<channels.size(); c++) {
+        for(size_t i=0; i<opts.inflight; i++, l++) {
+            pva::ChannelArray::shared_pointer op(channels[c]->createChannelArray(ret->lanes[l], request));
+            bool live;
+            {
+                Guard G(ret->mutex);
+                live = !!ret->cb;
+                if(live)
+                    ret->lanes[l]->op = op;
+            }
+            if(!live && op)
+                op->destroy(); // already complete or cancelled
+        }
+    }
+
+    return Operation(ret);
+}
+
+namespace detail {
+
+void registerRefTrackArray()
+{
+    epics::registerRefCounter("pvac::ArrayGetter", &ArrayGetter::num_instances);
+    epics::registerRefCounter("pvac::ArrayLane", &ArrayLane::num_instances);
+}
+
+}
+
+}//namespace pvac
@@ -422,5 +422,51 @@ ClientChannel::info(double timeout, const std::string& subfld)
     }
 }
 
+namespace {
+
+struct ArrayWait : public pvac::ClientChannel::ArrayCallback,
+                   public WaitCommon
+{
+    pvac::ArrayEvent result;
+
+    ArrayWait() {}
+    virtual ~ArrayWait() {}
+    virtual void arrayDone(const pvac::ArrayEvent& evt) OVERRIDE FINAL
+    {
+        {
+            Guard G(mutex);
+            if(done) {
+                LOG(pva::logLevelWarn, "oops, double event to ArrayCallback");
+            } else {
+                result = evt;
+                done = true;
+            }
+        }
+        event.signal();
+    }
+};
+
+} // namespace
+
+pvd::shared_vector<const void>
+ClientChannel::getArray(double timeout,
+                        const ArrayOptions& opts,
+                        epics::pvData::PVStructure::const_shared_pointer pvRequest)
+{
+    ArrayWait waiter;
+    {
+        Operation op(getArray(&waiter, opts, pvRequest));
+        waiter.wait(timeout);
+    }
+    switch(waiter.result.event) {
+    case ArrayEvent::Success:
+        return waiter.result.value;
+    case ArrayEvent::Fail:
+        throw std::runtime_error(waiter.result.message);
+    default:
+    case ArrayEvent::Cancel: // cancel implies timeout, which should already be thrown
+        THROW_EXCEPTION2(std::logic_error, "Cancelled!?!?");
+    }
+}
 
 }//namespace pvac
@@ -175,6 +175,7 @@ void registerRefTrackPut();
 void registerRefTrackMonitor();
 void registerRefTrackRPC();
 void registerRefTrackInfo();
+void registerRefTrackArray();
 
 }} // namespace pvac::detail
 
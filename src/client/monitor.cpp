@@ -5,9 +5,13 @@
 
 #include <sstream>
 #include <stdexcept>
+#include <algorithm>
+#include <map>
 
 #include <epicsGuard.h>
 #include <epicsMath.h>
+#include <epicsAtomic.h>
+#include <epicsThread.h>
 #include <pv/reftrack.h>
 
 #define epicsExportSharedSymbols
@@ -20,6 +24,129 @@ namespace pvd = epics::pvData;
 typedef epicsGuard<epicsMutex> Guard;
 typedef epicsGuardRelease<epicsMutex> UnGuard;
 
+namespace {
+using epics::pvAccess::MonitorFIFO;
+
+struct budget_t {
+    epicsMutex mutex;
+    // FIFOs open()'d while a limit is set.  Never locked while a FIFO mutex is held.
+    typedef std::map<MonitorFIFO*, std::tr1::weak_ptr<MonitorFIFO> > fifos_t;
+    fifos_t fifos;
+
+    // accessed with epicsAtomic
+    size_t limit,   // bytes.  0 disables
+           queued,  // bytes
+           nsquash,
+           nshed;
+    int busy; // relievePressure() in progress
+
+    budget_t() :limit(0u), queued(0u), nsquash(0u), nshed(0u), busy(0) {}
+} *budget;
+
+epicsThreadOnceId budgetOnce = EPICS_THREAD_ONCE_INIT;
+
+void budgetInit(void*)
+{
+    budget = new budget_t;
+}
+
+budget_t& getBudget()
+{
+    epicsThreadOnce(&budgetOnce, &budgetInit, 0);
+    assert(budget);
+    return *budget;
+}
+
+// Estimate of the serialized size of a field and its sub-fields
+size_t fieldBytes(const pvd::PVField& fld)
+{
+    size_t ret = 0u;
+    switch(fld.getField()->getType()) {
+    case pvd::scalar: {
+        const pvd::PVScalar& S(static_cast<const pvd::PVScalar&>(fld));
+        pvd::ScalarType stype(S.getScalar()->getScalarType());
+        if(stype==pvd::pvString)
+            ret = static_cast<const pvd::PVString&>(fld).get().size()+1u;
+        else
+            ret = pvd::ScalarTypeFunc::elementSize(stype);
+    }
+        break;
+    case pvd::scalarArray: {
+        const pvd::PVScalarArray& A(static_cast<const pvd::PVScalarArray&>(fld));
+        pvd::ScalarType stype(A.getScalarArray()->getElementType());
+        if(stype==pvd::pvString) {
+            pvd::PVStringArray::const_svector arr(static_cast<const pvd::PVStringArray&>(fld).view());
+            for(size_t i=0, N=arr.size(); i<N; i++)
+                ret += arr[i].size()+1u;
+        } else {
+            ret = A.getLength()*pvd::ScalarTypeFunc::elementSize(stype);
+        }
+    }
+        break;
+    case pvd::structure: {
+        const pvd::PVFieldPtrArray& flds(static_cast<const pvd::PVStructure&>(fld).getPVFields());
+        for(size_t i=0, N=flds.size(); i<N; i++)
+            ret += fieldBytes(*flds[i]);
+    }
+        break;
+    case pvd::structureArray: {
+        pvd::PVStructureArray::const_svector arr(static_cast<const pvd::PVStructureArray&>(fld).view());
+        for(size_t i=0, N=arr.size(); i<N; i++) {
+            if(arr[i])
+                ret += fieldBytes(*arr[i]);
+        }
+    }
+        break;
+    case pvd::union_: {
+        pvd::PVFieldPtr val(static_cast<const pvd::PVUnion&>(fld).get());
+        if(val)
+            ret = fieldBytes(*val);
+    }
+        break;
+    case pvd::unionArray: {
+        pvd::PVUnionArray::const_svector arr(static_cast<const pvd::PVUnionArray&>(fld).view());
+        for(size_t i=0, N=arr.size(); i<N; i++) {
+            if(arr[i])
+                ret += fieldBytes(*arr[i]);
+        }
+    }
+        break;
+    }
+    return ret;
+}
+
+// Estimate of the size of the changed fields of a queued element
+size_t elementBytes(const epics::pvAccess::MonitorElement& elem)
+{
+    const pvd::PVStructure& root(*elem.pvStructurePtr);
+    const pvd::BitSet& changed(*elem.changedBitSet);
+
+    if(changed.get(0))
+        return fieldBytes(root);
+
+    size_t ret = 0u;
+    for(pvd::int32 i=changed.nextSetBit(1); i>=0; ) {
+        pvd::PVField::const_shared_pointer fld(root.getSubField(size_t(i)));
+        if(!fld)
+            break;
+        ret += fieldBytes(*fld);
+        // skip over sub-fields already counted
+        i = changed.nextSetBit(fld->getNextFieldOffset());
+    }
+    return ret;
+}
+
+typedef std::pair<size_t, MonitorFIFO::shared_pointer> victim_t;
+typedef std::vector<victim_t> victims_t;
+
+struct largestFirst {
+    bool operator()(const victim_t& lhs, const victim_t& rhs) const {
+        return lhs.first > rhs.first;
+    }
+};
+
+} // namespace
+
 namespace epics {namespace pvAccess {
 
 MonitorFIFO::Config::Config()
@@ -51,6 +178,8 @@ MonitorFIFO::MonitorFIFO(const std::tr1::shared_ptr<MonitorRequester> &requester
     ,needClosed(false)
     ,freeHighLevel(0u)
     ,flowCount(0)
+    ,budgeted(false)
+    ,queuedBytes(0u)
 {
     REFTRACE_INCREMENT(num_instances);
 
@@ -95,6 +224,12 @@ MonitorFIFO::MonitorFIFO(const std::tr1::shared_ptr<MonitorRequester> &requester
 }
 
 MonitorFIFO::~MonitorFIFO() {
+    if(budgeted) {
+        budget_t& B(getBudget());
+        epics::atomic::subtract(B.queued, queuedBytes);
+        Guard G(B.mutex);
+        B.fifos.erase(this);
+    }
     REFTRACE_DECREMENT(num_instances);
 }
 
@@ -112,6 +247,9 @@ void MonitorFIFO::show(std::ostream& strm) const
 
     Guard G(mutex);
 
+    if(budgeted)
+        strm<<"  queuedBytes="<<queuedBytes<<"\n";
+
     switch(state) {
     case Closed: strm<<"  Closed"; break;
     case Opened: strm<<"  Opened"; break;
@@ -137,6 +275,7 @@ void MonitorFIFO::setFreeHighMark(double level)
 void MonitorFIFO::open(const pvd::StructureConstPtr& type)
 {
     std::string message;
+    bool doregister = false;
     {
         Guard G(mutex);
 
@@ -153,6 +292,13 @@ void MonitorFIFO::open(const pvd::StructureConstPtr& type)
         inuse.clear();
         returned.clear();
 
+        if(budgeted) {
+            epics::atomic::subtract(getBudget().queued, queuedBytes);
+            queuedBytes = 0u;
+        } else if(epics::atomic::get(getBudget().limit)!=0u) {
+            budgeted = doregister = true;
+        }
+
         // fill up empty.
         pvd::PVDataCreatePtr create(pvd::getPVDataCreate());
 
@@ -180,6 +326,16 @@ void MonitorFIFO::open(const pvd::StructureConstPtr& type)
         }
         needConnected = true;
     }
+    if(doregister) {
+        try {
+            std::tr1::weak_ptr<MonitorFIFO> self(shared_from_this());
+            budget_t& B(getBudget());
+            Guard G(B.mutex);
+            B.fifos[this] = self;
+        }catch(std::tr1::bad_weak_ptr&){
+            // not owned by a shared_ptr.  Counted, but can't be squashed
+        }
+    }
     if(message.empty()) return;
     requester_type::shared_pointer req(requester.lock());
     if(req) {
@@ -242,6 +398,7 @@ bool MonitorFIFO::tryPost(const pvData::PVStructure& value,
             if(inuse.empty() && running)
                 needEvent = true;
             inuse.push_back(elem);
+            _addBytes(*elem);
         }catch(...){
             if(havefree) {
                 empty.push_front(elem);
@@ -286,6 +443,9 @@ void MonitorFIFO::post(const pvData::PVStructure& value,
     if(conf.dropEmptyUpdates && !changed.logical_and(mapper.requestedMask()))
         return; // drop empty update
 
+    if(!use_empty)
+        _subBytes(*elem);
+
     scratch.clear();
     mapper.copyBaseToRequested(value, changed, *elem->pvStructurePtr, scratch);
 
@@ -313,6 +473,7 @@ void MonitorFIFO::post(const pvData::PVStructure& value,
 
         // leave as inuse.back()
     }
+    _addBytes(*elem);
 }
 
 void MonitorFIFO::notify()
@@ -325,6 +486,19 @@ void MonitorFIFO::notify()
          unl = false,
          clo = false;
     pvd::Status err;
+    bool overbudget = false;
+
+    {
+        Guard G(mutex);
+
+        if(budgeted) {
+            const size_t limit = epics::atomic::get(getBudget().limit);
+            overbudget = limit!=0u && epics::atomic::get(getBudget().queued) > limit;
+        }
+    }
+
+    if(overbudget)
+        relievePressure(); // may recursively notify() ourself
 
     {
         Guard G(mutex);
@@ -406,6 +580,7 @@ MonitorElementPtr MonitorFIFO::poll()
         if(!inuse.empty() && inuse.size() + empty.size() > 1) {
             ret = inuse.front();
             inuse.pop_front();
+            _subBytes(*ret);
             if(inuse.empty() && finished) {
                 self = shared_from_this();
                 req = requester.lock();
@@ -464,6 +639,8 @@ void MonitorFIFO::getStats(Stats& s) const
     s.nempty = empty.size() + returned.size();
     s.nfilled = inuse.size();
     s.noutstanding = conf.actualCount - s.nempty - s.nfilled;
+    s.nmerged = s.nmergedmax = 0;
+    s.window = pipeline ? conf.actualCount : 0u;
 }
 
 void MonitorFIFO::reportRemoteQueueStatus(pvd::int32 nfree)
@@ -514,4 +691,153 @@ size_t MonitorFIFO::_freeCount() const
     }
 }
 
+// caller must hold lock.  elem is being added to inuse, or has been modified while on it
+void MonitorFIFO::_addBytes(const MonitorElement& elem)
+{
+    if(!budgeted) return;
+    size_t nbytes = elementBytes(elem);
+    queuedBytes += nbytes;
+    epics::atomic::add(getBudget().queued, nbytes);
+}
+
+// caller must hold lock.  elem is being removed from inuse, or is about to be modified
+void MonitorFIFO::_subBytes(const MonitorElement& elem)
+{
+    if(!budgeted) return;
+    size_t nbytes = std::min(queuedBytes, elementBytes(elem));
+    queuedBytes -= nbytes;
+    epics::atomic::subtract(getBudget().queued, nbytes);
+}
+
+// Combine all queued elements into the oldest, as post() does when in overflow.
+// returns true if any elements were free'd
+bool MonitorFIFO::squash()
+{
+    Guard G(mutex);
+
+    if(state!=Opened || inuse.size()<2u)
+        return false;
+
+    const size_t nfree = inuse.size()-1u;
+    MonitorElementPtr& dest(inuse.front());
+    _subBytes(*dest);
+
+    buffer_t::iterator it(inuse.begin()), end(inuse.end());
+    for(++it; it!=end; ++it) {
+        MonitorElement& src(**it);
+        _subBytes(src);
+
+        dest->overrunBitSet->or_and(*dest->changedBitSet, *src.changedBitSet);
+        *dest->overrunBitSet |= *src.overrunBitSet;
+        dest->pvStructurePtr->copyUnchecked(*src.pvStructurePtr, *src.changedBitSet);
+        *dest->changedBitSet |= *src.changedBitSet;
+    }
+    _addBytes(*dest);
+
+    it = inuse.begin();
+    empty.splice(empty.end(), inuse, ++it, end);
+    if(pipeline)
+        flowCount += epicsInt32(nfree);
+
+    return true;
+}
+
+// Discard queued elements and end the subscription, as with finish()
+// returns true if the subscription was ended.
+bool MonitorFIFO::shed()
+{
+    requester_type::shared_pointer req;
+    {
+        Guard G(mutex);
+
+        if(state!=Opened || finished)
+            return false;
+
+        for(buffer_t::const_iterator it(inuse.begin()), end(inuse.end()); it!=end; ++it)
+            _subBytes(**it);
+        if(pipeline)
+            flowCount += epicsInt32(inuse.size());
+        empty.splice(empty.end(), inuse);
+
+        finished = true;
+        if(running)
+            needUnlisten = true;
+
+        req = requester.lock();
+    }
+    if(req)
+        req->message("Subscription ended as server monitor queue budget is exceeded", warningMessage);
+    return true;
+}
+
+void MonitorFIFO::relievePressure()
+{
+    budget_t& B(getBudget());
+
+    if(epics::atomic::compareAndSwap(B.busy, 0, 1)!=0)
+        return; // already in progress, maybe recursively from notify() below
+
+    victims_t victims;
+    {
+        Guard G(B.mutex);
+        victims.reserve(B.fifos.size());
+        for(budget_t::fifos_t::const_iterator it(B.fifos.begin()), end(B.fifos.end()); it!=end; ++it) {
+            MonitorFIFO::shared_pointer fifo(it->second.lock());
+            if(fifo)
+                victims.push_back(std::make_pair(0u, fifo));
+        }
+    }
+
+    const size_t limit = epics::atomic::get(B.limit);
+
+    // rank by queued bytes, the furthest behind first
+    for(size_t i=0; i<victims.size(); i++) {
+        Guard G(victims[i].second->mutex);
+        victims[i].first = victims[i].second->queuedBytes;
+    }
+    std::stable_sort(victims.begin(), victims.end(), largestFirst());
+
+    // first squash queues
+    for(size_t i=0; i<victims.size() && epics::atomic::get(B.queued) > limit; i++) {
+        if(victims[i].second->squash())
+            epics::atomic::increment(B.nsquash);
+    }
+
+    // then, if pressure continues, disconnect the worst offenders
+    victims_t shedding;
+    if(epics::atomic::get(B.queued) > limit) {
+        for(size_t i=0; i<victims.size(); i++) {
+            Guard G(victims[i].second->mutex);
+            victims[i].first = victims[i].second->queuedBytes;
+        }
+        std::stable_sort(victims.begin(), victims.end(), largestFirst());
+
+        for(size_t i=0; i<victims.size() && epics::atomic::get(B.queued) > limit; i++) {
+            if(victims[i].second->shed()) {
+                epics::atomic::increment(B.nshed);
+                shedding.push_back(victims[i]);
+            }
+        }
+    }
+
+    for(size_t i=0; i<shedding.size(); i++)
+        shedding[i].second->notify();
+
+    epics::atomic::set(B.busy, 0);
+}
+
+void MonitorFIFO::setBudget(size_t limit)
+{
+    epics::atomic::set(getBudget().limit, limit);
+}
+
+void MonitorFIFO::getBudgetStats(BudgetStats& s)
+{
+    budget_t& B(getBudget());
+    s.limit = epics::atomic::get(B.limit);
+    s.queued = epics::atomic::get(B.queued);
+    s.nsquash = epics::atomic::get(B.nsquash);
+    s.nshed = epics::atomic::get(B.nshed);
+}
+
 }} // namespace epics::pvAccess
@@ -101,10 +101,15 @@ class epicsShareClass Monitor : public virtual Destroyable{
         size_t nfilled; //!< # of elements ready to be poll()d
         size_t noutstanding; //!< # of elements poll()d but not released()d
         size_t nempty; //!< # of elements available for new remote data
+        size_t nmerged; //!< # of updates merged into an element which had not yet been poll()d
+        size_t nmergedmax; //!< largest # of updates merged into a single element
+        size_t window; //!< # of updates the server may send ahead of release() (pipeline=true), or 0
     };
 
     virtual void getStats(Stats& s) const {
         s.nfilled = s.noutstanding = s.nempty = 0;
+        s.nmerged = s.nmergedmax = 0;
+        s.window = 0;
     }
 
     /**
@@ -342,9 +347,39 @@ public:
 
     //! Number of unused FIFO slots at this moment, which may changed in the next.
     size_t freeCount() const;
+
+    // process-wide limit on memory held in FIFOs
+
+    //! Counters for the process-wide queue budget.  cf. setBudget()
+    struct BudgetStats {
+        size_t limit;   //!< Configured limit in bytes.  0 when disabled.
+        size_t queued;  //!< Estimated bytes currently queued in all budgeted FIFOs.
+        size_t nsquash; //!< # of times a FIFO had its queue squashed to relieve pressure.
+        size_t nshed;   //!< # of subscriptions ended to relieve pressure.
+    };
+
+    /** Limit the (estimated) total number of bytes held in the queues of all MonitorFIFO instances.
+     *
+     * Applies to FIFOs open()'d after this call.  When the limit is exceeded,
+     * the queues of the FIFOs holding the most bytes (furthest behind consumers) are
+     * squashed into a single element, as post() does on overflow.
+     * If squashing all queues does not bring the total under the limit,
+     * then the largest subscriptions are ended (as with finish() ) until it does.
+     *
+     * @param limit Limit in bytes.  0 (the default) disables.
+     */
+    static void setBudget(size_t limit);
+    //! Fetch current budget usage, and counts of shedding events.
+    static void getBudgetStats(BudgetStats& s);
 private:
     size_t _freeCount() const;
 
+    void _addBytes(const MonitorElement& elem);
+    void _subBytes(const MonitorElement& elem);
+    bool squash();
+    bool shed();
+    static void relievePressure();
+
     friend void providerRegInit(void*);
     static size_t num_instances;
 
@@ -400,6 +435,9 @@ private:
     size_t freeHighLevel;
     epicsInt32 flowCount;
 
+    bool budgeted; // counting towards process-wide budget.  const after open()
+    size_t queuedBytes; // estimated size of elements in inuse list when budgeted
+
     epics::pvData::PVRequestMapper mapper;
 
     typedef std::list<MonitorElementPtr> buffer_t;
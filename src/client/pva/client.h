@@ -8,6 +8,7 @@
 #include <ostream>
 #include <stdexcept>
 #include <list>
+#include <vector>
 
 #include <epicsMutex.h>
 
@@ -111,6 +112,24 @@ struct epicsShareClass InfoEvent : public PutEvent
     epics::pvData::FieldConstPtr type;
 };
 
+//! Information on progress, and completion, of ClientChannel::getArray()
+//! @since 7.1.6
+struct epicsShareClass ArrayEvent : public PutEvent
+{
+    //! Elements received so far
+    size_t received;
+    //! Elements to be received.  0 until known
+    size_t total;
+    //! Bytes received so far
+    size_t bytes;
+    //! Seconds since the operation began.  bytes/elapsed is the throughput
+    double elapsed;
+    //! The complete array.  value.original_type() is the element type.  Empty unless event==Success
+    epics::pvData::shared_vector<const void> value;
+
+    ArrayEvent() :received(0u), total(0u), bytes(0u), elapsed(0.0) {}
+};
+
 struct MonitorSync;
 
 //! Handle for monitor subscription
@@ -444,6 +463,52 @@ public:
     epics::pvData::FieldConstPtr info(double timeout = 3.0,
                                       const std::string& subfld = std::string());
 
+    //! callbacks for getArray()
+    struct ArrayCallback {
+        virtual ~ArrayCallback() {}
+        //! A chunk has been received.  evt.value is empty.
+        virtual void arrayProgress(const ArrayEvent& evt) {}
+        //! getArray operation is complete
+        virtual void arrayDone(const ArrayEvent& evt) =0;
+    };
+
+    //! Range and concurrency of getArray()
+    struct epicsShareClass ArrayOptions {
+        size_t offset;   //!< Index of the first element.  default 0
+        size_t count;    //!< Number of elements.  default 0, to the end of the array
+        size_t chunk;    //!< Elements per request.  default 1048576
+        size_t inflight; //!< Requests in flight on each channel.  default 4
+        /** Also connect a channel to this PV with each of these Options, and stripe chunks across all.
+         *  Channels with different Options::priority use different TCP connections to a PVA server.
+         */
+        std::vector<Options> stripes;
+        ArrayOptions();
+    };
+
+    /** Fetch a range of the 'value' array of this PV through epics::pvAccess::ChannelArray,
+     *  as concurrent chunks reassembled into one array allocated when the length is known.
+     *
+     * Each chunk is a separate ChannelArray::getArray(), so that one transfer does not delay
+     * other operations on the connection for long.  With 'inflight' requests on each channel,
+     * transfer is pipelined.  Chunks received on different connections are copied in parallel.
+     *
+     * @param cb Completion notification callback.  Must outlive Operation (call Operation::cancel() to force release)
+     * @param pvRequest if NULL defaults to "field(value)".
+     * @since 7.1.6
+     */
+    Operation getArray(ArrayCallback* cb,
+                       const ArrayOptions& opts = ArrayOptions(),
+                       epics::pvData::PVStructure::const_shared_pointer pvRequest = epics::pvData::PVStructure::const_shared_pointer());
+
+    //! Block and fetch a range of an array, as getArray(ArrayCallback*, ...)
+    //! @param timeout in seconds, of the entire transfer
+    //! @throws Timeout or std::runtime_error
+    //! @since 7.1.6
+    epics::pvData::shared_vector<const void>
+    getArray(double timeout,
+             const ArrayOptions& opts = ArrayOptions(),
+             epics::pvData::PVStructure::const_shared_pointer pvRequest = epics::pvData::PVStructure::const_shared_pointer());
+
     //! Connection state change CB
     struct ConnectCallback {
         virtual ~ConnectCallback() {}
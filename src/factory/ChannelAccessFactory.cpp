@@ -229,7 +229,9 @@ void providerRegInit(void*)
     registerRefCounter("pvas::SharedChannel", &pvas::detail::SharedChannel::num_instances);
     registerRefCounter("pvas::SharedPut", &pvas::detail::SharedPut::num_instances);
     registerRefCounter("pvas::SharedRPC", &pvas::detail::SharedRPC::num_instances);
+    registerRefCounter("pvas::SharedArray", &pvas::detail::SharedArray::num_instances);
     registerRefCounter("pvas::SharedPV", &pvas::SharedPV::num_instances);
+    registerRefCounter("pvas::Executor", &pvas::Executor::num_instances);
 }
 
 ChannelProviderRegistry::shared_pointer ChannelProviderRegistry::clients()
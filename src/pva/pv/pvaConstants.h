@@ -78,6 +78,12 @@ const epics::pvData::int16 INVALID_DATA_TYPE = 0xFFFF;
 /** Invalid IOID. */
 const epics::pvData::int32 INVALID_IOID = 0;
 
+/** Connection validation extension flag.  Peer keeps a TypeDictionary ($EPICS_PVA_TYPE_CACHE). */
+const epics::pvData::int8 PVA_VALIDATION_TYPE_DICTIONARY = 0x01;
+
+/** Monitor INIT response extension flag.  Updates are sent to a multicast group (MulticastPublisher). */
+const epics::pvData::int8 PVA_MONITOR_MULTICAST = 0x01;
+
 /** Default PVA provider name. */
 epicsShareExtern const std::string PVACCESS_DEFAULT_PROVIDER;
 
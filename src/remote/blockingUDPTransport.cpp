@@ -582,7 +582,8 @@ void initializeUDPTransports(bool serverFlag,
                              int32& listenPort,
                              bool autoAddressList,
                              const std::string& addressList,
-                             const std::string& ignoreAddressList)
+                             const std::string& ignoreAddressList,
+                             bool listen)
 {
     BlockingUDPConnector connector(serverFlag);
 
@@ -694,6 +695,11 @@ void initializeUDPTransports(bool serverFlag,
     sendTransport->start();
     udpTransports.push_back(sendTransport);
 
+    // replies to sendTransport are all that is needed to search.
+    // The listeners below only receive beacons (client) or searches (server).
+    if (!listen)
+        return;
+
     // TODO configurable local NIF, address
     osiSockAddr loAddr;
     memset(&loAddr, 0, sizeof(loAddr));
@@ -63,6 +63,8 @@ static const double ATOMIC_PERIOD = 0.225;
 static const double PERIOD_JITTER_MS = 0.025;
 
 static const int DEFAULT_USER_VALUE = 1;
+// first periodic search after 2 periods
+static const int DEFERRED_USER_VALUE = 3;
 static const int BOOST_VALUE = 1;
 // must be power of two (so that search is done)
 static const int MAX_COUNT_VALUE = 1 << 8;
@@ -152,6 +154,46 @@ void ChannelSearchManager::registerSearchInstance(SearchInstance::shared_pointer
         callback();
 }
 
+void ChannelSearchManager::registerSearchInstance(SearchInstance::shared_pointer const & channel, const osiSockAddr& server)
+{
+    if (m_canceled.get())
+        return;
+
+    {
+        Lock guard(m_channelMutex);
+
+        // overrides if already registered
+        m_channels[channel->getSearchInstanceID()] = channel;
+
+        Lock guard2(m_userValueMutex);
+        int32_t& userValue = channel->getUserValue();
+        userValue = DEFERRED_USER_VALUE;
+    }
+
+    Transport::shared_pointer tt;
+    {
+        Context::shared_pointer context(m_context.lock());
+        if (!context)
+            return;
+        tt = context->getSearchTransport();
+    }
+    BlockingUDPTransport::shared_pointer ut = std::tr1::static_pointer_cast<BlockingUDPTransport>(tt);
+    if (!ut)
+        return;
+
+    // separate buffer as m_sendBuffer may be partially filled by callback()
+    ByteBuffer buffer(MAX_UDP_UNFRAGMENTED_SEND);
+    MockTransportSendControl control;
+    {
+        Lock guard(m_mutex);
+        initializeSendBuffer(&buffer);
+    }
+    generateSearchRequestMessage(channel, &buffer, &control);
+
+    buffer.putByte(CAST_POSITION, (int8_t)0x80);  // unicast, no reply required
+    ut->send(&buffer, server);
+}
+
 void ChannelSearchManager::unregisterSearchInstance(SearchInstance::shared_pointer const & channel)
 {
     Lock guard(m_channelMutex);
@@ -201,35 +243,39 @@ void ChannelSearchManager::initializeSendBuffer()
     // for now OK, since it is only set here
     m_sequenceNumber++;
 
+    initializeSendBuffer(&m_sendBuffer);
+}
 
+void ChannelSearchManager::initializeSendBuffer(ByteBuffer* buffer)
+{
     // new buffer
-    m_sendBuffer.clear();
-    m_sendBuffer.putByte(PVA_MAGIC);
-    m_sendBuffer.putByte(PVA_CLIENT_PROTOCOL_REVISION);
-    m_sendBuffer.putByte((EPICS_BYTE_ORDER == EPICS_ENDIAN_BIG) ? 0x80 : 0x00); // data + 7-bit endianess
-    m_sendBuffer.putByte(CMD_SEARCH);
-    m_sendBuffer.putInt(4+1+3+16+2+1);      // "zero" payload
-    m_sendBuffer.putInt(m_sequenceNumber);
+    buffer->clear();
+    buffer->putByte(PVA_MAGIC);
+    buffer->putByte(PVA_CLIENT_PROTOCOL_REVISION);
+    buffer->putByte((EPICS_BYTE_ORDER == EPICS_ENDIAN_BIG) ? 0x80 : 0x00); // data + 7-bit endianess
+    buffer->putByte(CMD_SEARCH);
+    buffer->putInt(4+1+3+16+2+1);      // "zero" payload
+    buffer->putInt(m_sequenceNumber);
 
     // multicast vs unicast mask
     // This is CAST_POSITION, which is overwritten before send
-    m_sendBuffer.putByte((int8_t)0);
+    buffer->putByte((int8_t)0);
 
     // reserved part
-    m_sendBuffer.putByte((int8_t)0);
-    m_sendBuffer.putShort((int16_t)0);
+    buffer->putByte((int8_t)0);
+    buffer->putShort((int16_t)0);
 
     // NOTE: is it possible (very likely) that address is any local address ::ffff:0.0.0.0
-    encodeAsIPv6Address(&m_sendBuffer, &m_responseAddress);
-    m_sendBuffer.putShort((int16_t)ntohs(m_responseAddress.ia.sin_port));
+    encodeAsIPv6Address(buffer, &m_responseAddress);
+    buffer->putShort((int16_t)ntohs(m_responseAddress.ia.sin_port));
 
     // TODO now only TCP is supported
     // note: this affects DATA_COUNT_POSITION
-    m_sendBuffer.putByte((int8_t)1);
+    buffer->putByte((int8_t)1);
 
     MockTransportSendControl control;
-    SerializeHelper::serializeString("tcp", &m_sendBuffer, &control);
-    m_sendBuffer.putShort((int16_t)0);  // count
+    SerializeHelper::serializeString("tcp", buffer, &control);
+    buffer->putShort((int16_t)0);  // count
 }
 
 void ChannelSearchManager::flushSendBuffer()
@@ -990,7 +990,29 @@ bool AbstractCodec::directSerialize(ByteBuffer* /*existingBuffer*/, const char*
 bool AbstractCodec::directDeserialize(ByteBuffer *existingBuffer, char* deserializeTo,
                                       std::size_t elementCount, std::size_t elementSize)
 {
-    return false;
+    std::size_t count = elementCount * elementSize;
+
+    // same threshold as directSerialize()
+    if (existingBuffer!=&_socketBuffer || count < 64*1024)
+        return false;
+
+    // only called by pvData for arrays in native byte order.
+    // copy out whole elements as they arrive, across SPLIT and SEGMENTED messages.
+    while (count) {
+        std::size_t avail = _socketBuffer.getRemaining();
+        if (avail < elementSize) {
+            ensureData(elementSize);
+            avail = _socketBuffer.getRemaining();
+        }
+        std::size_t n = std::min(count, avail - avail%elementSize);
+
+        _socketBuffer.getArray(deserializeTo, n);
+
+        deserializeTo += n;
+        count -= n;
+    }
+
+    return true;
 }
 
 //
@@ -1247,6 +1269,7 @@ BlockingTCPTransportCodec::BlockingTCPTransportCodec(bool serverFlag, const Cont
     ,_remoteTransportReceiveBufferSize(MAX_TCP_RECV)
     ,_priority(priority)
     ,_verified(false)
+    ,_typeCache(context->getConfiguration()->getPropertyAsBoolean("EPICS_PVA_TYPE_CACHE", false))
 {
     REFTRACE_INCREMENT(num_instances);
 
@@ -1577,6 +1600,12 @@ void BlockingServerTCPTransportCodec::send(ByteBuffer* buffer,
             advertisedAuthPlugins.swap(validSPNames);
         }
 
+        // optional extensions, ignored by older clients
+        if(_typeCache) {
+            control->ensureBuffer(1);
+            buffer->putByte(PVA_VALIDATION_TYPE_DICTIONARY);
+        }
+
         // send immediately
         control->flush(true);
     }
@@ -1601,22 +1630,28 @@ void BlockingServerTCPTransportCodec::send(ByteBuffer* buffer,
 }
 
 void BlockingServerTCPTransportCodec::destroyAllChannels() {
-    Lock lock(_channelsMutex);
-    if(_channels.size()==0) return;
-
-    if (IS_LOGGABLE(logLevelDebug))
+    _channels_t temp;
     {
-        LOG(
-            logLevelDebug,
-            "Transport to %s still has %zu channel(s) active and closing...",
-            _socketName.c_str(), _channels.size());
-    }
+        Lock lock(_channelsMutex);
+        if(_channels.size()==0) return;
 
-    _channels_t temp;
-    temp.swap(_channels);
+        if (IS_LOGGABLE(logLevelDebug))
+        {
+            LOG(
+                logLevelDebug,
+                "Transport to %s still has %zu channel(s) active and closing...",
+                _socketName.c_str(), _channels.size());
+        }
+
+        temp.swap(_channels);
+    }
 
+    // detach every channel first, then destroy all of their requests in one pass
+    ServerChannel::requests_t reqs;
     for(_channels_t::iterator it(temp.begin()), end(temp.end()); it!=end; ++it)
-        it->second->destroy();
+        it->second->detach(reqs);
+
+    ServerChannel::destroyRequests(reqs);
 }
 
 void BlockingServerTCPTransportCodec::internalClose() {
@@ -1659,6 +1694,14 @@ void BlockingServerTCPTransportCodec::authenticationCompleted(epics::pvData::Sta
     }
 }
 
+void BlockingServerTCPTransportCodec::peerTypeHashes(const TypeDictionary::hashes_t& hashes)
+{
+    // called from the receive thread before the connection is verified,
+    // so before anything is serialized with _outgoingIR by the send thread.
+    if(_typeCache)
+        _outgoingIR.setPeerHashes(hashes);
+}
+
 void BlockingServerTCPTransportCodec::authNZInitialize(const std::string& securityPluginName,
                                                        const epics::pvData::PVStructure::shared_pointer& data)
 {
@@ -1882,6 +1925,26 @@ void BlockingClientTCPTransportCodec::send(ByteBuffer* buffer,
             SerializationHelper::serializeNullField(buffer, control);
         }
 
+        TypeDictionary::shared_pointer dict;
+        {
+            Guard G(_mutex);
+            dict = _typeDictionary;
+        }
+
+        if(dict) {
+            // types we already know, which the server need not send again
+            TypeDictionary::hashes_t hashes;
+            dict->hashes(hashes);
+
+            control->ensureBuffer(1);
+            buffer->putByte(PVA_VALIDATION_TYPE_DICTIONARY);
+            SerializeHelper::writeSize(hashes.size(), buffer, control);
+            for(size_t i=0; i<hashes.size(); i++) {
+                control->ensureBuffer(8);
+                buffer->putLong(int64(hashes[i]));
+            }
+        }
+
         // send immediately
         control->flush(true);
     }
@@ -1940,6 +2003,19 @@ void BlockingClientTCPTransportCodec::authNZInitialize(const std::vector<std::st
     enqueueSendRequest(transportSender);
 }
 
+void BlockingClientTCPTransportCodec::typeDictionaryOffered()
+{
+    if(!_typeCache)
+        return;
+
+    TypeDictionary::shared_pointer dict(TypeDictionary::clients());
+    // receive thread
+    _incomingIR.setDictionary(dict);
+
+    Guard G(_mutex);
+    _typeDictionary = dict;
+}
+
 void BlockingClientTCPTransportCodec::authenticationCompleted(epics::pvData::Status const & status,
                                                               const std::tr1::shared_ptr<PeerInfo>& peer)
 {
@@ -403,7 +403,8 @@ void initializeUDPTransports(
     epics::pvData::int32& listenPort,
     bool autoAddressList,
     const std::string& addressList,
-    const std::string& ignoreAddressList);
+    const std::string& ignoreAddressList,
+    bool listen = true);
 
 
 }
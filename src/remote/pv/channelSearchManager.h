@@ -73,6 +73,14 @@ public:
      * @param channel to register.
      */
     void registerSearchInstance(SearchInstance::shared_pointer const & channel, bool penalize = false);
+    /**
+     * Register channel whose server is (probably) already known.
+     * A search request is sent immediately to only this server.
+     * Periodic (broadcast) searching begins after a short delay if no response arrives.
+     * @param channel to register.
+     * @param server where to send the first search request.
+     */
+    void registerSearchInstance(SearchInstance::shared_pointer const & channel, const osiSockAddr& server);
     /**
      * Unregister channel.
      * @param channel to unregister.
@@ -116,6 +124,7 @@ private:
     void boost();
 
     void initializeSendBuffer();
+    void initializeSendBuffer(epics::pvData::ByteBuffer* buffer);
     void flushSendBuffer();
 
     static bool isPowerOfTwo(int32_t x);
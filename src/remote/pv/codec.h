@@ -434,6 +434,9 @@ private:
 protected:
     bool _verified;
     epics::pvData::Event _verifiedEvent;
+
+    // $EPICS_PVA_TYPE_CACHE
+    const bool _typeCache;
 };
 
 class BlockingServerTCPTransportCodec :
@@ -517,6 +520,9 @@ public:
     void authNZInitialize(const std::string& securityPluginName,
                           const epics::pvData::PVStructure::shared_pointer& data);
 
+    //! Types already known to the client, from its connection validation response.
+    void peerTypeHashes(const TypeDictionary::hashes_t& hashes);
+
     virtual void authenticationCompleted(epics::pvData::Status const & status,
                                          const std::tr1::shared_ptr<PeerInfo>& peer) OVERRIDE FINAL;
 
@@ -617,6 +623,9 @@ public:
 
     void authNZInitialize(const std::vector<std::string>& offeredSecurityPlugins);
 
+    //! Server offered to refer to known types by hash.  Call before authNZInitialize()
+    void typeDictionaryOffered();
+
     virtual void authenticationCompleted(epics::pvData::Status const & status,
                                          const std::tr1::shared_ptr<PeerInfo>& peer) OVERRIDE FINAL;
 
@@ -644,6 +653,9 @@ private:
     // are we queued to send verify or echo?
     bool sendQueued;
 
+    // announced to the server in the verify response
+    TypeDictionary::shared_pointer _typeDictionary;
+
     /**
      * Notifies clients about disconnect.
      */
@@ -105,7 +105,8 @@ enum ApplicationCommands {
     CMD_MULTIPLE_DATA = 19,
     CMD_RPC = 20,
     CMD_CANCEL_REQUEST = 21,
-    CMD_ORIGIN_TAG = 22
+    CMD_ORIGIN_TAG = 22,
+    CMD_MULTICAST_DATA = 23
 };
 
 enum ControlCommands {
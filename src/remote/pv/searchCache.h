@@ -0,0 +1,108 @@
+/**
+ * Copyright - See the COPYRIGHT that is included with this distribution.
+ * pvAccessCPP is distributed subject to a Software License Agreement found
+ * in file LICENSE that is included with this distribution.
+ */
+
+#ifndef SEARCHCACHE_H
+#define SEARCHCACHE_H
+
+#include <map>
+#include <string>
+
+#ifdef epicsExportSharedSymbols
+#   define searchCacheEpicsExportSharedSymbols
+#   undef epicsExportSharedSymbols
+#endif
+
+#include <osiSock.h>
+#include <epicsMutex.h>
+
+#include <pv/sharedPtr.h>
+#include <pv/noDefaultMethods.h>
+
+#ifdef searchCacheEpicsExportSharedSymbols
+#   define epicsExportSharedSymbols
+#       undef searchCacheEpicsExportSharedSymbols
+#endif
+
+#include <shareLib.h>
+
+#include <pv/pvaDefs.h>
+#include <pv/inetAddressUtil.h>
+
+namespace epics {
+namespace pvAccess {
+
+/**
+ * Remembers which server last answered a search for a channel name.
+ *
+ * Kept in a file so that short lived clients (eg. pvget) can skip
+ * broadcast searching for names found by a previous invocation.
+ * The file is merged, not overwritten, on save() so that several
+ * processes may share one cache.
+ *
+ * All entries of a server are dropped when it is seen again at the same
+ * address with a different GUID (ie. it was restarted).
+ */
+class epicsShareClass SearchCache
+{
+public:
+    POINTER_DEFINITIONS(SearchCache);
+
+    struct Entry {
+        //! TCP address of the server
+        osiSockAddr address;
+        ServerGUID guid;
+        //! POSIX time of the last search response
+        epicsUInt32 updated;
+    };
+
+    /**
+     * @param fname cache file name
+     * @param maxAge entries older than this (in seconds) are ignored.  <=0 for no limit.
+     */
+    SearchCache(const std::string& fname, double maxAge);
+    ~SearchCache();
+
+    //! Merge entries from the cache file.  A missing or unreadable file is not an error.
+    void load();
+    //! Merge with the present file content and write back, if anything has changed.
+    void save();
+
+    //! Lookup a channel name.
+    //! @returns false if there is no (sufficiently recent) entry
+    bool lookup(const std::string& name, Entry& entry) const;
+    //! Record a search response
+    void update(const std::string& name, const osiSockAddr& address, const ServerGUID& guid);
+    //! Forget a channel name, eg. if the cached server no longer has it.
+    void remove(const std::string& name);
+
+    size_t size() const;
+
+    const std::string& filename() const { return fname; }
+
+private:
+    typedef std::map<std::string, Entry> entries_t;
+    typedef std::map<osiSockAddr, ServerGUID, comp_osiSock_lt> servers_t;
+
+    bool expired(const Entry& ent, epicsUInt32 now) const;
+    static void read(const std::string& fname, entries_t& entries);
+    void merge(const entries_t& entries);
+    void invalidate(const osiSockAddr& address, const ServerGUID& guid);
+
+    const std::string fname;
+    const double maxAge;
+
+    mutable epicsMutex mutex;
+    entries_t entries;
+    //! last known GUID at each server address
+    servers_t servers;
+    bool dirty;
+
+    EPICS_NOT_COPYABLE(SearchCache)
+};
+
+}}
+
+#endif // SEARCHCACHE_H
@@ -0,0 +1,288 @@
+/**
+ * Copyright - See the COPYRIGHT that is included with this distribution.
+ * pvAccessCPP is distributed subject to a Software License Agreement found
+ * in file LICENSE that is included with this distribution.
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <string.h>
+
+#include <fstream>
+#include <sstream>
+
+#include <osiSock.h>
+#include <epicsGuard.h>
+
+#define epicsExportSharedSymbols
+#include <pv/searchCache.h>
+#include <pv/logger.h>
+
+typedef epicsGuard<epicsMutex> Guard;
+
+namespace {
+
+const char hexchars[] = "0123456789abcdef";
+
+std::string guid2hex(const epics::pvAccess::ServerGUID& guid)
+{
+    std::string ret(2u*sizeof(guid.value), '0');
+    for(size_t i=0; i<sizeof(guid.value); i++) {
+        unsigned char c = guid.value[i];
+        ret[2*i]   = hexchars[c>>4];
+        ret[2*i+1] = hexchars[c&0xf];
+    }
+    return ret;
+}
+
+int hexval(char c)
+{
+    if(c>='0' && c<='9') return c-'0';
+    if(c>='a' && c<='f') return c-'a'+10;
+    if(c>='A' && c<='F') return c-'A'+10;
+    return -1;
+}
+
+bool hex2guid(const std::string& hex, epics::pvAccess::ServerGUID& guid)
+{
+    if(hex.size()!=2u*sizeof(guid.value))
+        return false;
+    for(size_t i=0; i<sizeof(guid.value); i++) {
+        int hi = hexval(hex[2*i]), lo = hexval(hex[2*i+1]);
+        if(hi<0 || lo<0)
+            return false;
+        guid.value[i] = char((hi<<4) | lo);
+    }
+    return true;
+}
+
+bool sameGUID(const epics::pvAccess::ServerGUID& lhs, const epics::pvAccess::ServerGUID& rhs)
+{
+    return memcmp(lhs.value, rhs.value, sizeof(lhs.value))==0;
+}
+
+bool sameAddress(const osiSockAddr& lhs, const osiSockAddr& rhs)
+{
+    return lhs.ia.sin_addr.s_addr==rhs.ia.sin_addr.s_addr && lhs.ia.sin_port==rhs.ia.sin_port;
+}
+
+epicsUInt32 now()
+{
+    return epicsUInt32(::time(NULL));
+}
+
+} // namespace
+
+namespace epics {
+namespace pvAccess {
+
+SearchCache::SearchCache(const std::string& fname, double maxAge)
+    :fname(fname)
+    ,maxAge(maxAge)
+    ,dirty(false)
+{}
+
+SearchCache::~SearchCache() {}
+
+bool SearchCache::expired(const Entry& ent, epicsUInt32 now) const
+{
+    return maxAge>0.0 && ent.updated<now && double(now - ent.updated) > maxAge;
+}
+
+void SearchCache::read(const std::string& fname, entries_t& entries)
+{
+    std::ifstream strm(fname.c_str());
+    if(!strm.is_open())
+        return;
+
+    // one entry per line
+    //   <name> <ip:port> <guid as hex> <posix time>
+    std::string line;
+    size_t lineno = 0;
+    while(std::getline(strm, line)) {
+        lineno++;
+        if(line.empty() || line[0]=='#')
+            continue;
+
+        std::istringstream lstrm(line);
+        std::string name, addr, guid;
+        unsigned long updated = 0;
+        Entry ent;
+        memset(&ent.address, 0, sizeof(ent.address));
+
+        if(!(lstrm>>name>>addr>>guid>>updated)
+                || aToIPAddr(addr.c_str(), 0, &ent.address.ia)
+                || !hex2guid(guid, ent.guid))
+        {
+            LOG(logLevelDebug, "Ignore invalid search cache entry %s:%zu", fname.c_str(), lineno);
+            continue;
+        }
+        ent.updated = epicsUInt32(updated);
+
+        std::pair<entries_t::iterator, bool> ins(entries.insert(std::make_pair(name, ent)));
+        if(!ins.second && ins.first->second.updated < ent.updated)
+            ins.first->second = ent;
+    }
+}
+
+void SearchCache::merge(const entries_t& other)
+{
+    // caller holds mutex
+    const epicsUInt32 T(now());
+
+    for(entries_t::const_iterator it(other.begin()), end(other.end()); it!=end; ++it) {
+        if(expired(it->second, T))
+            continue;
+
+        entries_t::iterator cur(entries.find(it->first));
+        if(cur!=entries.end() && cur->second.updated >= it->second.updated)
+            continue; // our entry is newer
+
+        servers_t::iterator srv(servers.find(it->second.address));
+        if(srv!=servers.end() && !sameGUID(srv->second, it->second.guid)) {
+            // conflicting GUIDs for one server address.  keep only the newest
+            bool older = false;
+            for(entries_t::const_iterator e(entries.begin()), eend(entries.end()); e!=eend; ++e) {
+                if(sameAddress(e->second.address, it->second.address) && e->second.updated > it->second.updated) {
+                    older = true;
+                    break;
+                }
+            }
+            if(older)
+                continue;
+            invalidate(it->second.address, it->second.guid);
+        }
+
+        entries[it->first] = it->second;
+        servers[it->second.address] = it->second.guid;
+    }
+}
+
+void SearchCache::invalidate(const osiSockAddr& address, const ServerGUID& guid)
+{
+    // caller holds mutex
+    for(entries_t::iterator it(entries.begin()), end(entries.end()); it!=end;) {
+        entries_t::iterator cur(it++);
+
+        if(sameAddress(cur->second.address, address) && !sameGUID(cur->second.guid, guid)) {
+            entries.erase(cur);
+            dirty = true;
+        }
+    }
+}
+
+void SearchCache::load()
+{
+    entries_t fromfile;
+    read(fname, fromfile);
+
+    Guard G(mutex);
+    merge(fromfile);
+}
+
+void SearchCache::save()
+{
+    {
+        Guard G(mutex);
+        if(!dirty)
+            return;
+    }
+
+    // pick up entries written by other processes since we loaded
+    entries_t fromfile;
+    read(fname, fromfile);
+
+    entries_t towrite;
+    {
+        Guard G(mutex);
+        merge(fromfile);
+        towrite = entries;
+        dirty = false;
+    }
+
+    // write to a temporary and rename, so that readers never see a partial file
+    std::string tmpname(fname+".tmp");
+    {
+        std::ofstream strm(tmpname.c_str(), std::ios::out | std::ios::trunc);
+        if(!strm.is_open()) {
+            LOG(logLevelDebug, "Unable to write search cache %s", tmpname.c_str());
+            return;
+        }
+        const epicsUInt32 T(now());
+
+        for(entries_t::const_iterator it(towrite.begin()), end(towrite.end()); it!=end; ++it) {
+            if(expired(it->second, T) || it->first.find_first_of(" \t\r\n")!=std::string::npos)
+                continue;
+            strm<<it->first<<' '
+                <<inetAddressToString(it->second.address)<<' '
+                <<guid2hex(it->second.guid)<<' '
+                <<(unsigned long)it->second.updated<<'\n';
+        }
+        strm.flush();
+        if(!strm.good()) {
+            LOG(logLevelDebug, "Error writing search cache %s", tmpname.c_str());
+            ::remove(tmpname.c_str());
+            return;
+        }
+    }
+
+    if(::rename(tmpname.c_str(), fname.c_str())) {
+        // WIN32 rename() won't replace an existing file
+        ::remove(fname.c_str());
+        if(::rename(tmpname.c_str(), fname.c_str())) {
+            LOG(logLevelDebug, "Unable to replace search cache %s", fname.c_str());
+            ::remove(tmpname.c_str());
+        }
+    }
+}
+
+bool SearchCache::lookup(const std::string& name, Entry& entry) const
+{
+    Guard G(mutex);
+    entries_t::const_iterator it(entries.find(name));
+    if(it==entries.end() || expired(it->second, now()))
+        return false;
+    entry = it->second;
+    return true;
+}
+
+void SearchCache::update(const std::string& name, const osiSockAddr& address, const ServerGUID& guid)
+{
+    Entry ent;
+    memset(&ent.address, 0, sizeof(ent.address));
+    ent.address.ia.sin_family = AF_INET;
+    ent.address.ia.sin_addr = address.ia.sin_addr;
+    ent.address.ia.sin_port = address.ia.sin_port;
+    ent.guid = guid;
+    ent.updated = now();
+
+    Guard G(mutex);
+
+    servers_t::iterator srv(servers.find(ent.address));
+    if(srv==servers.end()) {
+        servers[ent.address] = guid;
+
+    } else if(!sameGUID(srv->second, guid)) {
+        // server restarted.  What we know about the previous instance is stale.
+        invalidate(ent.address, guid);
+        srv->second = guid;
+    }
+
+    entries[name] = ent;
+    dirty = true;
+}
+
+void SearchCache::remove(const std::string& name)
+{
+    Guard G(mutex);
+    if(entries.erase(name))
+        dirty = true;
+}
+
+size_t SearchCache::size() const
+{
+    Guard G(mutex);
+    return entries.size();
+}
+
+}} // namespace epics::pvAccess
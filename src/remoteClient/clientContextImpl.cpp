@@ -4,16 +4,20 @@
  * in file LICENSE that is included with this distribution.
  */
 
+#include <stdio.h>
+
 #include <iostream>
 #include <sstream>
 #include <memory>
 #include <queue>
+#include <deque>
 #include <stdexcept>
 
 #include <osiSock.h>
 #include <epicsGuard.h>
 #include <epicsAssert.h>
 #include <epicsAtomic.h>
+#include <epicsTime.h>
 
 #include <pv/lock.h>
 #include <pv/timer.h>
@@ -33,11 +37,14 @@
 #include <pv/channelSearchManager.h>
 #include <pv/serializationHelper.h>
 #include <pv/channelSearchManager.h>
+#include <pv/searchCache.h>
 #include <pv/clientContextImpl.h>
 #include <pv/configuration.h>
 #include <pv/beaconHandler.h>
 #include <pv/logger.h>
 #include <pv/securityImpl.h>
+#include <pv/scratchPool.h>
+#include <pv/serverContextImpl.h>
 
 #include <pv/pvAccessMB.h>
 
@@ -139,6 +146,18 @@ private:
     // holds: NULL_REQUEST, PURE_DESTROY_REQUEST, PURE_CANCEL_REQUEST, or
     // a mask of QOS_*
     int32 m_pendingRequest;
+
+    // pipelined requests, accepted but not yet sent.
+    struct QueuedRequest {
+        int32 qos;
+        PVStructure::shared_pointer value;
+        BitSet::shared_pointer changed;
+    };
+    std::deque<QueuedRequest> m_queued;
+    // number of pipelined requests queued or sent, and not yet completed
+    size_t m_inflight;
+    // pipeline window acknowledged by the server.  1 when not pipelining.
+    size_t m_window;
 protected:
 
     Mutex m_mutex;
@@ -195,6 +214,8 @@ public:
 protected:
     bool m_destroyed;
     bool m_initialized;
+    // the server destroys our remote instance along with the channel
+    bool m_channelDestroyed;
 
     AtomicBoolean m_lastRequest;
 
@@ -204,8 +225,11 @@ protected:
         m_channel(channel),
         m_ioid(INVALID_IOID),
         m_pendingRequest(NULL_REQUEST),
+        m_inflight(0u),
+        m_window(1u),
         m_destroyed(false),
         m_initialized(false),
+        m_channelDestroyed(false),
         m_subscribed()
     {
         REFTRACE_INCREMENT(num_instances);
@@ -251,6 +275,73 @@ protected:
         m_pendingRequest = NULL_REQUEST;
     }
 
+    /* Pipelining.
+     *
+     * When requested with pvRequest record._options.window=N, and acknowledged by the server
+     * in the INIT response, up to N get()/put() may be in progress.
+     * Each is sent as a separate message, and is completed in the order sent.
+     *
+     * Otherwise one request at a time with startRequest().
+     */
+    bool pipelined() {
+        Lock guard(m_mutex);
+        return m_window > 1u;
+    }
+
+    // pipelined equivalent of startRequest()
+    bool queueRequest(int32 qos,
+                      PVStructure::shared_pointer const & value = PVStructure::shared_pointer(),
+                      BitSet::shared_pointer const & changed = BitSet::shared_pointer()) {
+        Lock guard(m_mutex);
+        if (m_inflight >= m_window)
+            return false;
+        m_queued.push_back(QueuedRequest());
+        QueuedRequest& req = m_queued.back();
+        req.qos = qos;
+        req.value = value;
+        req.changed = changed;
+        m_inflight++;
+        return true;
+    }
+
+    // pipelined equivalent of abortRequest()
+    void abortQueued() {
+        Lock guard(m_mutex);
+        if (!m_queued.empty()) {
+            m_queued.pop_back();
+            m_inflight--;
+        }
+    }
+
+    // pipelined equivalent of beginRequest().
+    // sub-class send() calls me when beginRequest() returns NULL_REQUEST
+    int32 beginQueued(PVStructure::shared_pointer& value, BitSet::shared_pointer& changed) {
+        Lock guard(m_mutex);
+        if (m_queued.empty())
+            return NULL_REQUEST;
+        QueuedRequest& req = m_queued.front();
+        int32 ret = req.qos;
+        value.swap(req.value);
+        changed.swap(req.changed);
+        m_queued.pop_front();
+        return ret;
+    }
+
+    // sub-class normalResponse() calls me
+    void completeRequest() {
+        Lock guard(m_mutex);
+        if (m_inflight)
+            m_inflight--;
+    }
+
+    // requests in progress are lost on disconnect.  pipelining must be acknowledged again.
+    void resetPipeline() {
+        Lock guard(m_mutex);
+        m_queued.clear();
+        m_inflight = 0u;
+        m_window = 1u;
+    }
+
 public:
 
     pvAccessID getIOID() const OVERRIDE FINAL {
@@ -276,6 +367,19 @@ public:
                 m_initialized = true;
             }
 
+            // server acknowledges pipelining with "window=N"
+            if (status.getType() == Status::STATUSTYPE_OK
+                    && status.getMessage().compare(0, 7, "window=") == 0)
+            {
+                unsigned window = 0;
+                if (sscanf(status.getMessage().c_str() + 7, "%u", &window) == 1 && window > 1u)
+                {
+                    Lock G(m_mutex);
+                    m_window = window;
+                }
+                status = Status::Ok;
+            }
+
             initResponse(transport, version, payloadBuffer, qos, status);
         }
         else
@@ -337,7 +441,7 @@ public:
             if (m_destroyed)
                 return;
             m_destroyed = true;
-            initd = m_initialized;
+            initd = m_initialized && !m_channelDestroyed;
         }
 
         // unregister response request
@@ -370,11 +474,19 @@ public:
     void reportStatus(Channel::ConnectionState status) OVERRIDE FINAL {
         // destroy, since channel (parent) was destroyed
         if (status == Channel::DESTROYED)
+        {
+            {
+                // no CMD_DESTROY_REQUEST, CMD_DESTROY_CHANNEL (or closing the Transport) covers it
+                Lock guard(m_mutex);
+                m_channelDestroyed = true;
+            }
             destroy();
+        }
         else if (status == Channel::DISCONNECTED)
         {
             m_subscribed.clear();
             abortRequest();
+            resetPipeline();
         }
         // TODO notify?
     }
@@ -609,6 +721,12 @@ public:
 
     virtual void send(ByteBuffer* buffer, TransportSendControl* control) OVERRIDE FINAL {
         int32 pendingRequest = beginRequest();
+        if (pendingRequest == NULL_REQUEST)
+        {
+            PVStructure::shared_pointer value;
+            BitSet::shared_pointer changed;
+            pendingRequest = beginQueued(value, changed);
+        }
         bool initStage = ((pendingRequest & QOS_INIT) != 0);
 
         if (pendingRequest < 0)
@@ -649,6 +767,8 @@ public:
 
     virtual void normalResponse(Transport::shared_pointer const & transport, int8 /*version*/, ByteBuffer* payloadBuffer, int8 /*qos*/, const Status& status) OVERRIDE FINAL {
 
+        completeRequest();
+
         if (!status.isSuccess())
         {
             EXCEPTION_GUARD3(m_callback, cb, cb->getDone(status, external_from_this<ChannelGetImpl>(), PVStructurePtr(), BitSetPtr()));
@@ -693,7 +813,9 @@ public:
                         return;
                     }
           */
-        if (!startRequest(m_lastRequest.get() ? QOS_DESTROY | QOS_GET : QOS_DEFAULT)) {
+        const int32 qos = m_lastRequest.get() ? QOS_DESTROY | QOS_GET : QOS_DEFAULT;
+        const bool queued = pipelined();
+        if (queued ? !queueRequest(qos) : !startRequest(qos)) {
             EXCEPTION_GUARD3(m_callback, cb, cb->getDone(otherRequestPendingStatus, thisPtr, PVStructurePtr(), BitSetPtr()));
             return;
         }
@@ -702,7 +824,10 @@ public:
             m_channel->checkAndGetTransport()->enqueueSendRequest(internal_from_this<ChannelGetImpl>());
             //TODO bulk hack m_channel->checkAndGetTransport()->enqueueOnlySendRequest(thisSender);
         } catch (std::runtime_error &rte) {
-            abortRequest();
+            if (queued)
+                abortQueued();
+            else
+                abortRequest();
             EXCEPTION_GUARD3(m_callback, cb, cb->getDone(channelNotConnected, thisPtr, PVStructurePtr(), BitSetPtr()));
         }
     }
@@ -759,6 +884,9 @@ public:
 
     Mutex m_structureMutex;
 
+    // copies of pipelined put values
+    ScratchPool m_scratch;
+
     ChannelPutImpl(ClientChannelImpl::shared_pointer const & channel,
                    ChannelPutRequester::shared_pointer const & requester,
                    PVStructure::shared_pointer const & pvRequest) :
@@ -797,6 +925,20 @@ public:
 
     virtual void send(ByteBuffer* buffer, TransportSendControl* control) OVERRIDE FINAL {
         int32 pendingRequest = beginRequest();
+        // pipelined put() carries its own copy of the value
+        PVStructure::shared_pointer value(m_structure);
+        BitSet::shared_pointer changed(m_bitSet);
+        if (pendingRequest == NULL_REQUEST)
+        {
+            PVStructure::shared_pointer queuedValue;
+            BitSet::shared_pointer queuedChanged;
+            pendingRequest = beginQueued(queuedValue, queuedChanged);
+            if (queuedValue)
+            {
+                value.swap(queuedValue);
+                changed.swap(queuedChanged);
+            }
+        }
         if (pendingRequest < 0)
         {
             base_send(buffer, control, pendingRequest);
@@ -820,8 +962,8 @@ public:
             {
                 // no need to lock here, since it is already locked via TransportSender IF
                 //Lock lock(m_structureMutex);
-                m_bitSet->serialize(buffer, control);
-                m_structure->serialize(buffer, control, m_bitSet.get());
+                changed->serialize(buffer, control);
+                value->serialize(buffer, control, changed.get());
             }
         }
     }
@@ -848,6 +990,8 @@ public:
 
         ChannelPut::shared_pointer thisPtr(external_from_this<ChannelPutImpl>());
 
+        completeRequest();
+
         if (qos & QOS_GET)
         {
             if (!status.isSuccess())
@@ -886,7 +1030,9 @@ public:
             }
         }
 
-        if (!startRequest(m_lastRequest.get() ? QOS_GET | QOS_DESTROY : QOS_GET)) {
+        const int32 qos = m_lastRequest.get() ? QOS_GET | QOS_DESTROY : QOS_GET;
+        const bool queued = pipelined();
+        if (queued ? !queueRequest(qos) : !startRequest(qos)) {
             EXCEPTION_GUARD3(m_callback, cb, cb->getDone(otherRequestPendingStatus, thisPtr, PVStructurePtr(), BitSetPtr()));
             return;
         }
@@ -895,7 +1041,10 @@ public:
         try {
             m_channel->checkAndGetTransport()->enqueueSendRequest(internal_from_this<ChannelPutImpl>());
         } catch (std::runtime_error &rte) {
-            abortRequest();
+            if (queued)
+                abortQueued();
+            else
+                abortRequest();
             EXCEPTION_GUARD3(m_callback, cb, cb->getDone(channelNotConnected, thisPtr, PVStructurePtr(), BitSetPtr()));
         }
     }
@@ -923,12 +1072,30 @@ public:
             return;
         }
 
-        if (!startRequest(m_lastRequest.get() ? QOS_DESTROY : QOS_DEFAULT)) {
+        const int32 qos = m_lastRequest.get() ? QOS_DESTROY : QOS_DEFAULT;
+        const bool queued = pipelined();
+        if (queued)
+        {
+            // each pipelined put() is sent from its own copy.
+            // Released once sent, then re-used by later put()s.
+            ScratchPool& pool = m_scratch;
+            BitSet::shared_pointer changed(pool.bitSet(pvPutBitSet->size()));
+            *changed = *pvPutBitSet;
+            PVStructure::shared_pointer value(pool.structure(pvPutStructure->getStructure()));
+            value->copyUnchecked(*pvPutStructure, *changed);
+
+            if (!queueRequest(qos, value, changed)) {
+                EXCEPTION_GUARD3(m_callback, cb, cb->putDone(otherRequestPendingStatus, thisPtr));
+                return;
+            }
+        }
+        else if (!startRequest(qos)) {
             EXCEPTION_GUARD3(m_callback, cb, cb->putDone(otherRequestPendingStatus, thisPtr));
             return;
         }
 
         try {
+            if (!queued)
             {
                 epicsGuard<ChannelPutImpl> G(*this);
                 *m_bitSet = *pvPutBitSet;
@@ -936,7 +1103,10 @@ public:
             }
             m_channel->checkAndGetTransport()->enqueueSendRequest(internal_from_this<ChannelPutImpl>());
         } catch (std::runtime_error &rte) {
-            abortRequest();
+            if (queued)
+                abortQueued();
+            else
+                abortRequest();
             EXCEPTION_GUARD3(m_callback, cb, cb->putDone(channelNotConnected, thisPtr));
         }
     }
@@ -1802,21 +1972,120 @@ public:
 
 
 
+// record._options.pipeline is added to the type of a pvRequest which lacks it
+StructureConstPtr withPipelineOption(const StructureConstPtr& type, size_t depth)
+{
+    static const char* const path[] = {"record", "_options"};
+    FieldCreatePtr create(getFieldCreate());
+
+    if (depth==2u)
+        return create->appendField(type, "pipeline", create->createScalar(pvString));
+
+    StringArray names(type->getFieldNames());
+    FieldConstPtrArray fields(type->getFields());
+    for (size_t i=0; i<names.size(); i++) {
+        if (names[i]==path[depth])
+            fields[i] = withPipelineOption(static_pointer_cast<const Structure>(fields[i]), depth+1u);
+    }
+    return create->createStructure(type->getID(), names, fields);
+}
+
+// copy between structures of the same type, or which differ by an added field
+void copyRequest(PVStructure& dest, const PVStructure& src)
+{
+    if (dest.getStructure()==src.getStructure()) {
+        dest.copyUnchecked(src);
+        return;
+    }
+    const PVFieldPtrArray& fields(src.getPVFields());
+    for (size_t i=0; i<fields.size(); i++) {
+        PVField::shared_pointer fld(dest.getSubFieldT(fields[i]->getFieldName()));
+        switch (fields[i]->getField()->getType()) {
+        case structure:
+            copyRequest(static_cast<PVStructure&>(*fld), static_cast<const PVStructure&>(*fields[i]));
+            break;
+        case scalar:
+            static_cast<PVScalar&>(*fld).copyUnchecked(static_cast<const PVScalar&>(*fields[i]));
+            break;
+        case scalarArray:
+            static_cast<PVScalarArray&>(*fld).copyUnchecked(static_cast<const PVScalarArray&>(*fields[i]));
+            break;
+        default:
+            break; // not found in record._options
+        }
+    }
+}
+
+/* Servers which predate adaptive=true would otherwise stream without flow control.
+ * Returns a copy of pvRequest with record._options.pipeline=true
+ */
+PVStructure::shared_pointer requestPipeline(const PVStructure::shared_pointer& pvRequest)
+{
+    PVField::shared_pointer existing(pvRequest->getSubField("record._options.pipeline"));
+    PVScalar::shared_pointer option(dynamic_pointer_cast<PVScalar>(existing));
+    if (existing && !option)
+        return pvRequest; // not something we can set
+
+    StructureConstPtr type(option ? pvRequest->getStructure()
+                                  : withPipelineOption(pvRequest->getStructure(), 0u));
+
+    PVStructure::shared_pointer ret(getPVDataCreate()->createPVStructure(type));
+    copyRequest(*ret, *pvRequest);
+    ret->getSubFieldT<PVScalar>("record._options.pipeline")->putFrom<std::string>("true");
+    return ret;
+}
+
 class MonitorStrategy : public Monitor {
 public:
     virtual ~MonitorStrategy() {};
     virtual void init(StructureConstPtr const & structure) = 0;
     virtual void response(Transport::shared_pointer const & transport, ByteBuffer* payloadBuffer) = 0;
     virtual void unlisten() = 0;
+    //! Flow control credits to grant with a pipelined (re)subscribe
+    virtual int32 initialCredit(int32 queueSize) { return queueSize; }
+    //! Switch to receiving updates from a multicast group.  NULL if not supported.
+    virtual MulticastListener::shared_pointer multicastListener() { return MulticastListener::shared_pointer(); }
 };
 
 typedef vector<MonitorElement::shared_pointer> FreeElementQueue;
+
+// adaptive monitor: minimum window, and number of elements initially allocated
+static const int32 minWindow = 2;
 typedef queue<MonitorElement::shared_pointer> MonitorElementQueue;
 
+// multicast: datagrams received while awaiting a complete value, to be replayed after it
+static const size_t maxHeldDatagrams = 64u;
+
+struct HeldDatagram {
+    uint32 seq;
+    bool complete;
+    int byteOrder;
+    std::vector<char> payload;
+};
+
+// deserialize a HeldDatagram
+struct HeldDatagramReader : public DeserializableControl
+{
+    const ByteBuffer& buf;
+    explicit HeldDatagramReader(const ByteBuffer& buf) :buf(buf) {}
+    virtual ~HeldDatagramReader() {}
+
+    virtual void ensureData(std::size_t size) OVERRIDE FINAL {
+        if(buf.getRemaining()<size)
+            throw std::underflow_error("no more data in held datagram");
+    }
+    virtual void alignData(std::size_t) OVERRIDE FINAL {}
+    virtual bool directDeserialize(ByteBuffer *, char*, std::size_t, std::size_t) OVERRIDE FINAL { return false; }
+    virtual std::tr1::shared_ptr<const Field> cachedDeserialize(ByteBuffer* buffer) OVERRIDE FINAL {
+        return getFieldCreate()->deserialize(buffer, this);
+    }
+};
+
 
 class MonitorStrategyQueue :
     public MonitorStrategy,
     public TransportSender,
+    public MulticastListener,
     public std::tr1::enable_shared_from_this<MonitorStrategyQueue>
 {
 private:
@@ -1830,7 +2099,7 @@ private:
 
     const MonitorRequester::weak_pointer m_callback;
 
-    Mutex m_mutex;
+    mutable Mutex m_mutex;
 
     BitSet m_bitSet1;
     BitSet m_bitSet2;
@@ -1851,12 +2120,67 @@ private:
 
     bool m_unlisten;
 
+    /* With pvRequest option record._options.adaptive=true, the flow control window
+     * (credits granted to the server) is sized from the measured round trip time
+     * and the rate at which elements are release()'d, bounded by queueSize.
+     * Elements are allocated as the window grows.
+     */
+    const bool m_adaptive;
+    // elements in existence
+    int32 m_allocated;
+    // window in effect
+    int32 m_window;
+    // credits held by the server (granted and not yet used)
+    int32 m_credit;
+    // an ack was sent while the server had no credit, and no update has since arrived
+    bool m_stalled;
+    epicsTime m_stallTime;
+    // smoothed round trip time, and interval between release()s, in seconds.  0 when not measured
+    double m_rtt;
+    double m_drainInterval;
+    epicsTime m_lastRelease;
+    bool m_released;
+
+    /* With pvRequest option record._options.multicast=true, and a server which
+     * publishes this PV to a multicast group, updates arrive as datagrams.
+     * The server sends a complete value over TCP, with its sequence #,
+     * only when we ack.  Which we do when a datagram is missed.
+     */
+    bool m_multicast;
+    // m_mcastSeq is the sequence # of m_up2datePVStructure
+    bool m_synced;
+    uint32 m_mcastSeq;
+    // received while !m_synced.  Those following the complete value are replayed.
+    std::vector<HeldDatagram> m_mcastHeld;
+
+    int32 freeAvailable() const {
+        return int32(m_freeQueue.size()) + (m_queueSize - m_allocated);
+    }
+
+    // credits which should be granted to the server now
+    int32 creditDeficit() const {
+        return std::min(m_window, freeAvailable()) - m_credit;
+    }
+
+    // bandwidth-delay product: the # of updates consumed during one round trip,
+    // doubled to cover acknowledgement batching.
+    void adapt() {
+        if(m_rtt<=0.0 || m_drainInterval<=0.0)
+            return;
+        double bdp = m_rtt / m_drainInterval;
+        double want = 2.0*bdp + double(minWindow);
+        if(want >= double(m_queueSize))
+            m_window = m_queueSize;
+        else
+            m_window = std::max(minWindow, int32(want));
+    }
+
 public:
 
     MonitorStrategyQueue(ClientChannelImpl::shared_pointer channel, pvAccessID ioid,
                          MonitorRequester::weak_pointer const & callback,
                          int32 queueSize,
-                         bool pipeline, int32 ackAny) :
+                         bool pipeline, int32 ackAny, bool adaptive) :
         m_queueSize(queueSize), m_lastStructure(),
         m_freeQueue(),
         m_monitorQueue(),
@@ -1866,7 +2190,18 @@ public:
         m_reportQueueStateInProgress(false),
         m_channel(channel), m_ioid(ioid),
         m_pipeline(pipeline), m_ackAny(ackAny),
-        m_unlisten(false)
+        m_unlisten(false),
+        m_adaptive(pipeline && adaptive),
+        m_allocated(0),
+        m_window(std::min(queueSize, 2*minWindow)),
+        m_credit(0),
+        m_stalled(false),
+        m_rtt(0.0),
+        m_drainInterval(0.0),
+        m_released(false),
+        m_multicast(false),
+        m_synced(false),
+        m_mcastSeq(0u)
     {
         if (queueSize <= 1)
             throw std::invalid_argument("queueSize <= 1");
@@ -1883,6 +2218,8 @@ public:
 
         m_releasedCount = 0;
         m_reportQueueStateInProgress = false;
+        m_multicast = m_synced = false;
+        m_mcastHeld.clear();
 
         {
             while (!m_monitorQueue.empty())
@@ -1892,7 +2229,8 @@ public:
 
             m_up2datePVStructure.reset();
 
-            for (int32 i = 0; i < m_queueSize; i++)
+            m_allocated = m_adaptive ? std::min(m_queueSize, minWindow) : m_queueSize;
+            for (int32 i = 0; i < m_allocated; i++)
             {
                 PVStructure::shared_pointer pvStructure = getPVDataCreate()->createPVStructure(structure);
                 MonitorElement::shared_pointer monitorElement(new MonitorElement(pvStructure));
@@ -1904,68 +2242,628 @@ public:
     }
 
 
-    virtual void response(Transport::shared_pointer const & transport, ByteBuffer* payloadBuffer) OVERRIDE FINAL {
+private:
+    // deserialize an update, from TCP or a datagram.  Returns true if an element was queued.
+    // call with m_mutex locked
+    bool update(DeserializableControl* control, ByteBuffer* payloadBuffer) {
+        if (m_overrunInProgress)
+        {
+            PVStructurePtr pvStructure = m_overrunElement->pvStructurePtr;
+            BitSet::shared_pointer changedBitSet = m_overrunElement->changedBitSet;
+            BitSet::shared_pointer overrunBitSet = m_overrunElement->overrunBitSet;
+
+            m_bitSet1.deserialize(payloadBuffer, control);
+            pvStructure->deserialize(payloadBuffer, control, &m_bitSet1);
+            m_bitSet2.deserialize(payloadBuffer, control);
+
+            // OR local overrun
+            // TODO this does not work perfectly if bitSet is compressed !!!
+            // uncompressed bitSets should be used !!!
+            overrunBitSet->or_and(*(changedBitSet.get()), m_bitSet1);
+
+            // OR remove change
+            *(changedBitSet.get()) |= m_bitSet1;
+
+            // OR remote overrun
+            *(overrunBitSet.get()) |= m_bitSet2;
+
+            // m_up2datePVStructure is already set
+
+            return false;
+        }
+
+        if (m_adaptive)
+        {
+            if (m_credit > 0)
+                m_credit--;
+            if (m_stalled)
+            {
+                double sample = epicsTime::getCurrent() - m_stallTime;
+                m_rtt = m_rtt > 0.0 ? (7.0*m_rtt + sample)/8.0 : sample;
+                m_stalled = false;
+                adapt();
+            }
+        }
+
+        if (m_freeQueue.empty() && m_allocated < m_queueSize)
+        {
+            // window has grown
+            m_freeQueue.push_back(MonitorElement::shared_pointer(new MonitorElement(
+                                      getPVDataCreate()->createPVStructure(m_lastStructure))));
+            m_allocated++;
+        }
+
+        MonitorElementPtr newElement = m_freeQueue.back();
+        m_freeQueue.pop_back();
+
+        // setup current fields
+        PVStructurePtr pvStructure = newElement->pvStructurePtr;
+        BitSet::shared_pointer changedBitSet = newElement->changedBitSet;
+        BitSet::shared_pointer overrunBitSet = newElement->overrunBitSet;
+
+        try {
+            // deserialize changedBitSet and data, and overrun bit set
+            changedBitSet->deserialize(payloadBuffer, control);
+            if (m_up2datePVStructure && m_up2datePVStructure.get() != pvStructure.get()) {
+                assert(pvStructure->getStructure().get()==m_up2datePVStructure->getStructure().get());
+                pvStructure->copyUnchecked(*m_up2datePVStructure, *changedBitSet, true);
+            }
+            pvStructure->deserialize(payloadBuffer, control, changedBitSet.get());
+            overrunBitSet->deserialize(payloadBuffer, control);
+        } catch (...) {
+            // eg. truncated datagram
+            m_freeQueue.push_back(newElement);
+            throw;
+        }
+
+        m_up2datePVStructure = pvStructure;
+
+        if (m_freeQueue.empty() && m_allocated >= m_queueSize)
+        {
+            m_overrunInProgress = true;
+            m_overrunElement = newElement;
+            return false;
+        }
+
+        m_monitorQueue.push(newElement);
+        return true;
+    }
 
+    // request a complete value over TCP.  call with m_mutex locked
+    bool resync() {
+        m_synced = false;
+        m_releasedCount = 1;
+        if (m_reportQueueStateInProgress)
+            return false;
+        m_reportQueueStateInProgress = true;
+        return true;
+    }
+
+    // apply held datagrams which follow m_mcastSeq, in order.  call with m_mutex locked, and m_synced.
+    // Returns true if an element was queued.  Sets 'ack' if a resync is needed.
+    bool replayHeld(bool& ack) {
+        bool notify = false;
+        std::vector<HeldDatagram> held;
+        held.swap(m_mcastHeld);
+
+        bool found = true;
+        while (found && m_synced)
+        {
+            found = false;
+            bool later = false;
+            for (size_t i=0; i<held.size(); i++)
+            {
+                int32 delta = int32(held[i].seq - m_mcastSeq);
+                if (delta > 1) {
+                    later = true;
+                    continue;
+                } else if (delta < 1) {
+                    continue; // already included
+                }
+
+                found = true;
+                if (!held[i].complete) {
+                    ack = resync();
+                    break;
+                }
+                try {
+                    ByteBuffer buf(held[i].payload.empty() ? NULL : &held[i].payload[0], held[i].payload.size());
+                    buf.setEndianess(held[i].byteOrder);
+                    HeldDatagramReader reader(buf);
+                    notify |= update(&reader, &buf);
+                    m_mcastSeq = held[i].seq;
+                } catch (std::exception& e) {
+                    LOG(logLevelDebug, "Invalid multicast update %u : %s", unsigned(held[i].seq), e.what());
+                    ack = resync();
+                }
+                break;
+            }
+            if (!found && later)
+                ack = resync(); // missed a datagram
+        }
+        return notify;
+    }
+
+    void sendAck() {
+        try
+        {
+            m_channel->checkAndGetTransport()->enqueueSendRequest(shared_from_this());
+        } catch (std::exception&) {
+            // assume wrong connection state from checkAndGetTransport()
+            Lock guard(m_mutex);
+            m_reportQueueStateInProgress = false;
+        }
+    }
+
+public:
+    virtual void response(Transport::shared_pointer const & transport, ByteBuffer* payloadBuffer) OVERRIDE FINAL {
+        bool notify, ack = false;
         {
             // TODO do not lock deserialization
             Lock guard(m_mutex);
 
+            notify = update(transport.get(), payloadBuffer);
+
+            if (m_multicast)
+            {
+                // complete value as of this sequence #
+                transport->ensureData(4);
+                m_mcastSeq = payloadBuffer->getInt();
+                m_synced = true;
+
+                // datagrams which arrived before it
+                notify |= replayHeld(ack);
+            }
+        }
+
+        if (ack)
+            sendAck();
+
+        if (notify)
+        {
+            EXCEPTION_GUARD3(m_callback, cb, cb->monitorEvent(shared_from_this()));
+        }
+    }
+
+    virtual void datagram(const osiSockAddr& from, uint32 seq, bool complete,
+                          Transport::shared_pointer const & transport,
+                          ByteBuffer* payloadBuffer) OVERRIDE FINAL {
+        {
+            // only from the host of the server we are connected to
+            Transport::shared_pointer T(m_channel->getTransport());
+            if (!T || T->getRemoteAddress().ia.sin_addr.s_addr != from.ia.sin_addr.s_addr)
+            {
+                LOG(logLevelDebug, "Ignore multicast update %u from %s", unsigned(seq), inetAddressToString(from).c_str());
+                return;
+            }
+        }
+
+        bool notify = false, ack = false;
+        {
+            Lock guard(m_mutex);
+
+            if (!m_multicast)
+                return;
+
+            if (!m_synced)
+            {
+                // before the first complete value, or awaiting resync.  hold to replay after it
+                if (m_mcastHeld.size() >= maxHeldDatagrams)
+                    m_mcastHeld.erase(m_mcastHeld.begin());
+                m_mcastHeld.push_back(HeldDatagram());
+                HeldDatagram& held = m_mcastHeld.back();
+                held.seq = seq;
+                held.complete = complete;
+                held.byteOrder = payloadBuffer->getByteOrder();
+                if (complete)
+                    held.payload.assign(payloadBuffer->getBuffer() + payloadBuffer->getPosition(),
+                                        payloadBuffer->getBuffer() + payloadBuffer->getLimit());
+                return;
+            }
+
+            int32 delta = int32(seq - m_mcastSeq);
+            if (delta <= 0)
+                return; // duplicate, or already included in a complete value
+
+            if (delta == 1 && complete)
+            {
+                try {
+                    notify = update(transport.get(), payloadBuffer);
+                    m_mcastSeq = seq;
+                } catch (std::exception& e) {
+                    LOG(logLevelDebug, "Invalid multicast update %u : %s", unsigned(seq), e.what());
+                    ack = resync();
+                }
+            }
+            else
+            {
+                // missed a datagram, or an update which didn't fit
+                ack = resync();
+            }
+        }
+
+        if (ack)
+            sendAck();
+
+        if (notify)
+        {
+            EXCEPTION_GUARD3(m_callback, cb, cb->monitorEvent(shared_from_this()));
+        }
+    }
+
+    virtual MulticastListener::shared_pointer multicastListener() OVERRIDE FINAL {
+        Lock guard(m_mutex);
+        if (!m_pipeline)
+            return MulticastListener::shared_pointer();
+        m_multicast = true;
+        m_synced = false;
+        m_mcastHeld.clear();
+        return shared_from_this();
+    }
+
+    virtual void unlisten() OVERRIDE FINAL
+    {
+        bool notifyUnlisten = false;
+        {
+            Lock guard(m_mutex);
+            notifyUnlisten = m_monitorQueue.empty();
+            m_unlisten = !notifyUnlisten;
+        }
+
+        if (notifyUnlisten)
+        {
+            EXCEPTION_GUARD3(m_callback, cb, cb->unlisten(shared_from_this()));
+        }
+    }
+
+    virtual MonitorElement::shared_pointer poll() OVERRIDE FINAL {
+        Lock guard(m_mutex);
+
+        if (m_monitorQueue.empty()) {
+
+            if (m_unlisten) {
+                m_unlisten = false;
+                guard.unlock();
+                EXCEPTION_GUARD3(m_callback, cb, cb->unlisten(shared_from_this()));
+            }
+            return MonitorElement::shared_pointer();
+        }
+
+        MonitorElement::shared_pointer retVal(m_monitorQueue.front());
+        m_monitorQueue.pop();
+        return retVal;
+    }
+
+    // NOTE: a client must always call poll() after release() to check the presence of any new monitor elements
+    virtual void release(MonitorElement::shared_pointer const & monitorElement) OVERRIDE FINAL {
+
+        // fast sanity check check if monitorElement->pvStructurePtr->getStructure() matches
+        // not to accept wrong structure (might happen on monitor reconnect with different type)
+        // silent return
+        if (monitorElement->pvStructurePtr->getStructure().get() != m_lastStructure.get())
+            return;
+
+        bool sendAck = false;
+        {
+            Lock guard(m_mutex);
+
+            m_freeQueue.push_back(monitorElement);
+
             if (m_overrunInProgress)
             {
+                // compress bit-set
                 PVStructurePtr pvStructure = m_overrunElement->pvStructurePtr;
-                BitSet::shared_pointer changedBitSet = m_overrunElement->changedBitSet;
-                BitSet::shared_pointer overrunBitSet = m_overrunElement->overrunBitSet;
+                BitSetUtil::compress(m_overrunElement->changedBitSet, pvStructure);
+                BitSetUtil::compress(m_overrunElement->overrunBitSet, pvStructure);
+
+                m_monitorQueue.push(m_overrunElement);
+
+                m_overrunElement.reset();
+                m_overrunInProgress = false;
+            }
+
+            if (m_multicast)
+            {
+                // server only waits for resync requests
+            }
+            else if (m_adaptive)
+            {
+                epicsTime now(epicsTime::getCurrent());
+                if (m_released)
+                {
+                    double sample = now - m_lastRelease;
+                    m_drainInterval = m_drainInterval > 0.0 ? (7.0*m_drainInterval + sample)/8.0 : sample;
+                    adapt();
+                }
+                m_lastRelease = now;
+                m_released = true;
+
+                int32 deficit = creditDeficit();
+                if (!m_reportQueueStateInProgress && deficit > 0 &&
+                        (m_credit == 0 || deficit >= std::max(1, m_window/2)))
+                {
+                    sendAck = true;
+                    m_reportQueueStateInProgress = true;
+                }
+            }
+            else if (m_pipeline)
+            {
+                m_releasedCount++;
+                if (!m_reportQueueStateInProgress && m_releasedCount >= m_ackAny)
+                {
+                    sendAck = true;
+                    m_reportQueueStateInProgress = true;
+                }
+            }
+
+            if (sendAck)
+            {
+                guard.unlock();
+
+                try
+                {
+                    m_channel->checkAndGetTransport()->enqueueSendRequest(shared_from_this());
+                } catch (std::runtime_error&) {
+                    // assume wrong connection state from checkAndGetTransport()
+                    guard.lock();
+                    m_reportQueueStateInProgress = false;
+                } catch (std::exception& e) {
+                    LOG(logLevelWarn, "Ignore exception during MonitorStrategyQueue::release: %s", e.what());
+                    guard.lock();
+                    m_reportQueueStateInProgress = false;
+                }
+            }
+        }
+    }
+
+    virtual void getStats(Stats& s) const OVERRIDE FINAL {
+        Lock guard(m_mutex);
+        s.nfilled = m_monitorQueue.size();
+        s.nempty = m_freeQueue.size();
+        size_t held = s.nfilled + s.nempty + (m_overrunElement ? 1u : 0u);
+        size_t allocated = size_t(m_allocated);
+        s.noutstanding = allocated > held ? allocated - held : 0u;
+        s.nmerged = s.nmergedmax = 0;
+        s.window = !m_pipeline ? 0u : size_t(m_adaptive ? m_window : m_queueSize);
+    }
+
+    virtual int32 initialCredit(int32 queueSize) OVERRIDE FINAL {
+        if (!m_adaptive)
+            return queueSize;
+        Lock guard(m_mutex);
+        // init() will make all elements available
+        m_credit = m_window;
+        m_stalled = false;
+        return m_credit;
+    }
+
+    virtual void send(ByteBuffer* buffer, TransportSendControl* control) OVERRIDE FINAL {
+        control->startMessage((int8)CMD_MONITOR, 9);
+        buffer->putInt(m_channel->getServerChannelID());
+        buffer->putInt(m_ioid);
+        buffer->putByte((int8)QOS_GET_PUT);
+
+        {
+            Lock guard(m_mutex);
+            // with multicast, only resync requests are sent, and the window is not adapted
+            if (m_adaptive && !m_multicast)
+            {
+                int32 grant = std::max(0, creditDeficit());
+                if (m_credit == 0 && grant > 0)
+                {
+                    // server is waiting for us.  time until the next update
+                    m_stalled = true;
+                    m_stallTime = epicsTime::getCurrent();
+                }
+                m_credit += grant;
+                buffer->putInt(grant);
+            }
+            else
+            {
+                buffer->putInt(m_releasedCount);
+            }
+            m_releasedCount = 0;
+            m_reportQueueStateInProgress = false;
+        }
+
+        // immediate send
+        control->flush(true);
+    }
+
+    Status start() OVERRIDE FINAL {
+        Lock guard(m_mutex);
+        while (!m_monitorQueue.empty())
+        {
+            m_freeQueue.push_back(m_monitorQueue.front());
+            m_monitorQueue.pop();
+        }
+        if (m_overrunElement)
+        {
+            m_freeQueue.push_back(m_overrunElement);
+            m_overrunElement.reset();
+        }
+        m_overrunInProgress = false;
+        return Status::Ok;
+    }
+
+    Status stop() OVERRIDE FINAL {
+        return Status::Ok;
+    }
+
+    void destroy() OVERRIDE FINAL {
+    }
+
+};
+
+
+
+
+/* Keeps only the latest value.
+ *
+ * Updates which arrive before the previous one has been poll()'d are merged into
+ * the same element, as with an overrun.  Flow control credits are returned as soon as
+ * an update is received, so a slow consumer never stalls the server.
+ */
+class MonitorStrategyLatest :
+    public MonitorStrategy,
+    public TransportSender,
+    public std::tr1::enable_shared_from_this<MonitorStrategyLatest>
+{
+private:
+
+    StructureConstPtr m_lastStructure;
+    FreeElementQueue m_freeQueue;
+    // element waiting to be poll()'d, or NULL
+    MonitorElement::shared_pointer m_current;
+    // # of updates merged into m_current
+    size_t m_currentMerged;
+    // # of elements poll()'d and not yet release()'d
+    size_t m_outstanding;
+
+    size_t m_merged;
+    size_t m_mergedMax;
+
+    const MonitorRequester::weak_pointer m_callback;
+
+    mutable Mutex m_mutex;
+
+    BitSet m_bitSet1;
+    BitSet m_bitSet2;
+
+    PVStructure::shared_pointer m_up2datePVStructure;
+
+    int32 m_releasedCount;
+    bool m_reportQueueStateInProgress;
+
+    const ClientChannelImpl::shared_pointer m_channel;
+    const pvAccessID m_ioid;
+
+    const bool m_pipeline;
+
+    bool m_unlisten;
+
+public:
+
+    MonitorStrategyLatest(ClientChannelImpl::shared_pointer channel, pvAccessID ioid,
+                          MonitorRequester::weak_pointer const & callback,
+                          bool pipeline) :
+        m_currentMerged(0u),
+        m_outstanding(0u),
+        m_merged(0u),
+        m_mergedMax(0u),
+        m_callback(callback),
+        m_releasedCount(0),
+        m_reportQueueStateInProgress(false),
+        m_channel(channel), m_ioid(ioid),
+        m_pipeline(pipeline),
+        m_unlisten(false)
+    {}
+
+    virtual ~MonitorStrategyLatest() {}
+
+    virtual void init(StructureConstPtr const & structure) OVERRIDE FINAL {
+        Lock guard(m_mutex);
+
+        m_releasedCount = 0;
+        m_reportQueueStateInProgress = false;
+
+        m_current.reset();
+        m_currentMerged = 0u;
+        m_outstanding = 0u;
+        m_freeQueue.clear();
+        m_up2datePVStructure.reset();
+
+        // one to fill, one for the consumer.  more allocated if the consumer holds several.
+        for (int i = 0; i < 2; i++)
+        {
+            PVStructure::shared_pointer pvStructure = getPVDataCreate()->createPVStructure(structure);
+            MonitorElement::shared_pointer monitorElement(new MonitorElement(pvStructure));
+            m_freeQueue.push_back(monitorElement);
+        }
+
+        m_lastStructure = structure;
+    }
+
+    virtual void response(Transport::shared_pointer const & transport, ByteBuffer* payloadBuffer) OVERRIDE FINAL {
+        bool notify = false, sendAck = false;
+        {
+            Lock guard(m_mutex);
+
+            if (m_current)
+            {
+                // not yet consumed.  merge
+                PVStructurePtr pvStructure = m_current->pvStructurePtr;
+                BitSet::shared_pointer changedBitSet = m_current->changedBitSet;
+                BitSet::shared_pointer overrunBitSet = m_current->overrunBitSet;
 
                 m_bitSet1.deserialize(payloadBuffer, transport.get());
                 pvStructure->deserialize(payloadBuffer, transport.get(), &m_bitSet1);
                 m_bitSet2.deserialize(payloadBuffer, transport.get());
 
-                // OR local overrun
-                // TODO this does not work perfectly if bitSet is compressed !!!
-                // uncompressed bitSets should be used !!!
-                overrunBitSet->or_and(*(changedBitSet.get()), m_bitSet1);
+                // fields changed again are overrun
+                overrunBitSet->or_and(*changedBitSet, m_bitSet1);
+                *changedBitSet |= m_bitSet1;
+                *overrunBitSet |= m_bitSet2;
+
+                m_currentMerged++;
+                m_merged++;
+                if (m_mergedMax < m_currentMerged)
+                    m_mergedMax = m_currentMerged;
 
-                // OR remove change
-                *(changedBitSet.get()) |= m_bitSet1;
+            }
+            else
+            {
+                MonitorElementPtr newElement;
+                if (m_freeQueue.empty()) {
+                    newElement.reset(new MonitorElement(getPVDataCreate()->createPVStructure(m_lastStructure)));
+                } else {
+                    newElement = m_freeQueue.back();
+                    m_freeQueue.pop_back();
+                }
 
-                // OR remote overrun
-                *(overrunBitSet.get()) |= m_bitSet2;
+                PVStructurePtr pvStructure = newElement->pvStructurePtr;
+                BitSet::shared_pointer changedBitSet = newElement->changedBitSet;
+                BitSet::shared_pointer overrunBitSet = newElement->overrunBitSet;
 
-                // m_up2datePVStructure is already set
+                changedBitSet->deserialize(payloadBuffer, transport.get());
+                if (m_up2datePVStructure && m_up2datePVStructure.get() != pvStructure.get()) {
+                    assert(pvStructure->getStructure().get()==m_up2datePVStructure->getStructure().get());
+                    pvStructure->copyUnchecked(*m_up2datePVStructure, *changedBitSet, true);
+                }
+                pvStructure->deserialize(payloadBuffer, transport.get(), changedBitSet.get());
+                overrunBitSet->deserialize(payloadBuffer, transport.get());
 
-                return;
+                m_up2datePVStructure = pvStructure;
+                m_current = newElement;
+                m_currentMerged = 0u;
+                notify = true;
             }
 
-            MonitorElementPtr newElement = m_freeQueue.back();
-            m_freeQueue.pop_back();
-
-            if (m_freeQueue.empty())
+            // consumed (or merged) on arrival, so return credit now
+            if (m_pipeline)
             {
-                m_overrunInProgress = true;
-                m_overrunElement = newElement;
+                m_releasedCount++;
+                if (!m_reportQueueStateInProgress)
+                {
+                    sendAck = true;
+                    m_reportQueueStateInProgress = true;
+                }
             }
+        }
 
-            // setup current fields
-            PVStructurePtr pvStructure = newElement->pvStructurePtr;
-            BitSet::shared_pointer changedBitSet = newElement->changedBitSet;
-            BitSet::shared_pointer overrunBitSet = newElement->overrunBitSet;
-
-            // deserialize changedBitSet and data, and overrun bit set
-            changedBitSet->deserialize(payloadBuffer, transport.get());
-            if (m_up2datePVStructure && m_up2datePVStructure.get() != pvStructure.get()) {
-                assert(pvStructure->getStructure().get()==m_up2datePVStructure->getStructure().get());
-                pvStructure->copyUnchecked(*m_up2datePVStructure, *changedBitSet, true);
+        if (sendAck)
+        {
+            try
+            {
+                transport->enqueueSendRequest(shared_from_this());
+            } catch (std::exception& e) {
+                LOG(logLevelWarn, "Ignore exception during MonitorStrategyLatest::response: %s", e.what());
+                Lock guard(m_mutex);
+                m_reportQueueStateInProgress = false;
             }
-            pvStructure->deserialize(payloadBuffer, transport.get(), changedBitSet.get());
-            overrunBitSet->deserialize(payloadBuffer, transport.get());
-
-            m_up2datePVStructure = pvStructure;
-
-            if (!m_overrunInProgress)
-                m_monitorQueue.push(newElement);
         }
 
-        if (!m_overrunInProgress)
+        if (notify)
         {
             EXCEPTION_GUARD3(m_callback, cb, cb->monitorEvent(shared_from_this()));
         }
@@ -1976,7 +2874,7 @@ public:
         bool notifyUnlisten = false;
         {
             Lock guard(m_mutex);
-            notifyUnlisten = m_monitorQueue.empty();
+            notifyUnlisten = !m_current;
             m_unlisten = !notifyUnlisten;
         }
 
@@ -1989,7 +2887,7 @@ public:
     virtual MonitorElement::shared_pointer poll() OVERRIDE FINAL {
         Lock guard(m_mutex);
 
-        if (m_monitorQueue.empty()) {
+        if (!m_current) {
 
             if (m_unlisten) {
                 m_unlisten = false;
@@ -1999,67 +2897,42 @@ public:
             return MonitorElement::shared_pointer();
         }
 
-        MonitorElement::shared_pointer retVal(m_monitorQueue.front());
-        m_monitorQueue.pop();
+        MonitorElement::shared_pointer retVal;
+        retVal.swap(m_current);
+        m_outstanding++;
+
+        if (m_currentMerged)
+        {
+            // compress bit-set
+            PVStructurePtr pvStructure = retVal->pvStructurePtr;
+            BitSetUtil::compress(retVal->changedBitSet, pvStructure);
+            BitSetUtil::compress(retVal->overrunBitSet, pvStructure);
+            m_currentMerged = 0u;
+        }
+
         return retVal;
     }
 
-    // NOTE: a client must always call poll() after release() to check the presence of any new monitor elements
     virtual void release(MonitorElement::shared_pointer const & monitorElement) OVERRIDE FINAL {
 
-        // fast sanity check check if monitorElement->pvStructurePtr->getStructure() matches
-        // not to accept wrong structure (might happen on monitor reconnect with different type)
-        // silent return
+        // see MonitorStrategyQueue::release()
         if (monitorElement->pvStructurePtr->getStructure().get() != m_lastStructure.get())
             return;
 
-        bool sendAck = false;
-        {
-            Lock guard(m_mutex);
-
-            m_freeQueue.push_back(monitorElement);
-
-            if (m_overrunInProgress)
-            {
-                // compress bit-set
-                PVStructurePtr pvStructure = m_overrunElement->pvStructurePtr;
-                BitSetUtil::compress(m_overrunElement->changedBitSet, pvStructure);
-                BitSetUtil::compress(m_overrunElement->overrunBitSet, pvStructure);
-
-                m_monitorQueue.push(m_overrunElement);
-
-                m_overrunElement.reset();
-                m_overrunInProgress = false;
-            }
-
-            if (m_pipeline)
-            {
-                m_releasedCount++;
-                if (!m_reportQueueStateInProgress && m_releasedCount >= m_ackAny)
-                {
-                    sendAck = true;
-                    m_reportQueueStateInProgress = true;
-                }
-            }
-
-            if (sendAck)
-            {
-                guard.unlock();
+        Lock guard(m_mutex);
+        if (m_outstanding)
+            m_outstanding--;
+        m_freeQueue.push_back(monitorElement);
+    }
 
-                try
-                {
-                    m_channel->checkAndGetTransport()->enqueueSendRequest(shared_from_this());
-                } catch (std::runtime_error&) {
-                    // assume wrong connection state from checkAndGetTransport()
-                    guard.lock();
-                    m_reportQueueStateInProgress = false;
-                } catch (std::exception& e) {
-                    LOG(logLevelWarn, "Ignore exception during MonitorStrategyQueue::release: %s", e.what());
-                    guard.lock();
-                    m_reportQueueStateInProgress = false;
-                }
-            }
-        }
+    virtual void getStats(Stats& s) const OVERRIDE FINAL {
+        Lock guard(m_mutex);
+        s.nfilled = m_current ? 1u : 0u;
+        s.noutstanding = m_outstanding;
+        s.nempty = m_freeQueue.size();
+        s.nmerged = m_merged;
+        s.nmergedmax = m_mergedMax;
+        s.window = 0u; // updates are merged locally
     }
 
     virtual void send(ByteBuffer* buffer, TransportSendControl* control) OVERRIDE FINAL {
@@ -2081,17 +2954,11 @@ public:
 
     Status start() OVERRIDE FINAL {
         Lock guard(m_mutex);
-        while (!m_monitorQueue.empty())
+        if (m_current)
         {
-            m_freeQueue.push_back(m_monitorQueue.front());
-            m_monitorQueue.pop();
-        }
-        if (m_overrunElement)
-        {
-            m_freeQueue.push_back(m_overrunElement);
-            m_overrunElement.reset();
+            m_freeQueue.push_back(m_current);
+            m_current.reset();
         }
-        m_overrunInProgress = false;
         return Status::Ok;
     }
 
@@ -2115,13 +2982,22 @@ public:
     const MonitorRequester::weak_pointer m_callback;
     bool m_started;
 
-    const PVStructure::shared_pointer m_pvRequest;
+    // as sent to the server
+    PVStructure::shared_pointer m_pvRequest;
 
     std::tr1::shared_ptr<MonitorStrategy> m_monitorStrategy;
 
     int32 m_queueSize;
     bool m_pipeline;
     int32 m_ackAny;
+    bool m_latest;
+    bool m_adaptive;
+    bool m_multicast;
+
+    // registered with the context while the server publishes to a multicast group
+    MulticastListener::shared_pointer m_mcastListener;
+    ServerGUID m_mcastGUID;
+    uint32 m_mcastID;
 
     ChannelMonitorImpl(
         ClientChannelImpl::shared_pointer const & channel,
@@ -2134,7 +3010,11 @@ public:
         m_pvRequest(pvRequest),
         m_queueSize(2),
         m_pipeline(false),
-        m_ackAny(0)
+        m_ackAny(0),
+        m_latest(false),
+        m_adaptive(false),
+        m_multicast(false),
+        m_mcastID(0u)
     {
     }
 
@@ -2168,6 +3048,45 @@ public:
                 }
             }
 
+            option = pvOptions->getSubField<PVScalar>("latest");
+            if (option) {
+                try {
+                    m_latest = option->getAs<epics::pvData::boolean>();
+                }catch(std::runtime_error& e){
+                    SEND_MESSAGE(m_callback, cb, "Invalid latest=", warningMessage);
+                }
+            }
+
+            option = pvOptions->getSubField<PVScalar>("adaptive");
+            if (option) {
+                try {
+                    m_adaptive = option->getAs<epics::pvData::boolean>();
+                    // implies pipeline, with queueSize as the maximum window
+                    if (m_adaptive) {
+                        m_pipeline = true;
+                        m_pvRequest = requestPipeline(m_pvRequest);
+                        pvOptions = m_pvRequest->getSubFieldT<PVStructure>("record._options");
+                    }
+                }catch(std::runtime_error& e){
+                    SEND_MESSAGE(m_callback, cb, "Invalid adaptive=", warningMessage);
+                }
+            }
+
+            option = pvOptions->getSubField<PVScalar>("multicast");
+            if (option) {
+                try {
+                    m_multicast = option->getAs<epics::pvData::boolean>();
+                    // server waits for an ack before sending a complete value.
+                    // the ordinary queue is used, and the window is not adapted.
+                    if (m_multicast) {
+                        m_pipeline = true;
+                        m_latest = m_adaptive = false;
+                    }
+                }catch(std::runtime_error& e){
+                    SEND_MESSAGE(m_callback, cb, "Invalid multicast=", warningMessage);
+                }
+            }
+
             // pipeline options
             if (m_pipeline)
             {
@@ -2214,11 +3133,21 @@ public:
 
         BaseRequestImpl::activate();
 
-        std::tr1::shared_ptr<MonitorStrategyQueue> tp(
-            new MonitorStrategyQueue(m_channel, m_ioid, m_callback, m_queueSize,
-                                     m_pipeline, m_ackAny)
-        );
-        m_monitorStrategy = tp;
+        if (m_latest)
+        {
+            std::tr1::shared_ptr<MonitorStrategyLatest> tp(
+                new MonitorStrategyLatest(m_channel, m_ioid, m_callback, m_pipeline)
+            );
+            m_monitorStrategy = tp;
+        }
+        else
+        {
+            std::tr1::shared_ptr<MonitorStrategyQueue> tp(
+                new MonitorStrategyQueue(m_channel, m_ioid, m_callback, m_queueSize,
+                                         m_pipeline, m_ackAny, m_adaptive)
+            );
+            m_monitorStrategy = tp;
+        }
 
         // subscribe
         try {
@@ -2265,7 +3194,7 @@ public:
             if (pendingRequest & QOS_GET_PUT)
             {
                 control->ensureBuffer(4);
-                buffer->putInt(m_queueSize);
+                buffer->putInt(m_monitorStrategy->initialCredit(m_queueSize));
             }
         }
     }
@@ -2291,6 +3220,30 @@ public:
             throw std::runtime_error("initResponse() w/o Structure");
         m_monitorStrategy->init(structure);
 
+        unregisterMulticast();
+
+        // optional extension
+        if (payloadBuffer->getRemaining())
+        {
+            transport->ensureData(1);
+            int8 ext = payloadBuffer->getByte();
+            if (ext & PVA_MONITOR_MULTICAST)
+            {
+                std::string groupName(SerializeHelper::deserializeString(payloadBuffer, transport.get()));
+                ServerGUID guid;
+                transport->ensureData(sizeof(guid.value)+4);
+                payloadBuffer->get(guid.value, 0, sizeof(guid.value));
+                uint32 id = payloadBuffer->getInt();
+
+                Status sts(registerMulticast(groupName, guid, id));
+                if (!sts.isSuccess())
+                {
+                    EXCEPTION_GUARD3(m_callback, cb, cb->monitorConnect(sts, external_from_this<ChannelMonitorImpl>(), StructureConstPtr()));
+                    return;
+                }
+            }
+        }
+
         bool restoreStartedState = m_started;
 
         // notify
@@ -2435,6 +3388,42 @@ public:
     virtual void destroy() OVERRIDE FINAL
     {
         BaseRequestImpl::destroy();
+        unregisterMulticast();
+    }
+
+    Status registerMulticast(const std::string& groupName, const ServerGUID& guid, uint32 id)
+    {
+        MulticastListener::shared_pointer listener(m_monitorStrategy->multicastListener());
+        if (!listener)
+            return Status::error("Multicast requires pipeline=true");
+
+        osiSockAddr group;
+        memset(&group, 0, sizeof(group));
+        if (aToIPAddr(groupName.c_str(), 0, &group.ia))
+            return Status::error("Invalid multicast group "+groupName);
+
+        try {
+            m_channel->getContext()->registerMulticastListener(group, guid, id, listener);
+        } catch (std::exception& e) {
+            return Status::error(std::string("Unable to receive multicast: ")+e.what());
+        }
+
+        Lock G(m_mutex);
+        m_mcastListener = listener;
+        m_mcastGUID = guid;
+        m_mcastID = id;
+        return Status::Ok;
+    }
+
+    void unregisterMulticast()
+    {
+        MulticastListener::shared_pointer listener;
+        {
+            Lock G(m_mutex);
+            listener.swap(m_mcastListener);
+        }
+        if (listener)
+            m_channel->getContext()->unregisterMulticastListener(m_mcastGUID, m_mcastID, listener);
     }
 
     virtual MonitorElement::shared_pointer poll() OVERRIDE FINAL
@@ -2447,6 +3436,14 @@ public:
         m_monitorStrategy->release(monitorElement);
     }
 
+    virtual void getStats(Stats& s) const OVERRIDE FINAL
+    {
+        if (m_monitorStrategy)
+            m_monitorStrategy->getStats(s);
+        else
+            Monitor::getStats(s);
+    }
+
 };
 
 
@@ -2769,6 +3766,45 @@ public:
     }
 };
 
+class MulticastDataHandler : public AbstractClientResponseHandler {
+public:
+    MulticastDataHandler(ClientContextImpl::shared_pointer const & context) :
+        AbstractClientResponseHandler(context, "Multicast data")
+    {}
+
+    virtual ~MulticastDataHandler() {}
+
+    virtual void handleResponse(osiSockAddr* responseFrom,
+                                Transport::shared_pointer const & transport, int8 version, int8 command,
+                                size_t payloadSize, epics::pvData::ByteBuffer* payloadBuffer) OVERRIDE FINAL
+    {
+        AbstractClientResponseHandler::handleResponse(responseFrom, transport, version, command, payloadSize, payloadBuffer);
+
+        ServerGUID guid;
+        transport->ensureData(sizeof(guid.value)+4+4+1);
+
+        payloadBuffer->get(guid.value, 0, sizeof(guid.value));
+        uint32 id = payloadBuffer->getInt();
+        uint32 seq = payloadBuffer->getInt();
+        bool complete = payloadBuffer->getByte()!=0;
+
+        ClientContextImpl::shared_pointer context = _context.lock();
+        if (!context)
+            return;
+
+        std::vector<MulticastListener::shared_pointer> listeners;
+        context->getMulticastListeners(guid, id, listeners);
+
+        // each subscriber of this stream deserializes the same payload
+        size_t start = payloadBuffer->getPosition();
+        for (size_t i=0; i<listeners.size(); i++)
+        {
+            payloadBuffer->setPosition(start);
+            EXCEPTION_GUARD(listeners[i]->datagram(*responseFrom, seq, complete, transport, payloadBuffer));
+        }
+    }
+};
+
 class ClientConnectionValidationHandler : public AbstractClientResponseHandler {
 public:
     ClientConnectionValidationHandler(ClientContextImpl::shared_pointer context) :
@@ -2803,6 +3839,13 @@ public:
         //TODO: simplify byzantine class heirarchy...
         assert(cliTransport);
 
+        // optional extensions, absent from older servers
+        if(payloadBuffer->getRemaining()) {
+            int8 extensions = payloadBuffer->getByte();
+            if(extensions & PVA_VALIDATION_TYPE_DICTIONARY)
+                cliTransport->typeDictionaryOffered();
+        }
+
         cliTransport->authNZInitialize(offeredSecurityPlugins);
     }
 };
@@ -2967,7 +4010,7 @@ public:
         ResponseHandler::shared_pointer ignoreResponse(new NoopResponse(context, "Ignore"));
         ResponseHandler::shared_pointer dataResponse(new ResponseRequestHandler(context));
 
-        m_handlerTable.resize(CMD_CANCEL_REQUEST+1);
+        m_handlerTable.resize(CMD_MULTICAST_DATA+1);
 
         m_handlerTable[CMD_BEACON].reset(new BeaconResponseHandler(context)); /*  0 */
         m_handlerTable[CMD_CONNECTION_VALIDATION].reset(new ClientConnectionValidationHandler(context)); /*  1 */
@@ -2991,6 +4034,8 @@ public:
         m_handlerTable[CMD_MULTIPLE_DATA].reset(new MultipleResponseRequestHandler(context)); /* 19 - grouped monitors */
         m_handlerTable[CMD_RPC] = dataResponse; /* 20 - RPC response */
         m_handlerTable[CMD_CANCEL_REQUEST] = ignoreResponse; /* 21 - cancel request */
+        m_handlerTable[CMD_ORIGIN_TAG] = ignoreResponse; /* 22 - origin tag */
+        m_handlerTable[CMD_MULTICAST_DATA].reset(new MulticastDataHandler(context)); /* 23 - multicast monitor update */
     }
 
     virtual void handleResponse(osiSockAddr* responseFrom,
@@ -3096,6 +4141,16 @@ public:
         short priority,
         std::string const & addressesStr) OVERRIDE FINAL
     {
+        if (m_localShortcut && addressesStr.empty())
+        {
+            ChannelProvider::shared_pointer local(ServerContextImpl::findLocalProvider(channelName));
+            if (local)
+            {
+                // requester is notified by the local provider
+                return local->createChannel(channelName, channelRequester, priority);
+            }
+        }
+
         InetAddrVector addresses;
         getSocketAddressList(addresses, addressesStr, PVA_SERVER_PORT);
 
@@ -3295,6 +4350,11 @@ private:
         }
 
         virtual void destroy() OVERRIDE FINAL
+        {
+            destroyChannel(true);
+        }
+
+        virtual void destroyChannel(bool remoteDestroy) OVERRIDE FINAL
         {
             // Hack.  Prevent Transport from being dtor'd while m_channelMutex is held
             Transport::shared_pointer old_transport;
@@ -3316,7 +4376,7 @@ private:
 
                 if (m_connectionState == CONNECTED)
                 {
-                    disconnect(false, true);
+                    disconnect(false, remoteDestroy);
                 }
                 else if (m_transport)
                 {
@@ -3471,6 +4531,10 @@ public:
                 old_transport.swap(m_transport);
             }
 
+            // the cached server, if any, could not be used
+            if (m_addresses.empty() && m_context->getSearchCache())
+                m_context->getSearchCache()->remove(m_name);
+
             // ... and search again, with penalty
             initiateSearch(true);
         }
@@ -3577,14 +4641,23 @@ public:
 
             m_allowCreation = true;
 
-            if (m_addresses.empty())
+            SearchCache::Entry cached;
+            if (!m_addresses.empty())
             {
-                m_context->getChannelSearchManager()->registerSearchInstance(internal_from_this(), penalize);
+                m_context->getTimer()->scheduleAfterDelay(internal_from_this(),
+                        (m_addressIndex / m_addresses.size())*STATIC_SEARCH_BASE_DELAY_SEC);
+            }
+            else if (!penalize && m_context->getSearchCache() && m_context->getSearchCache()->lookup(m_name, cached))
+            {
+                // ask the server which last had this channel before broadcasting.
+                // Search requests go to the UDP port, the same as for $EPICS_PVA_ADDR_LIST
+                osiSockAddr server(cached.address);
+                server.ia.sin_port = htons(m_context->getBroadcastPort());
+                m_context->getChannelSearchManager()->registerSearchInstance(internal_from_this(), server);
             }
             else
             {
-                m_context->getTimer()->scheduleAfterDelay(internal_from_this(),
-                        (m_addressIndex / m_addresses.size())*STATIC_SEARCH_BASE_DELAY_SEC);
+                m_context->getChannelSearchManager()->registerSearchInstance(internal_from_this(), penalize);
             }
         }
 
@@ -3640,6 +4713,9 @@ public:
             // remember GUID
             std::copy(guid.value, guid.value + 12, m_guid.value);
 
+            if (m_addresses.empty() && m_context->getSearchCache())
+                m_context->getSearchCache()->update(m_name, *serverAddress, guid);
+
             // create channel
             {
                 Lock guard(m_channelMutex);
@@ -3812,9 +4888,8 @@ public:
                 buffer->putInt(sid);
                 // CID
                 buffer->putInt(m_channelID);
-                // send immediately
-                // TODO
-                control->flush(true);
+                // no flush.  destroys queued together (eg. many channels closed at once)
+                // share the send buffer, which is flushed when the send queue drains.
             }
         }
 
@@ -3957,7 +5032,7 @@ public:
     static size_t num_instances;
 
     InternalClientContextImpl(const Configuration::shared_pointer& conf) :
-        m_addressList(""), m_autoAddressList(true), m_connectionTimeout(30.0f), m_beaconPeriod(15.0f),
+        m_addressList(""), m_autoAddressList(true), m_lazyStart(false), m_localShortcut(false), m_connectionTimeout(30.0f), m_beaconPeriod(15.0f),
         m_broadcastPort(PVA_BROADCAST_PORT), m_receiveBufferSize(MAX_TCP_RECV),
         m_lastCID(0x10203040),
         m_lastIOID(0x80706050),
@@ -3971,6 +5046,10 @@ public:
     {
         REFTRACE_INCREMENT(num_instances);
 
+        memset(&m_mcastNIF, 0, sizeof(m_mcastNIF));
+        m_mcastNIF.ia.sin_family = AF_INET;
+        m_mcastNIF.ia.sin_addr.s_addr = htonl(INADDR_ANY);
+
         if(!m_configuration) m_configuration = ConfigurationFactory::getConfiguration("pvAccess-client");
         m_flushTransports.reserve(64);
         loadConfiguration();
@@ -3999,6 +5078,21 @@ public:
         return m_searchTransport;
     }
 
+    SearchCache* getSearchCache() const
+    {
+        return m_searchCache.get();
+    }
+
+    int32 getBroadcastPort() const
+    {
+        return m_broadcastPort;
+    }
+
+    bool lazyStart() const
+    {
+        return m_lazyStart;
+    }
+
     virtual void initialize() OVERRIDE FINAL {
         Lock lock(m_contextMutex);
 
@@ -4019,10 +5113,19 @@ public:
         out << "VERSION            : " << m_version.getVersionString() << std::endl;
         out << "ADDR_LIST          : " << m_addressList << std::endl;
         out << "AUTO_ADDR_LIST     : " << (m_autoAddressList ? "true" : "false") << std::endl;
+        out << "CLIENT_LAZY        : " << (m_lazyStart ? "true" : "false") << std::endl;
+        out << "CLIENT_LOCAL       : " << (m_localShortcut ? "true" : "false") << std::endl;
         out << "CONNECTION_TIMEOUT : " << m_connectionTimeout << std::endl;
         out << "BEACON_PERIOD      : " << m_beaconPeriod << std::endl;
         out << "BROADCAST_PORT     : " << m_broadcastPort << std::endl;;
         out << "RCV_BUFFER_SIZE    : " << m_receiveBufferSize << std::endl;
+        out << "SEARCH_CACHE       : " << (m_searchCache ? m_searchCache->filename() : std::string()) << std::endl;
+        out << "MCAST_INTF         : " << inetAddressToString(m_mcastNIF, false) << std::endl;
+        {
+            Lock guard(m_mcastMutex);
+            for (MulticastReceiverMap::const_iterator it(m_mcastReceivers.begin()), end(m_mcastReceivers.end()); it!=end; ++it)
+                out << "MCAST_GROUP        : " << it->first << std::endl;
+        }
         out << "STATE              : ";
         switch (m_contextState)
         {
@@ -4048,8 +5151,14 @@ public:
             if (m_contextState == CONTEXT_DESTROYED)
                 return;
 
+            // lazy context which was never used
+            bool started = m_contextState == CONTEXT_INITIALIZED;
+
             // go into destroyed state ASAP
             m_contextState = CONTEXT_DESTROYED;
+
+            if (!started)
+                return;
         }
 
         //
@@ -4073,6 +5182,17 @@ public:
         if (m_searchTransport)
             m_searchTransport->close();
 
+        {
+            MulticastReceiverMap receivers;
+            {
+                Lock guard(m_mcastMutex);
+                receivers.swap(m_mcastReceivers);
+                m_mcastListeners.clear();
+            }
+            for (MulticastReceiverMap::const_iterator it(receivers.begin()), end(receivers.end()); it!=end; ++it)
+                it->second->close();
+        }
+
         // wait for all transports to cleanly exit
         int tries = 40;
         epics::pvData::int32 transportCount;
@@ -4086,6 +5206,9 @@ public:
 
         if (transportCount)
             LOG(logLevelDebug, "PVA client context destroyed with %u transport(s) active.", (unsigned)transportCount);
+
+        if (m_searchCache)
+            m_searchCache->save();
     }
 
     virtual ~InternalClientContextImpl()
@@ -4111,10 +5234,26 @@ private:
 
         m_addressList = m_configuration->getPropertyAsString("EPICS_PVA_ADDR_LIST", m_addressList);
         m_autoAddressList = m_configuration->getPropertyAsBoolean("EPICS_PVA_AUTO_ADDR_LIST", m_autoAddressList);
+        m_lazyStart = m_configuration->getPropertyAsBoolean("EPICS_PVA_CLIENT_LAZY", m_lazyStart);
+        m_localShortcut = m_configuration->getPropertyAsBoolean("EPICS_PVA_CLIENT_LOCAL", m_localShortcut);
         m_connectionTimeout = m_configuration->getPropertyAsFloat("EPICS_PVA_CONN_TMO", m_connectionTimeout);
         m_beaconPeriod = m_configuration->getPropertyAsFloat("EPICS_PVA_BEACON_PERIOD", m_beaconPeriod);
         m_broadcastPort = m_configuration->getPropertyAsInteger("EPICS_PVA_BROADCAST_PORT", m_broadcastPort);
         m_receiveBufferSize = m_configuration->getPropertyAsInteger("EPICS_PVA_MAX_ARRAY_BYTES", m_receiveBufferSize);
+
+        if (!m_configuration->getPropertyAsAddress("EPICS_PVA_MCAST_INTF", &m_mcastNIF) &&
+                m_configuration->hasProperty("EPICS_PVA_MCAST_INTF"))
+        {
+            LOG(logLevelError, "EPICS_PVA_MCAST_INTF contains invalid IP or non-existant hostname, using any interface");
+            memset(&m_mcastNIF, 0, sizeof(m_mcastNIF));
+            m_mcastNIF.ia.sin_family = AF_INET;
+            m_mcastNIF.ia.sin_addr.s_addr = htonl(INADDR_ANY);
+        }
+
+        std::string cacheFile(m_configuration->getPropertyAsString("EPICS_PVA_SEARCH_CACHE", ""));
+        if (!cacheFile.empty())
+            m_searchCache.reset(new SearchCache(cacheFile,
+                                                m_configuration->getPropertyAsDouble("EPICS_PVA_SEARCH_CACHE_TMO", 86400.0)));
     }
 
     void internalInitialize() {
@@ -4130,6 +5269,9 @@ private:
 
         m_channelSearchManager.reset(new ChannelSearchManager(thisPointer));
 
+        if (m_searchCache)
+            m_searchCache->load();
+
         // TODO put memory barrier here... (if not already called within a lock?)
 
         // setup UDP transport
@@ -4149,8 +5291,10 @@ private:
             }
             epicsSocketDestroy (socket);
 
+            // a lazy (short lived) context does not listen for beacons
             initializeUDPTransports(false, m_udpTransports, ifaceList, m_responseHandler, m_searchTransport,
-                                    m_broadcastPort, m_autoAddressList, m_addressList, std::string());
+                                    m_broadcastPort, m_autoAddressList, m_addressList, std::string(),
+                                    !m_lazyStart);
 
         }
 
@@ -4161,28 +5305,27 @@ private:
         // TODO what if initialization failed!!!
     }
 
+    /* Only called when the context is destroyed.  All Transports are closed as
+     * the last channel releases them, which the server treats as destroying every
+     * channel and request.  So no CMD_DESTROY_CHANNEL or CMD_DESTROY_REQUEST is sent.
+     */
     void destroyAllChannels() {
-        Lock guard(m_cidMapMutex);
-
-        int count = 0;
-        std::vector<ClientChannelImpl::weak_pointer> channels(m_channelsByCID.size());
-        for (CIDChannelMap::iterator iter = m_channelsByCID.begin();
-                iter != m_channelsByCID.end();
-                iter++)
+        CIDChannelMap channels;
         {
-            channels[count++] = iter->second;
+            Lock guard(m_cidMapMutex);
+            // unregisterChannel() is now a no-op
+            channels.swap(m_channelsByCID);
         }
 
-        guard.unlock();
-
-
         ClientChannelImpl::shared_pointer ptr;
-        for (int i = 0; i < count; i++)
+        for (CIDChannelMap::iterator iter = channels.begin();
+                iter != channels.end();
+                iter++)
         {
-            ptr = channels[i].lock();
+            ptr = iter->second.lock();
             if (ptr)
             {
-                EXCEPTION_GUARD(ptr->destroy());
+                EXCEPTION_GUARD(ptr->destroyChannel(false));
             }
         }
     }
@@ -4360,6 +5503,69 @@ private:
         return handler;
     }
 
+    static std::pair<std::string, uint32> multicastKey(const ServerGUID& guid, uint32 id)
+    {
+        return std::make_pair(std::string(guid.value, sizeof(guid.value)), id);
+    }
+
+    virtual void registerMulticastListener(const osiSockAddr& group, const ServerGUID& guid, uint32 id,
+                                           MulticastListener::shared_pointer const & listener) OVERRIDE FINAL
+    {
+        std::string groupName(inetAddressToString(group));
+
+        Lock guard(m_mcastMutex);
+
+        if (m_mcastReceivers.find(groupName) == m_mcastReceivers.end())
+        {
+            // NOTE: multicast receiver socket must be "bound" to INADDR_ANY or multicast address
+            osiSockAddr bindAddress(group);
+#if defined(_WIN32)
+            bindAddress.ia.sin_addr.s_addr = htonl(INADDR_ANY);
+#endif
+            BlockingUDPConnector connector(false);
+            BlockingUDPTransport::shared_pointer transport(connector.connect(m_responseHandler, bindAddress,
+                                                                             PVA_CLIENT_PROTOCOL_REVISION));
+            if (!transport)
+                throw std::runtime_error("Failed to bind UDP socket to "+groupName);
+
+            transport->join(group, m_mcastNIF);
+            transport->start();
+            m_mcastReceivers[groupName] = transport;
+
+            LOG(logLevelDebug, "Joined multicast group %s", groupName.c_str());
+        }
+
+        m_mcastListeners.insert(std::make_pair(multicastKey(guid, id), MulticastListener::weak_pointer(listener)));
+    }
+
+    virtual void unregisterMulticastListener(const ServerGUID& guid, uint32 id,
+                                             MulticastListener::shared_pointer const & listener) OVERRIDE FINAL
+    {
+        Lock guard(m_mcastMutex);
+        std::pair<MulticastListenerMap::iterator, MulticastListenerMap::iterator> range(m_mcastListeners.equal_range(multicastKey(guid, id)));
+        while (range.first != range.second)
+        {
+            MulticastListener::shared_pointer L(range.first->second.lock());
+            if (!L || L == listener)
+                m_mcastListeners.erase(range.first++);
+            else
+                ++range.first;
+        }
+    }
+
+    virtual void getMulticastListeners(const ServerGUID& guid, uint32 id,
+                                       std::vector<MulticastListener::shared_pointer>& listeners) OVERRIDE FINAL
+    {
+        Lock guard(m_mcastMutex);
+        std::pair<MulticastListenerMap::iterator, MulticastListenerMap::iterator> range(m_mcastListeners.equal_range(multicastKey(guid, id)));
+        for (; range.first != range.second; ++range.first)
+        {
+            MulticastListener::shared_pointer L(range.first->second.lock());
+            if (L)
+                listeners.push_back(L);
+        }
+    }
+
     /**
      * Get, or create if necessary, transport of given server address.
      * @param serverAddress    required transport address
@@ -4430,6 +5636,18 @@ private:
      */
     bool m_autoAddressList;
 
+    /**
+     * Defer initialization until the first channel is created, and do not listen for beacons.
+     * Intended for short lived contexts (eg. pvget).
+     */
+    bool m_lazyStart;
+
+    /**
+     * Channels claimed by a provider of a ServerContext in this process are created
+     * directly through that ChannelProvider, without search or serialization.
+     */
+    bool m_localShortcut;
+
     /**
      * If the context doesn't see a beacon from a server that it is connected to for
      * connectionTimeout seconds then a state-of-health message is sent to the server over TCP/IP.
@@ -4453,6 +5671,11 @@ private:
      */
     int m_receiveBufferSize;
 
+    /**
+     * Servers which previously answered searches.  NULL unless $EPICS_PVA_SEARCH_CACHE is set.
+     */
+    SearchCache::shared_pointer m_searchCache;
+
     /**
      * Timer.
      */
@@ -4534,6 +5757,24 @@ private:
      */
     Mutex m_beaconMapMutex;
 
+    /**
+     * Interface on which multicast groups are joined.
+     */
+    osiSockAddr m_mcastNIF;
+
+    /**
+     * Receivers of multicast groups joined, and subscribers of streams (keys are server GUID and stream ID).
+     */
+    typedef std::map<std::string, BlockingUDPTransport::shared_pointer> MulticastReceiverMap;
+    MulticastReceiverMap m_mcastReceivers;
+    typedef std::multimap<std::pair<std::string, uint32>, MulticastListener::weak_pointer> MulticastListenerMap;
+    MulticastListenerMap m_mcastListeners;
+
+    /**
+     *  MulticastReceiverMap and MulticastListenerMap mutex.
+     */
+    Mutex m_mcastMutex;
+
     /**
      * Version.
      */
@@ -4757,7 +5998,8 @@ ChannelProvider::shared_pointer createClientProvider(const Configuration::shared
                                               external(internal.get(), epics::pvAccess::Destroyable::cleaner(internal));
     const_cast<InternalClientContextImpl::weak_pointer&>(internal->m_external_this) = external;
     const_cast<InternalClientContextImpl::weak_pointer&>(internal->m_internal_this) = internal;
-    internal->initialize();
+    if (!internal->lazyStart())
+        internal->initialize();
     return external;
 }
 
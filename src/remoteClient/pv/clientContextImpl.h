@@ -54,12 +54,34 @@ public:
     virtual Transport::shared_pointer checkDestroyedAndGetTransport() = 0;
     virtual Transport::shared_pointer getTransport() = 0;
     virtual void transportClosed() =0;
+    //! destroy(), optionally without sending CMD_DESTROY_CHANNEL
+    virtual void destroyChannel(bool remoteDestroy) =0;
 
     static epics::pvData::Status channelDestroyed;
     static epics::pvData::Status channelDisconnected;
 
 };
 
+/** Receives the CMD_MULTICAST_DATA datagrams of one stream (cf. MulticastPublisher)
+ *  which follow the header: ServerGUID, stream ID, sequence # and complete flag.
+ */
+class MulticastListener
+{
+public:
+    POINTER_DEFINITIONS(MulticastListener);
+    virtual ~MulticastListener() {}
+
+    /** @param from Sender of this datagram
+     *  @param seq Sequence # of this update
+     *  @param complete false if the server could not fit this update into a datagram
+     *  @param payloadBuffer positioned at the changed BitSet when 'complete'
+     */
+    virtual void datagram(const osiSockAddr& from,
+                          epics::pvData::uint32 seq, bool complete,
+                          Transport::shared_pointer const & transport,
+                          epics::pvData::ByteBuffer* payloadBuffer) = 0;
+};
+
 class ClientContextImpl : public Context
 {
 public:
@@ -110,6 +132,17 @@ public:
 
     virtual std::tr1::shared_ptr<BeaconHandler> getBeaconHandler(osiSockAddr* responseFrom) = 0;
 
+    /** Deliver datagrams of stream 'id' from server 'guid' to 'listener' (weak ref.).
+     *  Joins 'group' on first use.
+     *  @throws std::runtime_error if the group can not be joined.
+     */
+    virtual void registerMulticastListener(const osiSockAddr& group, const ServerGUID& guid, epics::pvData::uint32 id,
+                                           MulticastListener::shared_pointer const & listener) = 0;
+    virtual void unregisterMulticastListener(const ServerGUID& guid, epics::pvData::uint32 id,
+                                             MulticastListener::shared_pointer const & listener) = 0;
+    virtual void getMulticastListeners(const ServerGUID& guid, epics::pvData::uint32 id,
+                                       std::vector<MulticastListener::shared_pointer>& listeners) = 0;
+
     virtual void destroy() = 0;
 };
 
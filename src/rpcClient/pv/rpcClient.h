@@ -123,6 +123,49 @@ public:
      */
     epics::pvData::PVStructure::shared_pointer waitResponse(double timeout = RPCCLIENT_DEFAULT_TIMEOUT);
 
+    //! Completion of a request issued with issueAsync()
+    struct epicsShareClass Future
+    {
+        POINTER_DEFINITIONS(Future);
+        virtual ~Future();
+        //! Has the response (or an error) been received?
+        virtual bool done() =0;
+        /**
+         * Wait for the request to complete.
+         * @param timeout the time in seconds to wait for the response, 0 means forever.
+         * @return request response.  Not copied, and not referenced by RPCClient.
+         * @throws RPCRequestException exception thrown on error or timeout.
+         */
+        virtual epics::pvData::PVStructure::shared_pointer wait(double timeout = RPCCLIENT_DEFAULT_TIMEOUT) =0;
+    };
+
+    //! Notification of completion of a request issued with issueAsync()
+    struct epicsShareClass Callback
+    {
+        POINTER_DEFINITIONS(Callback);
+        virtual ~Callback();
+        /**
+         * Called from a PVA worker thread.  Must not block.
+         * @param status Success, or the reason for failure.
+         * @param response Non-NULL on success.  Not copied, and not referenced by RPCClient.
+         */
+        virtual void requestDone(const epics::pvData::Status& status,
+                                 epics::pvData::PVStructure::shared_pointer const & response) =0;
+    };
+
+    /**
+     * Issue a request and return immediately.
+     *
+     * Unlike issueRequest(), any number of these requests may be in progress concurrently,
+     * from any thread.  Each uses a ChannelRPC operation on the one Channel, which is
+     * kept for re-use by later requests.
+     * Does not wait for the channel to connect.
+     */
+    Future::shared_pointer issueAsync(epics::pvData::PVStructure::shared_pointer const & pvArgument);
+    //! As issueAsync(), with completion notified through the callback.
+    void issueAsync(epics::pvData::PVStructure::shared_pointer const & pvArgument,
+                    Callback::shared_pointer const & callback);
+
 private:
 
     const std::string m_serviceName;
@@ -134,6 +177,9 @@ private:
     struct RPCRequester;
     std::tr1::shared_ptr<RPCRequester> m_rpc_requester;
 
+    struct AsyncPool;
+    std::tr1::shared_ptr<AsyncPool> m_async;
+
     RPCClient(const RPCClient&);
     RPCClient& operator=(const RPCClient&);
 };
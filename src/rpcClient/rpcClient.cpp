@@ -4,8 +4,10 @@
  * found in file LICENSE that is included with this distribution.
  */
 
+#include <algorithm>
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include <epicsEvent.h>
 #include <pv/pvData.h>
@@ -114,6 +116,340 @@ struct RPCClient::RPCRequester : public pva::ChannelRPCRequester
     }
 };
 
+RPCClient::Future::~Future() {}
+RPCClient::Callback::~Callback() {}
+
+namespace {
+
+// The pva provider deserializes each reply into a new structure.
+bool providerOwnsReply(const ChannelProvider::shared_pointer& provider)
+{
+    return provider && provider->getProviderName()=="pva";
+}
+
+pvd::PVStructure::shared_pointer copyReply(const pvd::PVStructure& data)
+{
+    pvd::PVStructure::shared_pointer ret(pvd::getPVDataCreate()->createPVStructure(data.getStructure()));
+    ret->copyUnchecked(data);
+    return ret;
+}
+
+struct RPCFuture : public RPCClient::Future
+{
+    POINTER_DEFINITIONS(RPCFuture);
+
+    pvd::Mutex mutex;
+    epicsEvent event;
+    bool complete;
+    pvd::Status status;
+    pvd::PVStructure::shared_pointer data;
+    const RPCClient::Callback::shared_pointer callback;
+
+    explicit RPCFuture(const RPCClient::Callback::shared_pointer& callback)
+        :complete(false)
+        ,callback(callback)
+    {}
+    virtual ~RPCFuture() {}
+
+    void finish(const pvd::Status& sts, const pvd::PVStructure::shared_pointer& response)
+    {
+        pvd::Status result(sts);
+        if(result.isSuccess() && !response)
+            result = pvd::Status::error("No reply data");
+        {
+            pvd::Lock L(mutex);
+            if(complete)
+                return;
+            complete = true;
+            status = result;
+            if(!callback && result.isSuccess())
+                data = response;
+        }
+        if(callback) {
+            try {
+                callback->requestDone(result, result.isSuccess() ? response : pvd::PVStructure::shared_pointer());
+            } catch(std::exception& e) {
+                LOG(logLevelError, "Unhandled exception from RPCClient::Callback::requestDone(): %s", e.what());
+            }
+        }
+        event.signal();
+    }
+
+    virtual bool done() OVERRIDE FINAL
+    {
+        pvd::Lock L(mutex);
+        return complete;
+    }
+
+    virtual pvd::PVStructure::shared_pointer wait(double timeout) OVERRIDE FINAL
+    {
+        pvd::Lock L(mutex);
+        while(!complete) {
+            L.unlock();
+            if(timeout<=0.0) {
+                event.wait();
+            } else if(!event.wait(timeout)) {
+                throw RPCRequestException(pvd::Status::STATUSTYPE_ERROR, "RPC timeout");
+            }
+            L.lock();
+        }
+        // wake any other waiter
+        event.signal();
+
+        if(!status.isSuccess())
+            throw RPCRequestException(pvd::Status::STATUSTYPE_ERROR, status.getMessage());
+
+        // consume so that we can't possibly return it twice
+        pvd::PVStructure::shared_pointer ret;
+        ret.swap(data);
+        if(!ret)
+            throw std::logic_error("Response already taken");
+        return ret;
+    }
+};
+
+} // namespace
+
+/* Operations used by issueAsync().
+ * One ChannelRPC can have only one request in progress,
+ * so concurrent requests each take an idle operation, or create another.
+ */
+struct RPCClient::AsyncPool
+{
+    POINTER_DEFINITIONS(AsyncPool);
+
+    struct Op : public pva::ChannelRPCRequester
+    {
+        POINTER_DEFINITIONS(Op);
+
+        const AsyncPool::weak_pointer pool;
+        Op::weak_pointer self;
+
+        pvd::Mutex mutex;
+        // our reference to the operation
+        ChannelRPC::shared_pointer handle;
+        ChannelRPC::shared_pointer op;
+        bool connected;
+        bool dead; // connect failed.  never re-used
+        RPCFuture::shared_pointer current;
+        pvd::PVStructure::shared_pointer deferred;
+
+        explicit Op(const AsyncPool::shared_pointer& pool)
+            :pool(pool)
+            ,connected(false)
+            ,dead(false)
+        {}
+        virtual ~Op() {}
+
+        virtual std::string getRequesterName() OVERRIDE FINAL { return "RPCClient::AsyncPool::Op"; }
+
+        void idle()
+        {
+            AsyncPool::shared_pointer P(pool.lock());
+            Op::shared_pointer S(self.lock());
+            if(P && S)
+                P->release(S);
+        }
+
+        // forget an operation which never connected
+        void discard()
+        {
+            AsyncPool::shared_pointer P(pool.lock());
+            Op::shared_pointer S(self.lock());
+            if(P && S)
+                P->discard(S);
+        }
+
+        virtual void channelRPCConnect(
+            const pvd::Status& status,
+            ChannelRPC::shared_pointer const & operation) OVERRIDE FINAL
+        {
+            pvd::PVStructure::shared_pointer args;
+            RPCFuture::shared_pointer failed;
+            ChannelRPC::shared_pointer dispose;
+            {
+                pvd::Lock L(mutex);
+                TRACE("status="<<status);
+                connected = status.isSuccess();
+                if(connected) {
+                    op = operation;
+                    args.swap(deferred);
+                } else {
+                    dead = true;
+                    failed.swap(current);
+                    deferred.reset();
+                    dispose.swap(handle); // unset if called from createChannelRPC()
+                }
+            }
+            if(args) {
+                TRACE("request deferred: "<<args);
+                operation->request(args);
+            }
+            if(!connected) {
+                discard();
+                if(dispose)
+                    dispose->destroy();
+            }
+            if(failed)
+                failed->finish(status, pvd::PVStructure::shared_pointer());
+        }
+
+        virtual void requestDone(
+            const pvd::Status& status,
+            ChannelRPC::shared_pointer const & /*operation*/,
+            pvd::PVStructure::shared_pointer const & pvResponse) OVERRIDE FINAL
+        {
+            TRACE("status="<<status);
+            RPCFuture::shared_pointer cur;
+            {
+                pvd::Lock L(mutex);
+                cur.swap(current);
+            }
+            pvd::PVStructure::shared_pointer response(pvResponse);
+            {
+                AsyncPool::shared_pointer P(pool.lock());
+                if(P && P->copyReplies && response)
+                    response = copyReply(*response);
+            }
+            // available for re-use before the callback, which may issue another request
+            idle();
+            if(cur)
+                cur->finish(status, response);
+        }
+
+        virtual void channelDisconnect(bool destroy) OVERRIDE FINAL
+        {
+            TRACE("destroy="<<destroy);
+            RPCFuture::shared_pointer cur;
+            {
+                pvd::Lock L(mutex);
+                connected = false;
+                cur.swap(current);
+                deferred.reset();
+            }
+            if(cur) {
+                idle();
+                cur->finish(pvd::Status::error("Connection lost"), pvd::PVStructure::shared_pointer());
+            }
+        }
+    };
+
+    pvd::Mutex mutex;
+    const Channel::shared_pointer channel;
+    const pvd::PVStructure::shared_pointer pvRequest;
+    std::vector<Op::shared_pointer> idleOps, allOps;
+    bool destroyed;
+    const bool copyReplies;
+
+    AsyncPool(const Channel::shared_pointer& channel,
+              const pvd::PVStructure::shared_pointer& pvRequest)
+        :channel(channel)
+        ,pvRequest(pvRequest)
+        ,destroyed(false)
+        ,copyReplies(!providerOwnsReply(channel->getProvider()))
+    {}
+
+    void release(const Op::shared_pointer& op)
+    {
+        pvd::Lock L(mutex);
+        if(!destroyed)
+            idleOps.push_back(op);
+    }
+
+    void discard(const Op::shared_pointer& op)
+    {
+        pvd::Lock L(mutex);
+        allOps.erase(std::remove(allOps.begin(), allOps.end(), op), allOps.end());
+        idleOps.erase(std::remove(idleOps.begin(), idleOps.end(), op), idleOps.end());
+    }
+
+    void issue(const AsyncPool::shared_pointer& self,
+               const pvd::PVStructure::shared_pointer& args,
+               const RPCFuture::shared_pointer& future)
+    {
+        Op::shared_pointer op;
+        {
+            pvd::Lock L(mutex);
+            if(destroyed) {
+                L.unlock();
+                future->finish(pvd::Status::error("RPCClient destroyed"), pvd::PVStructure::shared_pointer());
+                return;
+            }
+            if(!idleOps.empty()) {
+                op = idleOps.back();
+                idleOps.pop_back();
+            }
+        }
+
+        bool create = !op;
+        if(create) {
+            op.reset(new Op(self));
+            op->self = op;
+        }
+
+        ChannelRPC::shared_pointer rpc;
+        {
+            pvd::Lock L(op->mutex);
+            op->current = future;
+            if(op->connected)
+                rpc = op->op;
+            else
+                op->deferred = args; // sent from channelRPCConnect()
+        }
+
+        if(create) {
+            // may call channelRPCConnect() recursively
+            ChannelRPC::shared_pointer handle(channel->createChannelRPC(op, pvRequest));
+            if(!handle)
+                throw std::logic_error("channel createChannelRPC() NULL");
+            bool dead;
+            {
+                pvd::Lock L(op->mutex);
+                dead = op->dead;
+                if(!dead)
+                    op->handle = handle;
+            }
+            if(dead) {
+                // connect already failed
+                handle->destroy();
+            } else {
+                pvd::Lock L(mutex);
+                allOps.push_back(op);
+            }
+        }
+
+        if(rpc) {
+            TRACE("request args: "<<args);
+            rpc->request(args);
+        }
+    }
+
+    void destroy()
+    {
+        std::vector<Op::shared_pointer> ops;
+        {
+            pvd::Lock L(mutex);
+            destroyed = true;
+            ops.swap(allOps);
+            idleOps.clear();
+        }
+        for(size_t i=0; i<ops.size(); i++) {
+            ChannelRPC::shared_pointer handle;
+            RPCFuture::shared_pointer cur;
+            {
+                pvd::Lock L(ops[i]->mutex);
+                handle.swap(ops[i]->handle);
+                ops[i]->op.reset();
+                cur.swap(ops[i]->current);
+            }
+            if(handle)
+                handle->destroy();
+            if(cur)
+                cur->finish(pvd::Status::error("RPCClient destroyed"), pvd::PVStructure::shared_pointer());
+        }
+    }
+};
+
 
 RPCClient::RPCClient(const std::string & serviceName,
                      pvd::PVStructure::shared_pointer const & pvRequest,
@@ -140,10 +476,17 @@ RPCClient::RPCClient(const std::string & serviceName,
     m_rpc = m_channel->createChannelRPC(m_rpc_requester, m_pvRequest);
     if(!m_rpc)
         throw std::logic_error("channel createChannelRPC() NULL");
+
+    m_async.reset(new AsyncPool(m_channel, m_pvRequest));
 }
 
 void RPCClient::destroy()
 {
+    if (m_async)
+    {
+        m_async->destroy();
+        m_async.reset();
+    }
     if (m_channel)
     {
         m_channel->destroy();
@@ -255,14 +598,35 @@ pvd::PVStructure::shared_pointer RPCClient::waitResponse(double timeout)
     if(!data)
         throw std::logic_error("No request in progress");
 
-    // copy it so that the caller need not worry about whether it will overwritten
-    // when the next request is issued
-    pvd::PVStructure::shared_pointer ret(pvd::getPVDataCreate()->createPVStructure(data->getStructure()));
-    ret->copyUnchecked(*data);
+    // The pva provider deserializes each reply into a new structure, which we no longer reference.
+    // Others may re-use or share theirs, so copy it so that the caller need not worry
+    // about whether it will be overwritten when the next request is issued.
+    if(!providerOwnsReply(m_provider))
+        data = copyReply(*data);
+
+    return data;
+}
 
+RPCClient::Future::shared_pointer RPCClient::issueAsync(pvd::PVStructure::shared_pointer const & pvArgument)
+{
+    RPCFuture::shared_pointer ret(new RPCFuture(Callback::shared_pointer()));
+    if(!m_async)
+        throw std::logic_error("RPCClient destroyed");
+    m_async->issue(m_async, pvArgument, ret);
     return ret;
 }
 
+void RPCClient::issueAsync(pvd::PVStructure::shared_pointer const & pvArgument,
+                           Callback::shared_pointer const & callback)
+{
+    if(!callback)
+        throw std::invalid_argument("RPCClient::issueAsync() requires a Callback");
+    RPCFuture::shared_pointer req(new RPCFuture(callback));
+    if(!m_async)
+        throw std::logic_error("RPCClient destroyed");
+    m_async->issue(m_async, pvArgument, req);
+}
+
 RPCClient::shared_pointer RPCClient::create(const std::string & serviceName,
         pvd::PVStructure::shared_pointer const & pvRequest)
 {
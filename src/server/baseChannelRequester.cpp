@@ -4,6 +4,8 @@
  * in file LICENSE that is included with this distribution.
  */
 
+#include <algorithm>
+
 #include <epicsAtomic.h>
 
 #define epicsExportSharedSymbols
@@ -25,6 +27,7 @@ const Status BaseChannelRequester::otherRequestPendingStatus(Status::STATUSTYPE_
 const Status BaseChannelRequester::notAChannelRequestStatus(Status::STATUSTYPE_ERROR, "not a channel request");
 
 const int32 BaseChannelRequester::NULL_REQUEST = -1;
+const size_t BaseChannelRequester::maxWindow = 64;
 
 BaseChannelRequester::BaseChannelRequester(
     ServerContextImpl::shared_pointer const & context,
@@ -35,7 +38,8 @@ BaseChannelRequester::BaseChannelRequester(
     _transport(transport),
     _channel(channel),
     _context(context),
-    _pendingRequest(BaseChannelRequester::NULL_REQUEST)
+    _pendingRequest(BaseChannelRequester::NULL_REQUEST),
+    _window(1u)
 {
 
 }
@@ -63,6 +67,73 @@ int32 BaseChannelRequester::getPendingRequest()
     return _pendingRequest;
 }
 
+BaseChannelRequester::queue_t BaseChannelRequester::queueRequest(int32 qos,
+                                                                 PVStructure::shared_pointer const & value,
+                                                                 BitSet::shared_pointer const & changed)
+{
+    Lock guard(_mutex);
+    if (_pendingRequest == NULL_REQUEST && _queued.empty())
+    {
+        _pendingRequest = qos;
+        return Started;
+    }
+    else if (_queued.size() + 1u >= _window)
+    {
+        return Rejected;
+    }
+    _queued.push_back(QueuedRequest());
+    QueuedRequest& req = _queued.back();
+    req.qos = qos;
+    req.value = value;
+    req.changed = changed;
+    return Queued;
+}
+
+bool BaseChannelRequester::nextRequest(int32& qos,
+                                       PVStructure::shared_pointer& value,
+                                       BitSet::shared_pointer& changed)
+{
+    Lock guard(_mutex);
+    if (_queued.empty())
+    {
+        _pendingRequest = NULL_REQUEST;
+        return false;
+    }
+    QueuedRequest& req = _queued.front();
+    _pendingRequest = qos = req.qos;
+    value.swap(req.value);
+    changed.swap(req.changed);
+    _queued.pop_front();
+    return true;
+}
+
+size_t BaseChannelRequester::getWindow()
+{
+    Lock guard(_mutex);
+    return _window;
+}
+
+void BaseChannelRequester::setWindow(size_t window)
+{
+    Lock guard(_mutex);
+    _window = std::max(size_t(1u), std::min(window, maxWindow));
+}
+
+size_t BaseChannelRequester::requestedWindow(PVStructure::shared_pointer const & pvRequest)
+{
+    PVScalar::shared_pointer opt;
+    if (pvRequest)
+        opt = pvRequest->getSubField<PVScalar>("record._options.window");
+    if (!opt)
+        return 1u;
+    try {
+        return std::max(uint32(1u), opt->getAs<uint32>());
+    } catch(std::exception& e) {
+        // not a number.  ignore
+        return 1u;
+    }
+}
+
 string BaseChannelRequester::getRequesterName()
 {
     std::stringstream name;
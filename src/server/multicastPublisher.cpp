@@ -0,0 +1,755 @@
+/**
+ * Copyright - See the COPYRIGHT that is included with this distribution.
+ * pvAccessCPP is distributed subject to a Software License Agreement found
+ * in file LICENSE that is included with this distribution.
+ */
+
+#include <string.h>
+
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <epicsGuard.h>
+
+#include <pv/pvData.h>
+#include <pv/bitSet.h>
+#include <pv/byteBuffer.h>
+#include <pv/serialize.h>
+#include <pv/createRequest.h>
+
+#define epicsExportSharedSymbols
+#include <pv/multicastPublisher.h>
+#include <pv/remote.h>
+#include <pv/logger.h>
+#include <pv/inetAddressUtil.h>
+
+namespace pvd = epics::pvData;
+
+typedef epicsGuard<epicsMutex> Guard;
+
+namespace {
+
+// serialize into a fixed size buffer, failing when full
+struct DatagramWriter : public pvd::SerializableControl
+{
+    pvd::ByteBuffer& buf;
+    explicit DatagramWriter(pvd::ByteBuffer& buf) :buf(buf) {}
+    virtual ~DatagramWriter() {}
+
+    virtual void flushSerializeBuffer() OVERRIDE FINAL
+    {
+        throw std::length_error("Datagram full");
+    }
+    virtual void ensureBuffer(std::size_t size) OVERRIDE FINAL
+    {
+        if(buf.getRemaining()<size)
+            throw std::length_error("Datagram full");
+    }
+    virtual void alignBuffer(std::size_t) OVERRIDE FINAL {}
+    virtual bool directSerialize(pvd::ByteBuffer *, const char*, std::size_t, std::size_t) OVERRIDE FINAL { return false; }
+    virtual void cachedSerialize(std::tr1::shared_ptr<const pvd::Field> const & field, pvd::ByteBuffer* buffer) OVERRIDE FINAL
+    {
+        field->serialize(buffer, this);
+    }
+};
+
+// larger datagrams are fragmented by IP.  Loss of any fragment is a gap.
+const size_t maxPayload = MAX_UDP_RECV - PVA_MESSAGE_HEADER_SIZE;
+
+} // namespace
+
+namespace epics {
+namespace pvAccess {
+
+class MulticastSubscriptionImpl;
+
+class MulticastStream :
+    public ChannelRequester,
+    public MonitorRequester,
+    public TransportSender,
+    public std::tr1::enable_shared_from_this<MulticastStream>
+{
+public:
+    POINTER_DEFINITIONS(MulticastStream);
+
+    const std::string name;
+    const pvd::uint32 id;
+    const ServerGUID guid;
+    const osiSockAddr group;
+    const BlockingUDPTransport::shared_pointer transport;
+
+    mutable epicsMutex mutex;
+
+    Channel::shared_pointer channel;
+    Monitor::shared_pointer monitor;
+    bool monitoring; // createMonitor() called
+    bool connected; // monitorConnect() called
+    bool closed;
+    pvd::Status status;
+    pvd::StructureConstPtr type;
+
+    // value as of sequence # 'seq'
+    pvd::PVStructurePtr current;
+    pvd::BitSet valid;
+    pvd::uint32 seq;
+
+    // datagram being sent
+    std::vector<char> payload;
+    size_t payloadLen;
+
+    size_t nsent, ntoobig, ndropped, nsync;
+    size_t ndrop; // # of updates still to drop()
+
+    typedef std::vector<std::tr1::weak_ptr<MulticastSubscriptionImpl> > subscribers_t;
+    subscribers_t subscribers;
+
+    MulticastStream(const std::string& name, pvd::uint32 id, const ServerGUID& guid,
+                    const osiSockAddr& group, const BlockingUDPTransport::shared_pointer& transport)
+        :name(name)
+        ,id(id)
+        ,guid(guid)
+        ,group(group)
+        ,transport(transport)
+        ,monitoring(false)
+        ,connected(false)
+        ,closed(false)
+        ,seq(0u)
+        ,payload(maxPayload)
+        ,payloadLen(0u)
+        ,nsent(0u)
+        ,ntoobig(0u)
+        ,ndropped(0u)
+        ,nsync(0u)
+        ,ndrop(0u)
+    {}
+    virtual ~MulticastStream() {}
+
+    virtual std::string getRequesterName() OVERRIDE FINAL { return "MulticastStream"; }
+
+    void open(const ChannelProvider::shared_pointer& provider);
+    void close();
+    void add(const std::tr1::shared_ptr<MulticastSubscriptionImpl>& sub);
+    pvd::uint32 snapshot(pvd::PVStructure& value, pvd::BitSet& changed);
+
+    void startMonitor(const Channel::shared_pointer& chan);
+    void connect(const pvd::Status& sts, const pvd::StructureConstPtr& structure);
+    void publish(const MonitorElement& elem);
+
+    virtual void channelCreated(const pvd::Status& sts, Channel::shared_pointer const & chan) OVERRIDE FINAL;
+    virtual void channelStateChange(Channel::shared_pointer const & chan, Channel::ConnectionState state) OVERRIDE FINAL;
+
+    virtual void monitorConnect(pvd::Status const & sts,
+                                MonitorPtr const & mon,
+                                pvd::StructureConstPtr const & structure) OVERRIDE FINAL;
+    virtual void monitorEvent(MonitorPtr const & mon) OVERRIDE FINAL;
+    virtual void unlisten(MonitorPtr const & mon) OVERRIDE FINAL;
+
+    virtual void send(pvd::ByteBuffer* buffer, TransportSendControl* control) OVERRIDE FINAL;
+};
+
+// The client's own Monitor, through which the provider checks its access
+class MulticastGate : public MonitorRequester
+{
+public:
+    POINTER_DEFINITIONS(MulticastGate);
+
+    const std::tr1::weak_ptr<MulticastSubscriptionImpl> sub;
+
+    explicit MulticastGate(const std::tr1::shared_ptr<MulticastSubscriptionImpl>& sub) :sub(sub) {}
+    virtual ~MulticastGate() {}
+
+    virtual std::string getRequesterName() OVERRIDE FINAL { return "MulticastGate"; }
+
+    virtual void monitorConnect(pvd::Status const & sts,
+                                MonitorPtr const & mon,
+                                pvd::StructureConstPtr const & structure) OVERRIDE FINAL;
+    virtual void monitorEvent(MonitorPtr const & /*mon*/) OVERRIDE FINAL {}
+    virtual void unlisten(MonitorPtr const & /*mon*/) OVERRIDE FINAL {}
+};
+
+class MulticastSubscriptionImpl :
+    public MulticastSubscription,
+    public std::tr1::enable_shared_from_this<MulticastSubscriptionImpl>
+{
+public:
+    POINTER_DEFINITIONS(MulticastSubscriptionImpl);
+
+    const MulticastStream::shared_pointer stream;
+    const MonitorRequester::weak_pointer requester;
+
+    mutable epicsMutex mutex;
+    MonitorElementPtr element;
+    bool running;     // between start() and stop()
+    bool wanted;      // a complete value has been requested
+    bool outstanding; // element poll()'d, but not yet release()'d
+    pvd::uint32 seq;
+
+    // monitorConnect() of the stream, and of the gate
+    bool streamReady, gateReady, notified;
+    pvd::Status streamStatus, gateStatus;
+    pvd::StructureConstPtr streamType, gateType;
+    Monitor::shared_pointer gate;
+
+    MulticastSubscriptionImpl(const MulticastStream::shared_pointer& stream,
+                              const MonitorRequester::shared_pointer& requester)
+        :stream(stream)
+        ,requester(requester)
+        ,running(false)
+        ,wanted(false)
+        ,outstanding(false)
+        ,seq(0u)
+        ,streamReady(false)
+        ,gateReady(false)
+        ,notified(false)
+    {}
+    virtual ~MulticastSubscriptionImpl() {}
+
+    void authorize(const Channel::shared_pointer& channel, const pvd::PVStructure::shared_pointer& pvRequest)
+    {
+        MulticastGate::shared_pointer gateReq(new MulticastGate(shared_from_this()));
+        Monitor::shared_pointer mon;
+        try {
+            mon = channel->createMonitor(gateReq, pvRequest);
+        } catch(std::exception& e) {
+            gateConnected(pvd::Status::error(e.what()), pvd::StructureConstPtr());
+            return;
+        }
+        bool destroy;
+        {
+            Guard G(mutex);
+            destroy = gateReady;
+            if(!destroy)
+                gate = mon;
+        }
+        if(destroy && mon)
+            mon->destroy();
+    }
+
+    void gateConnected(const pvd::Status& sts, const pvd::StructureConstPtr& type)
+    {
+        Monitor::shared_pointer mon;
+        {
+            Guard G(mutex);
+            if(gateReady)
+                return;
+            gateReady = true;
+            gateStatus = sts;
+            gateType = type;
+            mon.swap(gate);
+        }
+        // not needed after connect, so never started
+        if(mon)
+            mon->destroy();
+        notify();
+    }
+
+    void connected(const pvd::Status& sts, const pvd::StructureConstPtr& type)
+    {
+        {
+            Guard G(mutex);
+            streamReady = true;
+            streamStatus = sts;
+            streamType = type;
+        }
+        notify();
+    }
+
+    // once both the stream and the gate are connected
+    void notify()
+    {
+        pvd::Status sts;
+        pvd::StructureConstPtr type;
+        {
+            Guard G(mutex);
+            if(!streamReady || !gateReady || notified)
+                return;
+            notified = true;
+
+            if(!gateStatus.isSuccess()) {
+                sts = gateStatus;
+            } else if(!streamStatus.isSuccess()) {
+                sts = streamStatus;
+            } else if(!gateType || !streamType || !(*gateType==*streamType)) {
+                sts = pvd::Status::error("Type differs from multicast stream.  Retry without multicast");
+            } else {
+                type = streamType;
+                element.reset(new MonitorElement(pvd::getPVDataCreate()->createPVStructure(type)));
+            }
+        }
+        MonitorRequester::shared_pointer req(requester.lock());
+        if(req)
+            req->monitorConnect(sts, shared_from_this(), type);
+    }
+
+    void closed()
+    {
+        MonitorRequester::shared_pointer req(requester.lock());
+        if(req)
+            req->unlisten(shared_from_this());
+    }
+
+    void event()
+    {
+        MonitorRequester::shared_pointer req(requester.lock());
+        if(req)
+            req->monitorEvent(shared_from_this());
+    }
+
+    virtual pvd::Status start() OVERRIDE FINAL
+    {
+        bool notify;
+        {
+            Guard G(mutex);
+            running = true;
+            notify = wanted && !outstanding;
+        }
+        if(notify)
+            event();
+        return pvd::Status::Ok;
+    }
+
+    virtual pvd::Status stop() OVERRIDE FINAL
+    {
+        Guard G(mutex);
+        running = false;
+        return pvd::Status::Ok;
+    }
+
+    virtual MonitorElementPtr poll() OVERRIDE FINAL
+    {
+        Guard G(mutex);
+        if(!running || !wanted || outstanding || !element)
+            return MonitorElementPtr();
+
+        seq = stream->snapshot(*element->pvStructurePtr, *element->changedBitSet);
+        element->overrunBitSet->clear();
+        wanted = false;
+        outstanding = true;
+        return element;
+    }
+
+    virtual void release(MonitorElementPtr const & elem) OVERRIDE FINAL
+    {
+        bool notify;
+        {
+            Guard G(mutex);
+            if(elem!=element)
+                return;
+            outstanding = false;
+            notify = running && wanted;
+        }
+        if(notify)
+            event();
+    }
+
+    virtual void reportRemoteQueueStatus(pvd::int32 freeElements) OVERRIDE FINAL
+    {
+        if(freeElements<=0)
+            return;
+        bool notify;
+        {
+            Guard G(mutex);
+            wanted = true;
+            notify = running && !outstanding;
+        }
+        if(notify)
+            event();
+    }
+
+    virtual void destroy() OVERRIDE FINAL
+    {
+        Monitor::shared_pointer mon;
+        {
+            Guard G(mutex);
+            running = false;
+            gateReady = true;
+            mon.swap(gate);
+        }
+        if(mon)
+            mon->destroy();
+    }
+
+    virtual pvd::uint32 streamID() const OVERRIDE FINAL { return stream->id; }
+
+    virtual pvd::uint32 sequence() const OVERRIDE FINAL
+    {
+        Guard G(mutex);
+        return seq;
+    }
+};
+
+void MulticastGate::monitorConnect(pvd::Status const & sts,
+                                   MonitorPtr const & /*mon*/,
+                                   pvd::StructureConstPtr const & structure)
+{
+    std::tr1::shared_ptr<MulticastSubscriptionImpl> S(sub.lock());
+    if(S)
+        S->gateConnected(sts, structure);
+}
+
+void MulticastStream::open(const ChannelProvider::shared_pointer& provider)
+{
+    try {
+        Channel::shared_pointer chan(provider->createChannel(name, shared_from_this()));
+        Guard G(mutex);
+        if(!channel)
+            channel = chan;
+    } catch(std::exception& e) {
+        connect(pvd::Status::error(e.what()), pvd::StructureConstPtr());
+    }
+}
+
+void MulticastStream::close()
+{
+    Channel::shared_pointer chan;
+    Monitor::shared_pointer mon;
+    {
+        Guard G(mutex);
+        closed = true;
+        chan.swap(channel);
+        mon.swap(monitor);
+    }
+    if(mon)
+        mon->destroy();
+    if(chan)
+        chan->destroy();
+}
+
+void MulticastStream::add(const std::tr1::shared_ptr<MulticastSubscriptionImpl>& sub)
+{
+    bool notify;
+    pvd::Status sts;
+    pvd::StructureConstPtr structure;
+    {
+        Guard G(mutex);
+        for(subscribers_t::iterator it(subscribers.begin()); it!=subscribers.end();) {
+            if(it->expired())
+                it = subscribers.erase(it);
+            else
+                ++it;
+        }
+        subscribers.push_back(sub);
+        notify = connected;
+        sts = status;
+        structure = type;
+    }
+    if(notify)
+        sub->connected(sts, structure);
+}
+
+pvd::uint32 MulticastStream::snapshot(pvd::PVStructure& value, pvd::BitSet& changed)
+{
+    Guard G(mutex);
+    if(current && value.getStructure()==current->getStructure()) {
+        value.copyUnchecked(*current, valid);
+        changed = valid;
+    } else {
+        changed.clear(); // type changed since subscribing
+    }
+    nsync++;
+    return seq;
+}
+
+void MulticastStream::startMonitor(const Channel::shared_pointer& chan)
+{
+    {
+        Guard G(mutex);
+        if(monitoring || closed)
+            return;
+        monitoring = true;
+    }
+    Monitor::shared_pointer mon(chan->createMonitor(shared_from_this(), pvd::createRequest("field()")));
+    Guard G(mutex);
+    if(!monitor)
+        monitor = mon;
+}
+
+void MulticastStream::connect(const pvd::Status& sts, const pvd::StructureConstPtr& structure)
+{
+    subscribers_t subs;
+    {
+        Guard G(mutex);
+        status = sts;
+        if(sts.isSuccess()) {
+            type = structure;
+            current = pvd::getPVDataCreate()->createPVStructure(type);
+            valid.clear();
+        }
+        connected = true;
+        subs = subscribers;
+    }
+    for(subscribers_t::iterator it(subs.begin()), end(subs.end()); it!=end; ++it) {
+        std::tr1::shared_ptr<MulticastSubscriptionImpl> sub(it->lock());
+        if(sub)
+            sub->connected(sts, structure);
+    }
+}
+
+void MulticastStream::publish(const MonitorElement& elem)
+{
+    Guard G(mutex);
+    if(closed || !current)
+        return;
+
+    seq++;
+    current->copyUnchecked(*elem.pvStructurePtr, *elem.changedBitSet);
+    valid |= *elem.changedBitSet;
+
+    if(ndrop) {
+        // as if lost.  clients see a gap
+        ndrop--;
+        ndropped++;
+        return;
+    }
+
+    pvd::ByteBuffer buf(&payload[0], payload.size());
+    buf.put(guid.value, 0, sizeof(guid.value));
+    buf.putInt(id);
+    buf.putInt(seq);
+    size_t flag = buf.getPosition();
+    buf.putByte(1);
+    try {
+        DatagramWriter W(buf);
+        elem.changedBitSet->serialize(&buf, &W);
+        elem.pvStructurePtr->serialize(&buf, &W, elem.changedBitSet.get());
+        elem.overrunBitSet->serialize(&buf, &W);
+    } catch(std::length_error&) {
+        // clients recover over TCP
+        buf.setPosition(flag);
+        buf.putByte(0);
+        ntoobig++;
+    }
+    payloadLen = buf.getPosition();
+    nsent++;
+
+    // UDP sends immediately, so datagrams leave in sequence while we hold the lock
+    transport->enqueueSendRequest(shared_from_this());
+}
+
+void MulticastStream::channelCreated(const pvd::Status& sts, Channel::shared_pointer const & chan)
+{
+    if(!sts.isSuccess()) {
+        connect(sts, pvd::StructureConstPtr());
+        return;
+    }
+    {
+        Guard G(mutex);
+        channel = chan;
+    }
+    if(chan->isConnected())
+        startMonitor(chan);
+}
+
+void MulticastStream::channelStateChange(Channel::shared_pointer const & chan, Channel::ConnectionState state)
+{
+    if(state==Channel::CONNECTED)
+        startMonitor(chan);
+}
+
+void MulticastStream::monitorConnect(pvd::Status const & sts,
+                                     MonitorPtr const & mon,
+                                     pvd::StructureConstPtr const & structure)
+{
+    if(sts.isSuccess()) {
+        {
+            Guard G(mutex);
+            monitor = mon;
+        }
+        connect(sts, structure);
+        mon->start();
+    } else {
+        connect(sts, structure);
+    }
+}
+
+void MulticastStream::monitorEvent(MonitorPtr const & mon)
+{
+    while(true) {
+        MonitorElement::Ref elem(mon);
+        if(!elem)
+            break;
+        publish(*elem);
+    }
+}
+
+void MulticastStream::unlisten(MonitorPtr const & /*mon*/)
+{
+    subscribers_t subs;
+    {
+        Guard G(mutex);
+        subs = subscribers;
+    }
+    for(subscribers_t::iterator it(subs.begin()), end(subs.end()); it!=end; ++it) {
+        std::tr1::shared_ptr<MulticastSubscriptionImpl> sub(it->lock());
+        if(sub)
+            sub->closed();
+    }
+}
+
+void MulticastStream::send(pvd::ByteBuffer* buffer, TransportSendControl* control)
+{
+    // called from publish() with mutex held
+    control->startMessage((pvd::int8)CMD_MULTICAST_DATA, payloadLen);
+    control->setRecipient(group);
+    buffer->put(&payload[0], 0, payloadLen);
+}
+
+MulticastPublisher::MulticastPublisher(const ServerGUID& guid,
+                                       const osiSockAddr& group,
+                                       const osiSockAddr& nif,
+                                       const ResponseHandler::shared_pointer& handler,
+                                       const std::string& names)
+    :_guid(guid)
+    ,_group(group)
+    ,_nextID(0u)
+{
+    std::istringstream strm(names);
+    std::string name;
+    while(strm>>name)
+        _names.insert(name);
+
+    osiSockAddr any;
+    memset(&any, 0, sizeof(any));
+    any.ia.sin_family = AF_INET;
+    any.ia.sin_addr.s_addr = htonl(INADDR_ANY);
+    any.ia.sin_port = 0;
+
+    // send only, so not start()'d
+    BlockingUDPConnector connector(true);
+    _transport = connector.connect(handler, any, PVA_SERVER_PROTOCOL_REVISION);
+    if(!_transport)
+        throw std::runtime_error("Failed to create multicast UDP socket");
+
+    // also to subscribers on this host
+    _transport->setMutlicastNIF(nif, true);
+
+    LOG(logLevelDebug, "Publishing %zu PVs to multicast group %s",
+        _names.size(), inetAddressToString(_group).c_str());
+}
+
+MulticastPublisher::~MulticastPublisher()
+{
+    close();
+}
+
+bool MulticastPublisher::designated(const std::string& name) const
+{
+    return _names.find(name)!=_names.end();
+}
+
+bool MulticastPublisher::compatible(const pvd::PVStructure& pvRequest)
+{
+    pvd::PVStructure::const_shared_pointer fields(pvRequest.getSubField<pvd::PVStructure>("field"));
+    if(fields && !fields->getPVFields().empty())
+        return false;
+
+    pvd::PVStructure::const_shared_pointer options(pvRequest.getSubField<pvd::PVStructure>("record._options"));
+    if(options) {
+        const pvd::PVFieldPtrArray& opts(options->getPVFields());
+        for(size_t i=0; i<opts.size(); i++) {
+            const std::string& name(opts[i]->getFieldName());
+            if(name!="multicast" && name!="pipeline" && name!="queueSize"
+                    && name!="ackAny" && name!="adaptive")
+                return false;
+        }
+    }
+    return true;
+}
+
+MulticastSubscription::shared_pointer
+MulticastPublisher::subscribe(const Channel::shared_pointer& channel,
+                              const pvd::PVStructure::shared_pointer& pvRequest,
+                              const MonitorRequester::shared_pointer& requester)
+{
+    const std::string& name(channel->getChannelName());
+    MulticastStream::shared_pointer stream;
+    bool created = false;
+    {
+        Guard G(_mutex);
+        if(!_transport)
+            throw std::logic_error("MulticastPublisher closed");
+
+        streams_t::iterator it(_streams.find(name));
+        if(it==_streams.end()) {
+            stream.reset(new MulticastStream(name, _nextID++, _guid, _group, _transport));
+            _streams[name] = stream;
+            created = true;
+        } else {
+            stream = it->second;
+        }
+    }
+
+    // the first subscriber's channel is only used to find the provider
+    if(created)
+        stream->open(channel->getProvider());
+
+    std::tr1::shared_ptr<MulticastSubscriptionImpl> sub(new MulticastSubscriptionImpl(stream, requester));
+    sub->authorize(channel, pvRequest);
+    stream->add(sub);
+    return sub;
+}
+
+void MulticastPublisher::close()
+{
+    streams_t streams;
+    BlockingUDPTransport::shared_pointer transport;
+    {
+        Guard G(_mutex);
+        streams.swap(_streams);
+        transport.swap(_transport);
+    }
+    for(streams_t::iterator it(streams.begin()), end(streams.end()); it!=end; ++it) {
+        it->second->close();
+    }
+    if(transport)
+        transport->close();
+}
+
+void MulticastPublisher::printInfo(std::ostream& strm) const
+{
+    Guard G(_mutex);
+    strm<<"MCAST_ADDR = "<<inetAddressToString(_group)<<"\n";
+    for(streams_t::const_iterator it(_streams.begin()), end(_streams.end()); it!=end; ++it) {
+        const MulticastStream& S(*it->second);
+        Guard G2(S.mutex);
+        strm<<"MCAST_STREAM "<<S.id<<" "<<S.name
+            <<" seq="<<S.seq<<" sent="<<S.nsent<<" toobig="<<S.ntoobig
+            <<" dropped="<<S.ndropped<<" sync="<<S.nsync<<"\n";
+    }
+}
+
+bool MulticastPublisher::stats(const std::string& name, Stats& s) const
+{
+    MulticastStream::shared_pointer stream;
+    {
+        Guard G(_mutex);
+        streams_t::const_iterator it(_streams.find(name));
+        if(it==_streams.end())
+            return false;
+        stream = it->second;
+    }
+    Guard G(stream->mutex);
+    s.seq = stream->seq;
+    s.nsent = stream->nsent;
+    s.ntoobig = stream->ntoobig;
+    s.ndropped = stream->ndropped;
+    s.nsync = stream->nsync;
+    return true;
+}
+
+void MulticastPublisher::drop(const std::string& name, size_t count)
+{
+    MulticastStream::shared_pointer stream;
+    {
+        Guard G(_mutex);
+        streams_t::const_iterator it(_streams.find(name));
+        if(it==_streams.end())
+            return;
+        stream = it->second;
+    }
+    Guard G(stream->mutex);
+    stream->ndrop += count;
+}
+
+}} // namespace epics::pvAccess
@@ -7,6 +7,8 @@
 #ifndef BASECHANNELREQUESTER_H_
 #define BASECHANNELREQUESTER_H_
 
+#include <deque>
+
 #include <pv/requester.h>
 #include <pv/destroyable.h>
 #include <pv/serverContextImpl.h>
@@ -33,6 +35,37 @@ public:
     bool startRequest(epics::pvData::int32 qos);
     void stopRequest();
     epics::pvData::int32 getPendingRequest();
+
+    //! Result of queueRequest()
+    enum queue_t {
+        Started, //!< No other request in progress.  Caller should process it now.
+        Queued,  //!< Will be started by nextRequest() after the preceding request(s) complete
+        Rejected //!< Pipeline window full
+    };
+    /** Start a request, or queue it behind the one(s) in progress if the pipeline window allows.
+     *
+     * Requests are always started in the order received.
+     * With the default window of 1, this is equivalent to startRequest().
+     * @param value Optional data which goes with this request (eg. put value)
+     * @param changed Optional data which goes with this request
+     */
+    queue_t queueRequest(epics::pvData::int32 qos,
+                         epics::pvData::PVStructure::shared_pointer const & value = epics::pvData::PVStructure::shared_pointer(),
+                         epics::pvData::BitSet::shared_pointer const & changed = epics::pvData::BitSet::shared_pointer());
+    /** Complete the request in progress (as stopRequest()) and start the oldest queued request, if any.
+     * @returns true if a queued request was started, with qos, value, and changed as passed to queueRequest().
+     */
+    bool nextRequest(epics::pvData::int32& qos,
+                     epics::pvData::PVStructure::shared_pointer& value,
+                     epics::pvData::BitSet::shared_pointer& changed);
+    //! Number of requests which may be in progress or queued.  Always >=1
+    size_t getWindow();
+    void setWindow(size_t window);
+    //! Parse the requested pipeline window from pvRequest record._options.window .  Defaults to 1.
+    static size_t requestedWindow(epics::pvData::PVStructure::shared_pointer const & pvRequest);
+    //! Upper limit on pipeline window.
+    static const size_t maxWindow;
+
     //! The Operation associated with this Requester, except for GetField and Monitor (which are special snowflakes...)
     virtual std::tr1::shared_ptr<ChannelRequest> getOperation() =0;
     virtual std::string getRequesterName() OVERRIDE FINAL;
@@ -50,6 +83,8 @@ public:
     static const epics::pvData::Status noProcessACLStatus;
     static const epics::pvData::Status otherRequestPendingStatus;
     static const epics::pvData::Status notAChannelRequestStatus;
+    //! getPendingRequest() when idle
+    static const epics::pvData::int32 NULL_REQUEST;
 protected:
     const pvAccessID _ioid;
     const Transport::shared_pointer _transport;
@@ -57,8 +92,15 @@ protected:
     epics::pvData::Mutex _mutex;
 private:
     ServerContextImpl::shared_pointer _context;
-    static const epics::pvData::int32 NULL_REQUEST;
     epics::pvData::int32 _pendingRequest;
+
+    struct QueuedRequest {
+        epics::pvData::int32 qos;
+        epics::pvData::PVStructure::shared_pointer value;
+        epics::pvData::BitSet::shared_pointer changed;
+    };
+    std::deque<QueuedRequest> _queued;
+    size_t _window;
 };
 
 class BaseChannelRequesterMessageTransportSender : public TransportSender
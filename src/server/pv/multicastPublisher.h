@@ -0,0 +1,142 @@
+/**
+ * Copyright - See the COPYRIGHT that is included with this distribution.
+ * pvAccessCPP is distributed subject to a Software License Agreement found
+ * in file LICENSE that is included with this distribution.
+ */
+
+#ifndef MULTICASTPUBLISHER_H
+#define MULTICASTPUBLISHER_H
+
+#include <map>
+#include <set>
+#include <string>
+
+#ifdef epicsExportSharedSymbols
+#   define multicastPublisherEpicsExportSharedSymbols
+#   undef epicsExportSharedSymbols
+#endif
+
+#include <osiSock.h>
+#include <epicsMutex.h>
+
+#include <pv/sharedPtr.h>
+#include <pv/pvData.h>
+
+#ifdef multicastPublisherEpicsExportSharedSymbols
+#   define epicsExportSharedSymbols
+#       undef multicastPublisherEpicsExportSharedSymbols
+#endif
+
+#include <pv/pvaDefs.h>
+#include <pv/pvAccess.h>
+#include <pv/blockingUDP.h>
+
+namespace epics {
+namespace pvAccess {
+
+class MulticastStream;
+
+/** One client's view of a multicast stream.
+ *
+ * Takes the place of a Monitor of the PV.  Updates are not poll()'d here,
+ * but sent once to the group for all subscribers.  poll() instead yields the
+ * complete current value once for each reportRemoteQueueStatus(),
+ * which the client uses to recover from gaps in the sequence.
+ */
+class MulticastSubscription : public Monitor
+{
+public:
+    POINTER_DEFINITIONS(MulticastSubscription);
+    virtual ~MulticastSubscription() {}
+
+    //! Identifies this PV in datagrams
+    virtual epics::pvData::uint32 streamID() const =0;
+    //! Sequence # of the value last returned by poll()
+    virtual epics::pvData::uint32 sequence() const =0;
+};
+
+/** Publishes monitor updates of designated PVs to a multicast group.
+ *
+ * Configured with $EPICS_PVAS_MCAST_ADDR (group and port) and $EPICS_PVAS_MCAST_PV_LIST.
+ * A single Monitor of each designated PV is created when the first client subscribes
+ * with pvRequest option record._options.multicast=true, and kept until close().
+ * Each update is sent once as a CMD_MULTICAST_DATA datagram with payload
+ *
+ *   ServerGUID, u32 stream ID, u32 sequence #,
+ *   u8 1, changed BitSet, data, overrun BitSet
+ *   or u8 0 if the update is too large for one datagram.
+ */
+class epicsShareClass MulticastPublisher
+{
+public:
+    POINTER_DEFINITIONS(MulticastPublisher);
+
+    //! Counters of one published PV
+    struct Stats {
+        epics::pvData::uint32 seq; //!< sequence # of the latest update
+        size_t nsent;    //!< datagrams sent
+        size_t ntoobig;  //!< of which were too large to carry the update
+        size_t ndropped; //!< updates not sent.  see drop()
+        size_t nsync;    //!< complete values sent over TCP, to new subscribers or on resync
+        Stats() :seq(0u), nsent(0u), ntoobig(0u), ndropped(0u), nsync(0u) {}
+    };
+
+    MulticastPublisher(const ServerGUID& guid,
+                       const osiSockAddr& group,
+                       const osiSockAddr& nif,
+                       const ResponseHandler::shared_pointer& handler,
+                       const std::string& names);
+    ~MulticastPublisher();
+
+    //! Is this PV published?
+    bool designated(const std::string& name) const;
+
+    /** Can this request be served from a stream?
+     *  Streams publish all fields, so only requests without field selection,
+     *  and without options other than those of flow control, may be.
+     */
+    static bool compatible(const epics::pvData::PVStructure& pvRequest);
+
+    /** Begin receiving the stream of this PV.
+     *  The client's own Monitor is created through its 'channel', with its 'pvRequest',
+     *  so that the provider applies its access control.  This Monitor is never started,
+     *  and is destroyed once connected.
+     *  requester->monitorConnect() is called once both are connected, possibly before this returns.
+     *  It fails if the provider gives this client a different type than the stream.
+     */
+    MulticastSubscription::shared_pointer subscribe(const Channel::shared_pointer& channel,
+                                                    const epics::pvData::PVStructure::shared_pointer& pvRequest,
+                                                    const MonitorRequester::shared_pointer& requester);
+
+    //! Stop publishing, and destroy all Monitors.
+    void close();
+
+    //! @returns false if this PV has no stream (yet)
+    bool stats(const std::string& name, Stats& s) const;
+
+    //! For testing.  The next 'count' updates of this PV are not sent, as if lost.
+    void drop(const std::string& name, size_t count);
+
+    const osiSockAddr& group() const { return _group; }
+    const ServerGUID& guid() const { return _guid; }
+
+    void printInfo(std::ostream& strm) const;
+
+private:
+    const ServerGUID _guid;
+    const osiSockAddr _group;
+    std::set<std::string> _names;
+
+    BlockingUDPTransport::shared_pointer _transport;
+
+    mutable epicsMutex _mutex;
+    typedef std::map<std::string, std::tr1::shared_ptr<MulticastStream> > streams_t;
+    streams_t _streams;
+    epics::pvData::uint32 _nextID;
+
+    EPICS_NOT_COPYABLE(MulticastPublisher)
+};
+
+}} // namespace epics::pvAccess
+
+#endif // MULTICASTPUBLISHER_H
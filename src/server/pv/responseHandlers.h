@@ -16,6 +16,7 @@
 #include <pv/serverChannelImpl.h>
 #include <pv/baseChannelRequester.h>
 #include <pv/securityImpl.h>
+#include <pv/scratchPool.h>
 
 namespace epics {
 namespace pvAccess {
@@ -371,8 +372,11 @@ public:
 
     epics::pvData::BitSet::shared_pointer getPutBitSet();
     epics::pvData::PVStructure::shared_pointer getPutPVStructure();
+    //! Copies of queued pipelined put values
+    ScratchPool& getScratchPool() { return _scratch; }
     void send(epics::pvData::ByteBuffer* buffer, TransportSendControl* control) OVERRIDE FINAL;
 private:
+    ScratchPool _scratch;
     // Note: this forms a reference loop, which is broken in destroy()
     ChannelPut::shared_pointer _channelPut;
     epics::pvData::BitSet::shared_pointer _bitSet;
@@ -511,6 +515,8 @@ private:
     window_t _window_closed;
     bool _unlisten;
     bool _pipeline; // const after activate()
+    // when updates are sent to a multicast group.  Same as _channelMonitor
+    std::tr1::shared_ptr<MulticastSubscription> _multicast;
 };
 
 
@@ -7,6 +7,8 @@
 #ifndef SERVERCHANNEL_H_
 #define SERVERCHANNEL_H_
 
+#include <vector>
+
 #include <pv/destroyable.h>
 #include <pv/remote.h>
 #include <pv/security.h>
@@ -54,6 +56,17 @@ public:
 
     void destroy();
 
+    typedef std::vector<std::tr1::shared_ptr<BaseChannelRequester> > requests_t;
+
+    /** First half of destroy().  Destroy the local Channel and move all requests to 'reqs'.
+     *  Lets a caller tearing down many channels collect every request, then
+     *  destroy them together with destroyRequests().
+     */
+    void detach(requests_t& reqs);
+
+    //! Second half of destroy().
+    static void destroyRequests(const requests_t& reqs);
+
     void printInfo() const;
 
     void printInfo(FILE *fd) const;
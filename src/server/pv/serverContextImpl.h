@@ -16,13 +16,14 @@
 #include <pv/blockingUDP.h>
 #include <pv/blockingTCP.h>
 #include <pv/beaconEmitter.h>
+#include <pv/multicastPublisher.h>
 
 #include "serverContext.h"
 
 namespace epics {
 namespace pvAccess {
 
-class ServerContextImpl :
+class epicsShareClass ServerContextImpl :
     public ServerContext,
     public Context,
     public std::tr1::enable_shared_from_this<ServerContextImpl>
@@ -106,6 +107,9 @@ public:
      */
     const BlockingUDPTransport::shared_pointer& getBroadcastTransport();
 
+    //! NULL unless $EPICS_PVAS_MCAST_ADDR is set
+    MulticastPublisher::shared_pointer getMulticastPublisher();
+
     /**
      * Get channel providers.
      * @return channel providers.
@@ -121,6 +125,14 @@ public:
     // used by ServerChannelFindRequesterImpl
     typedef std::map<std::string, std::tr1::weak_ptr<ChannelProvider> > s_channelNameToProvider_t;
     s_channelNameToProvider_t s_channelNameToProvider;
+
+    /**
+     * Find a provider of a running ServerContext in this process which immediately
+     * claims this channel name.  Used by the "pva" client with $EPICS_PVA_CLIENT_LOCAL
+     * to bypass the network for local PVs.
+     * @return NULL if not found.
+     */
+    static ChannelProvider::shared_pointer findLocalProvider(const std::string& channelName);
 private:
 
     /**
@@ -186,6 +198,17 @@ private:
 
     BeaconEmitter::shared_pointer _beaconEmitter;
 
+    // $EPICS_PVAS_MCAST_ADDR, port 0 when not set
+    osiSockAddr _mcastGroup;
+
+    // $EPICS_PVAS_MCAST_INTF
+    osiSockAddr _mcastNIF;
+
+    // $EPICS_PVAS_MCAST_PV_LIST
+    std::string _mcastNames;
+
+    MulticastPublisher::shared_pointer _multicastPublisher;
+
     /**
      * PVAS acceptor (accepts PVA virtual circuit).
      */
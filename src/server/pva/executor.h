@@ -0,0 +1,82 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+#ifndef PV_EXECUTOR_H
+#define PV_EXECUTOR_H
+
+#include <shareLib.h>
+#include <pv/sharedPtr.h>
+#include <pv/noDefaultMethods.h>
+
+namespace epics{namespace pvAccess{
+void providerRegInit(void*);
+}} // epics::pvAccess
+
+namespace pvas {
+
+namespace detail {
+struct ExecutorImpl;
+struct Strand;
+}
+
+/** @addtogroup pvas
+ * @{
+ */
+
+/** A pool of worker threads on which SharedPV::Handler callbacks are run,
+ * instead of on the thread which delivered the request.
+ * eg. a server TCP receive thread, which a Handler doing slow device I/O would
+ * otherwise block for all channels of that client.
+ *
+ * One Executor may be shared by any number of SharedPV.  See SharedPV::Config::executor .
+ *
+ * Callbacks for one SharedPV are run one at a time, in the order in which they were requested.
+ * Callbacks for different SharedPVs may run concurrently, on different workers.
+ *
+ @code
+   pvas::Executor::shared_pointer exec(new pvas::Executor);
+   pvas::SharedPV::Config conf;
+   conf.executor = exec;
+   pvas::SharedPV::shared_pointer pv(pvas::SharedPV::build(handler, &conf));
+ @endcode
+ */
+class epicsShareClass Executor
+{
+    friend struct detail::Strand;
+public:
+    POINTER_DEFINITIONS(Executor);
+
+    struct epicsShareClass Config {
+        unsigned workers; //!< default 4.  Number of worker threads.
+        unsigned priority; //!< default epicsThreadPriorityMedium
+        Config();
+    };
+
+    explicit Executor(const Config& conf = Config());
+    //! Calls close()
+    ~Executor();
+
+    /** Stop the worker threads, after they have run all callbacks already queued.
+     * Callbacks requested afterwards are run by the requesting thread.
+     * Waits for workers to exit, except when called from a callback run by this Executor.
+     */
+    void close();
+
+    //! # of callbacks waiting, for all SharedPVs
+    size_t pending() const;
+
+private:
+    friend void epics::pvAccess::providerRegInit(void*);
+    static size_t num_instances;
+
+    const std::tr1::shared_ptr<detail::ExecutorImpl> impl;
+
+    EPICS_NOT_COPYABLE(Executor)
+};
+
+//! @}
+
+} // namespace pvas
+
+#endif // PV_EXECUTOR_H
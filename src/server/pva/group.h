@@ -0,0 +1,155 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+#ifndef PV_GROUP_H
+#define PV_GROUP_H
+
+#include <string>
+#include <vector>
+
+#include <epicsMutex.h>
+
+#include <shareLib.h>
+#include <pv/sharedPtr.h>
+#include <pv/noDefaultMethods.h>
+#include <pv/bitSet.h>
+
+#include <pva/sharedstate.h>
+
+namespace epics{namespace pvData{
+class Structure;
+class PVStructure;
+}} // epics::pvData
+
+namespace pvas {
+
+/** @addtogroup pvas
+ * @{
+ */
+
+/** Compose several SharedPV into one structure, served through a SharedPV of its own.
+ *
+ * Each member becomes a sub-structure of the group PV.  A post() to a member
+ * is forwarded to subscribers of the group as an update of that sub-structure.
+ * Within a Transaction, posts to any member, or to the group itself, are combined
+ * and delivered as one update when the last Transaction ends.
+ * So subscribers see a coherent snapshot, with one message in place of many.
+ *
+ @code
+   pvas::SharedPVGroup::shared_pointer grp(pvas::SharedPVGroup::build());
+   grp->add("a", pvA); // pvA and pvB already open()'d
+   grp->add("b", pvB);
+   grp->open();
+   provider.add("my:group", grp->pv());
+   {
+       pvas::SharedPVGroup::Transaction T(grp);
+       pvA->post(valA, changedA);
+       pvB->post(valB, changedB);
+   } // subscribers of "my:group" see one update of both
+ @endcode
+ *
+ * The group PV is read-only.  Posts to the group are not passed back to its members.
+ * A Transaction covers posts from all threads while it exists, not only those of its creator.
+ *
+ * @warning For the purposes of locking, this class is an Operation, the same as SharedPV.
+ *          No locks may be held when calling open(), close(), post(), or ending a Transaction.
+ */
+class epicsShareClass SharedPVGroup
+{
+    friend class SharedPV;
+public:
+    POINTER_DEFINITIONS(SharedPVGroup);
+
+    /** Combines all posts made while any instance exists, and delivers them when the last is destroyed.
+     * Transactions may nest.
+     */
+    class epicsShareClass Transaction
+    {
+        const SharedPVGroup::shared_pointer group;
+    public:
+        explicit Transaction(const SharedPVGroup::shared_pointer& group);
+        //! May post() to the group PV
+        ~Transaction();
+        EPICS_NOT_COPYABLE(Transaction)
+    };
+
+    //! @param conf Optional.  Configuration of the group PV.
+    static shared_pointer build(SharedPV::Config* conf=0);
+    ~SharedPVGroup();
+
+    //! The group PV, to be added to a StaticProvider or similar.
+    const SharedPV::shared_pointer& pv() const { return group; }
+
+    /** Include a member PV as the sub-structure 'field'.
+     * @throws std::logic_error if the group is open, or 'field' is already used.
+     */
+    void add(const std::string& field, const SharedPV::shared_pointer& member);
+
+    /** Compose the group type and initial value from the current types and values of all members,
+     *  and open() the group PV.
+     * @pre All members are open.
+     * @throws std::logic_error if a member is not open, or the group is already open.
+     */
+    void open();
+
+    //! close() the group PV.  Members are unaffected.  May be open()'d again, eg. after a member changes type.
+    void close(bool destroy=false);
+
+    bool isOpen() const;
+
+    /** Update the group PV directly.  Combined with member posts, as for a member post().
+     * @param value of the type of pv()->build()
+     */
+    void post(const epics::pvData::PVStructure& value,
+              const epics::pvData::BitSet& changed);
+
+private:
+    explicit SharedPVGroup(SharedPV::Config* conf);
+
+    // called by SharedPV::post() without locks held
+    void memberPosted(size_t index,
+                      const epics::pvData::PVStructure& value,
+                      const epics::pvData::BitSet& changed);
+    void begin();
+    void commit();
+    void flush(epicsGuard<epicsMutex>& G);
+
+    weak_pointer internal_self; // const after build()
+
+    const SharedPV::shared_pointer group;
+
+    mutable epicsMutex mutex;
+
+    struct Member {
+        std::string field;
+        SharedPV::shared_pointer pv;
+        // as of open()
+        std::tr1::shared_ptr<const epics::pvData::Structure> type;
+        // sub-structure of 'pending'
+        std::tr1::shared_ptr<epics::pvData::PVStructure> pending;
+        size_t offset;
+    };
+    typedef std::vector<Member> members_t;
+    members_t members;
+
+    //! Accumulates posts until flush().  NULL while closed.
+    std::tr1::shared_ptr<epics::pvData::PVStructure> pending;
+    epics::pvData::BitSet pendingChanged;
+    //! Copy of 'pending' being post()'d.  Only used while 'flushing'.
+    std::tr1::shared_ptr<epics::pvData::PVStructure> out;
+    epics::pvData::BitSet outChanged;
+
+    //! # of Transaction in existence
+    size_t transactions;
+    //! Some thread is in flush()
+    bool flushing;
+
+    EPICS_NOT_COPYABLE(SharedPVGroup)
+};
+
+} // namespace pvas
+
+//! @}
+
+#endif // PV_GROUP_H
@@ -7,6 +7,7 @@
 
 #include <string>
 #include <list>
+#include <map>
 
 #include <shareLib.h>
 #include <pv/sharedPtr.h>
@@ -15,6 +16,7 @@
 #include <pv/createRequest.h>
 
 #include <pva/server.h>
+#include <pva/executor.h>
 
 namespace epics{namespace pvData{
 class Structure;
@@ -38,9 +40,15 @@ struct SharedChannel;
 struct SharedMonitorFIFO;
 struct SharedPut;
 struct SharedRPC;
+struct SharedArray;
+struct Strand;
+struct ImageTransform;
+struct UpdateHistory;
 }
 
 struct Operation;
+class SharedPVSnapshot;
+class SharedPVGroup;
 
 /** @addtogroup pvas
  * @{
@@ -67,6 +75,24 @@ struct Operation;
  * Client channels, and operations on them, may be initiated at any time (via connect()).
  * However, operations other than RPC will not proceed until open() is called.
  *
+ * For an NTNDArray, a subscriber may ask for a smaller image with pvRequest options.
+ * eg. "record[roi=X:Y:W:H,bin=BX:BY,decimate=N]field()" .
+ * The region of interest is cropped, every N'th pixel is taken, then each BX by BY block
+ * is averaged.  Each distinct combination is computed once per post(), and shared
+ * by all subscribers using it.  Compressed images, and other types, are passed through unchanged.
+ *
+ * When built with Config::historySize>0, the most recent post() updates are retained.
+ * A new subscriber may ask for some of these with "record[history=N]field()".
+ * The last N updates are then delivered in order, the first including all fields valid at that time,
+ * instead of only the current value.  eg. to recover updates missed while reconnecting.
+ * History is not replayed to subscribers also requesting an image transform.
+ *
+ * When the 'value' field is a scalar array, a read-only epics::pvAccess::ChannelArray
+ * fetches ranges of it.  eg. with pvac::ClientChannel::getArray() .
+ *
+ * Handler callbacks are made from the thread delivering the request,
+ * unless a pvas::Executor is given with Config::executor .
+ *
  * @note A SharedPV does not have a name.  Name(s) are associated with a SharedPV
  *       By a Provider (StaticProvider, DynamicProvider, or any epics::pvAccess::ChannelProvider).
  *       These channel names may be seen via connect()
@@ -80,11 +106,20 @@ class epicsShareClass SharedPV
     friend struct detail::SharedMonitorFIFO;
     friend struct detail::SharedPut;
     friend struct detail::SharedRPC;
+    friend struct detail::SharedArray;
+    friend struct detail::Strand;
+    friend class SharedPVSnapshot;
+    friend class SharedPVGroup;
 public:
     POINTER_DEFINITIONS(SharedPV);
     struct epicsShareClass Config {
         bool dropEmptyUpdates; //!< default true.  Drop updates which don't include an field values.
         epics::pvData::PVRequestMapper::mode_t mapperMode; //!< default Mask.  @see epics::pvData::PVRequestMapper::mode_t
+        size_t historySize; //!< default 0.  Number of post() updates retained for replay to new subscribers.
+        //! default NULL.  If set, Handler callbacks are run by this Executor, one at a time.
+        std::tr1::shared_ptr<Executor> executor;
+        //! default 64.  With executor, a Put or RPC fails if this many callbacks are already waiting.  0 for no limit.
+        size_t queueLimit;
         Config();
     };
 
@@ -213,6 +248,23 @@ private:
     //! Used for initial Monitor update and Get operations.
     epics::pvData::BitSet valid;
 
+    //! incremented by open() and post().  Each ImageTransform is computed once per generation.
+    size_t generation;
+
+    //! ImageTransform in use, by ImageTransform::key()
+    typedef std::map<std::string, std::tr1::weak_ptr<detail::ImageTransform> > transforms_t;
+    transforms_t transforms;
+
+    //! NULL unless Config::historySize>0
+    std::tr1::shared_ptr<detail::UpdateHistory> history;
+
+    //! NULL unless Config::executor
+    std::tr1::shared_ptr<detail::Strand> strand;
+
+    //! SharedPVGroup(s) which include this PV, with the index of this member in each
+    typedef std::list<std::pair<std::tr1::weak_ptr<SharedPVGroup>, size_t> > groups_t;
+    groups_t groups;
+
     // whether onFirstConnect() has been, or is being, called.
     // Set when the first getField, Put, or Monitor (but not RPC) is created.
     // Cleared when the last Channel is destroyed.
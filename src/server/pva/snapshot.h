@@ -0,0 +1,127 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+#ifndef PV_SNAPSHOT_H
+#define PV_SNAPSHOT_H
+
+#include <string>
+#include <map>
+
+#include <epicsMutex.h>
+
+#include <shareLib.h>
+#include <pv/sharedPtr.h>
+#include <pv/noDefaultMethods.h>
+#include <pv/bitSet.h>
+#include <pv/timer.h>
+
+#include <pva/sharedstate.h>
+
+namespace epics{namespace pvData{
+class PVStructure;
+}} // epics::pvData
+
+namespace pvas {
+
+/** @addtogroup pvas
+ * @{
+ */
+
+/** Save, and restore, the type and value of a set of SharedPV to a file.
+ *
+ * Allows an IOC to restart with valid values before its driver(s) have reconnected,
+ * so that clients reconnect to meaningful data immediately.
+ *
+ * Typical usage is to load() and add() each PV before the ServerContext is created,
+ * so that no search is answered before values are restored.
+ *
+ @code
+   pvas::SharedPVSnapshot snap("/var/lib/myioc/pvs.snap");
+   snap.load();
+   pvas::SharedPV::shared_pointer pv(pvas::SharedPV::buildReadOnly());
+   snap.add("my:pv", pv); // may open()
+   if(!pv->isOpen())
+       pv->open(type);
+   snap.start(10.0); // save every 10 seconds
+ @endcode
+ *
+ * Files are written completely, then renamed into place.  So a reader never sees a partial file.
+ * Where available, load() maps the file into memory instead of reading it.
+ * The file format is only intended to be read back by the same version of this library.
+ */
+class epicsShareClass SharedPVSnapshot
+{
+public:
+    POINTER_DEFINITIONS(SharedPVSnapshot);
+
+    explicit SharedPVSnapshot(const std::string& fname);
+    ~SharedPVSnapshot();
+
+    /** Read the snapshot file.  Replaces the result of any previous load().
+     *
+     * A missing file is not an error.  A truncated or corrupt file is ignored with a warning.
+     * @returns The number of PVs read.
+     */
+    size_t load();
+
+    /** Include a PV in future snapshots.
+     *
+     * If the PV is closed, and load() found an entry of this name, then the PV is open()'d
+     * with the saved value.
+     * @returns true if the PV was open()'d
+     */
+    bool add(const std::string& name, const SharedPV::shared_pointer& pv);
+
+    //! Exclude a PV from future snapshots.
+    void remove(const std::string& name);
+
+    /** Write all added PVs which are open() to the file.
+     *
+     * Does nothing if no PV has been updated since the previous save(),
+     * unless force=true.
+     */
+    void save(bool force=false);
+
+    //! Call save() periodically from a background thread.
+    void start(double period);
+    //! Stop periodic save().  Does not save.
+    void stop();
+
+    //! Number of PVs added
+    size_t size() const;
+
+private:
+    struct Saver;
+
+    const std::string fname;
+
+    mutable epicsMutex mutex;
+
+    struct Entry {
+        SharedPV::weak_pointer pv;
+        size_t generation; // SharedPV::generation when saved
+        Entry() :generation(size_t(-1)) {}
+    };
+    typedef std::map<std::string, Entry> entries_t;
+    entries_t entries;
+    bool dirty; // entries added or removed
+
+    struct Saved {
+        std::tr1::shared_ptr<epics::pvData::PVStructure> value;
+        epics::pvData::BitSet valid;
+    };
+    typedef std::map<std::string, Saved> saved_t;
+    saved_t saved; // from load()
+
+    epics::pvData::Timer::shared_pointer timer;
+    std::tr1::shared_ptr<Saver> saver;
+
+    EPICS_NOT_COPYABLE(SharedPVSnapshot)
+};
+
+} // namespace pvas
+
+//! @}
+
+#endif // PV_SNAPSHOT_H
@@ -39,6 +39,8 @@
 #include <pv/codec.h>
 #include <pv/rpcServer.h>
 #include <pv/securityImpl.h>
+#include <pv/inetAddressUtil.h>
+#include <pv/scratchPool.h>
 
 using std::string;
 using std::ostringstream;
@@ -83,6 +85,68 @@ static PVField::shared_pointer reuseOrCreatePVField(
         return pvDataCreate->createPVField(field);
 }
 
+template<typename T>
+static void detachSharedArray(PVScalarArray& field)
+{
+    typedef PVValueArray<T> array_t;
+    array_t& arr = static_cast<array_t&>(field);
+
+    // Elements still referenced elsewhere (eg. posted to a SharedPV by the previous put)
+    // would be copied by deserialize() before being overwritten.
+    // Drop them so that new storage is allocated instead, and then shared by reference.
+    // Take our reference out with swap(), as view() would add another.
+    typename array_t::const_svector held;
+    arr.swap(held);
+    if (held.unique())
+        arr.swap(held); // re-use in place
+}
+
+static void detachSharedArray(PVScalarArray& field)
+{
+    if (field.getArray()->getArraySizeType() == Array::fixed)
+        return;
+
+    switch (field.getScalarArray()->getElementType()) {
+#define CASE(TYPE, PVT) case PVT: detachSharedArray<TYPE>(field); return
+    CASE(boolean, pvBoolean);
+    CASE(int8, pvByte);
+    CASE(int16, pvShort);
+    CASE(int32, pvInt);
+    CASE(int64, pvLong);
+    CASE(uint8, pvUByte);
+    CASE(uint16, pvUShort);
+    CASE(uint32, pvUInt);
+    CASE(uint64, pvULong);
+    CASE(float, pvFloat);
+    CASE(double, pvDouble);
+    CASE(std::string, pvString);
+#undef CASE
+    }
+}
+
+// detach the array fields of pvStructure which are about to be deserialize()'d
+static void detachSharedArrays(PVStructure& pvStructure, const BitSet& changed, bool all = false)
+{
+    all |= changed.get(pvStructure.getFieldOffset());
+
+    const PVFieldPtrArray& fields = pvStructure.getPVFields();
+    for (size_t i = 0, N = fields.size(); i < N; i++)
+    {
+        PVField& field = *fields[i];
+        switch (field.getField()->getType()) {
+        case scalarArray:
+            if (all || changed.get(field.getFieldOffset()))
+                detachSharedArray(static_cast<PVScalarArray&>(field));
+            break;
+        case structure:
+            detachSharedArrays(static_cast<PVStructure&>(field), changed, all);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
 
 
 void ServerBadResponse::handleResponse(osiSockAddr* responseFrom,
@@ -206,6 +270,22 @@ void ServerConnectionValidationHandler::handleResponse(
     //TODO: simplify byzantine class heirarchy...
     assert(casTransport);
 
+    // optional extensions, absent from older clients
+    if (payloadBuffer->getRemaining()) {
+        int8 extensions = payloadBuffer->getByte();
+        if (extensions & PVA_VALIDATION_TYPE_DICTIONARY) {
+            size_t count = SerializeHelper::readSize(payloadBuffer, transport.get());
+            if (count > TypeDictionary::maxSize)
+                throw std::runtime_error("Too many known types announced");
+            TypeDictionary::hashes_t hashes(count);
+            for (size_t i = 0; i < count; i++) {
+                transport->ensureData(8);
+                hashes[i] = uint64(payloadBuffer->getLong());
+            }
+            casTransport->peerTypeHashes(hashes);
+        }
+    }
+
     try {
         casTransport->authNZInitialize(securityPluginName, data);
     }catch(std::exception& e){
@@ -1053,8 +1133,13 @@ void ServerGetHandler::handleResponse(osiSockAddr* responseFrom,
         }
         atomic::add(request->bytesRX, payloadSize);
 
-        if (!request->startRequest(qosCode))
+        switch (request->queueRequest(qosCode))
         {
+        case BaseChannelRequester::Started:
+            break;
+        case BaseChannelRequester::Queued:
+            return; // started from send() of the preceding reply
+        case BaseChannelRequester::Rejected:
             BaseChannelRequester::sendFailureMessage((int8)CMD_GET, transport, ioid, qosCode, BaseChannelRequester::otherRequestPendingStatus);
             return;
         }
@@ -1083,6 +1168,16 @@ void ServerGetHandler::handleResponse(osiSockAddr* responseFrom,
         destroy(); \
     }
 
+namespace {
+// acknowledge a pipeline window requested with record._options.window
+Status pipelineStatus(size_t window)
+{
+    std::ostringstream msg;
+    msg<<"window="<<window;
+    return Status(Status::STATUSTYPE_OK, msg.str());
+}
+}
+
 #define DESERIALIZE_EXCEPTION_GUARD(code) \
     try { \
         code; \
@@ -1117,6 +1212,7 @@ ChannelGetRequester::shared_pointer ServerChannelGetRequesterImpl::create(Server
 void ServerChannelGetRequesterImpl::activate(PVStructure::shared_pointer const & pvRequest)
 {
     startRequest(QOS_INIT);
+    setWindow(requestedWindow(pvRequest));
     shared_pointer thisPointer(shared_from_this());
     _channel->registerRequest(_ioid, thisPointer);
     INIT_EXCEPTION_GUARD(CMD_GET, _channelGet, _channel->getChannel()->createChannelGet(thisPointer, pvRequest));
@@ -1134,6 +1230,12 @@ void ServerChannelGetRequesterImpl::channelGetConnect(const Status& status, Chan
             _pvStructure = std::tr1::static_pointer_cast<PVStructure>(reuseOrCreatePVField(structure, _pvStructure));
             _bitSet = createBitSetFor(_pvStructure, _bitSet);
         }
+
+        // only acknowledge in place of a plain success
+        if (_status.isOK() && _status.getMessage().empty() && getWindow() > 1u)
+            _status = pipelineStatus(getWindow());
+        else
+            setWindow(1u);
     }
 
     TransportSender::shared_pointer thisSender = shared_from_this();
@@ -1194,6 +1296,7 @@ ChannelGet::shared_pointer ServerChannelGetRequesterImpl::getChannelGet()
 void ServerChannelGetRequesterImpl::send(ByteBuffer* buffer, TransportSendControl* control)
 {
     const int32 request = getPendingRequest();
+    const bool pipelined = getWindow() > 1u;
 
     ChannelGet::shared_pointer channelGet;
     {
@@ -1217,7 +1320,9 @@ void ServerChannelGetRequesterImpl::send(ByteBuffer* buffer, TransportSendContro
     // since between last serialization data and stopRequest() a buffer can be already flushed
     // (i.e. in case of directSerialize)
     // if we call it here, then a bad client can issue another request just after stopRequest() was called
-    stopRequest();
+    // when pipelining, a following request is queued until nextRequest() below.
+    if (!pipelined)
+        stopRequest();
 
     if (_status.isSuccess())
     {
@@ -1242,6 +1347,18 @@ void ServerChannelGetRequesterImpl::send(ByteBuffer* buffer, TransportSendContro
     {
         destroy();
     }
+    else if (pipelined)
+    {
+        int32 next;
+        PVStructure::shared_pointer unused;
+        BitSet::shared_pointer unusedChanged;
+        if (nextRequest(next, unused, unusedChanged) && channelGet)
+        {
+            if (next & QOS_DESTROY)
+                channelGet->lastRequest();
+            channelGet->get();
+        }
+    }
 }
 /****************************************************************************************/
 void ServerPutHandler::handleResponse(osiSockAddr* responseFrom,
@@ -1290,14 +1407,53 @@ void ServerPutHandler::handleResponse(osiSockAddr* responseFrom,
         }
         atomic::add(request->bytesRX, payloadSize);
 
+        ChannelPut::shared_pointer channelPut = request->getChannelPut();
+
+        if (request->getWindow() > 1u && request->getPendingRequest() != BaseChannelRequester::NULL_REQUEST)
+        {
+            // pipelined request arriving while another is in progress.
+            // A put value is kept with the queued request.
+            PVStructure::shared_pointer putPVStructure;
+            BitSet::shared_pointer putBitSet;
+            if (!get && channelPut)
+            {
+                // copies come from, and return to, the pool of this operation
+                ScratchPool& pool = request->getScratchPool();
+                putPVStructure = pool.structure(request->getPutPVStructure()->getStructure());
+                putBitSet = pool.bitSet(putPVStructure->getNumberFields());
+
+                DESERIALIZE_EXCEPTION_GUARD(
+                    putBitSet->deserialize(payloadBuffer, transport.get());
+                    detachSharedArrays(*putPVStructure, *putBitSet);
+                    putPVStructure->deserialize(payloadBuffer, transport.get(), putBitSet.get());
+                );
+            }
+
+            switch (request->queueRequest(qosCode, putPVStructure, putBitSet))
+            {
+            case BaseChannelRequester::Queued:
+                return; // started from send() of the preceding reply
+            case BaseChannelRequester::Rejected:
+                BaseChannelRequester::sendFailureMessage((int8)CMD_PUT, transport, ioid, qosCode, BaseChannelRequester::otherRequestPendingStatus);
+                return;
+            case BaseChannelRequester::Started:
+                // preceding request completed meanwhile
+                if (lastRequest)
+                    channelPut->lastRequest();
+                if (get)
+                    channelPut->get();
+                else
+                    channelPut->put(putPVStructure, putBitSet);
+                return;
+            }
+        }
+
         if (!request->startRequest(qosCode))
         {
             BaseChannelRequester::sendFailureMessage((int8)CMD_PUT, transport, ioid, qosCode, BaseChannelRequester::otherRequestPendingStatus);
             return;
         }
 
-        ChannelPut::shared_pointer channelPut = request->getChannelPut();
-
         if (lastRequest)
             channelPut->lastRequest();
 
@@ -1316,6 +1472,7 @@ void ServerPutHandler::handleResponse(osiSockAddr* responseFrom,
 
                 DESERIALIZE_EXCEPTION_GUARD(
                     putBitSet->deserialize(payloadBuffer, transport.get());
+                    detachSharedArrays(*putPVStructure, *putBitSet);
                     putPVStructure->deserialize(payloadBuffer, transport.get(), putBitSet.get());
                 );
 
@@ -1346,6 +1503,7 @@ ChannelPutRequester::shared_pointer ServerChannelPutRequesterImpl::create(Server
 void ServerChannelPutRequesterImpl::activate(PVStructure::shared_pointer const & pvRequest)
 {
     startRequest(QOS_INIT);
+    setWindow(requestedWindow(pvRequest));
     shared_pointer thisPointer(shared_from_this());
     _channel->registerRequest(_ioid, thisPointer);
     INIT_EXCEPTION_GUARD(CMD_PUT, _channelPut, _channel->getChannel()->createChannelPut(thisPointer, pvRequest));
@@ -1362,6 +1520,12 @@ void ServerChannelPutRequesterImpl::channelPutConnect(const Status& status, Chan
             _pvStructure = std::tr1::static_pointer_cast<PVStructure>(reuseOrCreatePVField(structure, _pvStructure));
             _bitSet = createBitSetFor(_pvStructure, _bitSet);
         }
+
+        // only acknowledge in place of a plain success
+        if (_status.isOK() && _status.getMessage().empty() && getWindow() > 1u)
+            _status = pipelineStatus(getWindow());
+        else
+            setWindow(1u);
     }
 
     TransportSender::shared_pointer thisSender = shared_from_this();
@@ -1442,6 +1606,7 @@ PVStructure::shared_pointer ServerChannelPutRequesterImpl::getPutPVStructure()
 void ServerChannelPutRequesterImpl::send(ByteBuffer* buffer, TransportSendControl* control)
 {
     const int32 request = getPendingRequest();
+    const bool pipelined = getWindow() > 1u;
 
     ChannelPut::shared_pointer channelPut;
     {
@@ -1475,11 +1640,31 @@ void ServerChannelPutRequesterImpl::send(ByteBuffer* buffer, TransportSendContro
         }
     }
 
-    stopRequest();
-
     // lastRequest
     if ((QOS_DESTROY & request) != 0)
+    {
+        stopRequest();
         destroy();
+    }
+    else if (pipelined)
+    {
+        int32 next;
+        PVStructure::shared_pointer putPVStructure;
+        BitSet::shared_pointer putBitSet;
+        if (nextRequest(next, putPVStructure, putBitSet) && channelPut)
+        {
+            if (next & QOS_DESTROY)
+                channelPut->lastRequest();
+            if (next & QOS_GET)
+                channelPut->get();
+            else
+                channelPut->put(putPVStructure, putBitSet);
+        }
+    }
+    else
+    {
+        stopRequest();
+    }
 }
 
 
@@ -1558,6 +1743,7 @@ void ServerPutGetHandler::handleResponse(osiSockAddr* responseFrom,
 
                 DESERIALIZE_EXCEPTION_GUARD(
                     putBitSet->deserialize(payloadBuffer, transport.get());
+                    detachSharedArrays(*putPVStructure, *putBitSet);
                     putPVStructure->deserialize(payloadBuffer, transport.get(), putBitSet.get());
                 );
 
@@ -1891,10 +2077,43 @@ void ServerMonitorRequesterImpl::activate(PVStructure::shared_pointer const & pv
             message(strm.str(), epics::pvData::errorMessage);
         }
     }
+    // client sizes the window itself, which implies pipeline=true
+    O = pvRequest->getSubField<epics::pvData::PVScalar>("record._options.adaptive");
+    if(O) {
+        try{
+            _pipeline |= O->getAs<epics::pvData::boolean>();
+        }catch(std::exception& e){
+            std::ostringstream strm;
+            strm<<"Ignoring invalid adaptive= : "<<e.what();
+            message(strm.str(), epics::pvData::errorMessage);
+        }
+    }
+    // client acks only to request a complete value, which implies pipeline=true
+    bool multicast = false;
+    O = pvRequest->getSubField<epics::pvData::PVScalar>("record._options.multicast");
+    if(O) {
+        try{
+            multicast = O->getAs<epics::pvData::boolean>();
+            _pipeline |= multicast;
+        }catch(std::exception& e){
+            std::ostringstream strm;
+            strm<<"Ignoring invalid multicast= : "<<e.what();
+            message(strm.str(), epics::pvData::errorMessage);
+        }
+    }
     startRequest(QOS_INIT);
     shared_pointer thisPointer(shared_from_this());
     _channel->registerRequest(_ioid, thisPointer);
-    INIT_EXCEPTION_GUARD(CMD_MONITOR, _channelMonitor, _channel->getChannel()->createMonitor(thisPointer, pvRequest));
+
+    MulticastPublisher::shared_pointer publisher;
+    if(multicast)
+        publisher = _context->getMulticastPublisher();
+    if(publisher && publisher->designated(_channel->getChannel()->getChannelName())
+            && MulticastPublisher::compatible(*pvRequest)) {
+        INIT_EXCEPTION_GUARD(CMD_MONITOR, _channelMonitor, publisher->subscribe(_channel->getChannel(), pvRequest, thisPointer));
+    } else {
+        INIT_EXCEPTION_GUARD(CMD_MONITOR, _channelMonitor, _channel->getChannel()->createMonitor(thisPointer, pvRequest));
+    }
 }
 
 void ServerMonitorRequesterImpl::monitorConnect(const Status& status, Monitor::shared_pointer const & monitor, epics::pvData::StructureConstPtr const & structure)
@@ -1904,6 +2123,7 @@ void ServerMonitorRequesterImpl::monitorConnect(const Status& status, Monitor::s
         _status = status;
         _channelMonitor = monitor;
         _structure = structure;
+        _multicast = std::tr1::dynamic_pointer_cast<MulticastSubscription>(monitor);
     }
     TransportSender::shared_pointer thisSender = shared_from_this();
     _transport->enqueueSendRequest(thisSender);
@@ -1981,6 +2201,25 @@ void ServerMonitorRequesterImpl::send(ByteBuffer* buffer, TransportSendControl*
         {
             // valid due to _mutex lock above
             control->cachedSerialize(_structure, buffer);
+
+            // optional extension, ignored by older clients
+            MulticastPublisher::shared_pointer publisher;
+            MulticastSubscription::shared_pointer multicast;
+            {
+                Lock guard(_mutex);
+                multicast = _multicast;
+            }
+            if (multicast)
+                publisher = _context->getMulticastPublisher();
+            if (publisher)
+            {
+                control->ensureBuffer(1);
+                buffer->putByte(PVA_MONITOR_MULTICAST);
+                SerializeHelper::serializeString(inetAddressToString(publisher->group()), buffer, control);
+                control->ensureBuffer(sizeof(publisher->guid().value)+4);
+                buffer->put(publisher->guid().value, 0, sizeof(publisher->guid().value));
+                buffer->putInt(multicast->streamID());
+            }
         }
         stopRequest();
         startRequest(QOS_DEFAULT);
@@ -2019,6 +2258,18 @@ void ServerMonitorRequesterImpl::send(ByteBuffer* buffer, TransportSendControl*
 
                 // overrunBitset
                 element->overrunBitSet->serialize(buffer, control);
+
+                // multicast sequence # which this complete value corresponds to
+                MulticastSubscription::shared_pointer multicast;
+                {
+                    Lock guard(_mutex);
+                    multicast = _multicast;
+                }
+                if (multicast)
+                {
+                    control->ensureBuffer(4);
+                    buffer->putInt(multicast->sequence());
+                }
             }
 
             {
@@ -2199,6 +2450,8 @@ void ServerArrayHandler::handleResponse(osiSockAddr* responseFrom,
                 DESERIALIZE_EXCEPTION_GUARD(
                     offset = SerializeHelper::readSize(payloadBuffer, transport.get());
                     stride = SerializeHelper::readSize(payloadBuffer, transport.get());
+                    if (PVScalarArray* sarr = dynamic_cast<PVScalarArray*>(array.get()))
+                        detachSharedArray(*sarr);
                     array->deserialize(payloadBuffer, transport.get());
                 );
             }
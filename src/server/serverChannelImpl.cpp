@@ -62,7 +62,14 @@ std::tr1::shared_ptr<BaseChannelRequester> ServerChannel::getRequest(const pvAcc
 
 void ServerChannel::destroy()
 {
-    _requests_t reqs;
+    requests_t reqs;
+    detach(reqs);
+    destroyRequests(reqs);
+}
+
+void ServerChannel::detach(requests_t& reqs)
+{
+    _requests_t temp;
     {
         Lock guard(_mutex);
 
@@ -72,20 +79,27 @@ void ServerChannel::destroy()
         // destroy all requests
         // take ownership of _requests locally to prevent
         // removal via unregisterRequest() during iteration
-        _requests.swap(reqs);
+        _requests.swap(temp);
 
         // ... and the channel
         // TODO try catch
         _channel->destroy();
     }
-    // unlock our before destroy.
+
+    reqs.reserve(reqs.size() + temp.size());
+    for(_requests_t::const_iterator it=temp.begin(), end=temp.end(); it!=end; ++it)
+        reqs.push_back(it->second);
+}
+
+void ServerChannel::destroyRequests(const requests_t& reqs)
+{
+    // called without our lock.
     // our mutex is subordinate to operation mutex
 
-    for(_requests_t::const_iterator it=reqs.begin(), end=reqs.end(); it!=end; ++it)
+    for(requests_t::const_iterator it=reqs.begin(), end=reqs.end(); it!=end; ++it)
     {
-        const _requests_t::mapped_type& req = it->second;
         // will call unregisterRequest() which is now a no-op
-        req->destroy();
+        (*it)->destroy();
         // May still be in the send queue
     }
 }
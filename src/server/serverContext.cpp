@@ -4,7 +4,10 @@
  * in file LICENSE that is included with this distribution.
  */
 
+#include <set>
+
 #include <epicsSignal.h>
+#include <epicsGuard.h>
 
 #include <pv/lock.h>
 #include <pv/timer.h>
@@ -23,6 +26,26 @@ using namespace epics::pvData;
 using std::tr1::dynamic_pointer_cast;
 using std::tr1::static_pointer_cast;
 
+namespace {
+using namespace epics::pvAccess;
+
+// running servers, for ServerContextImpl::findLocalProvider()
+epicsMutex localServersLock;
+std::set<ServerContextImpl*> localServers;
+
+struct LocalFindRequester : public ChannelFindRequester {
+    bool found;
+    LocalFindRequester() :found(false) {}
+    virtual ~LocalFindRequester() {}
+    virtual void channelFindResult(const Status& status,
+                                   ChannelFind::shared_pointer const & channelFind,
+                                   bool wasFound) OVERRIDE FINAL
+    {
+        found = status.isSuccess() && wasFound;
+    }
+};
+} // namespace
+
 namespace epics {
 namespace pvAccess {
 
@@ -146,6 +169,29 @@ void ServerContextImpl::loadConfiguration()
     _receiveBufferSize = config->getPropertyAsInteger("EPICS_PVA_MAX_ARRAY_BYTES", _receiveBufferSize);
     _receiveBufferSize = config->getPropertyAsInteger("EPICS_PVAS_MAX_ARRAY_BYTES", _receiveBufferSize);
 
+    // multicast distribution of monitor updates for designated PVs
+    memset(&_mcastGroup, 0, sizeof(_mcastGroup));
+    _mcastGroup.ia.sin_family = AF_INET;
+    if(!config->getPropertyAsString("EPICS_PVAS_MCAST_ADDR", "").empty()) {
+        _mcastGroup.ia.sin_port = htons(PVA_BROADCAST_PORT+2);
+        if(!config->getPropertyAsAddress("EPICS_PVAS_MCAST_ADDR", &_mcastGroup) || !isMulticastAddress(&_mcastGroup))
+            THROW_EXCEPTION2(std::runtime_error, "EPICS_PVAS_MCAST_ADDR is not a multicast address");
+    }
+
+    memset(&_mcastNIF, 0, sizeof(_mcastNIF));
+    _mcastNIF.ia.sin_family = AF_INET;
+    _mcastNIF.ia.sin_addr.s_addr = htonl(INADDR_ANY);
+    if(!config->getPropertyAsAddress("EPICS_PVAS_MCAST_INTF", &_mcastNIF) && config->hasProperty("EPICS_PVAS_MCAST_INTF"))
+        THROW_EXCEPTION2(std::runtime_error, "EPICS_PVAS_MCAST_INTF contains invalid IP or non-existant hostname");
+
+    _mcastNames = config->getPropertyAsString("EPICS_PVAS_MCAST_PV_LIST", _mcastNames);
+
+    if(config->hasProperty("EPICS_PVAS_MONITOR_BUDGET")) {
+        // process-wide, shared with any other ServerContext
+        double limit = config->getPropertyAsDouble("EPICS_PVAS_MONITOR_BUDGET", 0.0);
+        MonitorFIFO::setBudget(limit>0.0 ? size_t(limit) : 0u);
+    }
+
     if(_channelProviders.empty()) {
         std::string providers = config->getPropertyAsString("EPICS_PVAS_PROVIDER_NAMES", PVACCESS_DEFAULT_PROVIDER);
 
@@ -251,6 +297,18 @@ ServerContextImpl::getCurrentConfig()
 
     SET("EPICS_PVAS_PROVIDER_NAMES", providerName.str());
 
+    if(_mcastGroup.ia.sin_port) {
+        SET("EPICS_PVAS_MCAST_ADDR", inetAddressToString(_mcastGroup));
+        SET("EPICS_PVAS_MCAST_INTF", inetAddressToString(_mcastNIF, false));
+        SET("EPICS_PVAS_MCAST_PV_LIST", _mcastNames);
+    }
+
+    {
+        MonitorFIFO::BudgetStats budget;
+        MonitorFIFO::getBudgetStats(budget);
+        SET("EPICS_PVAS_MONITOR_BUDGET", budget.limit);
+    }
+
 #undef SET
 
     return B.push_map().build();
@@ -283,6 +341,48 @@ void ServerContextImpl::initialize()
     _beaconEmitter.reset(new BeaconEmitter("tcp", _broadcastTransport, thisServerContext));
 
     _beaconEmitter->start();
+
+    if(_mcastGroup.ia.sin_port)
+        _multicastPublisher.reset(new MulticastPublisher(_guid, _mcastGroup, _mcastNIF, _responseHandler, _mcastNames));
+
+    {
+        epicsGuard<epicsMutex> G(localServersLock);
+        localServers.insert(this);
+    }
+}
+
+ChannelProvider::shared_pointer ServerContextImpl::findLocalProvider(const std::string& channelName)
+{
+    std::vector<ChannelProvider::shared_pointer> providers;
+    {
+        // a server is removed in shutdown() before it is destroyed
+        epicsGuard<epicsMutex> G(localServersLock);
+        for(std::set<ServerContextImpl*>::const_iterator it(localServers.begin()), end(localServers.end());
+            it!=end; ++it)
+        {
+            const std::vector<ChannelProvider::shared_pointer>& P((*it)->_channelProviders);
+            providers.insert(providers.end(), P.begin(), P.end());
+        }
+    }
+
+    for(size_t i=0; i<providers.size(); i++) {
+        // a gateway would lead back to us
+        if(providers[i]->getProviderName()=="pva")
+            continue;
+
+        // only synchronous answers are considered, otherwise fall back to searching.
+        // one requester per provider, so that a late answer can't be attributed to another.
+        std::tr1::shared_ptr<LocalFindRequester> finder(new LocalFindRequester);
+        try {
+            providers[i]->channelFind(channelName, finder);
+        } catch(std::exception& e) {
+            LOG(logLevelDebug, "Unhandled exception from channelFind(): %s", e.what());
+            continue;
+        }
+        if(finder->found)
+            return providers[i];
+    }
+    return ChannelProvider::shared_pointer();
 }
 
 void ServerContextImpl::run(uint32 seconds)
@@ -302,6 +402,11 @@ void ServerContextImpl::run(uint32 seconds)
 
 void ServerContextImpl::shutdown()
 {
+    {
+        epicsGuard<epicsMutex> G(localServersLock);
+        localServers.erase(this);
+    }
+
     if(!_timer)
         return; // already shutdown
 
@@ -322,6 +427,13 @@ void ServerContextImpl::shutdown()
     }
     _udpTransports.clear();
 
+    // stop publishing to multicast subscribers
+    if (_multicastPublisher)
+    {
+        _multicastPublisher->close();
+        _multicastPublisher.reset();
+    }
+
     // stop emitting beacons
     if (_beaconEmitter)
     {
@@ -382,8 +494,18 @@ void ServerContextImpl::printInfo(ostream& str, int lvl)
         SHOW(EPICS_PVAS_BROADCAST_PORT)
         SHOW(EPICS_PVAS_SERVER_PORT)
         SHOW(EPICS_PVAS_PROVIDER_NAMES)
+        SHOW(EPICS_PVAS_MONITOR_BUDGET)
 #undef SHOW
 
+        MonitorFIFO::BudgetStats budget;
+        MonitorFIFO::getBudgetStats(budget);
+        if(budget.limit)
+            str << "Monitor queues hold "<<budget.queued<<" of "<<budget.limit<<" bytes."
+                   "  Squashed "<<budget.nsquash<<", ended "<<budget.nshed<<" subscriptions\n";
+
+        if(_multicastPublisher)
+            _multicastPublisher->printInfo(str);
+
     } else {
         // lvl >= 1
 
@@ -504,6 +626,12 @@ const BlockingUDPTransport::shared_pointer& ServerContextImpl::getBroadcastTrans
     return _broadcastTransport;
 }
 
+MulticastPublisher::shared_pointer ServerContextImpl::getMulticastPublisher()
+{
+    Lock guard(_mutex);
+    return _multicastPublisher;
+}
+
 const std::vector<ChannelProvider::shared_pointer>& ServerContextImpl::getChannelProviders()
 {
     return _channelProviders;
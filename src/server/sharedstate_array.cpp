@@ -0,0 +1,184 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <list>
+
+#include <epicsMutex.h>
+#include <epicsGuard.h>
+#include <errlog.h>
+
+#include <shareLib.h>
+#include <pv/sharedPtr.h>
+#include <pv/noDefaultMethods.h>
+#include <pv/sharedVector.h>
+#include <pv/pvData.h>
+#include <pv/status.h>
+#include <pv/reftrack.h>
+
+#define epicsExportSharedSymbols
+#include "sharedstateimpl.h"
+
+namespace {
+
+template<typename T>
+void sliceArray(const pvd::PVScalarArray& in, pvd::PVScalarArray& out,
+                size_t offset, size_t count, size_t stride)
+{
+    typedef pvd::PVValueArray<T> array_t;
+
+    pvd::shared_vector<const T> src(static_cast<const array_t&>(in).view());
+    if(stride==1u) {
+        // shares the posted array
+        src.slice(offset, count);
+        static_cast<array_t&>(out).replace(src);
+
+    } else {
+        typename array_t::svector dest(count);
+        for(size_t i=0; i<count; i++)
+            dest[i] = src[offset + i*stride];
+        static_cast<array_t&>(out).replace(pvd::freeze(dest));
+    }
+}
+
+void slice(const pvd::PVScalarArray& in, pvd::PVScalarArray& out,
+           size_t offset, size_t count, size_t stride)
+{
+    switch(in.getScalarArray()->getElementType()) {
+#define CASE(TYPE, PVT) case pvd::PVT: sliceArray<TYPE>(in, out, offset, count, stride); return
+    CASE(pvd::boolean, pvBoolean);
+    CASE(pvd::int8, pvByte);
+    CASE(pvd::int16, pvShort);
+    CASE(pvd::int32, pvInt);
+    CASE(pvd::int64, pvLong);
+    CASE(pvd::uint8, pvUByte);
+    CASE(pvd::uint16, pvUShort);
+    CASE(pvd::uint32, pvUInt);
+    CASE(pvd::uint64, pvULong);
+    CASE(float, pvFloat);
+    CASE(double, pvDouble);
+    CASE(std::string, pvString);
+#undef CASE
+    }
+    throw std::logic_error("Unknown element type");
+}
+
+} // namespace
+
+namespace pvas {
+namespace detail {
+
+size_t SharedArray::num_instances;
+
+SharedArray::SharedArray(const std::tr1::shared_ptr<SharedChannel>& channel,
+                         const requester_type::shared_pointer& requester)
+    :channel(channel)
+    ,requester(requester)
+{
+    REFTRACE_INCREMENT(num_instances);
+}
+
+SharedArray::~SharedArray()
+{
+    REFTRACE_DECREMENT(num_instances);
+}
+
+void SharedArray::destroy() {}
+
+std::tr1::shared_ptr<pva::Channel> SharedArray::getChannel()
+{
+    return channel;
+}
+
+void SharedArray::cancel() {}
+
+void SharedArray::lastRequest() {}
+
+pvd::PVScalarArray::const_shared_pointer SharedArray::current(pvd::Status& sts) const
+{
+    pvd::PVScalarArray::const_shared_pointer ret;
+    if(!channel->owner->current) {
+        sts = pvd::Status::error("Not open()");
+
+    } else if(!(ret = channel->owner->current->getSubField<pvd::PVScalarArray>("value"))) {
+        sts = pvd::Status::error("'value' is not a scalar array");
+    }
+    return ret;
+}
+
+void SharedArray::putArray(pvd::PVArray::shared_pointer const & putArray,
+                           size_t offset, size_t count, size_t stride)
+{
+    requester_type::shared_pointer req(requester.lock());
+    if(req)
+        req->putArrayDone(pvd::Status::error("Read-only"), shared_from_this());
+}
+
+void SharedArray::getArray(size_t offset, size_t count, size_t stride)
+{
+    pvd::Status sts;
+    pvd::PVScalarArray::shared_pointer result;
+    {
+        Guard G(channel->owner->mutex);
+
+        pvd::PVScalarArray::const_shared_pointer value;
+        if(channel->dead)
+            sts = pvd::Status::error("Dead Channel");
+        else
+            value = current(sts);
+
+        if(!value) {
+            // sts already set
+        } else if(stride==0u) {
+            sts = pvd::Status::error("stride must be non-zero");
+
+        } else if(offset>value->getLength()) {
+            sts = pvd::Status::error("offset beyond end of array");
+
+        } else {
+            // count==0 is to the end.  Otherwise limited to the end.
+            const size_t avail = (value->getLength() - offset + stride - 1u)/stride;
+            if(count==0u || count>avail)
+                count = avail;
+
+            result = pvd::getPVDataCreate()->createPVScalarArray(value->getScalarArray()->getElementType());
+            slice(*value, *result, offset, count, stride);
+        }
+    }
+
+    requester_type::shared_pointer req(requester.lock());
+    if(req)
+        req->getArrayDone(sts, shared_from_this(), result);
+}
+
+void SharedArray::getLength()
+{
+    pvd::Status sts;
+    size_t length = 0u;
+    {
+        Guard G(channel->owner->mutex);
+
+        pvd::PVScalarArray::const_shared_pointer value;
+        if(channel->dead)
+            sts = pvd::Status::error("Dead Channel");
+        else
+            value = current(sts);
+
+        if(value)
+            length = value->getLength();
+    }
+
+    requester_type::shared_pointer req(requester.lock());
+    if(req)
+        req->getLengthDone(sts, shared_from_this(), length);
+}
+
+void SharedArray::setLength(size_t length)
+{
+    requester_type::shared_pointer req(requester.lock());
+    if(req)
+        req->setLengthDone(pvd::Status::error("Read-only"), shared_from_this());
+}
+
+}} // namespace pvas::detail
@@ -76,7 +76,7 @@ void SharedChannel::destroy()
         }
     }
     if(handler) {
-        handler->onLastDisconnect(owner);
+        Strand::onLastDisconnect(owner, handler);
     }
     if(owner->debugLvl>5)
     {
@@ -134,7 +134,7 @@ void SharedChannel::getField(pva::GetFieldRequester::shared_pointer const & requ
         requester->getDone(sts, desc);
     }
     if(handler) {
-        handler->onFirstConnect(owner);
+        Strand::onFirstConnect(owner, handler);
     }
 }
 
@@ -179,7 +179,7 @@ pva::ChannelPut::shared_pointer SharedChannel::createChannelPut(
         requester->channelPutConnect(pvd::Status::error(e.what()), ret, type);
     }
     if(handler) {
-        handler->onFirstConnect(owner);
+        Strand::onFirstConnect(owner, handler);
     }
     return ret;
 }
@@ -216,21 +216,55 @@ pva::Monitor::shared_pointer SharedChannel::createMonitor(
 
     std::tr1::shared_ptr<SharedMonitorFIFO> ret(new SharedMonitorFIFO(shared_from_this(), requester, pvRequest, &mconf));
 
-    bool notify;
+    bool notify = false;
     pvd::Status sts;
-    {
+
+    std::tr1::shared_ptr<ImageTransform> transform(new ImageTransform);
+    pvd::uint32 replay = 0u;
+    try {
+        if(!pvRequest || !transform->parse(*pvRequest))
+            transform.reset();
+
+        pvd::PVScalar::const_shared_pointer opt;
+        if(pvRequest && (opt = pvRequest->getSubField<pvd::PVScalar>("record._options.history")))
+            replay = opt->getAs<pvd::uint32>();
+    }catch(std::runtime_error& e){
+        sts = pvd::Status::error(e.what());
+    }
+
+    if(sts.isOK()) {
         Guard G(owner->mutex);
         if(dead) {
             sts = pvd::Status::error("Dead Channel");
-            notify = false;
 
         } else {
+            if(transform) {
+                // share with other subscribers using the same options
+                std::tr1::shared_ptr<ImageTransform> existing;
+                const std::string key(transform->key());
+                SharedPV::transforms_t::iterator found(owner->transforms.find(key));
+                if(found!=owner->transforms.end())
+                    existing = found->second.lock();
+                if(existing)
+                    transform = existing;
+                else
+                    owner->transforms[key] = transform;
+
+                for(SharedPV::transforms_t::iterator it(owner->transforms.begin()), end(owner->transforms.end()); it!=end;) {
+                    SharedPV::transforms_t::iterator cur(it++);
+                    if(cur->second.expired())
+                        owner->transforms.erase(cur);
+                }
+                ret->transform = transform;
+            }
+
             owner->monitors.push_back(ret.get());
             notify = !!owner->type;
             if(notify) {
                 ret->open(owner->type);
-                // post initial update
-                ret->post(*owner->current, owner->valid);
+                // post initial update, or recent updates
+                if(!replay || transform || !owner->history || !owner->history->replay(*ret, replay))
+                    ret->postUpdate(*owner->current, owner->valid);
             }
 
             if(!owner->channels.empty() && !owner->notifiedConn) {
@@ -248,9 +282,34 @@ pva::Monitor::shared_pointer SharedChannel::createMonitor(
             ret->notify();
         }
         if(handler) {
-            handler->onFirstConnect(owner);
+            Strand::onFirstConnect(owner, handler);
+        }
+    }
+    return ret;
+}
+
+pva::ChannelArray::shared_pointer SharedChannel::createChannelArray(
+        pva::ChannelArrayRequester::shared_pointer const & requester,
+        pvd::PVStructure::shared_pointer const & pvRequest)
+{
+    std::tr1::shared_ptr<SharedArray> ret(new SharedArray(shared_from_this(), requester));
+
+    pvd::Status sts;
+    pvd::Array::const_shared_pointer type;
+    {
+        Guard G(owner->mutex);
+        if(dead) {
+            sts = pvd::Status::error("Dead Channel");
+
+        } else {
+            pvd::PVScalarArray::const_shared_pointer value(ret->current(sts));
+            if(value)
+                type = value->getScalarArray();
         }
     }
+    if(!sts.isSuccess())
+        ret.reset();
+    requester->channelArrayConnect(sts, ret, type);
     return ret;
 }
 
@@ -269,6 +328,20 @@ SharedMonitorFIFO::~SharedMonitorFIFO()
     channel->owner->monitors.remove(this);
 }
 
+void SharedMonitorFIFO::postUpdate(const pvd::PVStructure& value, const pvd::BitSet& changed)
+{
+    if(!transform) {
+        post(value, changed);
+
+    } else {
+        // transform from the complete value, which includes fields not in 'changed'
+        pvd::BitSet tchanged;
+        const pvd::PVStructure& image = transform->apply(*channel->owner->current, changed,
+                                                         channel->owner->generation, tchanged);
+        post(image, tchanged);
+    }
+}
+
 } // namespace detail
 
 Operation::Operation(const std::tr1::shared_ptr<Impl> impl)
@@ -0,0 +1,267 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <deque>
+#include <vector>
+#include <stdexcept>
+#include <sstream>
+
+#include <epicsMutex.h>
+#include <epicsGuard.h>
+#include <epicsEvent.h>
+#include <epicsThread.h>
+#include <errlog.h>
+
+#include <shareLib.h>
+#include <pv/sharedPtr.h>
+#include <pv/noDefaultMethods.h>
+#include <pv/pvData.h>
+#include <pv/status.h>
+#include <pv/reftrack.h>
+
+#define epicsExportSharedSymbols
+#include "sharedstateimpl.h"
+
+namespace pvas {
+namespace detail {
+
+//! Worker threads of an Executor, and the Strands with callbacks waiting
+struct ExecutorImpl : public epicsThreadRunable,
+                      public std::tr1::enable_shared_from_this<ExecutorImpl>
+{
+    mutable epicsMutex mutex;
+    epicsEvent wakeup;
+
+    // guarded by mutex
+    std::deque<std::tr1::shared_ptr<Strand> > ready; // with callbacks waiting, and not running
+    size_t pending;
+    bool running;
+    std::vector<std::tr1::shared_ptr<epicsThread> > workers;
+
+    ExecutorImpl() :pending(0u), running(true) {}
+    virtual ~ExecutorImpl() {}
+
+    virtual void run() OVERRIDE FINAL
+    {
+        // the last reference may be released by a callback
+        std::tr1::shared_ptr<ExecutorImpl> self(shared_from_this());
+
+        Guard G(mutex);
+        while(true) {
+            if(ready.empty()) {
+                if(!running)
+                    break;
+                UnGuard U(G);
+                wakeup.wait();
+                continue;
+            }
+
+            std::tr1::shared_ptr<Strand> strand(ready.front());
+            ready.pop_front();
+            std::tr1::shared_ptr<Strand::Work> work(strand->queue.front());
+            strand->queue.pop_front();
+            if(work->limited)
+                strand->waiting--;
+            pending--;
+
+            // epicsEvent is binary.  pass on to another worker
+            if(!ready.empty())
+                wakeup.signal();
+
+            {
+                UnGuard U(G);
+                try {
+                    work->run();
+                }catch(std::exception& e){
+                    errlogPrintf("Unhandled exception from SharedPV::Handler : %s\n", e.what());
+                }
+                // release the Operation, which may complete() it, without our lock
+                work.reset();
+            }
+
+            if(strand->queue.empty())
+                strand->scheduled = false;
+            else
+                ready.push_back(strand); // behind other PVs
+        }
+        // pass on to another worker so that all exit
+        wakeup.signal();
+    }
+
+    EPICS_NOT_COPYABLE(ExecutorImpl)
+};
+
+namespace {
+
+struct HandlerWork : public Strand::Work
+{
+    enum kind_t {FirstConnect, LastDisconnect, Put, RPC};
+
+    const kind_t kind;
+    const SharedPV::shared_pointer pv;
+    const SharedPV::Handler::shared_pointer handler;
+    Operation op;
+
+    HandlerWork(kind_t kind,
+                const SharedPV::shared_pointer& pv,
+                const SharedPV::Handler::shared_pointer& handler,
+                const Operation& op = Operation())
+        :kind(kind), pv(pv), handler(handler), op(op)
+    {}
+    virtual ~HandlerWork() {}
+
+    virtual void run() OVERRIDE FINAL
+    {
+        switch(kind) {
+        case FirstConnect: handler->onFirstConnect(pv); break;
+        case LastDisconnect: handler->onLastDisconnect(pv); break;
+        case Put: handler->onPut(pv, op); break;
+        case RPC: handler->onRPC(pv, op); break;
+        }
+    }
+};
+
+} // namespace
+
+Strand::Strand(const Executor& exec, size_t limit)
+    :executor(exec.impl)
+    ,limit(limit)
+    ,waiting(0u)
+    ,scheduled(false)
+{}
+
+bool Strand::submit(const std::tr1::shared_ptr<Work>& work, bool limited)
+{
+    {
+        Guard G(executor->mutex);
+        if(executor->running) {
+            if(limited) {
+                if(limit && waiting>=limit)
+                    return false;
+                work->limited = true;
+                waiting++;
+            }
+
+            queue.push_back(work);
+            executor->pending++;
+
+            if(!scheduled) {
+                scheduled = true;
+                executor->ready.push_back(shared_from_this());
+                executor->wakeup.signal();
+            }
+            return true;
+        }
+    }
+    // closed
+    work->run();
+    return true;
+}
+
+void Strand::onFirstConnect(const std::tr1::shared_ptr<SharedPV>& pv,
+                            const std::tr1::shared_ptr<SharedPV::Handler>& handler)
+{
+    if(!pv->strand) {
+        handler->onFirstConnect(pv);
+    } else {
+        std::tr1::shared_ptr<Work> work(new HandlerWork(HandlerWork::FirstConnect, pv, handler));
+        pv->strand->submit(work, false);
+    }
+}
+
+void Strand::onLastDisconnect(const std::tr1::shared_ptr<SharedPV>& pv,
+                              const std::tr1::shared_ptr<SharedPV::Handler>& handler)
+{
+    if(!pv || !pv->strand) {
+        handler->onLastDisconnect(pv);
+    } else {
+        std::tr1::shared_ptr<Work> work(new HandlerWork(HandlerWork::LastDisconnect, pv, handler));
+        pv->strand->submit(work, false);
+    }
+}
+
+void Strand::onPut(const std::tr1::shared_ptr<SharedPV>& pv,
+                   const std::tr1::shared_ptr<SharedPV::Handler>& handler,
+                   Operation& op)
+{
+    if(!pv->strand) {
+        handler->onPut(pv, op);
+    } else {
+        std::tr1::shared_ptr<Work> work(new HandlerWork(HandlerWork::Put, pv, handler, op));
+        if(!pv->strand->submit(work, true))
+            op.complete(pvd::Status::error("Too many operations waiting"));
+    }
+}
+
+void Strand::onRPC(const std::tr1::shared_ptr<SharedPV>& pv,
+                   const std::tr1::shared_ptr<SharedPV::Handler>& handler,
+                   Operation& op)
+{
+    if(!pv->strand) {
+        handler->onRPC(pv, op);
+    } else {
+        std::tr1::shared_ptr<Work> work(new HandlerWork(HandlerWork::RPC, pv, handler, op));
+        if(!pv->strand->submit(work, true))
+            op.complete(pvd::Status::error("Too many operations waiting"));
+    }
+}
+
+} // namespace detail
+
+size_t Executor::num_instances;
+
+Executor::Config::Config()
+    :workers(4u)
+    ,priority(epicsThreadPriorityMedium)
+{}
+
+Executor::Executor(const Config& conf)
+    :impl(new detail::ExecutorImpl)
+{
+    if(conf.workers==0u)
+        throw std::logic_error("Executor requires at least one worker");
+
+    for(unsigned i=0; i<conf.workers; i++) {
+        std::ostringstream name;
+        name<<"pvas exec "<<i;
+        std::tr1::shared_ptr<epicsThread> worker(new epicsThread(*impl, name.str().c_str(),
+                                                                 epicsThreadGetStackSize(epicsThreadStackBig),
+                                                                 conf.priority));
+        impl->workers.push_back(worker);
+        worker->start();
+    }
+    REFTRACE_INCREMENT(num_instances);
+}
+
+Executor::~Executor()
+{
+    close();
+    REFTRACE_DECREMENT(num_instances);
+}
+
+void Executor::close()
+{
+    std::vector<std::tr1::shared_ptr<epicsThread> > workers;
+    {
+        Guard G(impl->mutex);
+        impl->running = false;
+        workers.swap(impl->workers);
+    }
+    impl->wakeup.signal();
+
+    for(size_t i=0; i<workers.size(); i++) {
+        // a worker may release the last reference to us
+        if(!workers[i]->isCurrentThread())
+            workers[i]->exitWait();
+    }
+}
+
+size_t Executor::pending() const
+{
+    Guard G(impl->mutex);
+    return impl->pending;
+}
+
+} // namespace pvas
@@ -0,0 +1,238 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <list>
+#include <stdexcept>
+
+#include <epicsMutex.h>
+#include <epicsGuard.h>
+#include <errlog.h>
+
+#include <shareLib.h>
+#include <pv/sharedPtr.h>
+#include <pv/bitSet.h>
+#include <pv/pvData.h>
+
+#define epicsExportSharedSymbols
+#include "sharedstateimpl.h"
+#include "pva/group.h"
+
+namespace pvas {
+
+SharedPVGroup::Transaction::Transaction(const SharedPVGroup::shared_pointer& group)
+    :group(group)
+{
+    group->begin();
+}
+
+SharedPVGroup::Transaction::~Transaction()
+{
+    try {
+        group->commit();
+    }catch(std::exception& e){
+        errlogPrintf("SharedPVGroup : error ending Transaction : %s\n", e.what());
+    }
+}
+
+SharedPVGroup::shared_pointer SharedPVGroup::build(SharedPV::Config* conf)
+{
+    SharedPVGroup::shared_pointer ret(new SharedPVGroup(conf));
+    ret->internal_self = ret;
+    return ret;
+}
+
+SharedPVGroup::SharedPVGroup(SharedPV::Config* conf)
+    :group(SharedPV::buildReadOnly(conf))
+    ,transactions(0u)
+    ,flushing(false)
+{}
+
+SharedPVGroup::~SharedPVGroup()
+{
+    // our entries in SharedPV::groups are now expired
+    FOR_EACH(members_t::const_iterator, it, end, members) {
+        Guard G(it->pv->mutex);
+        for(SharedPV::groups_t::iterator it2(it->pv->groups.begin()); it2!=it->pv->groups.end();) {
+            if(it2->first.expired())
+                it2 = it->pv->groups.erase(it2);
+            else
+                ++it2;
+        }
+    }
+}
+
+void SharedPVGroup::add(const std::string& field, const SharedPV::shared_pointer& member)
+{
+    if(!member)
+        throw std::logic_error("NULL member");
+
+    size_t index;
+    {
+        Guard G(mutex);
+        if(pending)
+            throw std::logic_error("SharedPVGroup can't add() while open");
+
+        FOR_EACH(members_t::const_iterator, it, end, members) {
+            if(it->field==field)
+                throw std::logic_error("SharedPVGroup duplicate field "+field);
+        }
+
+        index = members.size();
+        members.push_back(Member());
+        members.back().field = field;
+        members.back().pv = member;
+        members.back().offset = 0u;
+    }
+
+    Guard G(member->mutex);
+    member->groups.push_back(std::make_pair(internal_self, index));
+}
+
+void SharedPVGroup::open()
+{
+    pvd::StructureConstPtr type;
+    {
+        Guard G(mutex);
+        if(pending)
+            throw std::logic_error("SharedPVGroup already open");
+
+        pvd::FieldBuilderPtr builder(pvd::getFieldCreate()->createFieldBuilder());
+        FOR_EACH(members_t::iterator, it, end, members) {
+            // throws if not open
+            it->type = it->pv->build()->getStructure();
+            builder->add(it->field, it->type);
+        }
+
+        type = builder->createStructure();
+        pending = pvd::getPVDataCreate()->createPVStructure(type);
+        out = pvd::getPVDataCreate()->createPVStructure(type);
+        pendingChanged.clear();
+
+        FOR_EACH(members_t::iterator, it, end, members) {
+            it->pending = pending->getSubFieldT<pvd::PVStructure>(it->field);
+            it->offset = it->pending->getFieldOffset();
+        }
+
+        // member posts made while we fetch() are held, and delivered after the group PV is open
+        transactions++;
+    }
+
+    try {
+        pvd::PVStructurePtr value(pvd::getPVDataCreate()->createPVStructure(type));
+        pvd::BitSet valid;
+
+        FOR_EACH(members_t::const_iterator, it, end, members) {
+            pvd::PVStructurePtr mvalue(pvd::getPVDataCreate()->createPVStructure(it->type));
+            pvd::BitSet mvalid;
+            it->pv->fetch(*mvalue, mvalid);
+
+            value->getSubFieldT<pvd::PVStructure>(it->field)->copyUnchecked(*mvalue);
+            for(pvd::int32 bit = mvalid.nextSetBit(0); bit>=0; bit = mvalid.nextSetBit(bit+1))
+                valid.set(it->offset + bit);
+        }
+
+        group->open(*value, valid);
+    }catch(...){
+        Guard G(mutex);
+        pending.reset();
+        out.reset();
+        transactions--;
+        throw;
+    }
+
+    commit();
+}
+
+void SharedPVGroup::close(bool destroy)
+{
+    {
+        Guard G(mutex);
+        pending.reset();
+        pendingChanged.clear();
+    }
+    group->close(destroy);
+}
+
+bool SharedPVGroup::isOpen() const
+{
+    Guard G(mutex);
+    return !!pending;
+}
+
+void SharedPVGroup::post(const pvd::PVStructure& value,
+                         const pvd::BitSet& changed)
+{
+    Guard G(mutex);
+    if(!pending)
+        throw std::logic_error("Not open()");
+    else if(*pending->getStructure()!=*value.getStructure())
+        throw std::logic_error("Type mis-match");
+
+    pending->copyUnchecked(value, changed);
+    pendingChanged |= changed;
+
+    flush(G);
+}
+
+void SharedPVGroup::memberPosted(size_t index,
+                                 const pvd::PVStructure& value,
+                                 const pvd::BitSet& changed)
+{
+    Guard G(mutex);
+    if(!pending || index>=members.size())
+        return;
+
+    Member& member = members[index];
+    if(*member.type!=*value.getStructure())
+        return; // member re-open()'d with a different type.  Ignored until we are also.
+
+    member.pending->copyUnchecked(value, changed);
+    for(pvd::int32 bit = changed.nextSetBit(0); bit>=0; bit = changed.nextSetBit(bit+1))
+        pendingChanged.set(member.offset + bit);
+
+    flush(G);
+}
+
+void SharedPVGroup::begin()
+{
+    Guard G(mutex);
+    transactions++;
+}
+
+void SharedPVGroup::commit()
+{
+    Guard G(mutex);
+    if(transactions==0u)
+        throw std::logic_error("SharedPVGroup Transaction not started");
+    transactions--;
+
+    flush(G);
+}
+
+void SharedPVGroup::flush(Guard& G)
+{
+    // the thread already flushing will also post() our changes
+    if(!pending || transactions || flushing)
+        return;
+
+    flushing = true;
+    try {
+        while(pending && !transactions && !pendingChanged.isEmpty()) {
+            outChanged.clear();
+            outChanged.swap(pendingChanged);
+            out->copyUnchecked(*pending, outChanged);
+
+            // post() may notify monitors of other PVs, so no lock held
+            UnGuard U(G);
+            group->post(*out, outChanged);
+        }
+    }catch(...){
+        flushing = false;
+        throw;
+    }
+    flushing = false;
+}
+
+} // namespace pvas
@@ -0,0 +1,150 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include <epicsMutex.h>
+#include <epicsGuard.h>
+
+#include <shareLib.h>
+#include <pv/sharedPtr.h>
+#include <pv/byteBuffer.h>
+#include <pv/serialize.h>
+#include <pv/bitSet.h>
+#include <pv/pvData.h>
+
+#define epicsExportSharedSymbols
+#include "sharedstateimpl.h"
+
+namespace pvas {
+namespace detail {
+
+VectorWriter::VectorWriter(std::vector<char>& out, char *scratch, size_t size)
+    :out(out)
+    ,buf(scratch, size)
+{}
+
+VectorWriter::~VectorWriter() {}
+
+void VectorWriter::flushSerializeBuffer()
+{
+    buf.flip();
+    out.insert(out.end(), buf.getBuffer(), buf.getBuffer()+buf.getLimit());
+    buf.clear();
+}
+
+void VectorWriter::ensureBuffer(std::size_t size)
+{
+    if(buf.getRemaining()<size)
+        flushSerializeBuffer();
+    if(buf.getRemaining()<size)
+        throw std::logic_error("Serialization buffer too small");
+}
+
+bool VectorWriter::directSerialize(pvd::ByteBuffer *existingBuffer, const char* toSerialize,
+                                   std::size_t elementCount, std::size_t elementSize)
+{
+    // large arrays skip the intermediate buffer
+    if(existingBuffer!=&buf || elementCount*elementSize < buf.getSize())
+        return false;
+    flushSerializeBuffer();
+    out.insert(out.end(), toSerialize, toSerialize + elementCount*elementSize);
+    return true;
+}
+
+void VectorWriter::cachedSerialize(std::tr1::shared_ptr<const pvd::Field> const & field, pvd::ByteBuffer* buffer)
+{
+    field->serialize(buffer, this);
+}
+
+BufferReader::~BufferReader() {}
+
+void BufferReader::ensureData(std::size_t size)
+{
+    if(buf.getRemaining()<size)
+        throw std::runtime_error("Truncated");
+}
+
+std::tr1::shared_ptr<const pvd::Field> BufferReader::cachedDeserialize(pvd::ByteBuffer* buffer)
+{
+    return pvd::getFieldCreate()->deserialize(buffer, this);
+}
+
+UpdateHistory::UpdateHistory(size_t capacity)
+    :ring(capacity)
+    ,first(0u)
+    ,count(0u)
+    ,scratch(16u*1024u)
+{}
+
+void UpdateHistory::reset(const pvd::PVStructure& value, const pvd::BitSet& valid)
+{
+    first = count = 0u;
+    base = pvd::getPVDataCreate()->createPVStructure(value.getStructure());
+    base->copyUnchecked(value, valid);
+    baseValid = valid;
+}
+
+void UpdateHistory::push(const pvd::PVStructure& value, const pvd::BitSet& changed)
+{
+    if(ring.empty() || !base)
+        return;
+
+    if(count==ring.size()) {
+        pvd::BitSet oldest;
+        decode(first, *base, oldest);
+        baseValid |= oldest;
+        first = (first+1u)%ring.size();
+        count--;
+    }
+
+    std::vector<char>& ent = ring[(first+count)%ring.size()];
+    ent.clear(); // keeps capacity
+
+    VectorWriter control(ent, &scratch[0], scratch.size());
+    changed.serialize(&control.buf, &control);
+    value.serialize(&control.buf, &control, &changed);
+    control.flushSerializeBuffer();
+
+    count++;
+}
+
+void UpdateHistory::decode(size_t idx, pvd::PVStructure& value, pvd::BitSet& changed) const
+{
+    const std::vector<char>& ent = ring[idx];
+    // ByteBuffer won't modify
+    pvd::ByteBuffer buf(const_cast<char*>(&ent[0]), ent.size());
+    BufferReader control(buf);
+    changed.deserialize(&buf, &control);
+    value.deserialize(&buf, &control, &changed);
+}
+
+bool UpdateHistory::replay(SharedMonitorFIFO& mon, size_t n)
+{
+    if(!count || !base || !n)
+        return false;
+    n = std::min(n, count);
+
+    pvd::PVStructurePtr value(pvd::getPVDataCreate()->createPVStructure(base->getStructure()));
+    value->copyUnchecked(*base);
+    pvd::BitSet valid(baseValid), changed;
+
+    for(size_t i=0; i<count; i++) {
+        decode((first+i)%ring.size(), *value, changed);
+        valid |= changed;
+
+        if(i+n==count) {
+            // first replayed includes everything before it
+            mon.tryPost(*value, valid, pvd::BitSet(), true);
+        } else if(i+n>count) {
+            mon.tryPost(*value, changed, pvd::BitSet(), true);
+        }
+    }
+    return true;
+}
+
+}} // namespace pvas::detail
@@ -0,0 +1,371 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+
+#include <epicsMutex.h>
+#include <epicsGuard.h>
+
+#include <shareLib.h>
+#include <pv/sharedPtr.h>
+#include <pv/sharedVector.h>
+#include <pv/bitSet.h>
+#include <pv/pvData.h>
+
+#define epicsExportSharedSymbols
+#include "sharedstateimpl.h"
+
+namespace {
+
+// which part of the input array contributes to the output
+struct Geometry {
+    size_t ncolor; // 1 (mono) or 3 (RGB1, color is the fastest dimension)
+    size_t width, height; // input, in pixels
+    size_t x0, y0; // start of ROI
+    size_t step; // decimation
+    size_t binx, biny;
+    size_t owidth, oheight; // output, in pixels
+};
+
+/* Each output pixel is the mean of binx*biny decimated input pixels.
+ * Input rows are visited in order, and each is read with a constant stride.
+ * Only the final conversion, and cropping without binning, touch contiguous memory.
+ */
+template<typename T>
+void binPixels(const T* in, T* out, const Geometry& g)
+{
+    const size_t rowlen = g.width*g.ncolor;
+    const size_t olen = g.owidth*g.ncolor;
+
+    if(g.step==1u && g.binx==1u && g.biny==1u) {
+        // crop only
+        for(size_t j=0; j<g.oheight; j++)
+            memcpy(out + j*olen, in + (g.y0 + j)*rowlen + g.x0*g.ncolor, olen*sizeof(T));
+        return;
+    }
+
+    const size_t pixstride = g.step*g.ncolor;
+    const double scale = 1.0/double(g.binx*g.biny);
+    std::vector<double> acc(olen);
+
+    for(size_t j=0; j<g.oheight; j++) {
+        std::fill(acc.begin(), acc.end(), 0.0);
+
+        for(size_t v=0; v<g.biny; v++) {
+            const T* row = in + (g.y0 + (j*g.biny + v)*g.step)*rowlen + g.x0*g.ncolor;
+
+            for(size_t u=0; u<g.binx; u++) {
+                const T* px = row + u*pixstride;
+                const size_t stride = g.binx*pixstride;
+                if(g.ncolor==1u) {
+                    for(size_t i=0; i<g.owidth; i++)
+                        acc[i] += px[i*stride];
+                } else {
+                    for(size_t i=0; i<g.owidth; i++)
+                        for(size_t c=0; c<g.ncolor; c++)
+                            acc[i*g.ncolor + c] += px[i*stride + c];
+                }
+            }
+        }
+
+        T* orow = out + j*olen;
+        for(size_t k=0; k<olen; k++)
+            orow[k] = T(acc[k]*scale);
+    }
+}
+
+template<typename T>
+pvd::PVFieldPtr transformArray(const pvd::PVScalarArray& in, const Geometry& g)
+{
+    typedef pvd::PVValueArray<T> array_t;
+
+    pvd::shared_vector<const T> src(static_cast<const array_t&>(in).view());
+    typename array_t::svector dest(g.owidth*g.oheight*g.ncolor);
+    if(!dest.empty())
+        binPixels(src.data(), dest.data(), g);
+
+    typename array_t::shared_pointer ret(pvd::getPVDataCreate()->createPVScalarArray<array_t>());
+    ret->replace(pvd::freeze(dest));
+    return ret;
+}
+
+pvd::PVFieldPtr transformValue(const pvd::PVScalarArray& in, const Geometry& g)
+{
+    switch(in.getScalarArray()->getElementType()) {
+#define CASE(TYPE, PVT) case pvd::PVT: return transformArray<pvd::TYPE>(in, g)
+    CASE(int8, pvByte);
+    CASE(int16, pvShort);
+    CASE(int32, pvInt);
+    CASE(int64, pvLong);
+    CASE(uint8, pvUByte);
+    CASE(uint16, pvUShort);
+    CASE(uint32, pvUInt);
+    CASE(uint64, pvULong);
+    CASE(float, pvFloat);
+    CASE(double, pvDouble);
+#undef CASE
+    default:
+        return pvd::PVFieldPtr(); // boolean or string
+    }
+}
+
+pvd::uint32 dimGet(const pvd::PVStructure& dim, const char *name, pvd::uint32 def)
+{
+    pvd::PVScalar::const_shared_pointer fld(dim.getSubField<pvd::PVScalar>(name));
+    return fld ? fld->getAs<pvd::uint32>() : def;
+}
+
+void dimPut(pvd::PVStructure& dim, const char *name, size_t val)
+{
+    pvd::PVScalar::shared_pointer fld(dim.getSubField<pvd::PVScalar>(name));
+    if(fld)
+        fld->putFrom<pvd::int32>(pvd::int32(val));
+}
+
+// is any field in [fld, end of fld) marked?
+bool anyChanged(const pvd::BitSet& changed, const pvd::PVField::const_shared_pointer& fld)
+{
+    if(!fld)
+        return false;
+    pvd::int32 bit = changed.nextSetBit(fld->getFieldOffset());
+    return bit>=0 && size_t(bit)<fld->getNextFieldOffset();
+}
+
+void parseList(const pvd::PVStructure& pvRequest, const char *name,
+               pvd::uint32 *vals, size_t nvals, size_t nmin)
+{
+    pvd::PVScalar::const_shared_pointer opt(pvRequest.getSubField<pvd::PVScalar>(std::string("record._options.")+name));
+    if(!opt)
+        return;
+
+    // eg. "2" or "2:4"
+    std::string str(opt->getAs<std::string>());
+    size_t n = 0;
+    const char *pos = str.c_str();
+    while(n<nvals) {
+        unsigned val;
+        int consumed = 0;
+        if(sscanf(pos, "%u%n", &val, &consumed)!=1 || *pos=='-')
+            break;
+        vals[n++] = val;
+        pos += consumed;
+        if(*pos!=':')
+            break;
+        pos++;
+    }
+    if(n<nmin || *pos!='\0') {
+        std::ostringstream msg;
+        msg<<"Invalid option "<<name<<"='"<<str<<"'";
+        throw std::runtime_error(msg.str());
+    }
+    if(n==1u && nvals==2u)
+        vals[1] = vals[0]; // square binning
+}
+
+} // namespace
+
+namespace pvas {
+namespace detail {
+
+ImageTransform::ImageTransform()
+    :decimate(1u)
+    ,computed(false)
+    ,generation(0u)
+    ,image(false)
+    ,recomputed(false)
+{
+    roi[0] = roi[1] = roi[2] = roi[3] = 0u;
+    bin[0] = bin[1] = 1u;
+}
+
+bool ImageTransform::parse(const pvd::PVStructure& pvRequest)
+{
+    pvd::PVStructure::const_shared_pointer options(pvRequest.getSubField<pvd::PVStructure>("record._options"));
+    if(!options || (!options->getSubField("roi") && !options->getSubField("bin") && !options->getSubField("decimate")))
+        return false;
+
+    parseList(pvRequest, "roi", roi, 4u, 4u);
+    parseList(pvRequest, "bin", bin, 2u, 1u);
+    parseList(pvRequest, "decimate", &decimate, 1u, 1u);
+
+    if(bin[0]==0u || bin[1]==0u || decimate==0u)
+        throw std::runtime_error("bin and decimate must be >= 1");
+    return true;
+}
+
+std::string ImageTransform::key() const
+{
+    std::ostringstream strm;
+    strm<<roi[0]<<':'<<roi[1]<<':'<<roi[2]<<':'<<roi[3]
+        <<'/'<<bin[0]<<':'<<bin[1]
+        <<'/'<<decimate;
+    return strm.str();
+}
+
+const pvd::PVStructure& ImageTransform::apply(const pvd::PVStructure& current,
+                                              const pvd::BitSet& changed,
+                                              size_t gen,
+                                              pvd::BitSet& outChanged)
+{
+    outChanged = changed;
+
+    if(!computed || gen!=generation || current.getStructure()!=type) {
+        bool fresh = current.getStructure()!=type;
+        if(fresh) {
+            type = current.getStructure();
+            const std::string& id = type->getID();
+            image = id.compare(0, 19, "epics:nt/NTNDArray:")==0
+                    && current.getSubField<pvd::PVUnion>("value")
+                    && current.getSubField<pvd::PVStructureArray>("dimension");
+            result.reset();
+            imageBits.clear();
+        }
+
+        computed = true;
+        generation = gen;
+        recomputed = false;
+
+        if(image) {
+            if(!result) {
+                result = pvd::getPVDataCreate()->createPVStructure(type);
+                result->copyUnchecked(current);
+                fresh = true;
+            } else {
+                result->copyUnchecked(current, changed);
+            }
+
+            if(fresh || changed.get(0)
+                    || anyChanged(changed, current.getSubField("value"))
+                    || anyChanged(changed, current.getSubField("dimension"))
+                    || anyChanged(changed, current.getSubField("codec")))
+            {
+                if(compute(current)) {
+                    recomputed = true;
+                } else {
+                    // not an image we can handle.  pass through unchanged
+                    result->copyUnchecked(current);
+                }
+            }
+        }
+    }
+
+    if(!image)
+        return current;
+
+    // the transformed image is only re-sent when it was re-computed
+    if(recomputed)
+        outChanged |= imageBits;
+    return *result;
+}
+
+bool ImageTransform::compute(const pvd::PVStructure& current)
+{
+    pvd::PVUnion::const_shared_pointer value(current.getSubFieldT<pvd::PVUnion>("value"));
+    pvd::PVStructureArray::const_shared_pointer dimension(current.getSubFieldT<pvd::PVStructureArray>("dimension"));
+
+    {
+        // compressed images are passed through
+        pvd::PVScalar::const_shared_pointer codec(current.getSubField<pvd::PVScalar>("codec.name"));
+        if(codec && !codec->getAs<std::string>().empty())
+            return false;
+    }
+
+    pvd::PVScalarArray::const_shared_pointer arr(std::tr1::dynamic_pointer_cast<const pvd::PVScalarArray>(value->get()));
+    if(!arr)
+        return false;
+
+    pvd::PVStructureArray::const_svector dims(dimension->view());
+    for(size_t i=0; i<dims.size(); i++)
+        if(!dims[i])
+            return false;
+
+    Geometry g;
+    size_t xdim, ydim;
+    if(dims.size()==2u) {
+        g.ncolor = 1u;
+        xdim = 0u;
+        ydim = 1u;
+    } else if(dims.size()==3u && dimGet(*dims[0], "size", 0u)==3u) {
+        g.ncolor = 3u; // RGB1
+        xdim = 1u;
+        ydim = 2u;
+    } else {
+        return false;
+    }
+
+    g.width = dimGet(*dims[xdim], "size", 0u);
+    g.height = dimGet(*dims[ydim], "size", 0u);
+    if(arr->getLength()!=g.ncolor*g.width*g.height)
+        return false;
+
+    g.x0 = std::min<size_t>(roi[0], g.width);
+    g.y0 = std::min<size_t>(roi[1], g.height);
+    size_t w = g.width - g.x0,
+           h = g.height - g.y0;
+    if(roi[2])
+        w = std::min<size_t>(w, roi[2]);
+    if(roi[3])
+        h = std::min<size_t>(h, roi[3]);
+
+    g.step = decimate;
+    g.binx = bin[0];
+    g.biny = bin[1];
+    g.owidth = (w + g.step - 1u)/g.step/g.binx;
+    g.oheight = (h + g.step - 1u)/g.step/g.biny;
+
+    pvd::PVFieldPtr out(transformValue(*arr, g));
+    if(!out)
+        return false;
+
+    result->getSubFieldT<pvd::PVUnion>("value")->set(value->getSelectedIndex(), out);
+
+    {
+        const pvd::StructureConstPtr dimtype(dimension->getStructureArray()->getStructure());
+        pvd::PVStructureArray::svector odims(dims.size());
+        for(size_t i=0; i<dims.size(); i++) {
+            odims[i] = pvd::getPVDataCreate()->createPVStructure(dimtype);
+            odims[i]->copyUnchecked(*dims[i]);
+        }
+
+        const size_t index[] = {xdim, ydim},
+                     origin[] = {g.x0, g.y0},
+                     osize[] = {g.owidth, g.oheight},
+                     factor[] = {g.step*g.binx, g.step*g.biny};
+        for(size_t d=0; d<2u; d++) {
+            pvd::PVStructure& dim = *odims[index[d]];
+            const pvd::uint32 binning = std::max(pvd::uint32(1u), dimGet(dim, "binning", 1u));
+            dimPut(dim, "size", osize[d]);
+            // offset and binning are relative to the sensor
+            dimPut(dim, "offset", dimGet(dim, "offset", 0u) + origin[d]*binning);
+            dimPut(dim, "binning", binning*factor[d]);
+        }
+
+        result->getSubFieldT<pvd::PVStructureArray>("dimension")->replace(pvd::freeze(odims));
+    }
+
+    const pvd::int64 nbytes = pvd::int64(g.owidth*g.oheight*g.ncolor
+                                         * pvd::ScalarTypeFunc::elementSize(arr->getScalarArray()->getElementType()));
+    const char *sizes[] = {"compressedSize", "uncompressedSize"};
+    for(size_t i=0; i<2u; i++) {
+        pvd::PVScalar::shared_pointer fld(result->getSubField<pvd::PVScalar>(sizes[i]));
+        if(fld) {
+            fld->putFrom<pvd::int64>(nbytes);
+            imageBits.set(fld->getFieldOffset());
+        }
+    }
+
+    imageBits.set(result->getSubFieldT<pvd::PVUnion>("value")->getFieldOffset());
+    imageBits.set(result->getSubFieldT<pvd::PVStructureArray>("dimension")->getFieldOffset());
+
+    return true;
+}
+
+}} // namespace pvas::detail
@@ -144,7 +144,7 @@ void SharedPut::put(
 
         if(handler) {
             Operation op(impl);
-            handler->onPut(channel->owner, op);
+            Strand::onPut(channel->owner, handler, op);
         }
     }
 }
@@ -21,6 +21,7 @@
 
 #define epicsExportSharedSymbols
 #include "sharedstateimpl.h"
+#include "pva/group.h"
 
 
 namespace {
@@ -55,6 +56,8 @@ void SharedPV::Handler::onRPC(const SharedPV::shared_pointer& pv, Operation& op)
 SharedPV::Config::Config()
     :dropEmptyUpdates(true)
     ,mapperMode(pvd::PVRequestMapper::Mask)
+    ,historySize(0u)
+    ,queueLimit(64u)
 {}
 
 size_t SharedPV::num_instances;
@@ -85,9 +88,14 @@ SharedPV::shared_pointer SharedPV::buildMailbox(pvas::SharedPV::Config *conf)
 SharedPV::SharedPV(const std::tr1::shared_ptr<Handler> &handler, pvas::SharedPV::Config *conf)
     :config(conf ? *conf : Config())
     ,handler(handler)
+    ,generation(0u)
     ,notifiedConn(false)
     ,debugLvl(0)
 {
+    if(config.historySize)
+        history.reset(new detail::UpdateHistory(config.historySize));
+    if(config.executor)
+        strand.reset(new detail::Strand(*config.executor, config.queueLimit));
     REFTRACE_INCREMENT(num_instances);
 }
 
@@ -161,6 +169,9 @@ void SharedPV::open(const pvd::PVStructure &value, const epics::pvData::BitSet&
         type = newtype;
         current = newvalue;
         this->valid = valid;
+        generation++;
+        if(history)
+            history->reset(*current, valid);
 
         FOR_EACH(puts_t::const_iterator, it, end, puts) {
             if((*it)->channel->dead) continue;
@@ -194,7 +205,7 @@ void SharedPV::open(const pvd::PVStructure &value, const epics::pvData::BitSet&
             }
             (*it)->open(newtype);
             // post initial update
-            (*it)->post(*current, valid);
+            (*it)->postUpdate(*current, valid);
             p_monitor.push_back(self);
         }
         // consume getField
@@ -317,7 +328,7 @@ void SharedPV::realClose(bool destroy, bool closing, const epics::pvAccess::Chan
     }
     if(p_handler) {
         shared_pointer self(internal_self);
-        p_handler->onLastDisconnect(self);
+        detail::Strand::onLastDisconnect(self, p_handler);
     }
 }
 
@@ -334,6 +345,8 @@ void SharedPV::post(const pvd::PVStructure& value,
 {
     typedef std::vector<std::tr1::shared_ptr<pva::MonitorFIFO> > xmonitors_t;
     xmonitors_t p_monitor;
+    typedef std::vector<std::pair<std::tr1::shared_ptr<SharedPVGroup>, size_t> > xgroups_t;
+    xgroups_t p_group;
     {
         Guard I(mutex);
 
@@ -346,6 +359,9 @@ void SharedPV::post(const pvd::PVStructure& value,
             current->copyUnchecked(value, changed);
             valid |= changed;
         }
+        generation++;
+        if(history)
+            history->push(value, changed);
 
         p_monitor.reserve(monitors.size()); // ick, for lack of a list with thread-safe iteration
 
@@ -356,13 +372,22 @@ void SharedPV::post(const pvd::PVStructure& value,
             }catch(std::tr1::bad_weak_ptr&) {
                 continue; //racing destruction
             }
-            (*it)->post(value, changed);
+            (*it)->postUpdate(value, changed);
             p_monitor.push_back(self);
         }
+
+        FOR_EACH(groups_t::const_iterator, it, end, groups) {
+            std::tr1::shared_ptr<SharedPVGroup> grp(it->first.lock());
+            if(grp)
+                p_group.push_back(std::make_pair(grp, it->second));
+        }
     }
     FOR_EACH(xmonitors_t::iterator, it, end, p_monitor) {
         (*it)->notify();
     }
+    FOR_EACH(xgroups_t::iterator, it, end, p_group) {
+        it->first->memberPosted(it->second, value, changed);
+    }
 }
 
 void SharedPV::fetch(epics::pvData::PVStructure& value, epics::pvData::BitSet& valid)
@@ -136,7 +136,7 @@ void SharedRPC::request(epics::pvData::PVStructure::shared_pointer const & pvArg
 
         if(handler) {
             Operation op(impl);
-            handler->onRPC(channel->owner, op);
+            Strand::onRPC(channel->owner, handler, op);
         }
     }
 }
@@ -0,0 +1,339 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#if !defined(_WIN32) && !defined(__rtems__) && !defined(vxWorks)
+#  include <sys/types.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#  define USE_MMAP
+#endif
+
+#include <epicsMutex.h>
+#include <epicsGuard.h>
+#include <epicsEndian.h>
+
+#include <shareLib.h>
+#include <pv/sharedPtr.h>
+#include <pv/byteBuffer.h>
+#include <pv/serialize.h>
+#include <pv/serializeHelper.h>
+#include <pv/pvData.h>
+#include <pv/timer.h>
+
+#define epicsExportSharedSymbols
+#include <pv/logger.h>
+#include "sharedstateimpl.h"
+#include "pva/snapshot.h"
+
+namespace {
+
+// version is the last byte
+const char magic[8] = {'P', 'V', 'A', 'S', 'N', 'A', 'P', 1};
+
+// The contents of a file.  Mapped where possible.
+struct FileContents
+{
+    const char *data;
+    size_t size;
+#ifdef USE_MMAP
+    void *mapped;
+#endif
+    std::vector<char> storage;
+
+    FileContents()
+        :data(0)
+        ,size(0u)
+#ifdef USE_MMAP
+        ,mapped(MAP_FAILED)
+#endif
+    {}
+    ~FileContents()
+    {
+#ifdef USE_MMAP
+        if(mapped!=MAP_FAILED)
+            munmap(mapped, size);
+#endif
+    }
+
+    // returns false if the file can not be opened
+    bool open(const std::string& fname)
+    {
+#ifdef USE_MMAP
+        int fd = ::open(fname.c_str(), O_RDONLY);
+        if(fd<0)
+            return false;
+        struct stat info;
+        if(fstat(fd, &info)==0 && info.st_size>0) {
+            mapped = mmap(0, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if(mapped!=MAP_FAILED) {
+                data = static_cast<const char*>(mapped);
+                size = size_t(info.st_size);
+            }
+        }
+        ::close(fd);
+        if(mapped!=MAP_FAILED)
+            return true;
+        // fall back to read()
+#endif
+        std::ifstream strm(fname.c_str(), std::ios::in | std::ios::binary);
+        if(!strm.is_open())
+            return false;
+        storage.assign(std::istreambuf_iterator<char>(strm), std::istreambuf_iterator<char>());
+        data = storage.empty() ? 0 : &storage[0];
+        size = storage.size();
+        return true;
+    }
+};
+
+// PV value to be saved
+struct Current {
+    std::string name;
+    pvd::PVStructurePtr value;
+    pvd::BitSet valid;
+    size_t generation;
+};
+
+} // namespace
+
+namespace pvas {
+
+struct SharedPVSnapshot::Saver : public pvd::TimerCallback
+{
+    SharedPVSnapshot * const owner;
+    explicit Saver(SharedPVSnapshot *owner) :owner(owner) {}
+    virtual ~Saver() {}
+
+    virtual void callback() OVERRIDE FINAL
+    {
+        try {
+            owner->save();
+        }catch(std::exception& e){
+            LOG(pva::logLevelError, "Error saving snapshot %s : %s", owner->fname.c_str(), e.what());
+        }
+    }
+    virtual void timerStopped() OVERRIDE FINAL {}
+};
+
+SharedPVSnapshot::SharedPVSnapshot(const std::string& fname)
+    :fname(fname)
+    ,dirty(false)
+{}
+
+SharedPVSnapshot::~SharedPVSnapshot()
+{
+    stop();
+    // joins timer thread
+    timer.reset();
+}
+
+size_t SharedPVSnapshot::load()
+{
+    saved_t fromfile;
+
+    FileContents contents;
+    if(contents.open(fname) && contents.size) {
+        try {
+            if(contents.size<sizeof(magic)+1u || memcmp(contents.data, magic, sizeof(magic))!=0)
+                throw std::runtime_error("Not a snapshot file, or unsupported version");
+
+            const int order = contents.data[sizeof(magic)] ? EPICS_ENDIAN_BIG : EPICS_ENDIAN_LITTLE;
+            const size_t header = sizeof(magic)+1u;
+
+            // ByteBuffer won't modify
+            pvd::ByteBuffer buf(const_cast<char*>(contents.data)+header, contents.size-header, order);
+            detail::BufferReader control(buf);
+
+            const size_t count = pvd::SerializeHelper::readSize(&buf, &control);
+            for(size_t i=0; i<count; i++) {
+                std::string name(pvd::SerializeHelper::deserializeString(&buf, &control));
+
+                pvd::FieldConstPtr type(control.cachedDeserialize(&buf));
+                if(!type || type->getType()!=pvd::structure)
+                    throw std::runtime_error("Entry type must be a Structure");
+
+                Saved& ent = fromfile[name];
+                ent.valid.deserialize(&buf, &control);
+                ent.value = pvd::getPVDataCreate()->createPVStructure(std::tr1::static_pointer_cast<const pvd::Structure>(type));
+                ent.value->deserialize(&buf, &control, &ent.valid);
+            }
+
+        }catch(std::exception& e){
+            LOG(pva::logLevelWarn, "Ignoring invalid snapshot %s : %s", fname.c_str(), e.what());
+            fromfile.clear();
+        }
+    }
+
+    Guard G(mutex);
+    saved.swap(fromfile);
+    return saved.size();
+}
+
+bool SharedPVSnapshot::add(const std::string& name, const SharedPV::shared_pointer& pv)
+{
+    Saved restore;
+    {
+        Guard G(mutex);
+        Entry& ent = entries[name];
+        ent.pv = pv;
+        ent.generation = size_t(-1);
+        dirty = true;
+
+        saved_t::const_iterator it(saved.find(name));
+        if(it!=saved.end())
+            restore = it->second;
+    }
+
+    if(restore.value && !pv->isOpen()) {
+        try {
+            pv->open(*restore.value, restore.valid);
+            return true;
+        }catch(std::logic_error&){
+            // racing with another open()
+        }
+    }
+    return false;
+}
+
+void SharedPVSnapshot::remove(const std::string& name)
+{
+    Guard G(mutex);
+    if(entries.erase(name))
+        dirty = true;
+}
+
+size_t SharedPVSnapshot::size() const
+{
+    Guard G(mutex);
+    return entries.size();
+}
+
+void SharedPVSnapshot::save(bool force)
+{
+    std::vector<Current> pvs;
+    {
+        Guard G(mutex);
+        bool changed = force || dirty;
+
+        // only compare generations before copying anything
+        for(entries_t::const_iterator it(entries.begin()), end(entries.end()); !changed && it!=end; ++it) {
+            SharedPV::shared_pointer pv(it->second.pv.lock());
+            if(!pv)
+                continue;
+
+            Guard P(pv->mutex);
+            changed = pv->type && pv->generation!=it->second.generation;
+        }
+
+        if(!changed)
+            return;
+        dirty = false;
+
+        pvs.reserve(entries.size());
+        for(entries_t::const_iterator it(entries.begin()), end(entries.end()); it!=end; ++it) {
+            SharedPV::shared_pointer pv(it->second.pv.lock());
+            if(!pv)
+                continue;
+
+            // light-weight copy
+            Guard P(pv->mutex);
+            if(!pv->type)
+                continue;
+            pvs.push_back(Current());
+            Current& cur = pvs.back();
+            cur.name = it->first;
+            cur.value = pvd::getPVDataCreate()->createPVStructure(pv->type);
+            cur.value->copyUnchecked(*pv->current);
+            cur.valid = pv->valid;
+            cur.generation = pv->generation;
+        }
+    }
+
+    std::vector<char> out;
+    out.insert(out.end(), magic, magic+sizeof(magic));
+    out.push_back(EPICS_BYTE_ORDER==EPICS_ENDIAN_BIG ? 1 : 0);
+    {
+        std::vector<char> storage(64u*1024u);
+        detail::VectorWriter control(out, &storage[0], storage.size());
+        pvd::SerializeHelper::writeSize(pvs.size(), &control.buf, &control);
+        for(size_t i=0; i<pvs.size(); i++) {
+            pvd::SerializeHelper::serializeString(pvs[i].name, &control.buf, &control);
+            control.cachedSerialize(pvs[i].value->getStructure(), &control.buf);
+            pvs[i].valid.serialize(&control.buf, &control);
+            pvs[i].value->serialize(&control.buf, &control, &pvs[i].valid);
+        }
+        control.flushSerializeBuffer();
+    }
+
+    // write to a temporary and rename, so that readers never see a partial file
+    std::string tmpname(fname+".tmp");
+    {
+        std::ofstream strm(tmpname.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+        if(!strm.is_open())
+            throw std::runtime_error("Unable to write "+tmpname);
+        strm.write(&out[0], out.size());
+        strm.flush();
+        if(!strm.good()) {
+            ::remove(tmpname.c_str());
+            throw std::runtime_error("Error writing "+tmpname);
+        }
+    }
+
+    if(::rename(tmpname.c_str(), fname.c_str())) {
+        // WIN32 rename() won't replace an existing file
+        ::remove(fname.c_str());
+        if(::rename(tmpname.c_str(), fname.c_str())) {
+            ::remove(tmpname.c_str());
+            throw std::runtime_error("Unable to replace "+fname);
+        }
+    }
+
+    {
+        Guard G(mutex);
+        for(size_t i=0; i<pvs.size(); i++) {
+            entries_t::iterator it(entries.find(pvs[i].name));
+            if(it!=entries.end())
+                it->second.generation = pvs[i].generation;
+        }
+    }
+}
+
+void SharedPVSnapshot::start(double period)
+{
+    if(period<=0.0)
+        throw std::invalid_argument("Snapshot period must be positive");
+
+    stop();
+
+    Guard G(mutex);
+    if(!timer)
+        timer.reset(new pvd::Timer("pvasSnapshot", pvd::lowPriority));
+    saver.reset(new Saver(this));
+    timer->schedulePeriodic(saver, period, period);
+}
+
+void SharedPVSnapshot::stop()
+{
+    pvd::Timer::shared_pointer T;
+    std::tr1::shared_ptr<Saver> S;
+    {
+        Guard G(mutex);
+        T = timer;
+        S.swap(saver);
+    }
+    if(T && S)
+        T->cancel(S);
+}
+
+} // namespace pvas
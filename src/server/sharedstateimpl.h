@@ -5,7 +5,12 @@
 #ifndef SHAREDSTATEIMPL_H
 #define SHAREDSTATEIMPL_H
 
+#include <vector>
+#include <deque>
+
 #include <pv/createRequest.h>
+#include <pv/byteBuffer.h>
+#include <pv/serialize.h>
 
 #include "pva/sharedstate.h"
 #include <pv/pvAccess.h>
@@ -61,16 +66,142 @@ struct SharedChannel : public pva::Channel,
     virtual pva::Monitor::shared_pointer createMonitor(
             pva::MonitorRequester::shared_pointer const & requester,
             pvd::PVStructure::shared_pointer const & pvRequest) OVERRIDE FINAL;
+
+    virtual pva::ChannelArray::shared_pointer createChannelArray(
+            pva::ChannelArrayRequester::shared_pointer const & requester,
+            pvd::PVStructure::shared_pointer const & pvRequest) OVERRIDE FINAL;
+};
+
+/** Server side region of interest, decimation, and binning of an NTNDArray.
+ *
+ * Selected by pvRequest options record._options.roi, .bin, and .decimate .
+ * One instance is shared by all subscribers to a SharedPV with the same options,
+ * and computed once for each post().
+ * Guarded by PV mutex.
+ */
+struct ImageTransform
+{
+    pvd::uint32 roi[4]; // x, y, width, height.  width/height 0 extends to the edge
+    pvd::uint32 bin[2]; // x, y
+    pvd::uint32 decimate;
+
+    ImageTransform();
+
+    //! Parse options from pvRequest.
+    //! @returns false if no options were given
+    //! @throws std::runtime_error for invalid options
+    bool parse(const pvd::PVStructure& pvRequest);
+    //! Identifies options equivalent to ours
+    std::string key() const;
+
+    /** Transform the complete PV value.
+     *
+     * @param current Complete PV value, already updated.
+     * @param changed Fields updated since the previous call
+     * @param generation Result is re-used until this changes
+     * @param outChanged Set to the fields of the returned structure to post()
+     * @returns current if the PV is not an NTNDArray, or a transformed copy
+     */
+    const pvd::PVStructure& apply(const pvd::PVStructure& current,
+                                  const pvd::BitSet& changed,
+                                  size_t generation,
+                                  pvd::BitSet& outChanged);
+private:
+    bool compute(const pvd::PVStructure& current);
+
+    bool computed;
+    size_t generation;
+    pvd::StructureConstPtr type;
+    bool image; // is type an NTNDArray
+    pvd::PVStructurePtr result;
+    pvd::BitSet imageBits; // fields of result replaced by compute()
+    bool recomputed; // compute() ran for 'generation'
+
+    EPICS_NOT_COPYABLE(ImageTransform)
+};
+
+//! Serialize, in native byte order, to the end of a vector.
+//! Small items are collected in the caller provided scratch buffer.
+struct VectorWriter : public pvd::SerializableControl
+{
+    std::vector<char>& out;
+    pvd::ByteBuffer buf;
+
+    VectorWriter(std::vector<char>& out, char *scratch, size_t size);
+    virtual ~VectorWriter();
+
+    virtual void flushSerializeBuffer() OVERRIDE FINAL;
+    virtual void ensureBuffer(std::size_t size) OVERRIDE FINAL;
+    virtual void alignBuffer(std::size_t) OVERRIDE FINAL {}
+    virtual bool directSerialize(pvd::ByteBuffer *existingBuffer, const char* toSerialize,
+                                 std::size_t elementCount, std::size_t elementSize) OVERRIDE FINAL;
+    virtual void cachedSerialize(std::tr1::shared_ptr<const pvd::Field> const & field, pvd::ByteBuffer* buffer) OVERRIDE FINAL;
+};
+
+//! Deserialize from a complete buffer, as written by VectorWriter
+struct BufferReader : public pvd::DeserializableControl
+{
+    const pvd::ByteBuffer& buf;
+    explicit BufferReader(const pvd::ByteBuffer& buf) :buf(buf) {}
+    virtual ~BufferReader();
+
+    virtual void ensureData(std::size_t size) OVERRIDE FINAL;
+    virtual void alignData(std::size_t) OVERRIDE FINAL {}
+    virtual bool directDeserialize(pvd::ByteBuffer *, char*, std::size_t, std::size_t) OVERRIDE FINAL { return false; }
+    virtual std::tr1::shared_ptr<const pvd::Field> cachedDeserialize(pvd::ByteBuffer* buffer) OVERRIDE FINAL;
+};
+
+struct SharedMonitorFIFO;
+
+/** The most recent post() updates of a SharedPV, to be replayed to new subscribers.
+ *
+ * Each update is stored encoded as its changed mask, and the values of those fields.
+ * Storage is a ring of entries whose buffers are re-used.
+ * The value before the oldest entry is kept as the base of replay.
+ * Caller must hold the PV mutex.
+ */
+struct UpdateHistory
+{
+    explicit UpdateHistory(size_t capacity);
+
+    //! open().  Forget all updates, and begin from this value.
+    void reset(const pvd::PVStructure& value, const pvd::BitSet& valid);
+    //! post().  If full, the oldest update is folded into the base.
+    void push(const pvd::PVStructure& value, const pvd::BitSet& changed);
+    /** Post the last 'count' updates to a new subscriber.
+     * The first includes all fields valid at that time.
+     * @returns false, having done nothing, when no updates are stored.
+     */
+    bool replay(SharedMonitorFIFO& mon, size_t count);
+
+    size_t size() const { return count; }
+private:
+    void decode(size_t idx, pvd::PVStructure& value, pvd::BitSet& changed) const;
+
+    std::vector<std::vector<char> > ring;
+    size_t first, count;
+    std::vector<char> scratch;
+
+    pvd::PVStructurePtr base;
+    pvd::BitSet baseValid;
+
+    EPICS_NOT_COPYABLE(UpdateHistory)
 };
 
 struct SharedMonitorFIFO : public pva::MonitorFIFO
 {
     const std::tr1::shared_ptr<SharedChannel> channel;
+    // NULL unless requested.  const after SharedChannel::createMonitor()
+    std::tr1::shared_ptr<ImageTransform> transform;
     SharedMonitorFIFO(const std::tr1::shared_ptr<SharedChannel>& channel,
                       const requester_type::shared_pointer& requester,
                       const pvd::PVStructure::const_shared_pointer &pvRequest,
                       Config *conf);
     virtual ~SharedMonitorFIFO();
+
+    //! post() an update of the owning PV, through our transform (if any).
+    //! Caller must hold PV mutex.
+    void postUpdate(const pvd::PVStructure& value, const pvd::BitSet& changed);
 };
 
 struct SharedPut : public pva::ChannelPut,
@@ -126,6 +257,76 @@ struct SharedRPC : public pva::ChannelRPC,
     virtual void request(epics::pvData::PVStructure::shared_pointer const & pvArgument) OVERRIDE FINAL;
 };
 
+/** Read-only ChannelArray of the 'value' field, which must be a scalar array.
+ *
+ * getArray() returns a slice of the current value, without copying when stride is 1.
+ */
+struct SharedArray : public pva::ChannelArray,
+                     public std::tr1::enable_shared_from_this<SharedArray>
+{
+    const std::tr1::shared_ptr<SharedChannel> channel;
+    const requester_type::weak_pointer requester;
+
+    static size_t num_instances;
+
+    SharedArray(const std::tr1::shared_ptr<SharedChannel>& channel,
+                const requester_type::shared_pointer& requester);
+    virtual ~SharedArray();
+
+    virtual void destroy() OVERRIDE FINAL;
+    virtual std::tr1::shared_ptr<pva::Channel> getChannel() OVERRIDE FINAL;
+    virtual void cancel() OVERRIDE FINAL;
+    virtual void lastRequest() OVERRIDE FINAL;
+
+    virtual void putArray(pvd::PVArray::shared_pointer const & putArray,
+                          size_t offset, size_t count, size_t stride) OVERRIDE FINAL;
+    virtual void getArray(size_t offset, size_t count, size_t stride) OVERRIDE FINAL;
+    virtual void getLength() OVERRIDE FINAL;
+    virtual void setLength(size_t length) OVERRIDE FINAL;
+
+    //! The 'value' field of the current value.  Caller must hold PV mutex.
+    //! @returns NULL, with an error in sts, if closed or not a scalar array
+    pvd::PVScalarArray::const_shared_pointer current(pvd::Status& sts) const;
+};
+
+//! Handler callbacks of one SharedPV, run by an Executor in order and one at a time.
+struct Strand : public std::tr1::enable_shared_from_this<Strand>
+{
+    struct Work {
+        bool limited; // a Put or RPC.  counted in 'waiting'
+        Work() :limited(false) {}
+        virtual ~Work() {}
+        virtual void run() =0;
+    };
+
+    const std::tr1::shared_ptr<ExecutorImpl> executor;
+    const size_t limit;
+
+    // guarded by executor->mutex
+    std::deque<std::tr1::shared_ptr<Work> > queue;
+    size_t waiting; // # of limited in queue
+    bool scheduled; // in executor->ready, or running
+
+    Strand(const Executor& exec, size_t limit);
+
+    //! Queue to our Executor, or run now if it is closed.
+    //! @returns false if limited and already 'limit' others are waiting.
+    bool submit(const std::tr1::shared_ptr<Work>& work, bool limited);
+
+    // Call Handler methods directly, or through the Strand of the PV
+    static void onFirstConnect(const std::tr1::shared_ptr<SharedPV>& pv,
+                               const std::tr1::shared_ptr<SharedPV::Handler>& handler);
+    //! pv may be NULL (from ~SharedPV), in which case handler is called directly
+    static void onLastDisconnect(const std::tr1::shared_ptr<SharedPV>& pv,
+                                 const std::tr1::shared_ptr<SharedPV::Handler>& handler);
+    static void onPut(const std::tr1::shared_ptr<SharedPV>& pv,
+                      const std::tr1::shared_ptr<SharedPV::Handler>& handler,
+                      Operation& op);
+    static void onRPC(const std::tr1::shared_ptr<SharedPV>& pv,
+                      const std::tr1::shared_ptr<SharedPV::Handler>& handler,
+                      Operation& op);
+};
+
 } // namespace detail
 
 struct Operation::Impl
@@ -4,6 +4,10 @@
  * in file LICENSE that is included with this distribution.
  */
 
+#include <epicsGuard.h>
+#include <epicsThread.h>
+#include <epicsEndian.h>
+
 #define epicsExportSharedSymbols
 #include <pv/introspectionRegistry.h>
 #include <pv/serializationHelper.h>
@@ -12,12 +16,108 @@ using namespace epics::pvData;
 using namespace std;
 using std::tr1::static_pointer_cast;
 
+typedef epicsGuard<epicsMutex> Guard;
+
+namespace {
+using namespace epics::pvAccess;
+
+// feeds the serialized form of a type through FNV-1a
+struct HashControl : public SerializableControl
+{
+    uint64 value;
+    char scratch[256];
+    ByteBuffer buf;
+
+    HashControl()
+        :value(14695981039346656037ull)
+        // fixed byte order, so that peers of differing endianness agree
+        ,buf(scratch, sizeof(scratch), EPICS_ENDIAN_BIG)
+    {}
+    virtual ~HashControl() {}
+
+    virtual void flushSerializeBuffer() OVERRIDE FINAL
+    {
+        buf.flip();
+        const char *bytes = buf.getBuffer();
+        for(size_t i=0, N=buf.getLimit(); i<N; i++) {
+            value ^= uint8(bytes[i]);
+            value *= 1099511628211ull;
+        }
+        buf.clear();
+    }
+    virtual void ensureBuffer(std::size_t size) OVERRIDE FINAL
+    {
+        if(buf.getRemaining()<size)
+            flushSerializeBuffer();
+    }
+    virtual void alignBuffer(std::size_t) OVERRIDE FINAL {}
+    virtual bool directSerialize(ByteBuffer *, const char*, std::size_t, std::size_t) OVERRIDE FINAL { return false; }
+    virtual void cachedSerialize(std::tr1::shared_ptr<const Field> const & field, ByteBuffer* buffer) OVERRIDE FINAL
+    {
+        field->serialize(buffer, this);
+    }
+};
+
+epicsThreadOnceId clientDictionaryOnce = EPICS_THREAD_ONCE_INIT;
+TypeDictionary::shared_pointer *clientDictionary;
+
+void clientDictionaryInit(void *)
+{
+    clientDictionary = new TypeDictionary::shared_pointer(new TypeDictionary);
+}
+
+} // namespace
+
 namespace epics {
 namespace pvAccess {
 
+uint64 TypeDictionary::hash(const Field& field)
+{
+    HashControl control;
+    field.serialize(&control.buf, &control);
+    control.flushSerializeBuffer();
+    return control.value;
+}
+
+TypeDictionary::shared_pointer TypeDictionary::clients()
+{
+    epicsThreadOnce(&clientDictionaryOnce, &clientDictionaryInit, 0);
+    return *clientDictionary;
+}
+
+void TypeDictionary::add(uint64 hash, FieldConstPtr const & field)
+{
+    Guard G(mutex);
+    if(fields.size()<maxSize)
+        fields.insert(std::make_pair(hash, field));
+}
+
+FieldConstPtr TypeDictionary::find(uint64 hash) const
+{
+    Guard G(mutex);
+    fields_t::const_iterator it(fields.find(hash));
+    return it==fields.end() ? FieldConstPtr() : it->second;
+}
+
+void TypeDictionary::hashes(hashes_t& out) const
+{
+    Guard G(mutex);
+    out.clear();
+    out.reserve(fields.size());
+    for(fields_t::const_iterator it(fields.begin()), end(fields.end()); it!=end; ++it)
+        out.push_back(it->first);
+}
+
+size_t TypeDictionary::size() const
+{
+    Guard G(mutex);
+    return fields.size();
+}
+
 const int8 IntrospectionRegistry::NULL_TYPE_CODE = (int8)-1;
 const int8 IntrospectionRegistry::ONLY_ID_TYPE_CODE = (int8)-2;
 const int8 IntrospectionRegistry::FULL_WITH_ID_TYPE_CODE = (int8)-3;
+const int8 IntrospectionRegistry::ONLY_HASH_TYPE_CODE = (int8)-5;
 FieldCreatePtr IntrospectionRegistry::_fieldCreate(getFieldCreate());
 
 IntrospectionRegistry::IntrospectionRegistry()
@@ -34,6 +134,19 @@ void IntrospectionRegistry::reset()
 {
     _pointer = 1;
     _registry.clear();
+    _dictionary.reset();
+    _peerHashes.clear();
+}
+
+void IntrospectionRegistry::setDictionary(TypeDictionary::shared_pointer const & dict)
+{
+    _dictionary = dict;
+}
+
+void IntrospectionRegistry::setPeerHashes(TypeDictionary::hashes_t const & hashes)
+{
+    _peerHashes.clear();
+    _peerHashes.insert(hashes.begin(), hashes.end());
 }
 
 int16 IntrospectionRegistry::registerIntrospectionInterface(FieldConstPtr const & field, bool& existing)
@@ -89,11 +202,20 @@ void IntrospectionRegistry::serialize(FieldConstPtr const & field, ByteBuffer* b
                 buffer->putShort(key);
                 return;
             }
-            else {
-                control->ensureBuffer(3);
-                buffer->putByte(FULL_WITH_ID_TYPE_CODE);    // could also be a mask
-                buffer->putShort(key);
+            else if(!_peerHashes.empty()) {
+                const uint64 hash = TypeDictionary::hash(*field);
+                if(_peerHashes.find(hash)!=_peerHashes.end()) {
+                    control->ensureBuffer(3+8);
+                    buffer->putByte(ONLY_HASH_TYPE_CODE);
+                    buffer->putShort(key);
+                    buffer->putLong(int64(hash));
+                    return;
+                }
             }
+
+            control->ensureBuffer(3);
+            buffer->putByte(FULL_WITH_ID_TYPE_CODE);    // could also be a mask
+            buffer->putShort(key);
         }
 
         field->serialize(buffer, control);
@@ -131,6 +253,25 @@ FieldConstPtr IntrospectionRegistry::deserialize(ByteBuffer* buffer, Deserializa
         const short key = buffer->getShort();
         FieldConstPtr field = _fieldCreate->deserialize(buffer, control);
         _registry[key] = field;
+        if(_dictionary && field)
+            _dictionary->add(TypeDictionary::hash(*field), field);
+        return field;
+    }
+    else if(typeCode == IntrospectionRegistry::ONLY_HASH_TYPE_CODE)
+    {
+        control->ensureData(sizeof(int16)+sizeof(int64));
+        const short key = buffer->getShort();
+        const uint64 hash = uint64(buffer->getLong());
+        FieldConstPtr field;
+        if(_dictionary)
+            field = _dictionary->find(hash);
+        if(!field)
+        {
+            // peer referred to a type we never announced.
+            // This isn't recoverable.
+            throw std::runtime_error("IntrospectionRegistry hash miss.");
+        }
+        _registry[key] = field;
         return field;
     }
 
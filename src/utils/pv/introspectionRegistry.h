@@ -8,6 +8,8 @@
 #define INTROSPECTIONREGISTRY_H
 
 #include <map>
+#include <set>
+#include <vector>
 #include <iostream>
 
 #ifdef epicsExportSharedSymbols
@@ -29,6 +31,8 @@
 #       undef introspectionRegistryEpicsExportSharedSymbols
 #endif
 
+#include <pv/pvaDefs.h>
+
 // TODO check for memory leaks
 
 namespace epics {
@@ -36,13 +40,52 @@ namespace pvAccess {
 
 typedef std::map<const short,epics::pvData::FieldConstPtr> registryMap_t;
 
+/**
+ * Content addressed cache of introspection interfaces, keyed by a hash of their serialized form.
+ *
+ * Clients share one, which outlives individual connections, and servers.
+ * As entries are keyed by content, a server which restarts, or another server
+ * with the same types, benefits equally.
+ * With $EPICS_PVA_TYPE_CACHE set on both peers, a client tells a (re)connecting server
+ * which types it already knows, which the server then refers to by hash instead of
+ * sending them in full.
+ */
+class epicsShareClass TypeDictionary {
+    EPICS_NOT_COPYABLE(TypeDictionary)
+public:
+    POINTER_DEFINITIONS(TypeDictionary);
+    typedef std::vector<epics::pvData::uint64> hashes_t;
+
+    //! Upper limit on entries, and so on the hash list sent during connection validation.
+    static const size_t maxSize = 1024u;
+
+    //! Hash (64-bit FNV-1a) of the complete serialized form of a type, which is byte order independent.
+    static epics::pvData::uint64 hash(const epics::pvData::Field& field);
+
+    //! The dictionary shared by all client connections.
+    static shared_pointer clients();
+
+    TypeDictionary() {}
+
+    //! Entries are never removed, so a hash once announced remains valid.
+    void add(epics::pvData::uint64 hash, epics::pvData::FieldConstPtr const & field);
+    epics::pvData::FieldConstPtr find(epics::pvData::uint64 hash) const;
+    void hashes(hashes_t& out) const;
+    size_t size() const;
+
+private:
+    mutable epicsMutex mutex;
+    typedef std::map<epics::pvData::uint64, epics::pvData::FieldConstPtr> fields_t;
+    fields_t fields;
+};
+
 
 /**
  * PVData Structure registry.
  * Registry is used to cache introspection interfaces to minimize network traffic.
  * @author gjansa
  */
-class IntrospectionRegistry {
+class epicsShareClass IntrospectionRegistry {
     EPICS_NOT_COPYABLE(IntrospectionRegistry)
 public:
     IntrospectionRegistry();
@@ -53,6 +96,18 @@ public:
      */
     void reset();
 
+    /**
+     * Incoming side.  Types received in full are added to this dictionary,
+     * and references by hash are resolved from it.
+     */
+    void setDictionary(TypeDictionary::shared_pointer const & dict);
+
+    /**
+     * Outgoing side.  Types with these hashes are known to the peer,
+     * and will be sent as <code>ONLY_HASH</code>.
+     */
+    void setPeerHashes(TypeDictionary::hashes_t const & hashes);
+
 private:
     /**
      * Registers introspection interface and get it's ID. Always OUTGOING.
@@ -102,10 +157,19 @@ public:
      */
     const static epics::pvData::int8 FULL_WITH_ID_TYPE_CODE;
 
+    /**
+     * Serialization contains an ID (as <code>FULL_WITH_ID</code>) and a <code>TypeDictionary</code> hash
+     * in place of the interface description.  Only sent to peers which announced knowing the hash.
+     */
+    const static epics::pvData::int8 ONLY_HASH_TYPE_CODE;
+
 private:
     registryMap_t _registry;
     epics::pvData::int16 _pointer;
 
+    TypeDictionary::shared_pointer _dictionary;
+    std::set<epics::pvData::uint64> _peerHashes;
+
     /**
      * Field factory.
      */
@@ -0,0 +1,73 @@
+/**
+ * Copyright - See the COPYRIGHT that is included with this distribution.
+ * pvAccessCPP is distributed subject to a Software License Agreement found
+ * in file LICENSE that is included with this distribution.
+ */
+
+#ifndef SCRATCHPOOL_H
+#define SCRATCHPOOL_H
+
+#ifdef epicsExportSharedSymbols
+#   define scratchPoolExportSharedSymbols
+#   undef epicsExportSharedSymbols
+#endif
+
+#include <pv/sharedPtr.h>
+#include <pv/noDefaultMethods.h>
+#include <pv/pvIntrospect.h>
+#include <pv/pvData.h>
+#include <pv/bitSet.h>
+
+#ifdef scratchPoolExportSharedSymbols
+#   define epicsExportSharedSymbols
+#   undef scratchPoolExportSharedSymbols
+#endif
+
+#include <shareLib.h>
+
+namespace epics {
+namespace pvAccess {
+
+/** @brief Pool of transient PVStructure and BitSet instances.
+ *
+ * For short lived copies made for each request, eg. a queued pipelined put.
+ * Each operation keeps its own pool.
+ * Instances return to the pool when the last reference to them is released,
+ * by any thread, so callers simply drop their references when done.
+ * Instances released after the pool is destroyed are deleted.
+ *
+ * A re-used PVStructure is reset to default values.  A re-used BitSet is clear()'d.
+ *
+ * Hits and misses of all pools are counted, and shown by "refshow" as
+ * "ScratchPool hit" and "ScratchPool miss".
+ */
+class epicsShareClass ScratchPool
+{
+    EPICS_NOT_COPYABLE(ScratchPool)
+public:
+    //! Total of all pools
+    static size_t num_hits, num_misses;
+
+    //! Maximum # of free instances kept of each Structure, and of BitSet
+    static const size_t max_free = 8u;
+    //! Maximum # of different Structures pooled
+    static const size_t max_types = 16u;
+
+    ScratchPool();
+    ~ScratchPool();
+
+    //! A PVStructure of this type, with default values, which no-one else references
+    epics::pvData::PVStructure::shared_pointer structure(const epics::pvData::StructureConstPtr& type);
+
+    //! An empty BitSet which no-one else references
+    epics::pvData::BitSet::shared_pointer bitSet(size_t nbits);
+
+    struct Impl;
+private:
+    const std::tr1::shared_ptr<Impl> impl;
+};
+
+}
+}
+
+#endif // SCRATCHPOOL_H
@@ -0,0 +1,183 @@
+/**
+ * Copyright - See the COPYRIGHT that is included with this distribution.
+ * pvAccessCPP is distributed subject to a Software License Agreement found
+ * in file LICENSE that is included with this distribution.
+ */
+
+#include <map>
+#include <vector>
+
+#include <epicsThread.h>
+#include <epicsMutex.h>
+#include <epicsGuard.h>
+#include <epicsAtomic.h>
+
+#include <pv/reftrack.h>
+
+#define epicsExportSharedSymbols
+#include <pv/scratchPool.h>
+
+namespace pvd = epics::pvData;
+
+typedef epicsGuard<epicsMutex> Guard;
+
+namespace {
+
+using epics::pvAccess::ScratchPool;
+
+epicsThreadOnceId poolOnce = EPICS_THREAD_ONCE_INIT;
+
+void poolInit(void *)
+{
+    epics::registerRefCounter("ScratchPool hit", &ScratchPool::num_hits);
+    epics::registerRefCounter("ScratchPool miss", &ScratchPool::num_misses);
+}
+
+} // namespace
+
+namespace epics {
+namespace pvAccess {
+
+// Free instances.  Outlives the ScratchPool while instances are in use.
+struct ScratchPool::Impl
+{
+    epicsMutex mutex;
+    bool closed;
+
+    struct Entry {
+        pvd::StructureConstPtr type; // keeps the key alive
+        pvd::PVStructure::const_shared_pointer defaults;
+        std::vector<pvd::PVStructure*> instances;
+    };
+    typedef std::map<const pvd::Structure*, Entry> structures_t;
+    structures_t structures;
+
+    std::vector<pvd::BitSet*> bitSets;
+
+    Impl() :closed(false) {}
+    ~Impl() { clear(); }
+
+    // call with mutex locked, or when no longer shared
+    void clear()
+    {
+        for(structures_t::iterator it(structures.begin()), end(structures.end()); it!=end; ++it) {
+            for(size_t i=0; i<it->second.instances.size(); i++)
+                delete it->second.instances[i];
+        }
+        structures.clear();
+        for(size_t i=0; i<bitSets.size(); i++)
+            delete bitSets[i];
+        bitSets.clear();
+    }
+
+    // deleters.  Take back an instance when its last reference is released
+    struct ReturnStructure {
+        std::tr1::shared_ptr<Impl> impl;
+        explicit ReturnStructure(const std::tr1::shared_ptr<Impl>& impl) :impl(impl) {}
+        void operator()(pvd::PVStructure* inst)
+        {
+            {
+                Guard G(impl->mutex);
+                structures_t::iterator it(impl->structures.find(inst->getStructure().get()));
+                if(!impl->closed && it!=impl->structures.end() && it->second.instances.size()<max_free) {
+                    it->second.instances.push_back(inst);
+                    return;
+                }
+            }
+            delete inst;
+        }
+    };
+    struct ReturnBitSet {
+        std::tr1::shared_ptr<Impl> impl;
+        explicit ReturnBitSet(const std::tr1::shared_ptr<Impl>& impl) :impl(impl) {}
+        void operator()(pvd::BitSet* inst)
+        {
+            {
+                Guard G(impl->mutex);
+                if(!impl->closed && impl->bitSets.size()<max_free) {
+                    impl->bitSets.push_back(inst);
+                    return;
+                }
+            }
+            delete inst;
+        }
+    };
+};
+
+size_t ScratchPool::num_hits;
+size_t ScratchPool::num_misses;
+
+ScratchPool::ScratchPool()
+    :impl(new Impl)
+{
+    epicsThreadOnce(&poolOnce, &poolInit, 0);
+}
+
+ScratchPool::~ScratchPool()
+{
+    Guard G(impl->mutex);
+    impl->closed = true;
+    impl->clear();
+}
+
+pvd::PVStructure::shared_pointer ScratchPool::structure(const pvd::StructureConstPtr& type)
+{
+    pvd::PVStructure* inst = 0;
+    pvd::PVStructure::const_shared_pointer defaults;
+    {
+        Guard G(impl->mutex);
+
+        Impl::structures_t::iterator it(impl->structures.find(type.get()));
+        if(it==impl->structures.end()) {
+            // many different types is not the case we optimize for
+            if(impl->structures.size()>=max_types)
+                impl->clear();
+
+            it = impl->structures.insert(std::make_pair(type.get(), Impl::Entry())).first;
+            it->second.type = type;
+            it->second.defaults = pvd::getPVDataCreate()->createPVStructure(type);
+        }
+
+        std::vector<pvd::PVStructure*>& instances = it->second.instances;
+        if(!instances.empty()) {
+            inst = instances.back();
+            instances.pop_back();
+            defaults = it->second.defaults;
+        }
+    }
+
+    if(inst) {
+        epics::atomic::increment(num_hits);
+        // values of an earlier use are not seen by the next
+        inst->copyUnchecked(*defaults);
+
+    } else {
+        epics::atomic::increment(num_misses);
+        inst = new pvd::PVStructure(type);
+    }
+    return pvd::PVStructure::shared_pointer(inst, Impl::ReturnStructure(impl));
+}
+
+pvd::BitSet::shared_pointer ScratchPool::bitSet(size_t nbits)
+{
+    pvd::BitSet* inst = 0;
+    {
+        Guard G(impl->mutex);
+        if(!impl->bitSets.empty()) {
+            inst = impl->bitSets.back();
+            impl->bitSets.pop_back();
+        }
+    }
+
+    if(inst) {
+        epics::atomic::increment(num_hits);
+        inst->clear();
+
+    } else {
+        epics::atomic::increment(num_misses);
+        inst = new pvd::BitSet(nbits);
+    }
+    return pvd::BitSet::shared_pointer(inst, Impl::ReturnBitSet(impl));
+}
+
+}} // namespace epics::pvAccess
@@ -0,0 +1,200 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+/* pvac::ClientChannel::getArray() of a SharedPV array,
+ * directly through a StaticProvider, and through a server in this process.
+ */
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+#include <epicsEvent.h>
+#include <epicsGuard.h>
+
+#include <pv/pvUnitTest.h>
+#include <pv/current_function.h>
+#include <pv/pvData.h>
+#include <pv/configuration.h>
+#include <pv/serverContext.h>
+#include <pv/clientFactory.h>
+#include <pva/client.h>
+#include <pva/server.h>
+#include <pva/sharedstate.h>
+
+namespace pvd = epics::pvData;
+namespace pva = epics::pvAccess;
+
+namespace {
+
+const size_t length = 100000u;
+
+struct Progress : public pvac::ClientChannel::ArrayCallback
+{
+    epicsMutex mutex;
+    epicsEvent done;
+    size_t nprogress;
+    pvac::ArrayEvent result;
+
+    Progress() :nprogress(0u) {}
+    virtual ~Progress() {}
+
+    virtual void arrayProgress(const pvac::ArrayEvent& evt) OVERRIDE FINAL
+    {
+        epicsGuard<epicsMutex> G(mutex);
+        nprogress++;
+    }
+    virtual void arrayDone(const pvac::ArrayEvent& evt) OVERRIDE FINAL
+    {
+        {
+            epicsGuard<epicsMutex> G(mutex);
+            result = evt;
+        }
+        done.signal();
+    }
+};
+
+// elements [offset, offset+count) of the served array?
+bool isRange(const pvd::shared_vector<const void>& value, size_t offset, size_t count)
+{
+    if(value.original_type()!=pvd::pvDouble)
+        return false;
+    pvd::shared_vector<const double> arr(pvd::static_shared_vector_cast<const double>(value));
+    if(arr.size()!=count)
+        return false;
+    for(size_t i=0; i<count; i++) {
+        if(arr[i]!=double(offset+i))
+            return false;
+    }
+    return true;
+}
+
+void testWhole(pvac::ClientProvider& cli)
+{
+    testDiag("==== %s %s ====", CURRENT_FUNCTION, cli.name().c_str());
+
+    pvac::ClientChannel chan(cli.connect("array"));
+
+    pvac::ClientChannel::ArrayOptions opts;
+    opts.chunk = 3000u;
+    opts.inflight = 3u;
+
+    Progress cb;
+    pvac::Operation op(chan.getArray(&cb, opts));
+    testOk1(cb.done.wait(5.0));
+
+    epicsGuard<epicsMutex> G(cb.mutex);
+    testEqual(cb.result.event, pvac::ArrayEvent::Success);
+    testEqual(cb.result.total, length);
+    testEqual(cb.result.bytes, length*sizeof(double));
+    testOk1(isRange(cb.result.value, 0u, length));
+    // one progress for each chunk but the last
+    testEqual(cb.nprogress, (length+opts.chunk-1u)/opts.chunk - 1u);
+}
+
+void testRange(pvac::ClientProvider& cli)
+{
+    testDiag("==== %s %s ====", CURRENT_FUNCTION, cli.name().c_str());
+
+    pvac::ClientChannel chan(cli.connect("array"));
+
+    pvac::ClientChannel::ArrayOptions opts;
+    opts.offset = 10u;
+    opts.count = 25u;
+    opts.chunk = 7u;
+    testOk1(isRange(chan.getArray(5.0, opts), 10u, 25u));
+
+    // to the end
+    opts.offset = length - 10u;
+    opts.count = 0u;
+    testOk1(isRange(chan.getArray(5.0, opts), length - 10u, 10u));
+
+    opts.offset = length + 1u;
+    testThrows(std::runtime_error, chan.getArray(5.0, opts));
+}
+
+void testStriped(pvac::ClientProvider& cli)
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    pvac::ClientChannel chan(cli.connect("array"));
+
+    pvac::ClientChannel::ArrayOptions opts;
+    opts.chunk = 4096u;
+    opts.inflight = 2u;
+    // different priorities use different TCP connections
+    opts.stripes.resize(2);
+    opts.stripes[0].priority = 1;
+    opts.stripes[1].priority = 2;
+
+    testOk1(isRange(chan.getArray(5.0, opts), 0u, length));
+}
+
+void testNotArray(pvac::ClientProvider& cli)
+{
+    testDiag("==== %s %s ====", CURRENT_FUNCTION, cli.name().c_str());
+
+    pvac::ClientChannel chan(cli.connect("scalar"));
+    testThrows(std::runtime_error, chan.getArray(5.0));
+}
+
+} // namespace
+
+MAIN(testArrayChunks)
+{
+    testPlan(17);
+    try {
+        pvas::SharedPV::shared_pointer array(pvas::SharedPV::buildReadOnly()),
+                                       scalar(pvas::SharedPV::buildReadOnly());
+        {
+            pvd::PVStructurePtr initial(pvd::getPVDataCreate()->createPVStructure(
+                                            pvd::getFieldCreate()->createFieldBuilder()
+                                            ->addArray("value", pvd::pvDouble)
+                                            ->createStructure()));
+            pvd::shared_vector<double> values(length);
+            for(size_t i=0; i<length; i++)
+                values[i] = double(i);
+            initial->getSubFieldT<pvd::PVDoubleArray>("value")->replace(pvd::freeze(values));
+            array->open(*initial);
+        }
+        {
+            pvd::PVStructurePtr initial(pvd::getPVDataCreate()->createPVStructure(
+                                            pvd::getFieldCreate()->createFieldBuilder()
+                                            ->add("value", pvd::pvDouble)
+                                            ->createStructure()));
+            scalar->open(*initial);
+        }
+
+        pvas::StaticProvider provider("arrays");
+        provider.add("array", array);
+        provider.add("scalar", scalar);
+
+        {
+            pvac::ClientProvider local(provider.provider());
+            testWhole(local);
+            testRange(local);
+            testNotArray(local);
+        }
+
+        pva::ServerContext::shared_pointer server(pva::ServerContext::create(
+                                                      pva::ServerContext::Config()
+                                                      .provider(provider.provider())
+                                                      .config(pva::ConfigurationBuilder()
+                                                              .add("EPICS_PVAS_INTF_ADDR_LIST", "127.0.0.1")
+                                                              .add("EPICS_PVA_ADDR_LIST", "127.0.0.1")
+                                                              .add("EPICS_PVA_AUTO_ADDR_LIST","0")
+                                                              .add("EPICS_PVA_SERVER_PORT", "0")
+                                                              .add("EPICS_PVA_BROADCAST_PORT", "0")
+                                                              .push_map()
+                                                              .build())));
+
+        pva::ClientFactory::start();
+        pvac::ClientProvider remote("pva", server->getCurrentConfig());
+
+        testWhole(remote);
+        testStriped(remote);
+
+    }catch(std::exception& e){
+        testAbort("Unexpected exception: %s", e.what());
+    }
+    return testDone();
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+/* "pva" client with $EPICS_PVA_CLIENT_LOCAL connecting directly
+ * to the providers of a server in this process.
+ */
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <pv/pvUnitTest.h>
+#include <pv/current_function.h>
+#include <pv/pvData.h>
+#include <pv/configuration.h>
+#include <pv/serverContext.h>
+#include <pv/clientFactory.h>
+#include <pva/client.h>
+#include <pva/server.h>
+#include <pva/sharedstate.h>
+
+namespace pvd = epics::pvData;
+namespace pva = epics::pvAccess;
+
+namespace {
+
+const pvd::StructureConstPtr type(pvd::getFieldCreate()->createFieldBuilder()
+                                  ->add("value", pvd::pvInt)
+                                  ->createStructure());
+
+pva::ChannelProvider::shared_pointer clientProvider(const pva::ServerContext::shared_pointer& server, bool local)
+{
+    pva::ChannelProvider::shared_pointer ret(pva::ChannelProviderRegistry::clients()->createProvider("pva",
+                                                 pva::ConfigurationBuilder()
+                                                 .push_config(server->getCurrentConfig())
+                                                 .add("EPICS_PVA_CLIENT_LOCAL", local ? "YES" : "NO")
+                                                 .push_map()
+                                                 .build()));
+    if(!ret)
+        testAbort("No pva provider");
+    return ret;
+}
+
+std::string providerOf(const pva::ChannelProvider::shared_pointer& prov, const std::string& name)
+{
+    pva::Channel::shared_pointer chan(prov->createChannel(name));
+    std::string ret(chan->getProvider()->getProviderName());
+    chan->destroy();
+    return ret;
+}
+
+void testDetect(const pva::ServerContext::shared_pointer& server)
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    pva::ChannelProvider::shared_pointer local(clientProvider(server, true)),
+                                         remote(clientProvider(server, false));
+
+    testEqual(providerOf(local, "local:pv"), "shortcut");
+    testEqual(providerOf(local, "no:such:pv"), "pva");
+    testEqual(providerOf(remote, "local:pv"), "pva");
+}
+
+void testOperations(const pva::ServerContext::shared_pointer& server)
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    pvac::ClientProvider cli(clientProvider(server, true));
+    pvac::ClientChannel chan(cli.connect("local:pv"));
+
+    pvac::MonitorSync mon(chan.monitor());
+
+    testOk1(mon.wait(5.0));
+    testOk1(mon.poll());
+    testEqual(mon.root->getSubFieldT<pvd::PVScalar>("value")->getAs<pvd::int32>(), 0);
+
+    chan.put()
+        .set<pvd::int32>("value", 42)
+        .exec();
+
+    {
+        pvd::PVStructure::const_shared_pointer R(chan.get());
+        testEqual(R->getSubFieldT<pvd::PVScalar>("value")->getAs<pvd::int32>(), 42);
+    }
+
+    testOk1(mon.wait(5.0));
+    testOk1(mon.poll());
+    testEqual(mon.root->getSubFieldT<pvd::PVScalar>("value")->getAs<pvd::int32>(), 42);
+}
+
+} // namespace
+
+MAIN(testLocalShortcut)
+{
+    testPlan(10);
+    try {
+        pvas::SharedPV::shared_pointer pv(pvas::SharedPV::buildMailbox());
+        pv->open(type);
+
+        pvas::StaticProvider provider("shortcut");
+        provider.add("local:pv", pv);
+
+        pva::ServerContext::shared_pointer server(pva::ServerContext::create(
+                                                      pva::ServerContext::Config()
+                                                      .provider(provider.provider())
+                                                      .config(pva::ConfigurationBuilder()
+                                                              .add("EPICS_PVAS_INTF_ADDR_LIST", "127.0.0.1")
+                                                              .add("EPICS_PVA_ADDR_LIST", "127.0.0.1")
+                                                              .add("EPICS_PVA_AUTO_ADDR_LIST","0")
+                                                              .add("EPICS_PVA_SERVER_PORT", "0")
+                                                              .add("EPICS_PVA_BROADCAST_PORT", "0")
+                                                              .push_map()
+                                                              .build())));
+
+        pva::ClientFactory::start();
+
+        testDetect(server);
+        testOperations(server);
+
+    }catch(std::exception& e){
+        testAbort("Unexpected exception: %s", e.what());
+    }
+    return testDone();
+}
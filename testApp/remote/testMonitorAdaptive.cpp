@@ -0,0 +1,304 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+/* Client monitor with pvRequest option record._options.adaptive=true
+ * through a server in this process.
+ */
+
+#include <epicsEvent.h>
+#include <epicsGuard.h>
+#include <epicsThread.h>
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <pv/pvUnitTest.h>
+#include <pv/current_function.h>
+#include <pv/pvData.h>
+#include <pv/createRequest.h>
+#include <pv/configuration.h>
+#include <pv/serverContext.h>
+#include <pv/clientFactory.h>
+#include <pva/sharedstate.h>
+
+namespace pvd = epics::pvData;
+namespace pva = epics::pvAccess;
+
+typedef epicsGuard<epicsMutex> Guard;
+
+namespace {
+
+const pvd::StructureConstPtr type(pvd::getFieldCreate()->createFieldBuilder()
+                                  ->add("value", pvd::pvInt)
+                                  ->createStructure());
+
+struct WindowRequester : public pva::MonitorRequester
+{
+    POINTER_DEFINITIONS(WindowRequester);
+
+    epicsMutex mutex;
+    epicsEvent wakeup;
+    bool connected;
+    pvd::Status connStatus;
+
+    WindowRequester() :connected(false) {}
+    virtual ~WindowRequester() {}
+
+    virtual std::string getRequesterName() OVERRIDE FINAL { return "WindowRequester"; }
+
+    virtual void monitorConnect(pvd::Status const & status,
+                                pva::MonitorPtr const & /*monitor*/,
+                                pvd::StructureConstPtr const & /*structure*/) OVERRIDE FINAL
+    {
+        {
+            Guard G(mutex);
+            connected = true;
+            connStatus = status;
+        }
+        wakeup.signal();
+    }
+
+    virtual void monitorEvent(pva::MonitorPtr const & /*monitor*/) OVERRIDE FINAL
+    {
+        wakeup.signal();
+    }
+
+    virtual void unlisten(pva::MonitorPtr const & /*monitor*/) OVERRIDE FINAL {}
+
+    bool waitConnect()
+    {
+        Guard G(mutex);
+        while(!connected) {
+            epicsGuardRelease<epicsMutex> U(G);
+            if(!wakeup.wait(5.0))
+                return false;
+        }
+        return connStatus.isSuccess();
+    }
+};
+
+size_t windowOf(const pva::ChannelProvider::shared_pointer& cli_prov, const char *request)
+{
+    WindowRequester::shared_pointer req(new WindowRequester);
+    pva::Channel::shared_pointer chan(cli_prov->createChannel("adaptive:value"));
+    pva::Monitor::shared_pointer mon(chan->createMonitor(req, pvd::createRequest(request)));
+
+    testOk(req->waitConnect(), "Monitor connected with %s", request);
+
+    pva::Monitor::Stats stats;
+    mon->getStats(stats);
+
+    mon->destroy();
+    chan->destroy();
+    return stats.window;
+}
+
+void testFixed(const pva::ChannelProvider::shared_pointer& cli_prov)
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    testEqual(windowOf(cli_prov, "record[queueSize=8,pipeline=true]field()"), 8u);
+    testEqual(windowOf(cli_prov, "record[queueSize=8]field()"), 0u);
+}
+
+void testAdaptive(const pva::ChannelProvider::shared_pointer& cli_prov,
+                  const pvas::SharedPV::shared_pointer& pv)
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    WindowRequester::shared_pointer req(new WindowRequester);
+    pva::Channel::shared_pointer chan(cli_prov->createChannel("adaptive:value"));
+    pva::Monitor::shared_pointer mon(chan->createMonitor(req, pvd::createRequest("record[queueSize=16,adaptive=true]field()")));
+
+    testOk(req->waitConnect(), "Monitor connected");
+
+    pva::Monitor::Stats stats;
+    mon->getStats(stats);
+    testEqual(stats.window, 4u);
+
+    testOk1(mon->start().isSuccess());
+
+    pvd::PVStructurePtr value(pvd::getPVDataCreate()->createPVStructure(type));
+    pvd::BitSet changed;
+    changed.set(value->getSubFieldT<pvd::PVInt>("value")->getFieldOffset());
+
+    // producer out paces the consumer, which must still see the last update
+    pvd::int32 last = -1;
+    for(pvd::int32 i=1; i<=40; i++) {
+        value->getSubFieldT<pvd::PVInt>("value")->put(i);
+        pv->post(*value, changed);
+
+        if(i%4)
+            continue;
+
+        while(true) {
+            pva::MonitorElement::Ref elem(*mon);
+            if(!elem)
+                break;
+            last = elem->pvStructurePtr->getSubFieldT<pvd::PVInt>("value")->get();
+            epicsThreadSleep(0.01);
+        }
+    }
+
+    for(unsigned i=0; i<50 && last!=40; i++) {
+        req->wakeup.wait(0.1);
+        while(true) {
+            pva::MonitorElement::Ref elem(*mon);
+            if(!elem)
+                break;
+            last = elem->pvStructurePtr->getSubFieldT<pvd::PVInt>("value")->get();
+        }
+    }
+    testEqual(last, 40);
+
+    mon->getStats(stats);
+    testDiag("adapted window %u", unsigned(stats.window));
+    testOk1(stats.window>=2u);
+    testOk1(stats.window<=16u);
+    testEqual(stats.noutstanding, 0u);
+
+    mon->destroy();
+    chan->destroy();
+}
+
+// pop all queued elements.  returns the last value seen, or 'last' if none
+pvd::int32 popAll(const pva::Monitor::shared_pointer& mon, pvd::int32 last)
+{
+    while(true) {
+        pva::MonitorElement::Ref elem(*mon);
+        if(!elem)
+            return last;
+        last = elem->pvStructurePtr->getSubFieldT<pvd::PVInt>("value")->get();
+    }
+}
+
+void testGrow(const pva::ChannelProvider::shared_pointer& cli_prov,
+              const pvas::SharedPV::shared_pointer& pv)
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    WindowRequester::shared_pointer req(new WindowRequester);
+    pva::Channel::shared_pointer chan(cli_prov->createChannel("adaptive:value"));
+    pva::Monitor::shared_pointer mon(chan->createMonitor(req, pvd::createRequest("record[queueSize=16,adaptive=true]field()")));
+
+    testOk(req->waitConnect(), "Monitor connected");
+    testOk1(mon->start().isSuccess());
+
+    pva::Monitor::Stats stats;
+    mon->getStats(stats);
+    const size_t initial = stats.window;
+
+    pvd::PVStructurePtr value(pvd::getPVDataCreate()->createPVStructure(type));
+    pvd::BitSet changed;
+    changed.set(value->getSubFieldT<pvd::PVInt>("value")->getFieldOffset());
+
+    // updates are posted in bursts, and released as soon as they arrive.
+    // Many releases per round trip.
+    pvd::int32 counter = 1000, last = -1;
+    for(unsigned round=0; round<20; round++) {
+        for(unsigned i=0; i<32; i++) {
+            value->getSubFieldT<pvd::PVInt>("value")->put(++counter);
+            pv->post(*value, changed);
+        }
+        for(unsigned i=0; i<50 && last!=counter; i++) {
+            last = popAll(mon, last);
+            if(last!=counter)
+                req->wakeup.wait(0.1);
+        }
+    }
+
+    mon->getStats(stats);
+    testOk(stats.window>initial, "window grows %u -> %u", unsigned(initial), unsigned(stats.window));
+
+    mon->destroy();
+    chan->destroy();
+}
+
+void testShrink(const pva::ChannelProvider::shared_pointer& cli_prov,
+                const pvas::SharedPV::shared_pointer& pv)
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    WindowRequester::shared_pointer req(new WindowRequester);
+    pva::Channel::shared_pointer chan(cli_prov->createChannel("adaptive:value"));
+    pva::Monitor::shared_pointer mon(chan->createMonitor(req, pvd::createRequest("record[queueSize=16,adaptive=true]field()")));
+
+    testOk(req->waitConnect(), "Monitor connected");
+    testOk1(mon->start().isSuccess());
+
+    pva::Monitor::Stats stats;
+    mon->getStats(stats);
+    const size_t initial = stats.window;
+
+    pvd::PVStructurePtr value(pvd::getPVDataCreate()->createPVStructure(type));
+    pvd::BitSet changed;
+    changed.set(value->getSubFieldT<pvd::PVInt>("value")->getFieldOffset());
+
+    // slow consumer.  The producer keeps ahead, so the server always has an update waiting
+    // for credit, and one release takes much longer than a round trip.
+    pvd::int32 counter = 2000;
+    for(unsigned i=0; i<30; i++) {
+        for(unsigned j=0; j<2; j++) {
+            value->getSubFieldT<pvd::PVInt>("value")->put(++counter);
+            pv->post(*value, changed);
+        }
+        for(unsigned j=0; j<10; j++) {
+            pva::MonitorElement::Ref elem(*mon);
+            if(elem) {
+                epicsThreadSleep(0.05);
+                break;
+            }
+            req->wakeup.wait(0.1);
+        }
+    }
+
+    mon->getStats(stats);
+    testOk(stats.window<initial, "window shrinks %u -> %u", unsigned(initial), unsigned(stats.window));
+
+    mon->destroy();
+    chan->destroy();
+}
+
+} // namespace
+
+MAIN(testMonitorAdaptive)
+{
+    testPlan(17);
+    try {
+        pvas::SharedPV::shared_pointer pv(pvas::SharedPV::buildReadOnly());
+        {
+            pvd::PVStructurePtr initial(pvd::getPVDataCreate()->createPVStructure(type));
+            pv->open(*initial);
+        }
+
+        pvas::StaticProvider provider("adaptive");
+        provider.add("adaptive:value", pv);
+
+        pva::ServerContext::shared_pointer server(pva::ServerContext::create(
+                                                      pva::ServerContext::Config()
+                                                      .provider(provider.provider())
+                                                      .config(pva::ConfigurationBuilder()
+                                                              .add("EPICS_PVAS_INTF_ADDR_LIST", "127.0.0.1")
+                                                              .add("EPICS_PVA_ADDR_LIST", "127.0.0.1")
+                                                              .add("EPICS_PVA_AUTO_ADDR_LIST","0")
+                                                              .add("EPICS_PVA_SERVER_PORT", "0")
+                                                              .add("EPICS_PVA_BROADCAST_PORT", "0")
+                                                              .push_map()
+                                                              .build())));
+
+        pva::ClientFactory::start();
+        pva::ChannelProvider::shared_pointer cli_prov(pva::ChannelProviderRegistry::clients()->createProvider("pva",
+                                                                                                              server->getCurrentConfig()));
+        if(!cli_prov)
+            testAbort("No pva provider");
+
+        testFixed(cli_prov);
+        testAdaptive(cli_prov, pv);
+        testGrow(cli_prov, pv);
+        testShrink(cli_prov, pv);
+
+    }catch(std::exception& e){
+        testAbort("Unexpected exception: %s", e.what());
+    }
+    return testDone();
+}
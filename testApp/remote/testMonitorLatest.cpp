@@ -0,0 +1,195 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+/* Client monitor with pvRequest option record._options.latest=true
+ * through a server in this process.
+ */
+
+#include <epicsEvent.h>
+#include <epicsGuard.h>
+#include <epicsThread.h>
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <pv/pvUnitTest.h>
+#include <pv/current_function.h>
+#include <pv/pvData.h>
+#include <pv/createRequest.h>
+#include <pv/configuration.h>
+#include <pv/serverContext.h>
+#include <pv/clientFactory.h>
+#include <pva/sharedstate.h>
+
+namespace pvd = epics::pvData;
+namespace pva = epics::pvAccess;
+
+typedef epicsGuard<epicsMutex> Guard;
+
+namespace {
+
+const pvd::StructureConstPtr type(pvd::getFieldCreate()->createFieldBuilder()
+                                  ->add("value", pvd::pvInt)
+                                  ->createStructure());
+
+struct LatestRequester : public pva::MonitorRequester
+{
+    POINTER_DEFINITIONS(LatestRequester);
+
+    epicsMutex mutex;
+    epicsEvent wakeup;
+    bool connected;
+    pvd::Status connStatus;
+    size_t nevents;
+
+    LatestRequester() :connected(false), nevents(0u) {}
+    virtual ~LatestRequester() {}
+
+    virtual std::string getRequesterName() OVERRIDE FINAL { return "LatestRequester"; }
+
+    virtual void monitorConnect(pvd::Status const & status,
+                                pva::MonitorPtr const & /*monitor*/,
+                                pvd::StructureConstPtr const & /*structure*/) OVERRIDE FINAL
+    {
+        {
+            Guard G(mutex);
+            connected = true;
+            connStatus = status;
+        }
+        wakeup.signal();
+    }
+
+    virtual void monitorEvent(pva::MonitorPtr const & /*monitor*/) OVERRIDE FINAL
+    {
+        {
+            Guard G(mutex);
+            nevents++;
+        }
+        wakeup.signal();
+    }
+
+    virtual void unlisten(pva::MonitorPtr const & /*monitor*/) OVERRIDE FINAL {}
+
+    bool waitConnect()
+    {
+        Guard G(mutex);
+        while(!connected) {
+            epicsGuardRelease<epicsMutex> U(G);
+            if(!wakeup.wait(5.0))
+                return false;
+        }
+        return connStatus.isSuccess();
+    }
+
+    bool waitEvent()
+    {
+        Guard G(mutex);
+        while(!nevents) {
+            epicsGuardRelease<epicsMutex> U(G);
+            if(!wakeup.wait(5.0))
+                return false;
+        }
+        return true;
+    }
+};
+
+void testLatest(const pva::ChannelProvider::shared_pointer& cli_prov,
+                const pvas::SharedPV::shared_pointer& pv)
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    LatestRequester::shared_pointer req(new LatestRequester);
+    pva::Channel::shared_pointer chan(cli_prov->createChannel("latest:value"));
+    pva::Monitor::shared_pointer mon(chan->createMonitor(req, pvd::createRequest("record[latest=true]field()")));
+
+    testOk(req->waitConnect(), "Monitor connected");
+    testOk1(mon->start().isSuccess());
+
+    testOk(req->waitEvent(), "Initial update");
+
+    // consumer is slow.  initial update is not poll()'d while more arrive
+    pvd::PVStructurePtr value(pvd::getPVDataCreate()->createPVStructure(type));
+    pvd::BitSet changed;
+    changed.set(value->getSubFieldT<pvd::PVInt>("value")->getFieldOffset());
+
+    for(pvd::int32 i=1; i<=5; i++) {
+        value->getSubFieldT<pvd::PVInt>("value")->put(i);
+        pv->post(*value, changed);
+        epicsThreadSleep(0.05);
+    }
+
+    pva::Monitor::Stats stats;
+    for(unsigned i=0; i<50; i++) {
+        mon->getStats(stats);
+        if(stats.nmerged>=5u)
+            break;
+        epicsThreadSleep(0.1);
+    }
+    testEqual(stats.nmerged, 5u);
+    testEqual(stats.nmergedmax, 5u);
+    testEqual(stats.nfilled, 1u);
+
+    {
+        pva::MonitorElement::Ref elem(*mon);
+        testOk1(!!elem);
+        if(elem) {
+            testEqual(elem->pvStructurePtr->getSubFieldT<pvd::PVInt>("value")->get(), 5);
+            testOk1(elem->overrunBitSet->get(value->getSubFieldT<pvd::PVInt>("value")->getFieldOffset()));
+        } else {
+            testSkip(2, "No update");
+        }
+
+        mon->getStats(stats);
+        testEqual(stats.nfilled, 0u);
+        testEqual(stats.noutstanding, 1u);
+
+        testOk1(!mon->poll());
+    }
+
+    mon->getStats(stats);
+    testEqual(stats.noutstanding, 0u);
+
+    mon->destroy();
+    chan->destroy();
+}
+
+} // namespace
+
+MAIN(testMonitorLatest)
+{
+    testPlan(13);
+    try {
+        pvas::SharedPV::shared_pointer pv(pvas::SharedPV::buildReadOnly());
+        {
+            pvd::PVStructurePtr initial(pvd::getPVDataCreate()->createPVStructure(type));
+            pv->open(*initial);
+        }
+
+        pvas::StaticProvider provider("latest");
+        provider.add("latest:value", pv);
+
+        pva::ServerContext::shared_pointer server(pva::ServerContext::create(
+                                                      pva::ServerContext::Config()
+                                                      .provider(provider.provider())
+                                                      .config(pva::ConfigurationBuilder()
+                                                              .add("EPICS_PVAS_INTF_ADDR_LIST", "127.0.0.1")
+                                                              .add("EPICS_PVA_ADDR_LIST", "127.0.0.1")
+                                                              .add("EPICS_PVA_AUTO_ADDR_LIST","0")
+                                                              .add("EPICS_PVA_SERVER_PORT", "0")
+                                                              .add("EPICS_PVA_BROADCAST_PORT", "0")
+                                                              .push_map()
+                                                              .build())));
+
+        pva::ClientFactory::start();
+        pva::ChannelProvider::shared_pointer cli_prov(pva::ChannelProviderRegistry::clients()->createProvider("pva",
+                                                                                                              server->getCurrentConfig()));
+        if(!cli_prov)
+            testAbort("No pva provider");
+
+        testLatest(cli_prov, pv);
+
+    }catch(std::exception& e){
+        testAbort("Unexpected exception: %s", e.what());
+    }
+    return testDone();
+}
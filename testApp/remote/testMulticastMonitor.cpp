@@ -0,0 +1,238 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+/* Client monitor with pvRequest option record._options.multicast=true
+ * of a PV which a server in this process publishes to a multicast group.
+ */
+
+#include <string.h>
+
+#include <sstream>
+
+#include <osiSock.h>
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <pv/pvUnitTest.h>
+#include <pv/current_function.h>
+#include <pv/pvData.h>
+#include <pv/createRequest.h>
+#include <pv/configuration.h>
+#include <pv/serverContextImpl.h>
+#include <pv/clientFactory.h>
+#include <pva/client.h>
+#include <pva/sharedstate.h>
+
+namespace pvd = epics::pvData;
+namespace pva = epics::pvAccess;
+
+namespace {
+
+typedef pva::MulticastPublisher::Stats Stats;
+
+// a UDP port not in use
+unsigned short freePort()
+{
+    osiSockAttach();
+    SOCKET sock(epicsSocketCreate(AF_INET, SOCK_DGRAM, IPPROTO_UDP));
+    if(sock==INVALID_SOCKET)
+        testAbort("Can't allocate socket");
+
+    osiSockAddr addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.ia.sin_family = AF_INET;
+    addr.ia.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.ia.sin_port = 0;
+
+    osiSocklen_t len = sizeof(addr);
+    if(::bind(sock, &addr.sa, sizeof(addr)) || ::getsockname(sock, &addr.sa, &len)) {
+        epicsSocketDestroy(sock);
+        testAbort("Can't find a free UDP port");
+    }
+    epicsSocketDestroy(sock);
+    return ntohs(addr.ia.sin_port);
+}
+
+const pvd::StructureConstPtr type(pvd::getFieldCreate()->createFieldBuilder()
+                                  ->add("value", pvd::pvInt)
+                                  ->createStructure());
+
+// wait for, and return, the last value of a sequence
+pvd::int32 lastValue(pvac::MonitorSync& mon, pvd::int32 expect)
+{
+    pvd::int32 last = -1;
+    for(unsigned i=0; i<50; i++) {
+        while(mon.poll())
+            last = mon.root->getSubFieldT<pvd::PVScalar>("value")->getAs<pvd::int32>();
+        if(last==expect)
+            break;
+        mon.wait(0.1);
+    }
+    return last;
+}
+
+void post(const pvas::SharedPV::shared_pointer& pv, pvd::int32 first, pvd::int32 last)
+{
+    pvd::PVStructurePtr value(pvd::getPVDataCreate()->createPVStructure(type));
+    pvd::BitSet changed;
+    changed.set(value->getSubFieldT<pvd::PVInt>("value")->getFieldOffset());
+
+    for(pvd::int32 i=first; i<=last; i++) {
+        value->getSubFieldT<pvd::PVInt>("value")->put(i);
+        pv->post(*value, changed);
+    }
+}
+
+void testMulticast(pvac::ClientProvider& cli, const pvas::SharedPV::shared_pointer& pv,
+                   const pva::MulticastPublisher::shared_pointer& pub)
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    pvac::ClientChannel chan(cli.connect("mcast:pv"));
+    pvac::MonitorSync mon(chan.monitor(pvd::createRequest("record[multicast=true]field()")));
+
+    // complete value over TCP
+    testOk1(mon.wait(5.0));
+    testEqual(mon.event.event, pvac::MonitorEvent::Data);
+    testEqual(lastValue(mon, 0), 0);
+
+    Stats before, after;
+    testOk(pub->stats("mcast:pv", before), "PV is published");
+
+    // following updates are only sent as datagrams
+    post(pv, 1, 10);
+
+    pvd::int32 last = lastValue(mon, 10);
+    if(last<0) {
+        testSkip(4, "Multicast not delivered on loopback");
+        return;
+    }
+    testEqual(last, 10);
+
+    pub->stats("mcast:pv", after);
+    testOk(after.nsent>before.nsent, "sent %u datagrams", unsigned(after.nsent-before.nsent));
+    testOk(after.nsync==before.nsync, "no complete value over TCP (%u)", unsigned(after.nsync-before.nsync));
+
+    post(pv, 11, 20);
+    testEqual(lastValue(mon, 20), 20);
+}
+
+void testUnicast(pvac::ClientProvider& cli, const pvas::SharedPV::shared_pointer& pv)
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    // a PV not in $EPICS_PVAS_MCAST_PV_LIST is monitored as usual
+    pvac::ClientChannel chan(cli.connect("plain:pv"));
+    pvac::MonitorSync mon(chan.monitor(pvd::createRequest("record[multicast=true]field()")));
+
+    testOk1(mon.wait(5.0));
+    testEqual(lastValue(mon, 0), 0);
+
+    post(pv, 1, 5);
+    testEqual(lastValue(mon, 5), 5);
+}
+
+void testFieldSelect(pvac::ClientProvider& cli, const pvas::SharedPV::shared_pointer& pv)
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    // a stream publishes all fields, so a request which selects some is monitored as usual
+    pvac::ClientChannel chan(cli.connect("mcast:pv"));
+    pvac::MonitorSync mon(chan.monitor(pvd::createRequest("record[multicast=true]field(value)")));
+
+    testOk1(mon.wait(5.0));
+    testEqual(mon.event.event, pvac::MonitorEvent::Data);
+
+    post(pv, 21, 25);
+    testEqual(lastValue(mon, 25), 25);
+}
+
+void testGap(pvac::ClientProvider& cli, const pvas::SharedPV::shared_pointer& pv,
+             const pva::MulticastPublisher::shared_pointer& pub)
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    pvac::ClientChannel chan(cli.connect("mcast:pv"));
+    pvac::MonitorSync mon(chan.monitor(pvd::createRequest("record[multicast=true]field()")));
+
+    testOk1(mon.wait(5.0));
+    testEqual(lastValue(mon, 25), 25);
+
+    Stats before, after;
+    testOk(pub->stats("mcast:pv", before), "PV is published");
+
+    // the first update is lost.  the client notices the gap at the second
+    pub->drop("mcast:pv", 1u);
+    post(pv, 30, 35);
+
+    pvd::int32 last = lastValue(mon, 35);
+    if(last<0) {
+        testSkip(3, "Multicast not delivered on loopback");
+        return;
+    }
+    testEqual(last, 35);
+
+    pub->stats("mcast:pv", after);
+    testEqual(after.ndropped, before.ndropped+1u);
+    testOk(after.nsync>before.nsync, "resync with a complete value over TCP (%u)", unsigned(after.nsync-before.nsync));
+}
+
+} // namespace
+
+MAIN(testMulticastMonitor)
+{
+    testPlan(20);
+    try {
+        pvas::SharedPV::shared_pointer mpv(pvas::SharedPV::buildReadOnly()),
+                                       ppv(pvas::SharedPV::buildReadOnly());
+        {
+            pvd::PVStructurePtr initial(pvd::getPVDataCreate()->createPVStructure(type));
+            mpv->open(*initial);
+            ppv->open(*initial);
+        }
+
+        std::ostringstream group;
+        group<<"224.0.0.129:"<<freePort();
+
+        pvas::StaticProvider provider("mcast");
+        provider.add("mcast:pv", mpv);
+        provider.add("plain:pv", ppv);
+
+        pva::ServerContext::shared_pointer server(pva::ServerContext::create(
+                                                      pva::ServerContext::Config()
+                                                      .provider(provider.provider())
+                                                      .config(pva::ConfigurationBuilder()
+                                                              .add("EPICS_PVAS_INTF_ADDR_LIST", "127.0.0.1")
+                                                              .add("EPICS_PVA_ADDR_LIST", "127.0.0.1")
+                                                              .add("EPICS_PVA_AUTO_ADDR_LIST","0")
+                                                              .add("EPICS_PVA_SERVER_PORT", "0")
+                                                              .add("EPICS_PVA_BROADCAST_PORT", "0")
+                                                              .add("EPICS_PVAS_MCAST_ADDR", group.str())
+                                                              .add("EPICS_PVAS_MCAST_INTF", "127.0.0.1")
+                                                              .add("EPICS_PVAS_MCAST_PV_LIST", "mcast:pv")
+                                                              .push_map()
+                                                              .build())));
+
+        pva::ClientFactory::start();
+        pvac::ClientProvider cli("pva", pva::ConfigurationBuilder()
+                                 .push_config(server->getCurrentConfig())
+                                 .add("EPICS_PVA_MCAST_INTF", "127.0.0.1")
+                                 .push_map()
+                                 .build());
+
+        pva::MulticastPublisher::shared_pointer pub(std::tr1::dynamic_pointer_cast<pva::ServerContextImpl>(server)
+                                                    ->getMulticastPublisher());
+        if(!pub)
+            testAbort("No MulticastPublisher");
+
+        testMulticast(cli, mpv, pub);
+        testUnicast(cli, ppv);
+        testFieldSelect(cli, mpv);
+        testGap(cli, mpv, pub);
+
+    }catch(std::exception& e){
+        testAbort("Unexpected exception: %s", e.what());
+    }
+    return testDone();
+}
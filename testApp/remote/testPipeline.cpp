@@ -0,0 +1,220 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+/* Pipelined get() and put() with record._options.window
+ * through a server in this process.
+ */
+
+#include <vector>
+
+#include <epicsEvent.h>
+#include <epicsGuard.h>
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <pv/pvUnitTest.h>
+#include <pv/current_function.h>
+#include <pv/pvData.h>
+#include <pv/createRequest.h>
+#include <pv/configuration.h>
+#include <pv/serverContext.h>
+#include <pv/clientFactory.h>
+#include <pva/sharedstate.h>
+
+namespace pvd = epics::pvData;
+namespace pva = epics::pvAccess;
+
+typedef epicsGuard<epicsMutex> Guard;
+
+namespace {
+
+const pvd::StructureConstPtr type(pvd::getFieldCreate()->createFieldBuilder()
+                                  ->add("value", pvd::pvInt)
+                                  ->createStructure());
+
+const size_t window = 4u;
+
+struct PipeRequester : public pva::ChannelGetRequester,
+                       public pva::ChannelPutRequester
+{
+    POINTER_DEFINITIONS(PipeRequester);
+
+    epicsMutex mutex;
+    epicsEvent wakeup;
+    bool connected;
+    pvd::Status connStatus;
+    size_t done, failed;
+    std::vector<pvd::int32> values;
+
+    PipeRequester() :connected(false), done(0u), failed(0u) {}
+    virtual ~PipeRequester() {}
+
+    virtual std::string getRequesterName() OVERRIDE FINAL { return "PipeRequester"; }
+
+    void connect(const pvd::Status& status)
+    {
+        {
+            Guard G(mutex);
+            connected = true;
+            connStatus = status;
+        }
+        wakeup.signal();
+    }
+
+    void complete(const pvd::Status& status, const pvd::PVStructure::shared_pointer& value)
+    {
+        {
+            Guard G(mutex);
+            done++;
+            if(!status.isSuccess()) {
+                testDiag("Request fails: %s", status.getMessage().c_str());
+                failed++;
+            } else if(value) {
+                values.push_back(value->getSubFieldT<pvd::PVInt>("value")->get());
+            }
+        }
+        wakeup.signal();
+    }
+
+    virtual void channelGetConnect(const pvd::Status& status,
+                                   pva::ChannelGet::shared_pointer const & /*channelGet*/,
+                                   pvd::Structure::const_shared_pointer const & /*structure*/) OVERRIDE FINAL
+    { connect(status); }
+
+    virtual void getDone(const pvd::Status& status,
+                         pva::ChannelGet::shared_pointer const & /*channelGet*/,
+                         pvd::PVStructure::shared_pointer const & pvStructure,
+                         pvd::BitSet::shared_pointer const & /*bitSet*/) OVERRIDE FINAL
+    { complete(status, pvStructure); }
+
+    virtual void channelPutConnect(const pvd::Status& status,
+                                   pva::ChannelPut::shared_pointer const & /*channelPut*/,
+                                   pvd::Structure::const_shared_pointer const & /*structure*/) OVERRIDE FINAL
+    { connect(status); }
+
+    virtual void putDone(const pvd::Status& status,
+                         pva::ChannelPut::shared_pointer const & /*channelPut*/) OVERRIDE FINAL
+    { complete(status, pvd::PVStructure::shared_pointer()); }
+
+    virtual void getDone(const pvd::Status& status,
+                         pva::ChannelPut::shared_pointer const & /*channelPut*/,
+                         pvd::PVStructure::shared_pointer const & pvStructure,
+                         pvd::BitSet::shared_pointer const & /*bitSet*/) OVERRIDE FINAL
+    { complete(status, pvStructure); }
+
+    bool waitConnect()
+    {
+        Guard G(mutex);
+        while(!connected) {
+            epicsGuardRelease<epicsMutex> U(G);
+            if(!wakeup.wait(5.0))
+                return false;
+        }
+        return connStatus.isSuccess();
+    }
+
+    bool waitDone(size_t n)
+    {
+        Guard G(mutex);
+        while(done<n) {
+            epicsGuardRelease<epicsMutex> U(G);
+            if(!wakeup.wait(5.0))
+                return false;
+        }
+        return true;
+    }
+};
+
+pva::Channel::shared_pointer connect(const pva::ChannelProvider::shared_pointer& cli_prov)
+{
+    return cli_prov->createChannel("pipe:value");
+}
+
+void testPipelinePut(const pva::ChannelProvider::shared_pointer& cli_prov)
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    PipeRequester::shared_pointer req(new PipeRequester);
+    pva::Channel::shared_pointer chan(connect(cli_prov));
+    pva::ChannelPut::shared_pointer op(chan->createChannelPut(req, pvd::createRequest("record[window=4]field()")));
+
+    testOk(req->waitConnect(), "Put connected");
+
+    pvd::PVStructurePtr value(pvd::getPVDataCreate()->createPVStructure(type));
+    pvd::BitSet::shared_pointer changed(new pvd::BitSet);
+    changed->set(value->getSubFieldT<pvd::PVInt>("value")->getFieldOffset());
+
+    // queue puts without waiting for completion.
+    for(size_t i=0; i<window; i++) {
+        value->getSubFieldT<pvd::PVInt>("value")->put(pvd::int32(10+i));
+        op->put(value, changed);
+    }
+
+    testOk(req->waitDone(window), "All puts complete");
+    testEqual(req->failed, 0u);
+
+    // last put wins
+    op->get();
+    testOk(req->waitDone(window+1u), "get complete");
+    testOk(req->values.size()==1u && req->values[0]==pvd::int32(10+window-1), "value==%d",
+           req->values.empty() ? -1 : int(req->values[0]));
+}
+
+void testPipelineGet(const pva::ChannelProvider::shared_pointer& cli_prov)
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    PipeRequester::shared_pointer req(new PipeRequester);
+    pva::Channel::shared_pointer chan(connect(cli_prov));
+    pva::ChannelGet::shared_pointer op(chan->createChannelGet(req, pvd::createRequest("record[window=4]field()")));
+
+    testOk(req->waitConnect(), "Get connected");
+
+    // the first 'window' get()s can't be rejected
+    for(size_t i=0; i<window; i++)
+        op->get();
+
+    testOk(req->waitDone(window), "All gets complete");
+    testEqual(req->failed, 0u);
+    testEqual(req->values.size(), window);
+}
+
+} // namespace
+
+MAIN(testPipeline)
+{
+    testPlan(9);
+    try {
+        pvas::SharedPV::shared_pointer pv(pvas::SharedPV::buildMailbox());
+        pv->open(type);
+
+        pvas::StaticProvider provider("pipe");
+        provider.add("pipe:value", pv);
+
+        pva::ServerContext::shared_pointer server(pva::ServerContext::create(
+                                                      pva::ServerContext::Config()
+                                                      .provider(provider.provider())
+                                                      .config(pva::ConfigurationBuilder()
+                                                              .add("EPICS_PVAS_INTF_ADDR_LIST", "127.0.0.1")
+                                                              .add("EPICS_PVA_ADDR_LIST", "127.0.0.1")
+                                                              .add("EPICS_PVA_AUTO_ADDR_LIST","0")
+                                                              .add("EPICS_PVA_SERVER_PORT", "0")
+                                                              .add("EPICS_PVA_BROADCAST_PORT", "0")
+                                                              .push_map()
+                                                              .build())));
+
+        pva::ClientFactory::start();
+        pva::ChannelProvider::shared_pointer cli_prov(pva::ChannelProviderRegistry::clients()->createProvider("pva",
+                                                                                                              server->getCurrentConfig()));
+        if(!cli_prov)
+            testAbort("No pva provider");
+
+        testPipelinePut(cli_prov);
+        testPipelineGet(cli_prov);
+
+    }catch(std::exception& e){
+        testAbort("Unexpected exception: %s", e.what());
+    }
+    return testDone();
+}
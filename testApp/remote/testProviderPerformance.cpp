@@ -0,0 +1,613 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+/* Throughput and latency of get, put, monitor, and RPC through any client provider.
+ *
+ * Runs each combination of operation, concurrency (operations in flight),
+ * and payload size, and prints one line of results for each.
+ * So that providers may be compared, and regressions found, with the same scenarios.
+ *
+ * By default, PVs served from this process (pvas::StaticProvider with SharedPV)
+ * are measured, either directly with '-p local' or through a loopback server with '-p pva'.
+ * When PV names are given, these are measured through the named provider instead.
+ * eg. PVs of a pipeline or RPC server, or of another process.
+ */
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <sstream>
+#include <vector>
+#include <string>
+
+#include <epicsStdlib.h>
+#include <epicsGetopt.h>
+#include <epicsEvent.h>
+#include <epicsMutex.h>
+#include <epicsGuard.h>
+#include <epicsTime.h>
+
+#include <pv/pvData.h>
+#include <pv/createRequest.h>
+#include <pv/configuration.h>
+#include <pv/serverContext.h>
+#include <pv/clientFactory.h>
+#include <pva/client.h>
+#include <pva/server.h>
+#include <pva/sharedstate.h>
+
+namespace pvd = epics::pvData;
+namespace pva = epics::pvAccess;
+
+namespace {
+
+typedef epicsGuard<epicsMutex> Guard;
+
+void usage()
+{
+    fprintf(stderr, "\nUsage: testProviderPerformance [options] [<PV name> ...]\n\n"
+            "  -h:             Help: Print this message\n"
+            "  -p <provider>:  Client provider.  'local' to use PVs of this process w/o a server.  default 'pva'\n"
+            "  -o <ops>:       Operations, comma separated from get,put,monitor,rpc.  default all\n"
+            "  -c <counts>:    Concurrency, comma separated # of operations in flight.  default 1,8,64\n"
+            "  -s <sizes>:     Payload sizes, comma separated # of double[] elements, 0 for a scalar.  default 0,1024,65536\n"
+            "  -n <count>:     Operations, or monitor updates, in each measurement.  default 10000\n"
+            "  -r <request>:   pvRequest.  default 'field()'\n"
+            "  -w <sec>:       Timeout of each measurement.  default 30.0\n"
+            "\n"
+            "Without PV names, PVs named perf:<size> are served from this process,\n"
+            "through a server on 127.0.0.1 unless '-p local'.\n"
+            "These accept put, echo the RPC argument, and post -n updates for monitor.\n"
+            "Given PV names are used in turn by each operation in flight,\n"
+            "with a payload of the given size for put and rpc.\n"
+            "Latency columns are for get, put and rpc only.\n"
+            "\n");
+}
+
+enum op_t {Get, Put, Monitor, RPC};
+const char * const opNames[4] = {"get", "put", "monitor", "rpc"};
+
+// The built-in PV of one payload size
+struct PerfHandler : public pvas::SharedPV::Handler
+{
+    virtual ~PerfHandler() {}
+
+    virtual void onPut(const pvas::SharedPV::shared_pointer& pv, pvas::Operation& op) OVERRIDE FINAL
+    {
+        pv->post(op.value(), op.changed());
+        op.complete();
+    }
+
+    virtual void onRPC(const pvas::SharedPV::shared_pointer& pv, pvas::Operation& op) OVERRIDE FINAL
+    {
+        (void)pv;
+        pvd::BitSet changed;
+        changed.set(0);
+        op.complete(op.value(), changed);
+    }
+};
+
+pvd::StructureConstPtr buildType(size_t size)
+{
+    pvd::FieldBuilderPtr builder(pvd::getFieldCreate()->createFieldBuilder());
+    if(size==0u)
+        builder->add("value", pvd::pvDouble);
+    else
+        builder->addArray("value", pvd::pvDouble);
+    return builder->add("seq", pvd::pvULong)
+                  ->createStructure();
+}
+
+// fill in 'value' as a scalar or array
+void fillValue(pvd::PVField& field, const pvd::shared_vector<const double>& payload, double counter)
+{
+    if(pvd::PVScalar* scalar = dynamic_cast<pvd::PVScalar*>(&field)) {
+        scalar->putFrom<double>(counter);
+    } else if(pvd::PVScalarArray* array = dynamic_cast<pvd::PVScalarArray*>(&field)) {
+        array->putFrom(payload);
+    } else {
+        throw std::runtime_error("'value' is not a scalar or scalar array");
+    }
+}
+
+// Measurements of one scenario
+struct Stats {
+    epicsMutex mutex;
+    epicsEvent wakeup;
+    // indicies of Slots with no operation in flight
+    std::vector<size_t> ready;
+    size_t completed, errors;
+    std::string lastError;
+    std::vector<double> latency; // seconds
+
+    Stats() :completed(0u), errors(0u) {}
+
+    void reset()
+    {
+        Guard G(mutex);
+        ready.clear();
+        completed = errors = 0u;
+        lastError.clear();
+        latency.clear();
+    }
+};
+
+// One operation in flight, re-issued by the main thread when complete
+struct Slot : public pvac::ClientChannel::GetCallback,
+              public pvac::ClientChannel::PutCallback
+{
+    Stats& stats;
+    const size_t index;
+    const op_t op;
+    pvac::ClientChannel channel;
+    const pvd::PVStructure::const_shared_pointer pvRequest;
+    const pvd::shared_vector<const double>& payload;
+    pvd::PVStructurePtr arguments;
+
+    pvd::PVStructurePtr root; // of last putBuild()
+    pvd::PVFieldPtr value;
+
+    pvac::Operation operation;
+    epicsTime start;
+    double counter;
+
+    Slot(Stats& stats, size_t index, op_t op,
+         const pvac::ClientChannel& channel,
+         const pvd::PVStructure::const_shared_pointer& pvRequest,
+         const pvd::shared_vector<const double>& payload)
+        :stats(stats)
+        ,index(index)
+        ,op(op)
+        ,channel(channel)
+        ,pvRequest(pvRequest)
+        ,payload(payload)
+        ,counter(0.0)
+    {
+        if(op==RPC) {
+            arguments = pvd::getPVDataCreate()->createPVStructure(buildType(payload.size()));
+            fillValue(*arguments->getSubFieldT("value"), payload, 0.0);
+        }
+    }
+    virtual ~Slot()
+    {
+        operation.cancel();
+    }
+
+    void issue()
+    {
+        start = epicsTime::getCurrent();
+        counter += 1.0;
+        switch(op) {
+        case Get: operation = channel.get(this, pvRequest); break;
+        case Put: operation = channel.put(this, pvRequest); break;
+        case RPC: operation = channel.rpc(this, arguments, pvRequest); break;
+        case Monitor: break;
+        }
+    }
+
+    virtual void getDone(const pvac::GetEvent& evt) OVERRIDE FINAL { done(evt); }
+    virtual void putDone(const pvac::PutEvent& evt) OVERRIDE FINAL { done(evt); }
+
+    virtual void putBuild(const pvd::StructureConstPtr& build, pvac::ClientChannel::PutCallback::Args& args) OVERRIDE FINAL
+    {
+        if(!root || root->getStructure()!=build) {
+            root = pvd::getPVDataCreate()->createPVStructure(build);
+            value = root->getSubField("value");
+            if(!value)
+                throw std::runtime_error("No 'value' field");
+        }
+        fillValue(*value, payload, counter);
+        args.tosend.set(value->getFieldOffset());
+        args.root = root;
+    }
+
+    void done(const pvac::PutEvent& evt)
+    {
+        const double elapsed = epicsTime::getCurrent() - start;
+        {
+            Guard G(stats.mutex);
+            stats.completed++;
+            if(evt.event==pvac::PutEvent::Success) {
+                stats.latency.push_back(elapsed);
+            } else {
+                stats.errors++;
+                stats.lastError = evt.message;
+            }
+            stats.ready.push_back(index);
+        }
+        stats.wakeup.signal();
+    }
+
+    EPICS_NOT_COPYABLE(Slot)
+};
+
+struct Config {
+    std::vector<op_t> ops;
+    std::vector<size_t> concurrency, sizes;
+    size_t count;
+    double timeout;
+    pvd::PVStructure::const_shared_pointer pvRequest;
+    std::vector<std::string> names;
+};
+
+struct Result {
+    size_t completed, errors;
+    std::string lastError;
+    double elapsed;
+    std::vector<double> latency;
+};
+
+// Issue 'count' operations, keeping all Slots busy.  false on timeout.
+bool drive(std::vector<Slot*>& slots, Stats& stats, size_t count, double timeout)
+{
+    const epicsTime begin(epicsTime::getCurrent());
+    size_t issued = 0u;
+    std::vector<size_t> ready;
+
+    for(size_t i=0; i<slots.size(); i++)
+        ready.push_back(i);
+
+    while(true) {
+        for(size_t i=0; i<ready.size() && issued<count; i++, issued++)
+            slots[ready[i]]->issue();
+        ready.clear();
+
+        {
+            Guard G(stats.mutex);
+            if(stats.completed>=count)
+                return true;
+            ready.swap(stats.ready);
+        }
+
+        if(ready.empty()) {
+            const double remaining = timeout - (epicsTime::getCurrent() - begin);
+            if(remaining<=0.0 || !stats.wakeup.wait(remaining))
+                return false;
+        }
+    }
+}
+
+bool runOperation(pvac::ClientProvider& provider, const Config& conf, op_t op, size_t concurrency,
+                  const std::vector<std::string>& names, const pvd::shared_vector<const double>& payload,
+                  Result& result)
+{
+    Stats stats;
+    std::vector<Slot*> slots;
+    bool ok;
+
+    try {
+        for(size_t i=0; i<concurrency; i++)
+            slots.push_back(new Slot(stats, i, op, provider.connect(names[i%names.size()]),
+                                     conf.pvRequest, payload));
+
+        // first operation of each Slot includes connecting.  Not counted.
+        ok = drive(slots, stats, slots.size(), conf.timeout);
+        if(ok) {
+            {
+                Guard G(stats.mutex);
+                if(stats.errors) {
+                    result.errors = stats.errors;
+                    result.lastError = stats.lastError;
+                    ok = false;
+                }
+            }
+            stats.reset();
+        }
+
+        if(ok) {
+            const epicsTime begin(epicsTime::getCurrent());
+            ok = drive(slots, stats, conf.count, conf.timeout);
+            result.elapsed = epicsTime::getCurrent() - begin;
+
+            Guard G(stats.mutex);
+            result.completed = stats.completed;
+            result.errors = stats.errors;
+            result.lastError = stats.lastError;
+            result.latency.swap(stats.latency);
+        }
+    }catch(...){
+        for(size_t i=0; i<slots.size(); i++)
+            delete slots[i];
+        throw;
+    }
+
+    // cancels any operations still in flight after a timeout
+    for(size_t i=0; i<slots.size(); i++)
+        delete slots[i];
+    return ok;
+}
+
+// Each subscriber is done after 'count' updates, or an update with seq==count
+bool runMonitor(pvac::ClientProvider& provider, const Config& conf, size_t concurrency,
+                const std::vector<std::string>& names, const pvas::SharedPV::shared_pointer& pv,
+                Result& result)
+{
+    epicsEvent wakeup;
+    std::vector<pvac::MonitorSync> subs(concurrency);
+    std::vector<size_t> received(concurrency, 0u);
+    std::vector<bool> connected(concurrency, false), finished(concurrency, false);
+
+    for(size_t i=0; i<concurrency; i++)
+        subs[i] = provider.connect(names[i%names.size()]).monitor(conf.pvRequest, &wakeup);
+
+    epicsTime begin(epicsTime::getCurrent());
+    size_t nconnected = 0u, nfinished = 0u;
+    bool posted = false;
+
+    while(nfinished<concurrency) {
+        for(size_t i=0; i<concurrency; i++) {
+            if(subs[i].test() && subs[i].event.event!=pvac::MonitorEvent::Data) {
+                result.errors++;
+                result.lastError = subs[i].event.message;
+                return false;
+            }
+            while(subs[i].poll()) {
+                if(!connected[i]) {
+                    // initial update not counted
+                    connected[i] = true;
+                    nconnected++;
+                    continue;
+                } else if(finished[i]) {
+                    continue;
+                }
+                received[i]++;
+                pvd::PVScalar::const_shared_pointer seq(subs[i].root->getSubField<pvd::PVScalar>("seq"));
+                if(received[i]>=conf.count || (seq && seq->getAs<pvd::uint64>()>=conf.count)) {
+                    finished[i] = true;
+                    nfinished++;
+                }
+            }
+        }
+
+        if(nconnected==concurrency && !posted) {
+            begin = epicsTime::getCurrent();
+            posted = true;
+
+            if(pv) {
+                pvd::PVStructurePtr value(pv->build());
+                pvd::BitSet valid;
+                pv->fetch(*value, valid);
+                pvd::PVScalarPtr seq(value->getSubFieldT<pvd::PVScalar>("seq"));
+                pvd::BitSet changed;
+                changed.set(value->getSubFieldT("value")->getFieldOffset())
+                       .set(seq->getFieldOffset());
+
+                for(size_t n=1u; n<=conf.count; n++) {
+                    seq->putFrom<pvd::uint64>(n);
+                    pv->post(*value, changed);
+                }
+            }
+            continue; // updates may be ready already
+        }
+
+        const double remaining = conf.timeout - (epicsTime::getCurrent() - begin);
+        if(nfinished<concurrency && (remaining<=0.0 || !wakeup.wait(remaining)))
+            break;
+    }
+
+    result.elapsed = epicsTime::getCurrent() - begin;
+    for(size_t i=0; i<concurrency; i++)
+        result.completed += received[i];
+
+    for(size_t i=0; i<concurrency; i++)
+        subs[i].cancel();
+
+    return nfinished==concurrency;
+}
+
+double percentile(const std::vector<double>& sorted, unsigned pct)
+{
+    return sorted[std::min(sorted.size()-1u, sorted.size()*pct/100u)];
+}
+
+void report(op_t op, size_t concurrency, size_t size, size_t count, bool builtin, bool ok, Result& result)
+{
+    const double bytes = double(size ? size : 1u)*sizeof(double);
+    const double rate = result.elapsed>0.0 ? result.completed/result.elapsed : 0.0;
+
+    printf("%-8s %6u %8u %12.1f %10.2f",
+           opNames[op], unsigned(concurrency), unsigned(size), rate, rate*bytes/1e6);
+
+    if(op==Monitor) {
+        // posts squashed by the server, or dropped by the client queue
+        if(builtin)
+            printf(" %10s %10s %10s %9.1f%%", "-", "-", "-",
+                   100.0*(1.0 - double(result.completed)/double(concurrency*count)));
+        else
+            printf(" %10s %10s %10s %10s", "-", "-", "-", "-");
+    } else if(!result.latency.empty()) {
+        std::sort(result.latency.begin(), result.latency.end());
+        printf(" %10.1f %10.1f %10.1f %10s",
+               1e6*percentile(result.latency, 50u),
+               1e6*percentile(result.latency, 99u),
+               1e6*result.latency.back(), "-");
+    } else {
+        printf(" %10s %10s %10s %10s", "-", "-", "-", "-");
+    }
+
+    if(!ok)
+        printf("  %s", result.errors ? "FAIL" : "TIMEOUT");
+    if(result.errors)
+        printf(" %u errors, last: %s", unsigned(result.errors), result.lastError.c_str());
+    printf("\n");
+    fflush(stdout);
+}
+
+template<typename T>
+bool parseList(const char *arg, std::vector<T>& out)
+{
+    out.clear();
+    std::istringstream strm(arg);
+    std::string item;
+    while(std::getline(strm, item, ',')) {
+        epicsUInt32 val;
+        if(epicsParseUInt32(item.c_str(), &val, 0, NULL))
+            return false;
+        out.push_back(val);
+    }
+    return !out.empty();
+}
+
+bool parseOps(const char *arg, std::vector<op_t>& out)
+{
+    out.clear();
+    std::istringstream strm(arg);
+    std::string item;
+    while(std::getline(strm, item, ',')) {
+        size_t i;
+        for(i=0; i<4u && item!=opNames[i]; i++) {}
+        if(i==4u)
+            return false;
+        out.push_back(op_t(i));
+    }
+    return !out.empty();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    std::string providerName("pva");
+    std::string request("field()");
+    Config conf;
+    conf.count = 10000u;
+    conf.timeout = 30.0;
+    parseOps("get,put,monitor,rpc", conf.ops);
+    parseList("1,8,64", conf.concurrency);
+    parseList("0,1024,65536", conf.sizes);
+
+    int opt;
+    while ((opt = getopt(argc, argv, ":hp:o:c:s:n:r:w:")) != -1) {
+        bool ok = true;
+        switch (opt) {
+        case 'h':
+            usage();
+            return 0;
+        case 'p': providerName = optarg; break;
+        case 'o': ok = parseOps(optarg, conf.ops); break;
+        case 'c': ok = parseList(optarg, conf.concurrency)
+                       && *std::min_element(conf.concurrency.begin(), conf.concurrency.end())>0u; break;
+        case 's': ok = parseList(optarg, conf.sizes); break;
+        case 'n': {
+            epicsUInt32 val;
+            ok = !epicsParseUInt32(optarg, &val, 0, NULL) && val>0u;
+            conf.count = val;
+            break;
+        }
+        case 'r': request = optarg; break;
+        case 'w': ok = epicsScanDouble(optarg, &conf.timeout)==1 && conf.timeout>0.0; break;
+        default:
+            usage();
+            return 1;
+        }
+        if(!ok) {
+            fprintf(stderr, "Invalid argument -%c '%s'\n", opt, optarg);
+            return 1;
+        }
+    }
+
+    for(int i=optind; i<argc; i++)
+        conf.names.push_back(argv[i]);
+
+    const bool builtin = conf.names.empty();
+    if(builtin && providerName!="pva" && providerName!="local") {
+        fprintf(stderr, "PVs of this process are only available through providers 'pva' or 'local'.  Give PV names.\n");
+        return 1;
+    }
+
+    try {
+        conf.pvRequest = pvd::createRequest(request);
+
+        pvas::StaticProvider local("local");
+        std::vector<pvas::SharedPV::shared_pointer> pvs;
+        std::vector<pvd::shared_vector<const double> > payloads;
+
+        for(size_t s=0; s<conf.sizes.size(); s++) {
+            pvd::shared_vector<double> payload(conf.sizes[s]);
+            for(size_t i=0; i<payload.size(); i++)
+                payload[i] = double(i);
+            payloads.push_back(pvd::freeze(payload));
+
+            if(builtin) {
+                std::tr1::shared_ptr<PerfHandler> handler(new PerfHandler);
+                pvs.push_back(pvas::SharedPV::build(handler));
+
+                pvd::PVStructurePtr initial(pvd::getPVDataCreate()->createPVStructure(buildType(conf.sizes[s])));
+                fillValue(*initial->getSubFieldT("value"), payloads.back(), 0.0);
+                pvs.back()->open(*initial);
+
+                std::ostringstream name;
+                name<<"perf:"<<conf.sizes[s];
+                local.add(name.str(), pvs.back());
+            }
+        }
+
+        pva::ServerContext::shared_pointer server;
+        pvac::ClientProvider provider;
+
+        if(providerName=="local") {
+            provider = pvac::ClientProvider(local.provider());
+
+        } else if(builtin) {
+            server = pva::ServerContext::create(pva::ServerContext::Config()
+                                                .provider(local.provider())
+                                                .config(pva::ConfigurationBuilder()
+                                                        .add("EPICS_PVAS_INTF_ADDR_LIST", "127.0.0.1")
+                                                        .add("EPICS_PVA_ADDR_LIST", "127.0.0.1")
+                                                        .add("EPICS_PVA_AUTO_ADDR_LIST","0")
+                                                        .add("EPICS_PVA_SERVER_PORT", "0")
+                                                        .add("EPICS_PVA_BROADCAST_PORT", "0")
+                                                        .push_map()
+                                                        .build()));
+            pva::ClientFactory::start();
+            provider = pvac::ClientProvider("pva", server->getCurrentConfig());
+
+        } else {
+            pva::ClientFactory::start();
+            provider = pvac::ClientProvider(providerName, pva::ConfigurationBuilder()
+                                                          .push_env()
+                                                          .build());
+        }
+
+        printf("# provider '%s', %u operations per measurement\n", providerName.c_str(), unsigned(conf.count));
+        printf("%-8s %6s %8s %12s %10s %10s %10s %10s %10s\n",
+               "op", "conc", "size", "ops/s", "MB/s", "p50(us)", "p99(us)", "max(us)", "squashed");
+
+        bool allok = true;
+
+        for(size_t o=0; o<conf.ops.size(); o++) {
+            for(size_t s=0; s<conf.sizes.size(); s++) {
+                std::vector<std::string> names(conf.names);
+                if(builtin) {
+                    std::ostringstream name;
+                    name<<"perf:"<<conf.sizes[s];
+                    names.push_back(name.str());
+                }
+
+                for(size_t c=0; c<conf.concurrency.size(); c++) {
+                    Result result;
+                    result.completed = result.errors = 0u;
+                    result.elapsed = 0.0;
+                    bool ok;
+
+                    if(conf.ops[o]==Monitor)
+                        ok = runMonitor(provider, conf, conf.concurrency[c], names,
+                                        builtin ? pvs[s] : pvas::SharedPV::shared_pointer(), result);
+                    else
+                        ok = runOperation(provider, conf, conf.ops[o], conf.concurrency[c], names,
+                                          payloads[s], result);
+
+                    report(conf.ops[o], conf.concurrency[c], conf.sizes[s], conf.count, builtin, ok, result);
+                    allok &= ok;
+                }
+            }
+        }
+
+        return allok ? 0 : 2;
+    }catch(std::exception& e){
+        fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+}
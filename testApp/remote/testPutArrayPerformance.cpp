@@ -0,0 +1,249 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+/* Cost of putting a large array to a SharedPV through a loopback server.
+ *
+ * Puts are made to two PVs.  The handler of "bigput" posts each put value, as is usual.
+ * So the array of the previous put is still referenced by the PV when the next one arrives.
+ * The handler of "bigput:inplace" does not, so the array is only held by the server.
+ *
+ * Each put is timed, and compared with a memcpy() of the same size.
+ * The loopback transfer itself (copies in and out of the kernel) accounts for
+ * about two memcpy() equivalents, leaving one for copying out of the receive buffer.
+ * A server which copied the previous array before receiving into it would add
+ * another to "bigput" only, so the difference between the two is also shown.
+ *
+ * Checks that the array posted by "bigput" is the one its handler received,
+ * ie. that no further copy was made, and that "bigput:inplace" receives
+ * each put into the same array.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include <epicsStdlib.h>
+#include <epicsGetopt.h>
+#include <epicsMutex.h>
+#include <epicsGuard.h>
+#include <epicsTime.h>
+
+#include <pv/pvData.h>
+#include <pv/configuration.h>
+#include <pv/serverContext.h>
+#include <pv/clientFactory.h>
+#include <pva/client.h>
+#include <pva/server.h>
+#include <pva/sharedstate.h>
+
+namespace pvd = epics::pvData;
+namespace pva = epics::pvAccess;
+
+namespace {
+
+typedef epicsGuard<epicsMutex> Guard;
+
+void usage()
+{
+    fprintf(stderr, "\nUsage: testPutArrayPerformance [options]\n\n"
+            "  -h:             Help: Print this message\n"
+            "  -s <count>:     # of double[] elements.  default 13107200 (100 MB)\n"
+            "  -n <count>:     # of puts.  default 10\n"
+            "  -w <sec>:       Timeout of each put.  default 30.0\n"
+            "\n");
+}
+
+struct PutHandler : public pvas::SharedPV::Handler
+{
+    const bool posting;
+    epicsMutex mutex;
+    size_t puts, byReference, inPlace;
+    const void *last;
+
+    explicit PutHandler(bool posting) :posting(posting), puts(0u), byReference(0u), inPlace(0u), last(0) {}
+    virtual ~PutHandler() {}
+
+    virtual void onPut(const pvas::SharedPV::shared_pointer& pv, pvas::Operation& op) OVERRIDE FINAL
+    {
+        const void *received;
+        size_t count;
+        {
+            pvd::shared_vector<const double> arr(op.value().getSubFieldT<pvd::PVDoubleArray>("value")->view());
+            received = arr.data();
+            count = arr.size();
+        }
+
+        if(!posting) {
+            op.complete();
+
+            Guard G(mutex);
+            puts++;
+            if(received==last)
+                inPlace++;
+            last = received;
+            return;
+        }
+
+        pv->post(op.value(), op.changed());
+        op.complete();
+
+        pvd::PVStructurePtr current(pv->build());
+        pvd::BitSet valid;
+        pv->fetch(*current, valid);
+        pvd::shared_vector<const double> held(current->getSubFieldT<pvd::PVDoubleArray>("value")->view());
+
+        Guard G(mutex);
+        puts++;
+        if(held.data()==received && held.size()==count)
+            byReference++;
+    }
+};
+
+pvas::SharedPV::shared_pointer makePV(const std::tr1::shared_ptr<PutHandler>& handler)
+{
+    pvas::SharedPV::shared_pointer pv(pvas::SharedPV::build(handler));
+    pvd::PVStructurePtr initial(pvd::getPVDataCreate()->createPVStructure(
+                                    pvd::getFieldCreate()->createFieldBuilder()
+                                    ->addArray("value", pvd::pvDouble)
+                                    ->createStructure()));
+    pv->open(*initial);
+    return pv;
+}
+
+double medianPut(pvac::ClientChannel& channel, size_t nelem, size_t count, double timeout)
+{
+    std::vector<double> times;
+    for(size_t n=0; n<count; n++) {
+        pvd::shared_vector<double> payload(nelem);
+        for(size_t i=0; i<nelem; i++)
+            payload[i] = double(i+n);
+
+        epicsTime start(epicsTime::getCurrent());
+        channel.put()
+                .set("value", pvd::freeze(payload))
+                .exec(timeout);
+        times.push_back(epicsTime::getCurrent() - start);
+    }
+
+    std::sort(times.begin(), times.end());
+    return times[times.size()/2u];
+}
+
+double measureMemcpy(size_t nbytes, size_t count)
+{
+    std::vector<char> src(nbytes, 1), dest(nbytes);
+
+    epicsTime start(epicsTime::getCurrent());
+    for(size_t i=0; i<count; i++) {
+        src[i%nbytes]++;
+        memcpy(&dest[0], &src[0], nbytes);
+    }
+    double elapsed = epicsTime::getCurrent() - start;
+    volatile char sink = dest[nbytes-1u]; // not optimized away
+    (void)sink;
+    return elapsed/count;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    size_t nelem = 13107200u;
+    size_t count = 10u;
+    double timeout = 30.0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, ":hs:n:w:")) != -1) {
+        bool ok = true;
+        switch (opt) {
+        case 'h':
+            usage();
+            return 0;
+        case 's': {
+            epicsUInt32 val;
+            ok = !epicsParseUInt32(optarg, &val, 0, NULL) && val>0u;
+            nelem = val;
+            break;
+        }
+        case 'n': {
+            epicsUInt32 val;
+            ok = !epicsParseUInt32(optarg, &val, 0, NULL) && val>0u;
+            count = val;
+            break;
+        }
+        case 'w': ok = epicsScanDouble(optarg, &timeout)==1 && timeout>0.0; break;
+        default:
+            usage();
+            return 1;
+        }
+        if(!ok) {
+            fprintf(stderr, "Invalid argument -%c '%s'\n", opt, optarg);
+            return 1;
+        }
+    }
+
+    try {
+        std::tr1::shared_ptr<PutHandler> posting(new PutHandler(true)),
+                                         inplace(new PutHandler(false));
+
+        pvas::StaticProvider local("local");
+        local.add("bigput", makePV(posting));
+        local.add("bigput:inplace", makePV(inplace));
+
+        pva::ServerContext::shared_pointer server(pva::ServerContext::create(
+                                                      pva::ServerContext::Config()
+                                                      .provider(local.provider())
+                                                      .config(pva::ConfigurationBuilder()
+                                                              .add("EPICS_PVAS_INTF_ADDR_LIST", "127.0.0.1")
+                                                              .add("EPICS_PVA_ADDR_LIST", "127.0.0.1")
+                                                              .add("EPICS_PVA_AUTO_ADDR_LIST","0")
+                                                              .add("EPICS_PVA_SERVER_PORT", "0")
+                                                              .add("EPICS_PVA_BROADCAST_PORT", "0")
+                                                              .push_map()
+                                                              .build())));
+        pva::ClientFactory::start();
+        pvac::ClientProvider provider("pva", server->getCurrentConfig());
+        pvac::ClientChannel postchan(provider.connect("bigput")),
+                            inplacechan(provider.connect("bigput:inplace"));
+
+        const size_t nbytes = nelem*sizeof(double);
+
+        const double median = medianPut(postchan, nelem, count, timeout);
+        const double medianInPlace = medianPut(inplacechan, nelem, count, timeout);
+        const double copy = measureMemcpy(nbytes, 5u);
+
+        size_t puts, byReference, inplacePuts, inPlace;
+        {
+            Guard G(posting->mutex);
+            puts = posting->puts;
+            byReference = posting->byReference;
+        }
+        {
+            Guard G(inplace->mutex);
+            inplacePuts = inplace->puts;
+            inPlace = inplace->inPlace;
+        }
+
+        printf("# %zu puts of %zu bytes\n", count, nbytes);
+        printf("%-32s %10.1f\n", "memcpy MB/s", nbytes/copy/1e6);
+        printf("%-32s %10.1f\n", "posted put median (ms)", median*1e3);
+        printf("%-32s %10.1f\n", "posted put MB/s", nbytes/median/1e6);
+        printf("%-32s %10.2f\n", "posted memcpy equivalents", median/copy);
+        printf("%-32s %10.1f\n", "in place put median (ms)", medianInPlace*1e3);
+        printf("%-32s %10.2f\n", "in place memcpy equivalents", medianInPlace/copy);
+        printf("%-32s %10.2f\n", "posted - in place", (median-medianInPlace)/copy);
+        printf("%-32s %6zu/%zu\n", "posted by reference", byReference, puts);
+        printf("%-32s %6zu/%zu\n", "received in place", inPlace, inplacePuts ? inplacePuts-1u : 0u);
+
+        return byReference==puts && puts==count
+                && inplacePuts==count && inPlace+1u==count ? 0 : 1;
+
+    }catch(std::exception& e){
+        fprintf(stderr, "Error: %s\n", e.what());
+        return 2;
+    }
+}
@@ -1,4 +1,9 @@
 
+#include <vector>
+
+#include <epicsEvent.h>
+#include <epicsGuard.h>
+
 #include <pv/epicsException.h>
 #include <pv/valueBuilder.h>
 
@@ -68,6 +73,74 @@ void testSum(const pva::ChannelProvider::shared_pointer& cli_prov)
 
 
 
+pvd::PVStructurePtr sumArgs(double lhs, double rhs)
+{
+    pvd::ValueBuilder args("epics:nt/NTURI:1.0");
+    args.add<pvd::pvString>("scheme", "pva")
+        .add<pvd::pvString>("path", "sum");
+    return args.addNested("query")
+                   .add<pvd::pvDouble>("lhs", lhs)
+                   .add<pvd::pvDouble>("rhs", rhs)
+               .endNested()
+               .buildPVStructure();
+}
+
+struct SumCallback : public pva::RPCClient::Callback
+{
+    epicsMutex lock;
+    epicsEvent done;
+    size_t count;
+    double total;
+    SumCallback() :count(0u), total(0.0) {}
+    virtual ~SumCallback() {}
+    virtual void requestDone(const pvd::Status& status,
+                             pvd::PVStructure::shared_pointer const & response) OVERRIDE FINAL
+    {
+        {
+            epicsGuard<epicsMutex> G(lock);
+            count++;
+            if(status.isSuccess())
+                total += response->getSubFieldT<pvd::PVScalar>("value")->getAs<double>();
+        }
+        done.signal();
+    }
+};
+
+void testSumAsync(const pva::ChannelProvider::shared_pointer& cli_prov)
+{
+    testDiag("Concurrent requests");
+
+    pva::RPCClient client("sum", pvd::createRequest("field()"), cli_prov);
+
+    std::vector<pva::RPCClient::Future::shared_pointer> futures;
+    for(size_t i=0; i<4; i++)
+        futures.push_back(client.issueAsync(sumArgs(double(i), 1.0)));
+
+    for(size_t i=0; i<futures.size(); i++) {
+        try {
+            pvd::PVStructurePtr reply(futures[i]->wait());
+            pvd::int32 value = reply->getSubFieldT<pvd::PVScalar>("value")->getAs<pvd::int32>();
+            testOk(value==pvd::int32(i+1), "Reply[%u] value = %d", unsigned(i), (int)value);
+        } catch(std::exception& e) {
+            testFail("Reply[%u] error: %s", unsigned(i), e.what());
+        }
+    }
+
+    std::tr1::shared_ptr<SumCallback> cb(new SumCallback);
+    for(size_t i=0; i<3; i++)
+        client.issueAsync(sumArgs(double(i), 0.0), cb);
+
+    {
+        epicsGuard<epicsMutex> G(cb->lock);
+        while(cb->count<3u) {
+            epicsGuardRelease<epicsMutex> U(G);
+            if(!cb->done.wait(5.0))
+                break;
+        }
+        testOk(cb->count==3u && cb->total==3.0, "Callbacks %u total %f", unsigned(cb->count), cb->total);
+    }
+}
+
 struct FailService : public pva::RPCService
 {
     virtual epics::pvData::PVStructure::shared_pointer request(
@@ -110,7 +183,7 @@ void testRPCFail(const pva::ChannelProvider::shared_pointer& cli_prov)
 
 MAIN(testRPC)
 {
-    testPlan(3);
+    testPlan(8);
     try {
         pva::Configuration::shared_pointer conf(pva::ConfigurationBuilder()
                                                 //.push_env()
@@ -147,6 +220,7 @@ MAIN(testRPC)
         testDiag("Client Ready");
 
         testSum(cli_prov);
+        testSumAsync(cli_prov);
         testRPCFail(cli_prov);
 
     }catch(std::exception& e){
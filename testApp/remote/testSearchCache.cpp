@@ -0,0 +1,137 @@
+/**
+ * Copyright - See the COPYRIGHT that is included with this distribution.
+ * pvAccessCPP is distributed subject to a Software License Agreement found
+ * in file LICENSE that is included with this distribution.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <fstream>
+
+#include <osiSock.h>
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <pv/pvUnitTest.h>
+
+#include <pv/searchCache.h>
+#include <pv/inetAddressUtil.h>
+
+namespace pva = epics::pvAccess;
+
+namespace {
+
+const char fname[] = "testSearchCache.tmp";
+
+osiSockAddr mkaddr(const char *str)
+{
+    osiSockAddr ret;
+    memset(&ret, 0, sizeof(ret));
+    if(aToIPAddr(str, 0, &ret.ia))
+        testAbort("Bad address %s", str);
+    return ret;
+}
+
+pva::ServerGUID mkguid(char fill)
+{
+    pva::ServerGUID ret;
+    memset(ret.value, fill, sizeof(ret.value));
+    return ret;
+}
+
+bool lookupAt(const pva::SearchCache& cache, const char *name, const char *addr, char guid)
+{
+    pva::SearchCache::Entry ent;
+    if(!cache.lookup(name, ent)) {
+        testDiag("No entry for %s", name);
+        return false;
+    }
+    testDiag("%s -> %s", name, pva::inetAddressToString(ent.address).c_str());
+    return pva::inetAddressToString(ent.address)==addr && memcmp(ent.guid.value, mkguid(guid).value, sizeof(ent.guid.value))==0;
+}
+
+void testUpdate()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+    pva::SearchCache cache(fname, 0.0);
+
+    pva::SearchCache::Entry ent;
+    testOk1(!cache.lookup("pv:a", ent));
+
+    cache.update("pv:a", mkaddr("10.1.2.3:5075"), mkguid(1));
+    cache.update("pv:b", mkaddr("10.1.2.3:5075"), mkguid(1));
+    cache.update("pv:c", mkaddr("10.1.2.4:5075"), mkguid(2));
+    testEqual(cache.size(), 3u);
+    testOk1(lookupAt(cache, "pv:a", "10.1.2.3:5075", 1));
+
+    testDiag("Server at 10.1.2.3 restarts, and is found to have pv:b");
+    cache.update("pv:b", mkaddr("10.1.2.3:5075"), mkguid(3));
+    testOk1(!cache.lookup("pv:a", ent));
+    testOk1(lookupAt(cache, "pv:b", "10.1.2.3:5075", 3));
+    testOk1(lookupAt(cache, "pv:c", "10.1.2.4:5075", 2));
+
+    cache.remove("pv:c");
+    testOk1(!cache.lookup("pv:c", ent));
+    testEqual(cache.size(), 1u);
+}
+
+void testSaveLoad()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+    ::remove(fname);
+
+    {
+        pva::SearchCache cache(fname, 0.0);
+        cache.load(); // missing file is not an error
+        testEqual(cache.size(), 0u);
+
+        cache.update("pv:a", mkaddr("10.1.2.3:5075"), mkguid(1));
+        cache.update("pv:c", mkaddr("10.1.2.4:5075"), mkguid(2));
+        cache.save();
+    }
+    {
+        // another process adds an entry
+        pva::SearchCache cache(fname, 0.0);
+        cache.load();
+        testEqual(cache.size(), 2u);
+        cache.update("pv:d", mkaddr("10.1.2.5:5075"), mkguid(4));
+        cache.save();
+    }
+    {
+        std::ofstream strm(fname, std::ios::app);
+        strm<<"# comment\n"
+              "pv:bad 10.1.2.6:5075 nothex 0\n"
+              "pv:old 10.1.2.7:5075 050505050505050505050505 1\n";
+    }
+    {
+        pva::SearchCache cache(fname, 3600.0);
+        cache.load();
+        testEqual(cache.size(), 3u);
+        testOk1(lookupAt(cache, "pv:a", "10.1.2.3:5075", 1));
+        testOk1(lookupAt(cache, "pv:c", "10.1.2.4:5075", 2));
+        testOk1(lookupAt(cache, "pv:d", "10.1.2.5:5075", 4));
+
+        pva::SearchCache::Entry ent;
+        testOk(!cache.lookup("pv:old", ent), "Expired entry ignored");
+    }
+    {
+        pva::SearchCache cache(fname, 0.0);
+        cache.load();
+        testOk(cache.size()==4u, "No age limit %u", unsigned(cache.size()));
+    }
+
+    ::remove(fname);
+}
+
+} // namespace
+
+MAIN(testSearchCache)
+{
+    testPlan(16);
+    osiSockAttach();
+    testUpdate();
+    testSaveLoad();
+    osiSockRelease();
+    return testDone();
+}
@@ -0,0 +1,278 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+/* SharedPV::Handler callbacks run by a pvas::Executor
+ */
+
+#include <vector>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+#include <epicsThread.h>
+#include <epicsEvent.h>
+#include <epicsMutex.h>
+#include <epicsGuard.h>
+
+#include <pv/pvUnitTest.h>
+#include <pv/current_function.h>
+#include <pv/pvData.h>
+#include <pva/client.h>
+#include <pva/server.h>
+#include <pva/sharedstate.h>
+#include <pva/executor.h>
+
+namespace pvd = epics::pvData;
+
+namespace {
+
+typedef epicsGuard<epicsMutex> Guard;
+typedef epicsGuardRelease<epicsMutex> UnGuard;
+
+// Puts wait until the gate is opened
+struct GateHandler : public pvas::SharedPV::Handler
+{
+    epicsMutex mutex;
+    epicsEvent wakeup, entered;
+    bool open;
+    size_t active, maxActive;
+    std::vector<double> order;
+    std::vector<epicsThreadId> threads;
+
+    GateHandler() :open(true), active(0u), maxActive(0u) {}
+    virtual ~GateHandler() {}
+
+    void setOpen(bool o)
+    {
+        {
+            Guard G(mutex);
+            open = o;
+        }
+        if(o)
+            wakeup.signal();
+    }
+
+    virtual void onPut(const pvas::SharedPV::shared_pointer& pv, pvas::Operation& op) OVERRIDE FINAL
+    {
+        {
+            Guard G(mutex);
+            active++;
+            if(maxActive<active)
+                maxActive = active;
+            threads.push_back(epicsThreadGetIdSelf());
+        }
+        entered.signal();
+        {
+            Guard G(mutex);
+            while(!open) {
+                UnGuard U(G);
+                wakeup.wait();
+            }
+        }
+        wakeup.signal(); // pass on
+
+        {
+            Guard G(mutex);
+            order.push_back(op.value().getSubFieldT<pvd::PVDouble>("value")->get());
+            active--;
+        }
+        pv->post(op.value(), op.changed());
+        op.complete();
+    }
+};
+
+struct Putter : public pvac::ClientChannel::PutCallback
+{
+    const double val;
+    epicsEvent done;
+    pvac::PutEvent result;
+    pvac::Operation op;
+
+    explicit Putter(double val) :val(val) {}
+    virtual ~Putter() {}
+
+    virtual void putBuild(const pvd::StructureConstPtr& build, pvac::ClientChannel::PutCallback::Args& args) OVERRIDE FINAL
+    {
+        pvd::PVStructurePtr root(pvd::getPVDataCreate()->createPVStructure(build));
+        pvd::PVDoublePtr value(root->getSubFieldT<pvd::PVDouble>("value"));
+        value->put(val);
+        args.tosend.set(value->getFieldOffset());
+        args.root = root;
+    }
+    virtual void putDone(const pvac::PutEvent& evt) OVERRIDE FINAL
+    {
+        result = evt;
+        done.signal();
+    }
+};
+
+pvas::SharedPV::shared_pointer makePV(const std::tr1::shared_ptr<GateHandler>& handler,
+                                      const pvas::Executor::shared_pointer& exec,
+                                      size_t queueLimit)
+{
+    pvas::SharedPV::Config conf;
+    conf.executor = exec;
+    conf.queueLimit = queueLimit;
+    pvas::SharedPV::shared_pointer pv(pvas::SharedPV::build(handler, &conf));
+    pv->open(pvd::getFieldCreate()->createFieldBuilder()
+             ->add("value", pvd::pvDouble)
+             ->createStructure());
+    return pv;
+}
+
+void testWorker()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    pvas::Executor::shared_pointer exec(new pvas::Executor);
+    std::tr1::shared_ptr<GateHandler> handler(new GateHandler);
+    pvas::StaticProvider prov("test");
+    prov.add("pv", makePV(handler, exec, 64u));
+
+    pvac::ClientProvider cli(prov.provider());
+    pvac::ClientChannel chan(cli.connect("pv"));
+
+    chan.put().set("value", 1.0).exec();
+
+    Guard G(handler->mutex);
+    testEqual(handler->threads.size(), 1u);
+    testOk(handler->threads.size()==1u && handler->threads[0]!=epicsThreadGetIdSelf(),
+           "onPut() not called by the requesting thread");
+}
+
+void testOrdered()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    pvas::Executor::shared_pointer exec(new pvas::Executor);
+    std::tr1::shared_ptr<GateHandler> handler(new GateHandler);
+    pvas::StaticProvider prov("test");
+    prov.add("pv", makePV(handler, exec, 64u));
+
+    pvac::ClientProvider cli(prov.provider());
+    pvac::ClientChannel chan(cli.connect("pv"));
+
+    // onFirstConnect() is queued after the first onPut(), so complete one put beforehand
+    chan.put().set("value", 0.0).exec();
+    handler->entered.tryWait();
+    {
+        Guard G(handler->mutex);
+        handler->order.clear();
+    }
+
+    handler->setOpen(false);
+
+    Putter A(1.0), B(2.0), C(3.0);
+    A.op = chan.put(&A);
+    testOk1(handler->entered.wait(5.0));
+    B.op = chan.put(&B);
+    C.op = chan.put(&C);
+
+    testEqual(exec->pending(), 2u);
+
+    handler->setOpen(true);
+    testOk1(A.done.wait(5.0) && B.done.wait(5.0) && C.done.wait(5.0));
+
+    Guard G(handler->mutex);
+    testEqual(handler->maxActive, 1u);
+    testOk(handler->order.size()==3u
+           && handler->order[0]==1.0 && handler->order[1]==2.0 && handler->order[2]==3.0,
+           "in order");
+}
+
+void testLimit()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    pvas::Executor::shared_pointer exec(new pvas::Executor);
+    std::tr1::shared_ptr<GateHandler> handler(new GateHandler);
+    pvas::StaticProvider prov("test");
+    prov.add("pv", makePV(handler, exec, 1u));
+
+    pvac::ClientProvider cli(prov.provider());
+    pvac::ClientChannel chan(cli.connect("pv"));
+
+    handler->setOpen(false);
+
+    Putter A(1.0), B(2.0), C(3.0);
+    A.op = chan.put(&A);
+    testOk1(handler->entered.wait(5.0));
+    B.op = chan.put(&B); // waits
+    C.op = chan.put(&C); // rejected
+
+    testOk1(C.done.wait(5.0));
+    testEqual(C.result.event, pvac::PutEvent::Fail);
+    testDiag("message '%s'", C.result.message.c_str());
+
+    handler->setOpen(true);
+    testOk1(A.done.wait(5.0) && B.done.wait(5.0));
+    testEqual(A.result.event, pvac::PutEvent::Success);
+    testEqual(B.result.event, pvac::PutEvent::Success);
+}
+
+void testIndependent()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    pvas::Executor::shared_pointer exec(new pvas::Executor);
+    std::tr1::shared_ptr<GateHandler> slow(new GateHandler),
+                                      fast(new GateHandler);
+    pvas::StaticProvider prov("test");
+    prov.add("slow", makePV(slow, exec, 64u));
+    prov.add("fast", makePV(fast, exec, 64u));
+
+    pvac::ClientProvider cli(prov.provider());
+    pvac::ClientChannel slowchan(cli.connect("slow")),
+                        fastchan(cli.connect("fast"));
+
+    slow->setOpen(false);
+
+    Putter A(1.0);
+    A.op = slowchan.put(&A);
+    testOk1(slow->entered.wait(5.0));
+
+    // not blocked by the put to "slow"
+    fastchan.put().set("value", 2.0).exec(5.0);
+    testPass("put to other PV completes");
+
+    slow->setOpen(true);
+    testOk1(A.done.wait(5.0));
+}
+
+void testClosed()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    pvas::Executor::shared_pointer exec(new pvas::Executor);
+    std::tr1::shared_ptr<GateHandler> handler(new GateHandler);
+    pvas::StaticProvider prov("test");
+    prov.add("pv", makePV(handler, exec, 64u));
+
+    exec->close();
+
+    pvac::ClientProvider cli(prov.provider());
+    pvac::ClientChannel chan(cli.connect("pv"));
+
+    chan.put().set("value", 1.0).exec();
+
+    Guard G(handler->mutex);
+    testOk(handler->threads.size()==1u && handler->threads[0]==epicsThreadGetIdSelf(),
+           "onPut() called by the requesting thread after close()");
+}
+
+} // namespace
+
+MAIN(testSharedExecutor)
+{
+    testPlan(17);
+    try {
+        testWorker();
+        testOrdered();
+        testLimit();
+        testIndependent();
+        testClosed();
+    }catch(std::exception& e){
+        testAbort("Unexpected exception: %s", e.what());
+    }
+    return testDone();
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <stdio.h>
+
+#include <fstream>
+#include <iterator>
+
+#include <epicsThread.h>
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <pv/pvUnitTest.h>
+#include <pv/current_function.h>
+#include <pv/pvData.h>
+#include <pva/sharedstate.h>
+#include <pva/snapshot.h>
+
+namespace pvd = epics::pvData;
+
+namespace {
+
+const char fname[] = "testSharedSnapshot.tmp";
+
+const pvd::StructureConstPtr type(pvd::getFieldCreate()->createFieldBuilder()
+                                  ->add("value", pvd::pvInt)
+                                  ->addArray("wave", pvd::pvDouble)
+                                  ->add("desc", pvd::pvString)
+                                  ->createStructure());
+
+void postValue(pvas::SharedPV& pv, pvd::int32 val)
+{
+    pvd::PVStructurePtr inst(pvd::getPVDataCreate()->createPVStructure(type));
+    pvd::BitSet changed;
+
+    inst->getSubFieldT<pvd::PVInt>("value")->put(val);
+    changed.set(inst->getSubFieldT<pvd::PVInt>("value")->getFieldOffset());
+
+    pvd::PVDoubleArray::svector wave(100000);
+    for(size_t i=0; i<wave.size(); i++)
+        wave[i] = double(i) + val;
+    inst->getSubFieldT<pvd::PVDoubleArray>("wave")->replace(pvd::freeze(wave));
+    changed.set(inst->getSubFieldT<pvd::PVDoubleArray>("wave")->getFieldOffset());
+
+    pv.post(*inst, changed);
+}
+
+void testSaveRestore()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+    ::remove(fname);
+
+    {
+        pvas::SharedPVSnapshot snap(fname);
+        testEqual(snap.load(), 0u); // missing file is not an error
+
+        pvas::SharedPV::shared_pointer a(pvas::SharedPV::buildReadOnly()),
+                                       b(pvas::SharedPV::buildReadOnly()),
+                                       closed(pvas::SharedPV::buildReadOnly());
+        testOk1(!snap.add("pv:a", a));
+        testOk1(!snap.add("pv:b", b));
+        testOk1(!snap.add("pv:closed", closed));
+        testEqual(snap.size(), 3u);
+
+        a->open(type);
+        b->open(type);
+        postValue(*a, 42);
+
+        snap.save();
+    }
+    {
+        // an IOC restarts
+        pvas::SharedPVSnapshot snap(fname);
+        testEqual(snap.load(), 2u);
+
+        pvas::SharedPV::shared_pointer a(pvas::SharedPV::buildReadOnly()),
+                                       b(pvas::SharedPV::buildReadOnly()),
+                                       closed(pvas::SharedPV::buildReadOnly());
+        testOk1(snap.add("pv:a", a));
+        testOk1(a->isOpen());
+        testOk1(snap.add("pv:b", b));
+        testOk1(!snap.add("pv:closed", closed));
+        testOk1(!closed->isOpen());
+
+        pvd::PVStructurePtr value(a->build());
+        pvd::BitSet valid;
+        a->fetch(*value, valid);
+
+        testEqual(value->getSubFieldT<pvd::PVInt>("value")->get(), 42);
+        pvd::PVDoubleArray::const_svector wave(value->getSubFieldT<pvd::PVDoubleArray>("wave")->view());
+        testOk(wave.size()==100000u && wave[0]==42.0 && wave[99999]==99999.0+42.0,
+               "wave restored %u", unsigned(wave.size()));
+        testOk1(valid.get(value->getSubFieldT<pvd::PVInt>("value")->getFieldOffset()));
+        testOk1(!valid.get(value->getSubFieldT<pvd::PVString>("desc")->getFieldOffset()));
+    }
+
+    ::remove(fname);
+}
+
+void testPeriodic()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+    ::remove(fname);
+
+    pvas::SharedPV::shared_pointer a(pvas::SharedPV::buildReadOnly());
+    {
+        pvas::SharedPVSnapshot snap(fname);
+        snap.add("pv:a", a);
+        a->open(type);
+        postValue(*a, 1);
+
+        snap.start(0.1);
+        epicsThreadSleep(0.5);
+        postValue(*a, 2);
+        epicsThreadSleep(0.5);
+        snap.stop();
+    }
+    {
+        pvas::SharedPVSnapshot snap(fname);
+        testEqual(snap.load(), 1u);
+
+        pvas::SharedPV::shared_pointer b(pvas::SharedPV::buildReadOnly());
+        snap.add("pv:a", b);
+
+        pvd::PVStructurePtr value(b->build());
+        pvd::BitSet valid;
+        b->fetch(*value, valid);
+        testEqual(value->getSubFieldT<pvd::PVInt>("value")->get(), 2);
+    }
+
+    ::remove(fname);
+}
+
+void testCorrupt()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+    ::remove(fname);
+
+    {
+        pvas::SharedPVSnapshot snap(fname);
+        pvas::SharedPV::shared_pointer a(pvas::SharedPV::buildReadOnly());
+        snap.add("pv:a", a);
+        a->open(type);
+        postValue(*a, 3);
+        snap.save();
+    }
+    {
+        // truncate
+        std::ifstream in(fname, std::ios::binary);
+        std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+        std::ofstream out(fname, std::ios::binary | std::ios::trunc);
+        out.write(content.c_str(), content.size()/2u);
+    }
+    {
+        pvas::SharedPVSnapshot snap(fname);
+        testEqual(snap.load(), 0u);
+    }
+    {
+        std::ofstream out(fname, std::ios::binary | std::ios::trunc);
+        out<<"not a snapshot";
+    }
+    {
+        pvas::SharedPVSnapshot snap(fname);
+        testEqual(snap.load(), 0u);
+    }
+
+    ::remove(fname);
+}
+
+} // namespace
+
+MAIN(testSharedSnapshot)
+{
+    testPlan(19);
+    try {
+        testSaveRestore();
+        testPeriodic();
+        testCorrupt();
+    }catch(std::exception& e){
+        testAbort("Unexpected exception: %s", e.what());
+    }
+    return testDone();
+}
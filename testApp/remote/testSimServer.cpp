@@ -0,0 +1,460 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+/* Simulation server for measuring server CPU usage.
+ *
+ * Serves configurable numbers of NTScalar, NTScalarArray, NTEnum, and NTNDArray PVs
+ * through pvas::SharedPV, updated at a fixed rate by one or more threads.
+ * Periodically prints the update rate, and process CPU time per update.
+ *
+ * The NTScalarArray waveform follows SimADC in testADCSim.cpp .
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <signal.h>
+#define USE_SIGNAL
+#endif
+
+#include <epicsStdlib.h>
+#include <epicsGetopt.h>
+#include <epicsEvent.h>
+#include <epicsMutex.h>
+#include <epicsGuard.h>
+#include <epicsThread.h>
+#include <epicsTime.h>
+
+#include <pv/pvData.h>
+#include <pv/standardField.h>
+#include <pv/configuration.h>
+#include <pv/serverContext.h>
+#include <pva/server.h>
+#include <pva/sharedstate.h>
+
+namespace pvd = epics::pvData;
+namespace pva = epics::pvAccess;
+
+namespace {
+
+typedef epicsGuard<epicsMutex> Guard;
+
+epicsEvent done;
+
+#ifdef USE_SIGNAL
+void alldone(int num)
+{
+    (void)num;
+    done.signal();
+}
+#endif
+
+void usage()
+{
+    fprintf(stderr, "\nUsage: testSimServer [options]\n\n"
+            "  -h:             Help: Print this message\n"
+            "  -p <prefix>:    PV name prefix.  default 'sim:'\n"
+            "  -s <count>:     Number of NTScalar PVs.  default 10\n"
+            "  -a <count>:     Number of NTScalarArray PVs.  default 10\n"
+            "  -e <count>:     Number of NTEnum PVs.  default 10\n"
+            "  -i <count>:     Number of NTNDArray PVs.  default 1\n"
+            "  -n <length>:    NTScalarArray length.  default 1000\n"
+            "  -x <width>:     NTNDArray width.  default 640\n"
+            "  -y <height>:    NTNDArray height.  default 480\n"
+            "  -r <hz>:        Updates per second of each PV.  0 for as fast as possible.  default 1.0\n"
+            "  -t <threads>:   Number of update threads.  default 1\n"
+            "  -S <sec>:       Interval between statistics.  default 10.0\n"
+            "\n"
+            "PV names are <prefix><type><index>.  eg. sim:scalar0, sim:array0, sim:enum0, sim:image0\n"
+            "\n");
+}
+
+enum kind_t {Scalar, Array, Enum, Image};
+
+struct Params {
+    size_t nelements;
+    size_t width, height;
+};
+
+pvd::StructureConstPtr buildType(kind_t kind)
+{
+    pvd::StandardFieldPtr standard(pvd::getStandardField());
+    pvd::FieldBuilderPtr builder(pvd::getFieldCreate()->createFieldBuilder());
+
+    switch(kind) {
+    case Scalar:
+        builder = builder->setId("epics:nt/NTScalar:1.0")
+                         ->add("value", pvd::pvDouble)
+                         ->add("display", standard->display())
+                         ->add("control", standard->control());
+        break;
+    case Array:
+        builder = builder->setId("epics:nt/NTScalarArray:1.0")
+                         ->addArray("value", pvd::pvDouble)
+                         ->add("display", standard->display());
+        break;
+    case Enum:
+        builder = builder->setId("epics:nt/NTEnum:1.0")
+                         ->add("value", standard->enumerated());
+        break;
+    case Image:
+        builder = builder->setId("epics:nt/NTNDArray:1.0")
+                         ->addNestedUnion("value")
+                             ->addArray("ubyteValue", pvd::pvUByte)
+                         ->endNested()
+                         ->addNestedStructure("codec")
+                             ->add("name", pvd::pvString)
+                             ->add("parameters", pvd::getFieldCreate()->createVariantUnion())
+                         ->endNested()
+                         ->add("compressedSize", pvd::pvLong)
+                         ->add("uncompressedSize", pvd::pvLong)
+                         ->addNestedStructureArray("dimension")
+                             ->setId("dimension_t")
+                             ->add("size", pvd::pvInt)
+                             ->add("offset", pvd::pvInt)
+                             ->add("fullSize", pvd::pvInt)
+                             ->add("binning", pvd::pvInt)
+                             ->add("reverse", pvd::pvBoolean)
+                         ->endNested()
+                         ->add("uniqueId", pvd::pvInt)
+                         ->add("dataTimeStamp", standard->timeStamp());
+        break;
+    }
+
+    return builder->add("alarm", standard->alarm())
+                  ->add("timeStamp", standard->timeStamp())
+                  ->createStructure();
+}
+
+// one simulated PV, and the container used to post() updates to it
+struct SimPV {
+    const kind_t kind;
+    const Params& params;
+    const pvas::SharedPV::shared_pointer pv;
+    const pvd::PVStructurePtr value;
+    pvd::BitSet changed;
+    double phase;
+    pvd::uint32 counter;
+
+    pvd::PVScalarPtr secs, nanos;
+
+    SimPV(kind_t kind, const Params& params, const pvd::StructureConstPtr& type, double phase)
+        :kind(kind)
+        ,params(params)
+        ,pv(pvas::SharedPV::buildReadOnly())
+        ,value(pvd::getPVDataCreate()->createPVStructure(type))
+        ,phase(phase)
+        ,counter(0u)
+        ,secs(value->getSubFieldT<pvd::PVScalar>("timeStamp.secondsPastEpoch"))
+        ,nanos(value->getSubFieldT<pvd::PVScalar>("timeStamp.nanoseconds"))
+    {
+        changed.set(secs->getFieldOffset())
+               .set(nanos->getFieldOffset());
+
+        switch(kind) {
+        case Scalar: {
+            value->getSubFieldT<pvd::PVScalar>("display.units")->putFrom<std::string>("V");
+            value->getSubFieldT<pvd::PVScalar>("display.limitLow")->putFrom<double>(-1.0);
+            value->getSubFieldT<pvd::PVScalar>("display.limitHigh")->putFrom<double>(1.0);
+            changed.set(value->getSubFieldT<pvd::PVField>("value")->getFieldOffset());
+            break;
+        }
+        case Array:
+            value->getSubFieldT<pvd::PVScalar>("display.units")->putFrom<std::string>("V");
+            changed.set(value->getSubFieldT<pvd::PVField>("value")->getFieldOffset());
+            break;
+        case Enum: {
+            pvd::PVStringArray::svector choices(4);
+            choices[0] = "Idle";
+            choices[1] = "Acquire";
+            choices[2] = "Readout";
+            choices[3] = "Fault";
+            value->getSubFieldT<pvd::PVStringArray>("value.choices")->replace(pvd::freeze(choices));
+            changed.set(value->getSubFieldT<pvd::PVField>("value.index")->getFieldOffset());
+            break;
+        }
+        case Image: {
+            pvd::PVStructureArrayPtr dimension(value->getSubFieldT<pvd::PVStructureArray>("dimension"));
+            pvd::PVStructureArray::svector dims(2);
+            const size_t sizes[2] = {params.width, params.height};
+            for(size_t i=0; i<2; i++) {
+                dims[i] = pvd::getPVDataCreate()->createPVStructure(dimension->getStructureArray()->getStructure());
+                dims[i]->getSubFieldT<pvd::PVScalar>("size")->putFrom<pvd::int32>(sizes[i]);
+                dims[i]->getSubFieldT<pvd::PVScalar>("fullSize")->putFrom<pvd::int32>(sizes[i]);
+                dims[i]->getSubFieldT<pvd::PVScalar>("binning")->putFrom<pvd::int32>(1);
+            }
+            dimension->replace(pvd::freeze(dims));
+            const pvd::int64 nbytes = pvd::int64(params.width*params.height);
+            value->getSubFieldT<pvd::PVScalar>("compressedSize")->putFrom(nbytes);
+            value->getSubFieldT<pvd::PVScalar>("uncompressedSize")->putFrom(nbytes);
+            changed.set(value->getSubFieldT<pvd::PVField>("value")->getFieldOffset())
+                   .set(value->getSubFieldT<pvd::PVField>("uniqueId")->getFieldOffset())
+                   .set(value->getSubFieldT<pvd::PVField>("dataTimeStamp")->getFieldOffset());
+            break;
+        }
+        }
+
+        update(epicsTime::getCurrent());
+        pv->open(*value);
+    }
+
+    void update(const epicsTime& now)
+    {
+        const epicsTimeStamp ts(now);
+        secs->putFrom<pvd::int64>(pvd::int64(ts.secPastEpoch) + POSIX_TIME_AT_EPICS_EPOCH);
+        nanos->putFrom<pvd::int32>(pvd::int32(ts.nsec));
+        counter++;
+
+        switch(kind) {
+        case Scalar:
+            value->getSubFieldT<pvd::PVScalar>("value")->putFrom<double>(sin(phase + 0.1*counter));
+            break;
+        case Array: {
+            // as SimADC
+            pvd::PVDoubleArray::svector wave(params.nelements);
+            const double shift = phase + 0.1*counter;
+            for(size_t i=0; i<wave.size(); i++)
+                wave[i] = sin(0.1*i + shift);
+            value->getSubFieldT<pvd::PVDoubleArray>("value")->replace(pvd::freeze(wave));
+            break;
+        }
+        case Enum:
+            value->getSubFieldT<pvd::PVScalar>("value.index")->putFrom<pvd::uint32>(counter%4u);
+            break;
+        case Image: {
+            // moving diagonal gradient
+            pvd::PVUByteArray::svector pixels(params.width*params.height);
+            for(size_t y=0; y<params.height; y++) {
+                pvd::uint8 *row = &pixels[y*params.width];
+                for(size_t x=0; x<params.width; x++)
+                    row[x] = pvd::uint8(x + y + counter);
+            }
+            value->getSubFieldT<pvd::PVUnion>("value")->select<pvd::PVUByteArray>("ubyteValue")->replace(pvd::freeze(pixels));
+            value->getSubFieldT<pvd::PVScalar>("uniqueId")->putFrom<pvd::uint32>(counter);
+            value->getSubFieldT<pvd::PVScalar>("dataTimeStamp.secondsPastEpoch")->copy(*secs);
+            value->getSubFieldT<pvd::PVScalar>("dataTimeStamp.nanoseconds")->copy(*nanos);
+            break;
+        }
+        }
+    }
+
+    void post(const epicsTime& now)
+    {
+        update(now);
+        pv->post(*value, changed);
+    }
+};
+
+// updates a subset of all PVs
+struct Worker : public epicsThreadRunable
+{
+    epicsMutex mutex;
+    epicsEvent wakeup;
+    bool stop;
+    epicsUInt64 nupdates;
+
+    const double period;
+    std::vector<SimPV*> pvs;
+
+    epicsThread thread;
+
+    explicit Worker(double period)
+        :stop(false)
+        ,nupdates(0u)
+        ,period(period)
+        ,thread(*this, "simWorker",
+                epicsThreadGetStackSize(epicsThreadStackSmall),
+                epicsThreadPriorityMedium)
+    {}
+    virtual ~Worker()
+    {
+        {
+            Guard G(mutex);
+            stop = true;
+        }
+        wakeup.signal();
+        thread.exitWait();
+    }
+
+    virtual void run() OVERRIDE FINAL
+    {
+        epicsTime next(epicsTime::getCurrent());
+        while(true) {
+            {
+                Guard G(mutex);
+                if(stop)
+                    break;
+            }
+
+            epicsTime now(epicsTime::getCurrent());
+            for(size_t i=0; i<pvs.size(); i++)
+                pvs[i]->post(now);
+
+            {
+                Guard G(mutex);
+                nupdates += pvs.size();
+            }
+
+            if(period<=0.0)
+                continue;
+
+            next += period;
+            now = epicsTime::getCurrent();
+            double delay = next - now;
+            if(delay>0.0) {
+                wakeup.wait(delay);
+            } else {
+                next = now; // fell behind.  don't try to catch up
+            }
+        }
+    }
+
+    epicsUInt64 count()
+    {
+        Guard G(mutex);
+        return nupdates;
+    }
+};
+
+bool parseSize(const char *arg, size_t& out)
+{
+    epicsUInt32 val;
+    if(epicsParseUInt32(arg, &val, 0, NULL))
+        return false;
+    out = val;
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    std::string prefix("sim:");
+    size_t counts[4] = {10u, 10u, 10u, 1u};
+    const char * const names[4] = {"scalar", "array", "enum", "image"};
+    Params params;
+    params.nelements = 1000u;
+    params.width = 640u;
+    params.height = 480u;
+    double rate = 1.0, interval = 10.0;
+    size_t nthreads = 1u;
+
+    int opt;
+    while ((opt = getopt(argc, argv, ":hp:s:a:e:i:n:x:y:r:t:S:")) != -1) {
+        bool ok = true;
+        switch (opt) {
+        case 'h':
+            usage();
+            return 0;
+        case 'p': prefix = optarg; break;
+        case 's': ok = parseSize(optarg, counts[Scalar]); break;
+        case 'a': ok = parseSize(optarg, counts[Array]); break;
+        case 'e': ok = parseSize(optarg, counts[Enum]); break;
+        case 'i': ok = parseSize(optarg, counts[Image]); break;
+        case 'n': ok = parseSize(optarg, params.nelements); break;
+        case 'x': ok = parseSize(optarg, params.width); break;
+        case 'y': ok = parseSize(optarg, params.height); break;
+        case 't': ok = parseSize(optarg, nthreads) && nthreads>0u; break;
+        case 'r': ok = epicsScanDouble(optarg, &rate)==1 && rate>=0.0; break;
+        case 'S': ok = epicsScanDouble(optarg, &interval)==1 && interval>0.0; break;
+        default:
+            usage();
+            return 1;
+        }
+        if(!ok) {
+            fprintf(stderr, "Invalid argument -%c '%s'\n", opt, optarg);
+            return 1;
+        }
+    }
+
+    try {
+        pvas::StaticProvider provider("sim");
+        std::vector<SimPV*> pvs;
+
+        for(unsigned k=Scalar; k<=Image; k++) {
+            pvd::StructureConstPtr type(buildType(kind_t(k)));
+            for(size_t i=0; i<counts[k]; i++) {
+                std::ostringstream name;
+                name<<prefix<<names[k]<<i;
+                pvs.push_back(new SimPV(kind_t(k), params, type, 0.01*pvs.size()));
+                provider.add(name.str(), pvs.back()->pv);
+            }
+        }
+
+        pva::ServerContext::shared_pointer server(pva::ServerContext::create(pva::ServerContext::Config()
+                                                                             .provider(provider.provider())
+                                                                             .config(pva::ConfigurationBuilder()
+                                                                                     .push_env()
+                                                                                     .build())));
+#ifdef USE_SIGNAL
+        signal(SIGINT, alldone);
+        signal(SIGTERM, alldone);
+        signal(SIGQUIT, alldone);
+#endif
+        server->printInfo();
+
+        printf("Serving %zu scalar, %zu array[%zu], %zu enum, %zu image[%zux%zu] with %zu thread(s) at %.1f Hz\n",
+               counts[Scalar], counts[Array], params.nelements, counts[Enum],
+               counts[Image], params.width, params.height, nthreads, rate);
+
+        std::vector<Worker*> workers(nthreads);
+        for(size_t t=0; t<nthreads; t++)
+            workers[t] = new Worker(rate>0.0 ? 1.0/rate : 0.0);
+        // interleave so that each thread has a similar mix of types
+        for(size_t i=0; i<pvs.size(); i++)
+            workers[i%nthreads]->pvs.push_back(pvs[i]);
+        for(size_t t=0; t<nthreads; t++)
+            workers[t]->thread.start();
+
+        epicsTime prevTime(epicsTime::getCurrent());
+        clock_t prevCPU = clock();
+        epicsUInt64 prevCount = 0u;
+
+        while(!done.wait(interval)) {
+            epicsTime now(epicsTime::getCurrent());
+            clock_t cpu = clock();
+            epicsUInt64 count = 0u;
+            for(size_t t=0; t<nthreads; t++)
+                count += workers[t]->count();
+
+            const double elapsed = now - prevTime,
+                         cpusec = double(cpu - prevCPU)/CLOCKS_PER_SEC;
+            const epicsUInt64 nupdates = count - prevCount;
+
+            // CPU time includes that spent sending to subscribers.
+            // Divide by the number of subscribers for the cost of each.
+            printf("%.1f updates/s  CPU %.1f%%  %.2f us/update\n",
+                   nupdates/elapsed,
+                   100.0*cpusec/elapsed,
+                   nupdates ? 1e6*cpusec/nupdates : 0.0);
+            fflush(stdout);
+
+            prevTime = now;
+            prevCPU = cpu;
+            prevCount = count;
+        }
+
+        for(size_t t=0; t<nthreads; t++)
+            delete workers[t];
+
+        server.reset();
+
+        for(size_t i=0; i<pvs.size(); i++) {
+            pvs[i]->pv->close(true);
+            delete pvs[i];
+        }
+
+    } catch(std::exception& e){
+        std::cerr<<"Error: "<<e.what()<<"\n";
+        return 1;
+    }
+    return 0;
+}
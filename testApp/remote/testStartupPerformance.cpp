@@ -0,0 +1,152 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+/* Measure the time taken by a single shot get, as done by pvget,
+ * including client context creation and destruction.
+ *
+ * Compares the default (eager) client context with $EPICS_PVA_CLIENT_LAZY=YES
+ * against a server in this process.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <iostream>
+#include <algorithm>
+#include <vector>
+
+#include <epicsStdlib.h>
+#include <epicsGetopt.h>
+#include <epicsTime.h>
+
+#include <pv/pvData.h>
+#include <pv/configuration.h>
+#include <pv/serverContext.h>
+#include <pva/sharedstate.h>
+#include <pva/client.h>
+
+namespace pvd = epics::pvData;
+namespace pva = epics::pvAccess;
+
+namespace {
+
+void usage()
+{
+    fprintf(stderr, "\nUsage: testStartupPerformance [options]\n\n"
+            "  -h:             Help: Print this message\n"
+            "  -i <count>:     Number of get()s for each mode.  default 100\n"
+            "  -w <sec>:       Timeout for each get().  default 5.0\n"
+            "\n");
+}
+
+struct Stats {
+    std::vector<double> samples;
+
+    void show(const char *name)
+    {
+        if(samples.empty())
+            return;
+        std::sort(samples.begin(), samples.end());
+        double sum = 0.0;
+        for(size_t i=0; i<samples.size(); i++)
+            sum += samples[i];
+        printf("%-8s n=%zu mean=%.3f ms min=%.3f ms median=%.3f ms max=%.3f ms\n",
+               name, samples.size(),
+               1e3*sum/samples.size(),
+               1e3*samples.front(),
+               1e3*samples[samples.size()/2],
+               1e3*samples.back());
+    }
+};
+
+void getOnce(Stats& stats, const pva::ServerContext::shared_pointer& server,
+             bool lazy, double timeout)
+{
+    epicsTime start(epicsTime::getCurrent());
+    {
+        pvac::ClientProvider provider("pva", pva::ConfigurationBuilder()
+                                      .push_config(server->getCurrentConfig())
+                                      .add("EPICS_PVA_CLIENT_LAZY", lazy ? "YES" : "NO")
+                                      .push_map()
+                                      .build());
+
+        pvac::ClientChannel chan(provider.connect("startup:counter"));
+
+        chan.get(timeout);
+    }
+    stats.samples.push_back(epicsTime::getCurrent() - start);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    epicsUInt32 count = 100;
+    double timeout = 5.0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, ":hi:w:")) != -1) {
+        switch (opt) {
+        case 'h':
+            usage();
+            return 0;
+        case 'i':
+            if(epicsParseUInt32(optarg, &count, 0, NULL)) {
+                fprintf(stderr, "Invalid count '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'w':
+            if(epicsScanDouble(optarg, &timeout) != 1) {
+                fprintf(stderr, "Invalid timeout '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        default:
+            usage();
+            return 1;
+        }
+    }
+
+    try {
+        pvd::StructureConstPtr type(pvd::getFieldCreate()->createFieldBuilder()
+                                    ->add("value", pvd::pvInt)
+                                    ->createStructure());
+
+        pvas::SharedPV::shared_pointer pv(pvas::SharedPV::buildReadOnly());
+        pv->open(type);
+
+        pvas::StaticProvider provider("startup");
+        provider.add("startup:counter", pv);
+
+        // isolated server on random ports
+        pva::ServerContext::shared_pointer server(pva::ServerContext::create(
+                                                      pva::ServerContext::Config()
+                                                      .provider(provider.provider())
+                                                      .config(pva::ConfigurationBuilder()
+                                                              .add("EPICS_PVAS_INTF_ADDR_LIST", "127.0.0.1")
+                                                              .add("EPICS_PVA_ADDR_LIST", "127.0.0.1")
+                                                              .add("EPICS_PVA_AUTO_ADDR_LIST","0")
+                                                              .add("EPICS_PVA_SERVER_PORT", "0")
+                                                              .add("EPICS_PVA_BROADCAST_PORT", "0")
+                                                              .push_map()
+                                                              .build())));
+
+        Stats eager, lazy;
+
+        // alternate to spread out any drift
+        for(epicsUInt32 i=0; i<count; i++) {
+            getOnce(eager, server, false, timeout);
+            getOnce(lazy, server, true, timeout);
+        }
+
+        eager.show("eager");
+        lazy.show("lazy");
+
+    } catch(std::exception& e){
+        std::cerr<<"Error: "<<e.what()<<"\n";
+        return 1;
+    }
+    return 0;
+}
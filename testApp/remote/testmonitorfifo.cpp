@@ -793,11 +793,62 @@ void checkBadRequest()
     tester.testTimeline({});
 }
 
+void checkBudget()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+    pva::MonitorFIFO::Config conf;
+    conf.maxCount=4;
+    conf.defCount=4;
+
+    // each queued pvInt update is estimated as 4 bytes
+    pva::MonitorFIFO::setBudget(10u);
+
+    Tester tester(pvReqEmpty, &conf);
+
+    tester.connect(pvd::pvInt);
+    tester.mon->notify();
+    tester.mon->start();
+    tester.testTimeline({Tester::Connect});
+
+    tester.post(1);
+    tester.post(2);
+    tester.mon->notify(); // 8 bytes queued, under budget
+    tester.testTimeline({Tester::Event});
+
+    tester.post(3);
+    tester.mon->notify(); // 12 bytes queued, squash to 4
+    tester.testTimeline({});
+
+    pva::MonitorFIFO::BudgetStats stats;
+    pva::MonitorFIFO::getBudgetStats(stats);
+    testEqual(stats.queued, size_t(4u));
+    testEqual(stats.nsquash, size_t(1u));
+    testEqual(stats.nshed, size_t(0u));
+
+    testPop(*tester.mon, 3, true);
+    testEmpty(*tester.mon);
+
+    // a single update is over budget, so squashing can't help
+    pva::MonitorFIFO::setBudget(2u);
+
+    tester.post(4);
+    tester.mon->notify();
+    tester.testTimeline({Tester::Event, Tester::Unlisten});
+
+    pva::MonitorFIFO::getBudgetStats(stats);
+    testEqual(stats.queued, size_t(0u));
+    testEqual(stats.nshed, size_t(1u));
+
+    testEmpty(*tester.mon);
+
+    pva::MonitorFIFO::setBudget(0u);
+}
+
 } // namespace
 
 MAIN(testmonitorfifo)
 {
-    testPlan(189);
+    testPlan(202);
     checkPlain();
     checkAfterClose();
     checkReOpenLost();
@@ -808,6 +859,7 @@ MAIN(testmonitorfifo)
     checkSpam();
     checkCountdown();
     checkBadRequest();
+    checkBudget();
     return testDone();
 }
 
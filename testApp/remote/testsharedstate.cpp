@@ -3,11 +3,14 @@
  * found in the file LICENSE that is included with the distribution
  */
 
+#include <sstream>
+
 #include <pv/pvUnitTest.h>
 #include <testMain.h>
 
 #include <pva/client.h>
 #include <pva/sharedstate.h>
+#include <pva/group.h>
 #include <pv/current_function.h>
 //#include <pv/pvAccess.h>
 
@@ -186,16 +189,303 @@ void testPutRPC()
     testEqual(reply->getSubFieldT<pvd::PVScalar>("value")->getAs<pvd::uint32>(), 100u);
 }
 
+const pvd::StructureConstPtr imageType(pvd::getFieldCreate()->createFieldBuilder()
+                                       ->setId("epics:nt/NTNDArray:1.0")
+                                       ->addNestedUnion("value")
+                                           ->addArray("ubyteValue", pvd::pvUByte)
+                                           ->addArray("ushortValue", pvd::pvUShort)
+                                       ->endNested()
+                                       ->addNestedStructure("codec")
+                                           ->add("name", pvd::pvString)
+                                       ->endNested()
+                                       ->add("compressedSize", pvd::pvLong)
+                                       ->add("uncompressedSize", pvd::pvLong)
+                                       ->addNestedStructureArray("dimension")
+                                           ->setId("dimension_t")
+                                           ->add("size", pvd::pvInt)
+                                           ->add("offset", pvd::pvInt)
+                                           ->add("fullSize", pvd::pvInt)
+                                           ->add("binning", pvd::pvInt)
+                                           ->add("reverse", pvd::pvBoolean)
+                                       ->endNested()
+                                       ->add("uniqueId", pvd::pvInt)
+                                       ->createStructure());
+
+// 4x4 mono image with pixel value 10*y + x + base
+void postImage(pvas::SharedPV& pv, pvd::uint8 base)
+{
+    pvd::PVStructurePtr inst(pvd::getPVDataCreate()->createPVStructure(imageType));
+    pvd::BitSet changed;
+
+    pvd::PVUByteArray::svector pixels(16);
+    for(size_t y=0; y<4; y++)
+        for(size_t x=0; x<4; x++)
+            pixels[y*4+x] = pvd::uint8(10*y + x + base);
+    pvd::PVUnionPtr value(inst->getSubFieldT<pvd::PVUnion>("value"));
+    value->select<pvd::PVUByteArray>("ubyteValue")->replace(pvd::freeze(pixels));
+    changed.set(value->getFieldOffset());
+
+    pvd::PVStructureArrayPtr dimension(inst->getSubFieldT<pvd::PVStructureArray>("dimension"));
+    pvd::PVStructureArray::svector dims(2);
+    for(size_t i=0; i<2; i++) {
+        dims[i] = pvd::getPVDataCreate()->createPVStructure(dimension->getStructureArray()->getStructure());
+        dims[i]->getSubFieldT<pvd::PVScalar>("size")->putFrom<pvd::int32>(4);
+        dims[i]->getSubFieldT<pvd::PVScalar>("fullSize")->putFrom<pvd::int32>(4);
+        dims[i]->getSubFieldT<pvd::PVScalar>("binning")->putFrom<pvd::int32>(1);
+    }
+    dimension->replace(pvd::freeze(dims));
+    changed.set(dimension->getFieldOffset());
+
+    pv.post(*inst, changed);
+}
+
+std::string showPixels(pvac::MonitorSync& mon)
+{
+    std::ostringstream strm;
+    if(!mon.poll())
+        return "<no update>";
+    pvd::PVUByteArray::const_shared_pointer arr(mon.root->getSubFieldT<pvd::PVUnion>("value")->get<pvd::PVUByteArray>());
+    if(!arr)
+        return "<not ubyte>";
+    pvd::PVUByteArray::const_svector pixels(arr->view());
+    for(size_t i=0; i<pixels.size(); i++)
+        strm<<(i ? " " : "")<<unsigned(pixels[i]);
+    return strm.str();
+}
+
+pvd::int32 dimField(pvac::MonitorSync& mon, size_t idx, const char *name)
+{
+    pvd::PVStructureArray::const_svector dims(mon.root->getSubFieldT<pvd::PVStructureArray>("dimension")->view());
+    if(idx>=dims.size())
+        return -1;
+    return dims[idx]->getSubFieldT<pvd::PVScalar>(name)->getAs<pvd::int32>();
+}
+
+void testImageTransform()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    std::tr1::shared_ptr<pvas::StaticProvider> prov(new pvas::StaticProvider("test"));
+    std::tr1::shared_ptr<pvas::SharedPV> pv(pvas::SharedPV::buildReadOnly());
+
+    prov->add("pv:image", pv);
+
+    pv->open(imageType);
+    postImage(*pv, 0u);
+
+    pvac::ClientProvider cli(prov->provider());
+
+    pvac::ClientChannel chan(cli.connect("pv:image"));
+
+    pvac::MonitorSync roi(chan.monitor(pvd::createRequest("record[roi=1:1:2:2]field()")));
+    pvac::MonitorSync bin(chan.monitor(pvd::createRequest("record[bin=2]field()")));
+    pvac::MonitorSync bin2(chan.monitor(pvd::createRequest("record[bin=2:2]field(value)")));
+    pvac::MonitorSync dec(chan.monitor(pvd::createRequest("record[decimate=2]field()")));
+
+    testOk1(roi.test());
+    testEqual(showPixels(roi), "11 12 21 22");
+    testEqual(dimField(roi, 0, "size"), 2);
+    testEqual(dimField(roi, 1, "offset"), 1);
+
+    testOk1(bin.test());
+    testEqual(showPixels(bin), "5 7 25 27");
+    testEqual(dimField(bin, 0, "binning"), 2);
+
+    testOk1(bin2.test());
+    testEqual(showPixels(bin2), "5 7 25 27");
+    testOk(bin.root->getSubFieldT<pvd::PVUnion>("value")->get<pvd::PVUByteArray>()->view().data()
+           ==bin2.root->getSubFieldT<pvd::PVUnion>("value")->get<pvd::PVUByteArray>()->view().data(),
+           "Equivalent requests share one result");
+
+    testOk1(dec.test());
+    testEqual(showPixels(dec), "0 2 20 22");
+
+    postImage(*pv, 100u);
+
+    testOk1(roi.test());
+    testEqual(showPixels(roi), "111 112 121 122");
+
+    {
+        // image not re-computed, so not re-sent
+        pvd::PVStructurePtr inst(pvd::getPVDataCreate()->createPVStructure(imageType));
+        pvd::BitSet changed;
+        pvd::PVIntPtr uid(inst->getSubFieldT<pvd::PVInt>("uniqueId"));
+        uid->put(5);
+        changed.set(uid->getFieldOffset());
+        pv->post(*inst, changed);
+    }
+
+    testOk1(roi.test());
+    testOk1(roi.poll());
+    testOk(!roi.changed.get(roi.root->getSubFieldT<pvd::PVUnion>("value")->getFieldOffset()),
+           "value not changed");
+
+    pvac::MonitorSync bad(chan.monitor(pvd::createRequest("record[bin=0]field()")));
+    testOk1(bad.test());
+    testEqual(bad.event.event, pvac::MonitorEvent::Fail);
+}
+
+void postValue(pvas::SharedPV& pv, pvd::uint32 val)
+{
+    pvd::PVStructurePtr inst(pvd::getPVDataCreate()->createPVStructure(type));
+    pvd::BitSet changed;
+    pvd::PVScalarPtr value(inst->getSubFieldT<pvd::PVScalar>("value"));
+    value->putFrom<pvd::uint32>(val);
+    changed.set(value->getFieldOffset());
+    pv.post(*inst, changed);
+}
+
+std::string showValues(pvac::MonitorSync& mon)
+{
+    std::ostringstream strm;
+    if(mon.test()) {
+        while(mon.poll())
+            strm<<mon.root->getSubFieldT<pvd::PVScalar>("value")->getAs<pvd::uint32>()<<' ';
+    }
+    return strm.str();
+}
+
+void testHistory()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    std::tr1::shared_ptr<pvas::StaticProvider> prov(new pvas::StaticProvider("test"));
+    pvas::SharedPV::Config conf;
+    conf.historySize = 4u;
+    std::tr1::shared_ptr<pvas::SharedPV> pv(pvas::SharedPV::buildReadOnly(&conf));
+
+    prov->add("pv:hist", pv);
+
+    pv->open(type);
+    for(pvd::uint32 i=1u; i<=6u; i++)
+        postValue(*pv, i);
+
+    pvac::ClientProvider cli(prov->provider());
+
+    pvac::ClientChannel chan(cli.connect("pv:hist"));
+
+    pvac::MonitorSync plain(chan.monitor());
+    testEqual(showValues(plain), "6 ");
+
+    pvac::MonitorSync some(chan.monitor(pvd::createRequest("record[history=3]field()")));
+    testEqual(showValues(some), "4 5 6 ");
+
+    pvac::MonitorSync all(chan.monitor(pvd::createRequest("record[history=100]field()")));
+    testEqual(showValues(all), "3 4 5 6 ");
+
+    postValue(*pv, 7u);
+    testEqual(showValues(some), "7 ");
+
+    pvac::MonitorSync bad(chan.monitor(pvd::createRequest("record[history=many]field()")));
+    testOk1(bad.test());
+    testEqual(bad.event.event, pvac::MonitorEvent::Fail);
+}
+
+// a field is changed if it, or any enclosing structure, is marked
+const char* marked(const pvac::MonitorSync& mon, const pvd::PVField *fld)
+{
+    for(; fld; fld = fld->getParent()) {
+        if(mon.changed.get(fld->getFieldOffset()))
+            return "*";
+    }
+    return "";
+}
+
+// "a.value,b.value;" per update, marking changed values with '*'
+std::string showGroup(pvac::MonitorSync& mon)
+{
+    std::ostringstream strm;
+    if(mon.test()) {
+        while(mon.poll()) {
+            pvd::PVScalarPtr a(mon.root->getSubFieldT<pvd::PVScalar>("a.value")),
+                             b(mon.root->getSubFieldT<pvd::PVScalar>("b.value"));
+            strm<<a->getAs<pvd::uint32>()<<marked(mon, a.get())<<','
+                <<b->getAs<pvd::uint32>()<<marked(mon, b.get())<<';';
+        }
+    }
+    return strm.str();
+}
+
+void testGroup()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    std::tr1::shared_ptr<pvas::StaticProvider> prov(new pvas::StaticProvider("test"));
+    std::tr1::shared_ptr<pvas::SharedPV> a(pvas::SharedPV::buildReadOnly()),
+                                         b(pvas::SharedPV::buildReadOnly());
+    pvas::SharedPVGroup::shared_pointer grp(pvas::SharedPVGroup::build());
+
+    a->open(type);
+    b->open(type);
+    postValue(*a, 1u);
+
+    grp->add("a", a);
+    grp->add("b", b);
+    testThrows(std::logic_error, grp->add("a", b));
+    grp->open();
+    testOk1(grp->isOpen());
+    testThrows(std::logic_error, grp->add("c", b));
+
+    prov->add("pv:a", a);
+    prov->add("pv:grp", grp->pv());
+
+    pvac::ClientProvider cli(prov->provider());
+
+    pvac::ClientChannel chan(cli.connect("pv:grp"));
+    pvac::MonitorSync mon(chan.monitor());
+    testEqual(showGroup(mon), "1*,0*;");
+
+    pvac::ClientChannel chanA(cli.connect("pv:a"));
+    pvac::MonitorSync monA(chanA.monitor());
+    testEqual(showValues(monA), "1 ");
+
+    // outside of a Transaction, each member post is an update
+    postValue(*a, 2u);
+    postValue(*b, 3u);
+    testEqual(showGroup(mon), "2*,0;2,3*;");
+
+    {
+        pvas::SharedPVGroup::Transaction T(grp);
+        postValue(*a, 4u);
+        postValue(*b, 5u);
+        {
+            pvas::SharedPVGroup::Transaction T2(grp);
+            postValue(*a, 6u);
+        }
+        testEqual(showGroup(mon), "");
+    }
+    testEqual(showGroup(mon), "6*,5*;");
+    // members are updated as usual
+    testEqual(showValues(monA), "2 4 6 ");
+
+    // posts to the group itself are combined likewise
+    {
+        pvd::PVStructurePtr root(grp->pv()->build());
+        pvd::BitSet changed;
+        pvd::PVScalarPtr value(root->getSubFieldT<pvd::PVScalar>("b.value"));
+        value->putFrom<pvd::uint32>(7u);
+        changed.set(value->getFieldOffset());
+
+        pvas::SharedPVGroup::Transaction T(grp);
+        postValue(*a, 8u);
+        grp->post(*root, changed);
+    }
+    testEqual(showGroup(mon), "8*,7*;");
+}
+
 } // namespace
 
 MAIN(testsharedstate)
 {
-    testPlan(19);
+    testPlan(54);
     try {
         testNoClient();
         testGetMon();
         testPutRPCCancel();
         testPutRPC();
+        testImageTransform();
+        testHistory();
+        testGroup();
     }catch(std::exception& e){
         testAbort("Unexpected exception: %s", e.what());
     }
@@ -0,0 +1,130 @@
+/**
+ * Copyright - See the COPYRIGHT that is included with this distribution.
+ * pvAccessCPP is distributed subject to a Software License Agreement found
+ * in file LICENSE that is included with this distribution.
+ */
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+#include <epicsThread.h>
+#include <epicsEvent.h>
+
+#include <pv/pvUnitTest.h>
+#include <pv/pvData.h>
+#include <pv/scratchPool.h>
+
+namespace pvd = epics::pvData;
+using epics::pvAccess::ScratchPool;
+
+namespace {
+
+pvd::StructureConstPtr makeType(const char *name)
+{
+    return pvd::getFieldCreate()->createFieldBuilder()
+            ->add(name, pvd::pvDouble)
+            ->createStructure();
+}
+
+void testStructure()
+{
+    testDiag("testStructure()");
+
+    ScratchPool pool;
+    pvd::StructureConstPtr A(makeType("a")), B(makeType("b"));
+
+    const size_t hits = ScratchPool::num_hits, misses = ScratchPool::num_misses;
+
+    pvd::PVStructurePtr first(pool.structure(A));
+    testOk1(!!first && first->getStructure()==A);
+
+    // still referenced, so a new instance
+    pvd::PVStructurePtr second(pool.structure(A));
+    testOk1(!!second && second!=first);
+    testEqual(ScratchPool::num_misses - misses, 2u);
+
+    // released, so re-used
+    pvd::PVStructure* raw = first.get();
+    first->getSubFieldT<pvd::PVDouble>("a")->put(4.0);
+    first.reset();
+    first = pool.structure(A);
+    testEqual(first.get(), raw);
+    testEqual(ScratchPool::num_hits - hits, 1u);
+    // reset
+    testEqual(first->getSubFieldT<pvd::PVDouble>("a")->get(), 0.0);
+
+    // pooled by type
+    pvd::PVStructurePtr other(pool.structure(B));
+    testOk1(other->getStructure()==B);
+    testEqual(ScratchPool::num_misses - misses, 3u);
+}
+
+void testBitSet()
+{
+    testDiag("testBitSet()");
+
+    ScratchPool pool;
+
+    pvd::BitSet::shared_pointer bits(pool.bitSet(10u));
+    bits->set(3u);
+    pvd::BitSet* raw = bits.get();
+    bits.reset();
+
+    bits = pool.bitSet(10u);
+    testEqual(bits.get(), raw);
+    testOk1(bits->isEmpty());
+}
+
+struct OtherThread {
+    pvd::PVStructurePtr inst;
+    epicsEvent done;
+};
+
+void otherThread(void *raw)
+{
+    OtherThread *info = static_cast<OtherThread*>(raw);
+    info->inst.reset();
+    info->done.signal();
+}
+
+void testRelease()
+{
+    testDiag("testRelease()");
+
+    pvd::StructureConstPtr A(makeType("a"));
+
+    {
+        ScratchPool pool;
+
+        // released by another thread
+        OtherThread info;
+        info.inst = pool.structure(A);
+        pvd::PVStructure* raw = info.inst.get();
+        epicsThreadMustCreate("testScratchPool", epicsThreadPriorityMedium,
+                              epicsThreadGetStackSize(epicsThreadStackSmall),
+                              &otherThread, &info);
+        info.done.wait();
+
+        testEqual(pool.structure(A).get(), raw);
+    }
+
+    // released after the pool
+    pvd::PVStructurePtr inst;
+    {
+        ScratchPool pool;
+        inst = pool.structure(A);
+    }
+    inst->getSubFieldT<pvd::PVDouble>("a")->put(1.0);
+    inst.reset();
+    testPass("Released after pool destroyed");
+}
+
+} // namespace
+
+MAIN(testScratchPool)
+{
+    testPlan(12);
+    testStructure();
+    testBitSet();
+    testRelease();
+    return testDone();
+}
@@ -0,0 +1,166 @@
+/**
+ * Copyright - See the COPYRIGHT that is included with this distribution.
+ * pvAccessCPP is distributed subject to a Software License Agreement found
+ * in file LICENSE that is included with this distribution.
+ */
+
+#include <stdexcept>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <pv/pvUnitTest.h>
+#include <pv/current_function.h>
+#include <pv/introspectionRegistry.h>
+
+namespace pvd = epics::pvData;
+namespace pva = epics::pvAccess;
+
+namespace {
+
+// stand in for a connection, both directions through one buffer
+struct Control : public pvd::SerializableControl, public pvd::DeserializableControl
+{
+    char storage[4096];
+    pvd::ByteBuffer buf;
+    pva::IntrospectionRegistry outgoing, incoming;
+
+    Control() :buf(storage, sizeof(storage)) {}
+    virtual ~Control() {}
+
+    virtual void flushSerializeBuffer() OVERRIDE FINAL {}
+    virtual void ensureBuffer(std::size_t size) OVERRIDE FINAL
+    {
+        if(buf.getRemaining()<size)
+            throw std::logic_error("Test buffer too small");
+    }
+    virtual void alignBuffer(std::size_t) OVERRIDE FINAL {}
+    virtual bool directSerialize(pvd::ByteBuffer *, const char*, std::size_t, std::size_t) OVERRIDE FINAL { return false; }
+    virtual void cachedSerialize(std::tr1::shared_ptr<const pvd::Field> const & field, pvd::ByteBuffer* buffer) OVERRIDE FINAL
+    {
+        outgoing.serialize(field, buffer, this);
+    }
+
+    virtual void ensureData(std::size_t size) OVERRIDE FINAL
+    {
+        if(buf.getRemaining()<size)
+            throw std::runtime_error("Truncated");
+    }
+    virtual void alignData(std::size_t) OVERRIDE FINAL {}
+    virtual bool directDeserialize(pvd::ByteBuffer *, char*, std::size_t, std::size_t) OVERRIDE FINAL { return false; }
+    virtual std::tr1::shared_ptr<const pvd::Field> cachedDeserialize(pvd::ByteBuffer* buffer) OVERRIDE FINAL
+    {
+        return incoming.deserialize(buffer, this);
+    }
+
+    // send one type, and return it as received
+    pvd::FieldConstPtr roundTrip(const pvd::FieldConstPtr& field, pvd::int8 *typeCode=0)
+    {
+        buf.clear();
+        cachedSerialize(field, &buf);
+        buf.flip();
+        if(typeCode)
+            *typeCode = buf.getBuffer()[0];
+        return cachedDeserialize(&buf);
+    }
+};
+
+pvd::StructureConstPtr buildType(const char *id)
+{
+    return pvd::getFieldCreate()->createFieldBuilder()
+            ->setId(id)
+            ->add("value", pvd::pvDouble)
+            ->addNestedStructure("alarm")
+                ->add("severity", pvd::pvInt)
+                ->add("message", pvd::pvString)
+            ->endNested()
+            ->createStructure();
+}
+
+void testHash()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    pvd::StructureConstPtr A(buildType("a_t")), A2(buildType("a_t")), B(buildType("b_t"));
+
+    testOk1(A.get()!=A2.get());
+    testEqual(pva::TypeDictionary::hash(*A), pva::TypeDictionary::hash(*A2));
+    testOk1(pva::TypeDictionary::hash(*A)!=pva::TypeDictionary::hash(*B));
+}
+
+void testClients()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    // one for all servers, and so bounded by maxSize
+    testOk1(!!pva::TypeDictionary::clients());
+    testOk1(pva::TypeDictionary::clients()==pva::TypeDictionary::clients());
+}
+
+void testReconnect()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    pvd::StructureConstPtr A(buildType("a_t")), B(buildType("b_t"));
+    pva::TypeDictionary::shared_pointer dict(new pva::TypeDictionary);
+    pvd::int8 code = 0;
+
+    {
+        // first connection learns types sent in full
+        Control conn;
+        conn.incoming.setDictionary(dict);
+
+        pvd::FieldConstPtr rx(conn.roundTrip(A, &code));
+        testEqual(code, pva::IntrospectionRegistry::FULL_WITH_ID_TYPE_CODE);
+        testOk1(!!rx && *rx==*A);
+        testOk1(!!dict->find(pva::TypeDictionary::hash(*A)));
+        // also sub-structure "alarm"
+        testEqual(dict->size(), 2u);
+    }
+    {
+        // reconnect, after the peer learns what we know
+        Control conn;
+        conn.incoming.setDictionary(dict);
+        pva::TypeDictionary::hashes_t known;
+        dict->hashes(known);
+        conn.outgoing.setPeerHashes(known);
+
+        pvd::FieldConstPtr rx(conn.roundTrip(A, &code));
+        testEqual(code, pva::IntrospectionRegistry::ONLY_HASH_TYPE_CODE);
+        testOk1(rx==dict->find(pva::TypeDictionary::hash(*A)));
+        testEqual(conn.buf.getPosition(), 1u+2u+8u);
+
+        // later references use the ID as usual
+        rx = conn.roundTrip(A, &code);
+        testEqual(code, pva::IntrospectionRegistry::ONLY_ID_TYPE_CODE);
+        testOk1(!!rx && *rx==*A);
+
+        // new types are still sent in full
+        rx = conn.roundTrip(B, &code);
+        testEqual(code, pva::IntrospectionRegistry::FULL_WITH_ID_TYPE_CODE);
+        testOk1(!!rx && *rx==*B);
+    }
+    {
+        // a hash which the receiver doesn't know is a protocol error
+        Control conn;
+        pva::TypeDictionary::hashes_t known(1, pva::TypeDictionary::hash(*A));
+        conn.outgoing.setPeerHashes(known);
+
+        testThrows(std::runtime_error, conn.roundTrip(A));
+    }
+}
+
+} // namespace
+
+MAIN(testTypeDictionary)
+{
+    testPlan(17);
+    try {
+        testHash();
+        testClients();
+        testReconnect();
+    }catch(std::exception& e){
+        testAbort("Unexpected exception: %s", e.what());
+    }
+    return testDone();
+}